@@ -0,0 +1,220 @@
+/* ASCII case conversion, character classes and tokenizing using ARM NEON
+ */
+
+#include <string.h>
+#include "arm_neon.h"
+#include "ascii.h"
+#include "neon_util.h"
+#include "stream.h"
+
+
+// lanes in [lo, hi] are set to 0xff
+static inline uint8x16_t in_range(uint8x16_t v, uint8_t lo, uint8_t hi) {
+    // v: vector
+    // cge / cle: compare greater-than or equal / less-than or equal
+    return vandq_u8(vcgeq_u8(v, vdupq_n_u8(lo)), vcleq_u8(v, vdupq_n_u8(hi)));
+}
+
+
+static inline uint8x16_t class_mask(uint8x16_t v, unsigned classes) {
+    uint8x16_t mask = vdupq_n_u8(0);
+
+    if(classes & ASCII_CLASS_DIGIT) {
+        mask = vorrq_u8(mask, in_range(v, '0', '9'));
+    }
+    if(classes & ASCII_CLASS_ALPHA) {
+        // setting bit 5 maps A-Z onto a-z and nothing else onto a-z
+        mask = vorrq_u8(mask, in_range(vorrq_u8(v, vdupq_n_u8(0x20)), 'a', 'z'));
+    }
+    if(classes & ASCII_CLASS_SPACE) {
+        mask = vorrq_u8(mask, vceqq_u8(v, vdupq_n_u8(' ')));
+        mask = vorrq_u8(mask, in_range(v, '\t', '\r'));
+    }
+
+    return mask;
+}
+
+
+static inline int class_scalar(uint8_t c, unsigned classes) {
+    return ((classes & ASCII_CLASS_DIGIT) && c >= '0' && c <= '9') ||
+           ((classes & ASCII_CLASS_ALPHA) && (c | 0x20) >= 'a' && (c | 0x20) <= 'z') ||
+           ((classes & ASCII_CLASS_SPACE) && (c == ' ' || (c >= '\t' && c <= '\r')));
+}
+
+
+void ascii_toupper(const uint8_t *in, size_t n, uint8_t *out) {
+    size_t i = 0;
+    size_t distance = stream_settings.prefetch_distance;
+    int nontemporal = stream_nontemporal(2 * n);
+    uint8x16_t vector_case = vdupq_n_u8(0x20);
+
+    for(; i + 32 <= n; i += 32) {
+        uint8x16_t vector_data0 = vld1q_u8(in + i);
+        uint8x16_t vector_data1 = vld1q_u8(in + i + 16);
+        uint8x16_t is_lower0 = in_range(vector_data0, 'a', 'z');
+        uint8x16_t is_lower1 = in_range(vector_data1, 'a', 'z');
+
+        stream_prefetch_ahead(in + i, distance);
+        stream_store_u8x16x2(out + i,
+                             vbslq_u8(is_lower0, vbicq_u8(vector_data0, vector_case), vector_data0),
+                             vbslq_u8(is_lower1, vbicq_u8(vector_data1, vector_case), vector_data1),
+                             nontemporal);
+    }
+    for(; i + 16 <= n; i += 16) {
+        uint8x16_t vector_data = vld1q_u8(in + i);
+        uint8x16_t is_lower = in_range(vector_data, 'a', 'z');
+
+        // v: vector
+        // bsl: bit select (mask ? a : b)
+        // bic: clear bit 5 in the selected lanes
+        vst1q_u8(out + i, vbslq_u8(is_lower, vbicq_u8(vector_data, vector_case), vector_data));
+    }
+
+    for(; i < n; i++) {
+        uint8_t c = in[i];
+        out[i] = (uint8_t)(c >= 'a' && c <= 'z' ? c & ~0x20 : c);
+    }
+}
+
+
+void ascii_tolower(const uint8_t *in, size_t n, uint8_t *out) {
+    size_t i = 0;
+    size_t distance = stream_settings.prefetch_distance;
+    int nontemporal = stream_nontemporal(2 * n);
+    uint8x16_t vector_case = vdupq_n_u8(0x20);
+
+    for(; i + 32 <= n; i += 32) {
+        uint8x16_t vector_data0 = vld1q_u8(in + i);
+        uint8x16_t vector_data1 = vld1q_u8(in + i + 16);
+        uint8x16_t is_upper0 = in_range(vector_data0, 'A', 'Z');
+        uint8x16_t is_upper1 = in_range(vector_data1, 'A', 'Z');
+
+        stream_prefetch_ahead(in + i, distance);
+        stream_store_u8x16x2(out + i,
+                             vbslq_u8(is_upper0, vorrq_u8(vector_data0, vector_case), vector_data0),
+                             vbslq_u8(is_upper1, vorrq_u8(vector_data1, vector_case), vector_data1),
+                             nontemporal);
+    }
+    for(; i + 16 <= n; i += 16) {
+        uint8x16_t vector_data = vld1q_u8(in + i);
+        uint8x16_t is_upper = in_range(vector_data, 'A', 'Z');
+
+        // v: vector
+        // orr: logical or, sets bit 5 in the selected lanes
+        vst1q_u8(out + i, vbslq_u8(is_upper, vorrq_u8(vector_data, vector_case), vector_data));
+    }
+
+    for(; i < n; i++) {
+        uint8_t c = in[i];
+        out[i] = (uint8_t)(c >= 'A' && c <= 'Z' ? c | 0x20 : c);
+    }
+}
+
+
+int ascii_equal_ignore_case(const uint8_t *a, const uint8_t *b, size_t n) {
+    size_t i = 0;
+    uint8x16_t vector_case = vdupq_n_u8(0x20);
+    uint8x16_t vector_diff = vdupq_n_u8(0);
+
+    for(; i + 16 <= n; i += 16) {
+        uint8x16_t vector_a = vld1q_u8(a + i);
+        uint8x16_t vector_b = vld1q_u8(b + i);
+        uint8x16_t is_alpha;
+
+        // the bytes may only differ in bit 5 and only where a is a letter
+        uint8x16_t vector_xor = veorq_u8(vector_a, vector_b);
+        is_alpha = in_range(vorrq_u8(vector_a, vector_case), 'a', 'z');
+        vector_xor = vbicq_u8(vector_xor, vandq_u8(is_alpha, vector_case));
+
+        vector_diff = vorrq_u8(vector_diff, vector_xor);
+
+        // early exit, checked once every 256 bytes
+        if((i & 0xff) == 0xf0 && max_u8x16(vector_diff) != 0) {
+            return 0;
+        }
+    }
+    if(max_u8x16(vector_diff) != 0) {
+        return 0;
+    }
+
+    for(; i < n; i++) {
+        uint8_t ca = a[i], cb = b[i];
+        if(ca >= 'A' && ca <= 'Z') {
+            ca |= 0x20;
+        }
+        if(cb >= 'A' && cb <= 'Z') {
+            cb |= 0x20;
+        }
+        if(ca != cb) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+void ascii_class_bitmap(const uint8_t *in, size_t n, unsigned classes, uint8_t *bitmap) {
+    size_t i = 0;
+
+    for(; i + 16 <= n; i += 16) {
+        uint16_t word = movemask_u8x16(class_mask(vld1q_u8(in + i), classes));
+        memcpy(bitmap + i / 8, &word, 2);
+    }
+
+    if(i < n) {
+        memset(bitmap + i / 8, 0, (n - i + 7) / 8);
+        for(; i < n; i++) {
+            if(class_scalar(in[i], classes)) {
+                bitmap[i / 8] |= (uint8_t)(1u << (i % 8));
+            }
+        }
+    }
+}
+
+
+size_t ascii_tokenize(const uint8_t *in, size_t n, unsigned classes,
+                      uint8_t *starts, uint8_t *ends) {
+    size_t i, tokens = 0;
+    uint8x16_t prev_mask = vdupq_n_u8(0);
+
+    for(i = 0; i < n; i += 16) {
+        uint8x16_t vector_data, mask, prev;
+        uint16_t word_start, word_end;
+        uint8_t block[16];
+        size_t bytes = n - i < 16 ? n - i : 16;
+
+        // the last block is padded with zeros, which are in no class
+        if(bytes == 16) {
+            vector_data = vld1q_u8(in + i);
+        } else {
+            memset(block, 0, sizeof(block));
+            memcpy(block, in + i, bytes);
+            vector_data = vld1q_u8(block);
+        }
+
+        mask = class_mask(vector_data, classes);
+
+        // mask of the preceding byte of every lane
+        prev = vextq_u8(prev_mask, mask, 15);
+
+        // start: in a token, predecessor is not; end: the other way round
+        word_start = movemask_u8x16(vbicq_u8(mask, prev));
+        word_end = movemask_u8x16(vbicq_u8(prev, mask));
+
+        if(bytes < 16) {
+            // padding lanes must not report the end of the last token
+            word_end &= (uint16_t)((1u << bytes) - 1);
+        }
+
+        memcpy(block, &word_start, 2);
+        memcpy(starts + i / 8, block, (bytes + 7) / 8);
+        memcpy(block, &word_end, 2);
+        memcpy(ends + i / 8, block, (bytes + 7) / 8);
+
+        tokens += (size_t)__builtin_popcount(word_start);
+        prev_mask = mask;
+    }
+
+    return tokens;
+}
@@ -0,0 +1,37 @@
+/* ASCII case conversion, character classes and tokenizing using ARM NEON
+ *
+ * Bitmaps are LSB-first: bit i (bit i % 8 of byte i / 8) describes input
+ * byte i, a bitmap for n bytes is (n + 7) / 8 bytes long. Bytes above 0x7f
+ * belong to no class and are never case converted.
+ */
+
+#ifndef ASCII_H
+#define ASCII_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// character classes, can be combined
+#define ASCII_CLASS_DIGIT 0x1  // 0-9
+#define ASCII_CLASS_ALPHA 0x2  // A-Z a-z
+#define ASCII_CLASS_SPACE 0x4  // space, \t \n \v \f \r
+#define ASCII_CLASS_ALNUM (ASCII_CLASS_DIGIT | ASCII_CLASS_ALPHA)
+
+// in == out is allowed
+void ascii_toupper(const uint8_t *in, size_t n, uint8_t *out);
+void ascii_tolower(const uint8_t *in, size_t n, uint8_t *out);
+
+// returns 1 if a and b are equal ignoring ASCII case, 0 otherwise
+int ascii_equal_ignore_case(const uint8_t *a, const uint8_t *b, size_t n);
+
+// sets bit i of bitmap if byte i is in any of the given classes
+void ascii_class_bitmap(const uint8_t *in, size_t n, unsigned classes, uint8_t *bitmap);
+
+// splits the input into tokens, maximal runs of bytes in the given classes:
+// starts gets a bit at the first byte of every token, ends a bit at the byte
+// following it (no bit for a token that reaches the end of the input)
+// returns the number of tokens
+size_t ascii_tokenize(const uint8_t *in, size_t n, unsigned classes,
+                      uint8_t *starts, uint8_t *ends);
+
+#endif
@@ -0,0 +1,285 @@
+/* Mixing, gain and filter kernels for 16-Bit signed integer audio using
+ * ARM NEON
+ */
+
+#include <string.h>
+#include "arm_neon.h"
+#include "audio.h"
+
+
+static inline int32_t saturate_s32(int64_t x) {
+    return x > INT32_MAX ? INT32_MAX : x < INT32_MIN ? INT32_MIN : (int32_t)x;
+}
+
+
+static inline int16_t saturate_s16(int64_t x) {
+    return x > INT16_MAX ? INT16_MAX : x < INT16_MIN ? INT16_MIN : (int16_t)x;
+}
+
+
+// scalar vqrshrn_n_s32
+static inline int16_t round_narrow(int32_t acc, int shift) {
+    return saturate_s16(((int64_t)acc + (1 << (shift - 1))) >> shift);
+}
+
+
+void audio_mix_s16(const int16_t *const *inputs, const int16_t *gains, unsigned count, size_t n, int16_t *out) {
+    size_t i = 0;
+    unsigned j;
+
+    for(; i + 8 <= n; i += 8) {
+        int32x4_t acc_low = vdupq_n_s32(0), acc_high = vdupq_n_s32(0);
+
+        if(gains == NULL) {
+            for(j = 0; j < count; j++) {
+                int16x8_t x = vld1q_s16(inputs[j] + i);
+
+                // v: vector
+                // addw: add 16-bit lanes to 32-bit lanes (widening), the sum
+                // of up to 65536 inputs cannot overflow
+                acc_low = vaddw_s16(acc_low, vget_low_s16(x));
+                acc_high = vaddw_s16(acc_high, vget_high_s16(x));
+            }
+            // qmovn: narrow to 16-bit lanes with saturation
+            vst1q_s16(out + i, vcombine_s16(vqmovn_s32(acc_low), vqmovn_s32(acc_high)));
+        } else {
+            for(j = 0; j < count; j++) {
+                int16x8_t x = vld1q_s16(inputs[j] + i);
+
+                // qdmlal_n: acc + 2 * x * gain with saturation, Q15 * Q15
+                // products become Q31
+                acc_low = vqdmlal_n_s16(acc_low, vget_low_s16(x), gains[j]);
+                acc_high = vqdmlal_n_s16(acc_high, vget_high_s16(x), gains[j]);
+            }
+            // qrshrn_n: round, shift right and narrow with saturation, Q31
+            // back to Q15
+            vst1q_s16(out + i, vcombine_s16(vqrshrn_n_s32(acc_low, 16), vqrshrn_n_s32(acc_high, 16)));
+        }
+    }
+
+    for(; i < n; i++) {
+        int64_t sum = 0;
+        int32_t acc = 0;
+
+        if(gains == NULL) {
+            for(j = 0; j < count; j++) {
+                sum += inputs[j][i];
+            }
+            out[i] = saturate_s16(sum);
+        } else {
+            for(j = 0; j < count; j++) {
+                acc = saturate_s32((int64_t)acc + saturate_s32(2 * (int64_t)inputs[j][i] * gains[j]));
+            }
+            out[i] = round_narrow(acc, 16);
+        }
+    }
+}
+
+
+void audio_gain_ramp_s16(const int16_t *in, size_t n, int16_t gain_start, int16_t gain_end, int16_t *out) {
+    size_t i = 0;
+    // the gain in Q15.16, start + step * i stays between both gains
+    int32_t start = (int32_t)gain_start * 65536;
+    int32_t step = n > 0 ? (int32_t)(((int64_t)gain_end - gain_start) * 65536 / (int64_t)n) : 0;
+    // multiples of the step may exceed int32_t, they wrap like the lanes do
+    uint32_t step_bits = (uint32_t)step;
+    uint32_t offsets_low[4] = {0, step_bits, 2 * step_bits, 3 * step_bits};
+    int32x4_t gain_low = vaddq_s32(vdupq_n_s32(start), vreinterpretq_s32_u32(vld1q_u32(offsets_low)));
+    int32x4_t gain_high = vaddq_s32(gain_low, vreinterpretq_s32_u32(vdupq_n_u32(4 * step_bits)));
+    int32x4_t increment = vreinterpretq_s32_u32(vdupq_n_u32(8 * step_bits));
+
+    for(; i + 8 <= n; i += 8) {
+        // v: vector
+        // shrn_n: shift right and narrow, the integer part of the gain
+        int16x8_t gain = vcombine_s16(vshrn_n_s32(gain_low, 16), vshrn_n_s32(gain_high, 16));
+
+        // qrdmulh: (2 * x * gain + 2^15) >> 16 with saturation
+        vst1q_s16(out + i, vqrdmulhq_s16(vld1q_s16(in + i), gain));
+        gain_low = vaddq_s32(gain_low, increment);
+        gain_high = vaddq_s32(gain_high, increment);
+    }
+
+    for(; i < n; i++) {
+        int16_t gain = (int16_t)((start + step * (int64_t)i) >> 16);
+        out[i] = saturate_s16((2 * (int64_t)in[i] * gain + (1 << 15)) >> 16);
+    }
+}
+
+
+void audio_deinterleave_s16(const int16_t *in, size_t frames, int16_t *left, int16_t *right) {
+    size_t i = 0;
+
+    for(; i + 8 <= frames; i += 8) {
+        // v: vector
+        // uzp: unzip, even lanes of both vectors into val[0], odd ones into
+        // val[1]
+        int16x8x2_t channels = vuzpq_s16(vld1q_s16(in + 2 * i), vld1q_s16(in + 2 * i + 8));
+
+        vst1q_s16(left + i, channels.val[0]);
+        vst1q_s16(right + i, channels.val[1]);
+    }
+
+    for(; i < frames; i++) {
+        left[i] = in[2 * i];
+        right[i] = in[2 * i + 1];
+    }
+}
+
+
+void audio_interleave_s16(const int16_t *left, const int16_t *right, size_t frames, int16_t *out) {
+    size_t i = 0;
+
+    for(; i + 8 <= frames; i += 8) {
+        // zip: interleave the lanes of both vectors, low halves into val[0],
+        // high halves into val[1]
+        int16x8x2_t samples = vzipq_s16(vld1q_s16(left + i), vld1q_s16(right + i));
+
+        vst1q_s16(out + 2 * i, samples.val[0]);
+        vst1q_s16(out + 2 * i + 8, samples.val[1]);
+    }
+
+    for(; i < frames; i++) {
+        out[2 * i] = left[i];
+        out[2 * i + 1] = right[i];
+    }
+}
+
+
+int audio_fir_init(audio_fir *fir, const int16_t *taps, unsigned count) {
+    if(count == 0 || count > AUDIO_FIR_MAX_TAPS) {
+        return -1;
+    }
+    memcpy(fir->taps, taps, count * sizeof(int16_t));
+    fir->count = count;
+    memset(fir->line, 0, sizeof(fir->line));
+    return 0;
+}
+
+
+void audio_fir_process(audio_fir *fir, const int16_t *in, size_t n, int16_t *out) {
+    unsigned count = fir->count, k;
+    int16_t *line = fir->line;
+    const int16_t *x = line + count - 1;
+    size_t done, i, m;
+
+    // the chunk follows the history in the delay line, so every output sees
+    // its count inputs in one contiguous run
+    for(done = 0; done < n; done += m) {
+        m = n - done < AUDIO_FIR_CHUNK ? n - done : AUDIO_FIR_CHUNK;
+        memcpy(line + count - 1, in + done, m * sizeof(int16_t));
+
+        for(i = 0; i + 8 <= m; i += 8) {
+            int32x4_t acc_low = vdupq_n_s32(0), acc_high = vdupq_n_s32(0);
+
+            for(k = 0; k < count; k++) {
+                int16x8_t v = vld1q_s16(x + i - k);
+
+                // v: vector
+                // mlal_n: multiply-accumulate long by a scalar, 16-bit lanes
+                // times the tap added to 32-bit lanes
+                acc_low = vmlal_n_s16(acc_low, vget_low_s16(v), fir->taps[k]);
+                acc_high = vmlal_n_s16(acc_high, vget_high_s16(v), fir->taps[k]);
+            }
+            vst1q_s16(out + done + i, vcombine_s16(vqrshrn_n_s32(acc_low, 15), vqrshrn_n_s32(acc_high, 15)));
+        }
+
+        for(; i < m; i++) {
+            uint32_t acc = 0;
+
+            for(k = 0; k < count; k++) {
+                acc += (uint32_t)(fir->taps[k] * x[i - k]);
+            }
+            out[done + i] = round_narrow((int32_t)acc, 15);
+        }
+
+        memmove(line, line + m, (count - 1) * sizeof(int16_t));
+    }
+}
+
+
+int audio_biquad_init(audio_biquad *biquad, const audio_biquad_coeffs *stages, unsigned count, unsigned channels) {
+    if(count == 0 || count > AUDIO_BIQUAD_MAX_STAGES || channels == 0 || channels > AUDIO_MAX_CHANNELS) {
+        return -1;
+    }
+    memcpy(biquad->stages, stages, count * sizeof(audio_biquad_coeffs));
+    biquad->count = count;
+    biquad->channels = channels;
+    memset(biquad->state, 0, sizeof(biquad->state));
+    return 0;
+}
+
+
+// the first lanes channels of a frame, the other lanes zero
+static inline int16x4_t load_channels(const int16_t *p, unsigned lanes) {
+    int16_t padded[4] = {0};
+
+    if(lanes == 4) {
+        return vld1_s16(p);
+    }
+    memcpy(padded, p, lanes * sizeof(int16_t));
+    return vld1_s16(padded);
+}
+
+static inline void store_channels(int16_t *p, int16x4_t x, unsigned lanes) {
+    int16_t padded[4];
+
+    if(lanes == 4) {
+        vst1_s16(p, x);
+        return;
+    }
+    vst1_s16(padded, x);
+    memcpy(p, padded, lanes * sizeof(int16_t));
+}
+
+
+void audio_biquad_process(audio_biquad *biquad, const int16_t *in, size_t frames, int16_t *out) {
+    unsigned channels = biquad->channels, count = biquad->count;
+    unsigned c, j, r;
+    size_t f;
+
+    // the recursion runs along the frames, the vectors hold 4 channels; the
+    // last group of 1 to 3 channels (mono, stereo, ...) is padded to 4 lanes
+    for(c = 0; c < channels; c += 4) {
+        unsigned lanes = channels - c < 4 ? channels - c : 4;
+        int16x4_t state[AUDIO_BIQUAD_MAX_STAGES][4];
+
+        for(j = 0; j < count; j++) {
+            for(r = 0; r < 4; r++) {
+                state[j][r] = load_channels(&biquad->state[j][r][c], lanes);
+            }
+        }
+
+        for(f = 0; f < frames; f++) {
+            int16x4_t x = load_channels(in + f * channels + c, lanes);
+
+            for(j = 0; j < count; j++) {
+                const audio_biquad_coeffs *k = &biquad->stages[j];
+                int32x4_t acc;
+
+                // v: vector
+                // mull_n/mlal_n/mlsl_n: multiply (-accumulate/-subtract)
+                // long by a scalar, 16-bit lanes into 32-bit lanes
+                acc = vmull_n_s16(x, k->b0);
+                acc = vmlal_n_s16(acc, state[j][0], k->b1);
+                acc = vmlal_n_s16(acc, state[j][1], k->b2);
+                acc = vmlsl_n_s16(acc, state[j][2], k->a1);
+                acc = vmlsl_n_s16(acc, state[j][3], k->a2);
+
+                state[j][1] = state[j][0];
+                state[j][0] = x;
+                state[j][3] = state[j][2];
+                // qrshrn_n: Q14 coefficients, round and narrow with
+                // saturation back to Q15 samples
+                x = vqrshrn_n_s32(acc, 14);
+                state[j][2] = x;
+            }
+            store_channels(out + f * channels + c, x, lanes);
+        }
+
+        for(j = 0; j < count; j++) {
+            for(r = 0; r < 4; r++) {
+                store_channels(&biquad->state[j][r][c], state[j][r], lanes);
+            }
+        }
+    }
+}
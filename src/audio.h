@@ -0,0 +1,73 @@
+/* Mixing, gain and filter kernels for 16-Bit signed integer audio using
+ * ARM NEON
+ *
+ * Samples are Q15 fixed point (-1.0 to 1 - 2^-15), gains and FIR taps are
+ * Q15, biquad coefficients Q14 (-2.0 to 2 - 2^-14). Results saturate to the
+ * 16-bit range; the accumulators of the filters are 32-bit and wrap, which
+ * is out of reach for filters with a gain of at most 1 (sum of |taps| at
+ * most 1.0, stable biquads).
+ *
+ * The filters keep their history in the state structures, so a stream can
+ * be processed in blocks of any length with the same result as at once.
+ * in == out (and out == inputs[j]) is allowed except for the stereo
+ * (de)interleaving.
+ */
+
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AUDIO_FIR_MAX_TAPS     128
+#define AUDIO_FIR_CHUNK        256
+#define AUDIO_BIQUAD_MAX_STAGES 8
+#define AUDIO_MAX_CHANNELS     32
+
+// out = saturate(sum of the count inputs[j]), gains[j] (Q15) scale input j
+// if gains is not NULL, the sum then saturates after every input like
+// vqdmlal
+void audio_mix_s16(const int16_t *const *inputs, const int16_t *gains, unsigned count, size_t n, int16_t *out);
+
+// out[i] = in[i] * gain (vqrdmulh), the Q15 gain moves linearly from
+// gain_start at i = 0 towards gain_end, reached after n samples
+void audio_gain_ramp_s16(const int16_t *in, size_t n, int16_t gain_start, int16_t gain_end, int16_t *out);
+
+// stereo frames (left, right, left, ...) to planar channels and back
+void audio_deinterleave_s16(const int16_t *in, size_t frames, int16_t *left, int16_t *right);
+void audio_interleave_s16(const int16_t *left, const int16_t *right, size_t frames, int16_t *out);
+
+typedef struct {
+    int16_t taps[AUDIO_FIR_MAX_TAPS];
+    unsigned count;
+    // the last count - 1 input samples followed by the current chunk
+    int16_t line[AUDIO_FIR_MAX_TAPS - 1 + AUDIO_FIR_CHUNK];
+} audio_fir;
+
+// out[i] = sum of taps[k] * in[i - k], in[i] of earlier blocks for i < 0,
+// zero before the first block; init returns 0 or -1 for 0 or more than
+// AUDIO_FIR_MAX_TAPS taps
+int audio_fir_init(audio_fir *fir, const int16_t *taps, unsigned count);
+void audio_fir_process(audio_fir *fir, const int16_t *in, size_t n, int16_t *out);
+
+// y = b0 x + b1 x[-1] + b2 x[-2] - a1 y[-1] - a2 y[-2] (direct form I)
+typedef struct {
+    int16_t b0, b1, b2, a1, a2;
+} audio_biquad_coeffs;
+
+typedef struct {
+    audio_biquad_coeffs stages[AUDIO_BIQUAD_MAX_STAGES];
+    unsigned count;
+    unsigned channels;
+    // x[-1], x[-2], y[-1], y[-2] of every stage and channel
+    int16_t state[AUDIO_BIQUAD_MAX_STAGES][4][AUDIO_MAX_CHANNELS];
+} audio_biquad;
+
+// a cascade of count stages applied to every channel of interleaved
+// frames, 4 channels per vector (the last 1 to 3 channels padded to a
+// vector, so mono and stereo run vectorized as well); init returns 0 or -1
+// for unsupported stage or channel counts
+int audio_biquad_init(audio_biquad *biquad, const audio_biquad_coeffs *stages, unsigned count, unsigned channels);
+void audio_biquad_process(audio_biquad *biquad, const int16_t *in, size_t frames, int16_t *out);
+
+#endif
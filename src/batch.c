@@ -0,0 +1,334 @@
+/* Batched popcount, compare, SAD and Adler-32 over many small records
+ * using ARM NEON
+ */
+
+#include <string.h>
+#include "arm_neon.h"
+#include "batch.h"
+#include "checksum.h"
+#include "stream.h"
+
+// descriptors between the record processed and the one prefetched
+#define BATCH_PREFETCH 4
+
+#define ADLER32_MOD 65521
+// the lanes of the Adler-32 prefix sums cannot wrap up to this length
+#define ADLER32_MAX_RECORD 4096
+
+
+static inline uint32_t sum_u32x4(uint32x4_t v) {
+    // v: vector
+    // padd: pairwise addition (d registers only)
+    uint32x2_t sum = vpadd_u32(vget_low_u32(v), vget_high_u32(v));
+
+    return vget_lane_u32(vpadd_u32(sum, sum), 0);
+}
+
+
+// the last partial chunk of a record, zero padded
+static inline uint8x16_t load_partial(const uint8_t *data, size_t n) {
+    uint8_t tail[16] = {0};
+
+    memcpy(tail, data, n);
+    return vld1q_u8(tail);
+}
+
+
+// Every operation has a state with _init, _step (one 16-byte chunk of x,
+// and of y for the operations on two records) and _result (the record
+// length for the zero padding of the last chunk).
+
+typedef struct {
+    uint32x4_t sum;
+} popcount_state;
+
+static inline void popcount_init(popcount_state *s) {
+    s->sum = vdupq_n_u32(0);
+}
+
+static inline void popcount_step(popcount_state *s, uint8x16_t x, uint8x16_t y) {
+    (void)y;
+    // v: vector
+    // cnt: number of set bits per lane
+    // paddl/padal: pairwise addition (and accumulate) into lanes of twice
+    // the width
+    s->sum = vpadalq_u16(s->sum, vpaddlq_u8(vcntq_u8(x)));
+}
+
+static inline uint32_t popcount_result(const popcount_state *s, size_t n) {
+    (void)n;
+    return sum_u32x4(s->sum);
+}
+
+
+typedef struct {
+    uint8x16_t difference;
+} equal_state;
+
+static inline void equal_init(equal_state *s) {
+    s->difference = vdupq_n_u8(0);
+}
+
+static inline void equal_step(equal_state *s, uint8x16_t x, uint8x16_t y) {
+    // v: vector
+    // eor/orr: bitwise xor/or, the differing bits of all chunks
+    s->difference = vorrq_u8(s->difference, veorq_u8(x, y));
+}
+
+static inline uint8_t equal_result(const equal_state *s, size_t n) {
+    uint8x8_t folded = vorr_u8(vget_low_u8(s->difference), vget_high_u8(s->difference));
+
+    (void)n;
+    return vget_lane_u64(vreinterpret_u64_u8(folded), 0) == 0;
+}
+
+
+typedef struct {
+    uint32x4_t sum;
+} sad_state;
+
+static inline void sad_init(sad_state *s) {
+    s->sum = vdupq_n_u32(0);
+}
+
+static inline void sad_step(sad_state *s, uint8x16_t x, uint8x16_t y) {
+    // v: vector
+    // abd: absolute difference
+    s->sum = vpadalq_u16(s->sum, vpaddlq_u8(vabdq_u8(x, y)));
+}
+
+static inline uint32_t sad_result(const sad_state *s, size_t n) {
+    (void)n;
+    return sum_u32x4(s->sum);
+}
+
+
+// s1 sums the bytes, s2 the byte sums before every chunk (each of those
+// bytes is 16 positions further from the end), weighted the bytes times
+// their distance 16..1 from the end of their chunk
+typedef struct {
+    uint32x4_t s1;
+    uint32x4_t s2;
+    uint32x4_t weighted;
+    size_t chunks;
+} adler32_state;
+
+static inline void adler32_init(adler32_state *s) {
+    s->s1 = vdupq_n_u32(0);
+    s->s2 = vdupq_n_u32(0);
+    s->weighted = vdupq_n_u32(0);
+    s->chunks = 0;
+}
+
+static inline void adler32_step(adler32_state *s, uint8x16_t x, uint8x16_t y) {
+    static const uint8_t weights[16] = {16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1};
+    uint16x8_t products;
+
+    (void)y;
+    s->s2 = vaddq_u32(s->s2, s->s1);
+    s->s1 = vpadalq_u16(s->s1, vpaddlq_u8(x));
+    // v: vector
+    // mull/mlal: multiply (-accumulate) long, 8-bit lanes into 16-bit lanes
+    products = vmull_u8(vget_low_u8(x), vld1_u8(weights));
+    products = vmlal_u8(products, vget_high_u8(x), vld1_u8(weights + 8));
+    s->weighted = vpadalq_u16(s->weighted, products);
+    s->chunks++;
+}
+
+static inline uint32_t adler32_result(const adler32_state *s, size_t n) {
+    // the zero padding of the last chunk moved every byte padding positions
+    // further from the end
+    uint64_t padding = 16 * s->chunks - n;
+    uint64_t s1 = sum_u32x4(s->s1);
+    uint64_t s2 = n + 16 * (uint64_t)sum_u32x4(s->s2) + sum_u32x4(s->weighted) - padding * s1;
+
+    return (uint32_t)((s2 % ADLER32_MOD) << 16 | (1 + s1) % ADLER32_MOD);
+}
+
+
+// the chunks of two records alternate while both have whole chunks left, the
+// rest of each record follows on its own
+#define PAIR_KERNEL(op) \
+    static inline void op##_rest(op##_state *s, const uint8_t *x, const uint8_t *y, size_t n) { \
+        size_t i = 0; \
+        \
+        for(; i + 16 <= n; i += 16) { \
+            op##_step(s, vld1q_u8(x + i), vld1q_u8(y + i)); \
+        } \
+        if(i < n) { \
+            op##_step(s, load_partial(x + i, n - i), load_partial(y + i, n - i)); \
+        } \
+    } \
+    \
+    static inline void op##_pair(op##_state *s0, const uint8_t *x0, const uint8_t *y0, size_t n0, \
+                                 op##_state *s1, const uint8_t *x1, const uint8_t *y1, size_t n1) { \
+        size_t common = (n0 < n1 ? n0 : n1) / 16 * 16, i; \
+        \
+        op##_init(s0); \
+        op##_init(s1); \
+        for(i = 0; i < common; i += 16) { \
+            op##_step(s0, vld1q_u8(x0 + i), vld1q_u8(y0 + i)); \
+            op##_step(s1, vld1q_u8(x1 + i), vld1q_u8(y1 + i)); \
+        } \
+        op##_rest(s0, x0 + common, y0 + common, n0 - common); \
+        op##_rest(s1, x1 + common, y1 + common, n1 - common); \
+    }
+
+// batch functions of an operation on single records, an odd last record is
+// paired with an empty one, storage is static for internal ones
+#define BATCH_1_RECORDS(storage, name, op, type) \
+    storage void name(const batch_record *records, size_t count, type *out) { \
+        op##_state s0, s1; \
+        size_t i; \
+        \
+        for(i = 0; i + 1 < count; i += 2) { \
+            const batch_record *r0 = &records[i], *r1 = &records[i + 1]; \
+            \
+            if(i + BATCH_PREFETCH + 1 < count) { \
+                stream_prefetch(records[i + BATCH_PREFETCH].data); \
+                stream_prefetch(records[i + BATCH_PREFETCH + 1].data); \
+            } \
+            op##_pair(&s0, r0->data, r0->data, r0->length, &s1, r1->data, r1->data, r1->length); \
+            out[i] = op##_result(&s0, r0->length); \
+            out[i + 1] = op##_result(&s1, r1->length); \
+        } \
+        if(i < count) { \
+            op##_pair(&s0, records[i].data, records[i].data, records[i].length, &s1, records[i].data, records[i].data, 0); \
+            out[i] = op##_result(&s0, records[i].length); \
+        } \
+    }
+
+#define BATCH_1_STRIDED(storage, name, op, type) \
+    storage void name##_strided(const uint8_t *records, size_t stride, size_t length, size_t count, type *out) { \
+        op##_state s0, s1; \
+        size_t i; \
+        \
+        for(i = 0; i + 1 < count; i += 2) { \
+            const uint8_t *r0 = records + i * stride, *r1 = r0 + stride; \
+            \
+            stream_prefetch(r0 + BATCH_PREFETCH * stride); \
+            op##_pair(&s0, r0, r0, length, &s1, r1, r1, length); \
+            out[i] = op##_result(&s0, length); \
+            out[i + 1] = op##_result(&s1, length); \
+        } \
+        if(i < count) { \
+            op##_pair(&s0, records + i * stride, records + i * stride, length, &s1, records, records, 0); \
+            out[i] = op##_result(&s0, length); \
+        } \
+    }
+
+// batch functions of an operation on pairs of records a[i], b[i] over the
+// length of a[i], results for pairs failing check are 0 (and their bytes are
+// not read, b[i] may be shorter)
+#define BATCH_2(name, op, type, check) \
+    void name(const batch_record *a, const batch_record *b, size_t count, type *out) { \
+        op##_state s0, s1; \
+        size_t i; \
+        \
+        for(i = 0; i + 1 < count; i += 2) { \
+            int valid0 = check(a[i], b[i]); \
+            int valid1 = check(a[i + 1], b[i + 1]); \
+            size_t n0 = valid0 ? a[i].length : 0; \
+            size_t n1 = valid1 ? a[i + 1].length : 0; \
+            \
+            if(i + BATCH_PREFETCH + 1 < count) { \
+                stream_prefetch(a[i + BATCH_PREFETCH].data); \
+                stream_prefetch(b[i + BATCH_PREFETCH].data); \
+                stream_prefetch(a[i + BATCH_PREFETCH + 1].data); \
+                stream_prefetch(b[i + BATCH_PREFETCH + 1].data); \
+            } \
+            op##_pair(&s0, a[i].data, b[i].data, n0, &s1, a[i + 1].data, b[i + 1].data, n1); \
+            out[i] = valid0 ? op##_result(&s0, n0) : 0; \
+            out[i + 1] = valid1 ? op##_result(&s1, n1) : 0; \
+        } \
+        if(i < count) { \
+            int valid0 = check(a[i], b[i]); \
+            size_t n0 = valid0 ? a[i].length : 0; \
+            \
+            op##_pair(&s0, a[i].data, b[i].data, n0, &s1, a[i].data, b[i].data, 0); \
+            out[i] = valid0 ? op##_result(&s0, n0) : 0; \
+        } \
+    } \
+    \
+    void name##_strided(const uint8_t *a, const uint8_t *b, size_t stride, size_t length, size_t count, type *out) { \
+        op##_state s0, s1; \
+        size_t i; \
+        \
+        for(i = 0; i + 1 < count; i += 2) { \
+            size_t offset = i * stride; \
+            \
+            stream_prefetch(a + offset + BATCH_PREFETCH * stride); \
+            stream_prefetch(b + offset + BATCH_PREFETCH * stride); \
+            op##_pair(&s0, a + offset, b + offset, length, &s1, a + offset + stride, b + offset + stride, length); \
+            out[i] = op##_result(&s0, length); \
+            out[i + 1] = op##_result(&s1, length); \
+        } \
+        if(i < count) { \
+            op##_pair(&s0, a + i * stride, b + i * stride, length, &s1, a, b, 0); \
+            out[i] = op##_result(&s0, length); \
+        } \
+    }
+
+#define BATCH_1(storage, name, op, type) \
+    BATCH_1_RECORDS(storage, name, op, type) \
+    BATCH_1_STRIDED(storage, name, op, type)
+
+#define ANY_LENGTH(a, b)  1
+#define SAME_LENGTH(a, b) ((a).length == (b).length)
+
+PAIR_KERNEL(popcount)
+PAIR_KERNEL(equal)
+PAIR_KERNEL(sad)
+PAIR_KERNEL(adler32)
+
+BATCH_1(, batch_popcount, popcount, uint32_t)
+BATCH_2(batch_equal, equal, uint8_t, SAME_LENGTH)
+BATCH_2(batch_sad, sad, uint32_t, ANY_LENGTH)
+BATCH_1_STRIDED(static, adler32_short, adler32, uint32_t)
+
+
+void batch_adler32(const batch_record *records, size_t count, uint32_t *out) {
+    adler32_state s0, s1;
+    // a short record waiting for a partner, count if none
+    size_t waiting = count, i;
+
+    for(i = 0; i < count; i++) {
+        const batch_record *r = &records[i];
+
+        if(i + BATCH_PREFETCH < count) {
+            stream_prefetch(records[i + BATCH_PREFETCH].data);
+        }
+        if(r->length > ADLER32_MAX_RECORD) {
+            // the vector sums of longer records may wrap
+            out[i] = adler32_update(ADLER32_INIT, r->data, r->length);
+        } else if(waiting == count) {
+            waiting = i;
+        } else {
+            const batch_record *w = &records[waiting];
+
+            adler32_pair(&s0, w->data, w->data, w->length, &s1, r->data, r->data, r->length);
+            out[waiting] = adler32_result(&s0, w->length);
+            out[i] = adler32_result(&s1, r->length);
+            waiting = count;
+        }
+    }
+    if(waiting < count) {
+        const batch_record *w = &records[waiting];
+
+        adler32_pair(&s0, w->data, w->data, w->length, &s1, w->data, w->data, 0);
+        out[waiting] = adler32_result(&s0, w->length);
+    }
+}
+
+
+void batch_adler32_strided(const uint8_t *records, size_t stride, size_t length, size_t count, uint32_t *out) {
+    size_t i;
+
+    if(length <= ADLER32_MAX_RECORD) {
+        adler32_short_strided(records, stride, length, count, out);
+        return;
+    }
+    for(i = 0; i < count; i++) {
+        out[i] = adler32_update(ADLER32_INIT, records + i * stride, length);
+    }
+}
@@ -0,0 +1,42 @@
+/* Batched popcount, compare, SAD and Adler-32 over many small records
+ * using ARM NEON
+ *
+ * One call processes a whole array of records, given either as (pointer,
+ * length) descriptors or as count records of the same length stride bytes
+ * apart. Records are processed in pairs whose 16-byte chunks alternate, so
+ * the dependency chains of two records overlap, and the records a few
+ * descriptors ahead are prefetched. Meant for millions of 16-64 byte
+ * records (packet payloads, keypoint patches) where calling a buffer
+ * kernel per record would cost more than the work itself.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    const uint8_t *data;
+    size_t length;
+} batch_record;
+
+// out[i] = number of set bits of record i
+void batch_popcount(const batch_record *records, size_t count, uint32_t *out);
+void batch_popcount_strided(const uint8_t *records, size_t stride, size_t length, size_t count, uint32_t *out);
+
+// out[i] = 1 if a[i] and b[i] have the same length and bytes, 0 otherwise
+void batch_equal(const batch_record *a, const batch_record *b, size_t count, uint8_t *out);
+void batch_equal_strided(const uint8_t *a, const uint8_t *b, size_t stride, size_t length, size_t count, uint8_t *out);
+
+// out[i] = sum of |a[i][j] - b[i][j]| over the length of a[i], b[i] must be
+// at least as long
+void batch_sad(const batch_record *a, const batch_record *b, size_t count, uint32_t *out);
+void batch_sad_strided(const uint8_t *a, const uint8_t *b, size_t stride, size_t length, size_t count, uint32_t *out);
+
+// out[i] = adler32_update(ADLER32_INIT, record i), records above 4 KiB fall
+// back to adler32_update()
+void batch_adler32(const batch_record *records, size_t count, uint32_t *out);
+void batch_adler32_strided(const uint8_t *records, size_t stride, size_t length, size_t count, uint32_t *out);
+
+#endif
@@ -0,0 +1,267 @@
+/* Leading-zero-count based bit length, floor(log2), normalization and
+ * varint (LEB128) length kernels using ARM NEON
+ */
+
+#include "arm_neon.h"
+#include "bitlen.h"
+#include "stream.h"
+
+
+static inline uint8_t clz_scalar(uint32_t x, int width) {
+    return (uint8_t)(x == 0 ? width : __builtin_clz(x) - (32 - width));
+}
+
+
+// bit lengths of 16 consecutive 32-bit values, narrowed to bytes
+static inline uint8x16_t bitlen_u32x16(const uint32_t *in) {
+    uint32x4_t vector_width = vdupq_n_u32(32);
+    uint16x8_t lo, hi;
+
+    // v: vector
+    // clz: count leading zeros
+    // q: 128-bit registers
+    // u32: 32-bit unsigned integer
+    // bitlen = 32 - clz, which fits in 8 bits so narrowing is exact
+    lo = vcombine_u16(vmovn_u32(vsubq_u32(vector_width, vclzq_u32(vld1q_u32(in)))),
+                      vmovn_u32(vsubq_u32(vector_width, vclzq_u32(vld1q_u32(in + 4)))));
+    hi = vcombine_u16(vmovn_u32(vsubq_u32(vector_width, vclzq_u32(vld1q_u32(in + 8)))),
+                      vmovn_u32(vsubq_u32(vector_width, vclzq_u32(vld1q_u32(in + 12)))));
+
+    return vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+}
+
+
+// bit lengths of 16 consecutive 16-bit values, narrowed to bytes
+static inline uint8x16_t bitlen_u16x16(const uint16_t *in) {
+    uint16x8_t vector_width = vdupq_n_u16(16);
+    uint16x8_t lo, hi;
+
+    lo = vsubq_u16(vector_width, vclzq_u16(vld1q_u16(in)));
+    hi = vsubq_u16(vector_width, vclzq_u16(vld1q_u16(in + 8)));
+
+    return vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+}
+
+
+void bitlen_u8(const uint8_t *in, size_t n, uint8_t *out) {
+    size_t i = 0;
+    size_t distance = stream_settings.prefetch_distance;
+    uint8x16_t vector_width = vdupq_n_u8(8);
+
+    for(; i + 16 <= n; i += 16) {
+        stream_prefetch_ahead(in + i, distance);
+        vst1q_u8(out + i, vsubq_u8(vector_width, vclzq_u8(vld1q_u8(in + i))));
+    }
+
+    for(; i < n; i++) {
+        out[i] = (uint8_t)(8 - clz_scalar(in[i], 8));
+    }
+}
+
+
+void bitlen_u16(const uint16_t *in, size_t n, uint8_t *out) {
+    size_t i = 0;
+    size_t distance = stream_settings.prefetch_distance;
+
+    for(; i + 16 <= n; i += 16) {
+        stream_prefetch_ahead(in + i, distance);
+        vst1q_u8(out + i, bitlen_u16x16(in + i));
+    }
+
+    for(; i < n; i++) {
+        out[i] = (uint8_t)(16 - clz_scalar(in[i], 16));
+    }
+}
+
+
+void bitlen_u32(const uint32_t *in, size_t n, uint8_t *out) {
+    size_t i = 0;
+    size_t distance = stream_settings.prefetch_distance;
+
+    for(; i + 16 <= n; i += 16) {
+        stream_prefetch_ahead(in + i, distance);
+        vst1q_u8(out + i, bitlen_u32x16(in + i));
+    }
+
+    for(; i < n; i++) {
+        out[i] = (uint8_t)(32 - clz_scalar(in[i], 32));
+    }
+}
+
+
+// ilog2 = bitlen - 1, wrapping to 0xff for zero
+static void decrement_u8(uint8_t *data, size_t n) {
+    size_t i = 0;
+    uint8x16_t vector_one = vdupq_n_u8(1);
+
+    for(; i + 16 <= n; i += 16) {
+        vst1q_u8(data + i, vsubq_u8(vld1q_u8(data + i), vector_one));
+    }
+
+    for(; i < n; i++) {
+        data[i] = (uint8_t)(data[i] - 1);
+    }
+}
+
+
+void ilog2_u8(const uint8_t *in, size_t n, uint8_t *out) {
+    size_t i = 0;
+    size_t distance = stream_settings.prefetch_distance;
+    uint8x16_t vector_max = vdupq_n_u8(7);
+
+    // floor(log2(x)) = 7 - clz(x), 7 - 8 wraps to 0xff for zero
+    for(; i + 16 <= n; i += 16) {
+        stream_prefetch_ahead(in + i, distance);
+        vst1q_u8(out + i, vsubq_u8(vector_max, vclzq_u8(vld1q_u8(in + i))));
+    }
+
+    for(; i < n; i++) {
+        out[i] = (uint8_t)(7 - clz_scalar(in[i], 8));
+    }
+}
+
+
+void ilog2_u16(const uint16_t *in, size_t n, uint8_t *out) {
+    bitlen_u16(in, n, out);
+    decrement_u8(out, n);
+}
+
+
+void ilog2_u32(const uint32_t *in, size_t n, uint8_t *out) {
+    bitlen_u32(in, n, out);
+    decrement_u8(out, n);
+}
+
+
+void normalize_u8(const uint8_t *in, size_t n, uint8_t *out, uint8_t *shift) {
+    size_t i = 0;
+    size_t distance = stream_settings.prefetch_distance;
+
+    for(; i + 16 <= n; i += 16) {
+        uint8x16_t vector_data = vld1q_u8(in + i);
+        uint8x16_t vector_clz = vclzq_u8(vector_data);
+
+        stream_prefetch_ahead(in + i, distance);
+
+        // v: vector
+        // shl: shift left by a per-lane amount
+        // shifting zero by 8 keeps it zero
+        vst1q_u8(out + i, vshlq_u8(vector_data, vreinterpretq_s8_u8(vector_clz)));
+        vst1q_u8(shift + i, vector_clz);
+    }
+
+    for(; i < n; i++) {
+        shift[i] = clz_scalar(in[i], 8);
+        out[i] = (uint8_t)(shift[i] < 8 ? in[i] << shift[i] : 0);
+    }
+}
+
+
+void normalize_u16(const uint16_t *in, size_t n, uint16_t *out, uint8_t *shift) {
+    size_t i = 0;
+    size_t distance = stream_settings.prefetch_distance;
+
+    for(; i + 8 <= n; i += 8) {
+        uint16x8_t vector_data = vld1q_u16(in + i);
+        uint16x8_t vector_clz = vclzq_u16(vector_data);
+
+        stream_prefetch_ahead(in + i, distance);
+
+        vst1q_u16(out + i, vshlq_u16(vector_data, vreinterpretq_s16_u16(vector_clz)));
+        vst1_u8(shift + i, vmovn_u16(vector_clz));
+    }
+
+    for(; i < n; i++) {
+        shift[i] = clz_scalar(in[i], 16);
+        out[i] = (uint16_t)(shift[i] < 16 ? in[i] << shift[i] : 0);
+    }
+}
+
+
+void normalize_u32(const uint32_t *in, size_t n, uint32_t *out, uint8_t *shift) {
+    size_t i = 0;
+    size_t distance = stream_settings.prefetch_distance;
+
+    for(; i + 8 <= n; i += 8) {
+        uint32x4_t vector_data0 = vld1q_u32(in + i);
+        uint32x4_t vector_data1 = vld1q_u32(in + i + 4);
+        uint32x4_t vector_clz0 = vclzq_u32(vector_data0);
+        uint32x4_t vector_clz1 = vclzq_u32(vector_data1);
+        uint16x8_t vector_shift;
+
+        stream_prefetch_ahead(in + i, distance);
+
+        vst1q_u32(out + i, vshlq_u32(vector_data0, vreinterpretq_s32_u32(vector_clz0)));
+        vst1q_u32(out + i + 4, vshlq_u32(vector_data1, vreinterpretq_s32_u32(vector_clz1)));
+
+        vector_shift = vcombine_u16(vmovn_u32(vector_clz0), vmovn_u32(vector_clz1));
+        vst1_u8(shift + i, vmovn_u16(vector_shift));
+    }
+
+    for(; i < n; i++) {
+        shift[i] = clz_scalar(in[i], 32);
+        out[i] = shift[i] < 32 ? in[i] << shift[i] : 0;
+    }
+}
+
+
+// LEB128 length from the bit length: 1 + (b > 7) + (b > 14) + (b > 21) + (b > 28)
+static inline uint8x16_t varint_len_from_bitlen(uint8x16_t vector_bitlen) {
+    uint8x16_t vector_len = vdupq_n_u8(1);
+
+    // compares yield 0xff (-1) for true, so subtracting adds one
+    vector_len = vsubq_u8(vector_len, vcgtq_u8(vector_bitlen, vdupq_n_u8(7)));
+    vector_len = vsubq_u8(vector_len, vcgtq_u8(vector_bitlen, vdupq_n_u8(14)));
+    vector_len = vsubq_u8(vector_len, vcgtq_u8(vector_bitlen, vdupq_n_u8(21)));
+    vector_len = vsubq_u8(vector_len, vcgtq_u8(vector_bitlen, vdupq_n_u8(28)));
+
+    return vector_len;
+}
+
+
+static inline uint8_t varint_len_scalar(uint32_t x) {
+    uint8_t bits = (uint8_t)(32 - clz_scalar(x, 32));
+    return (uint8_t)(1 + (bits > 7) + (bits > 14) + (bits > 21) + (bits > 28));
+}
+
+
+void varint_len_u32(const uint32_t *in, size_t n, uint8_t *out) {
+    size_t i = 0;
+    size_t distance = stream_settings.prefetch_distance;
+
+    for(; i + 16 <= n; i += 16) {
+        stream_prefetch_ahead(in + i, distance);
+        vst1q_u8(out + i, varint_len_from_bitlen(bitlen_u32x16(in + i)));
+    }
+
+    for(; i < n; i++) {
+        out[i] = varint_len_scalar(in[i]);
+    }
+}
+
+
+size_t varint_size_u32(const uint32_t *in, size_t n) {
+    size_t i = 0, total;
+    size_t distance = stream_settings.prefetch_distance;
+    uint32x4_t vector_sum = vdupq_n_u32(0);
+    uint64x2_t vector_total;
+
+    for(; i + 16 <= n; i += 16) {
+        uint8x16_t vector_len = varint_len_from_bitlen(bitlen_u32x16(in + i));
+
+        stream_prefetch_ahead(in + i, distance);
+
+        // v: vector
+        // padal: pairwise addition with accumulate (widening)
+        vector_sum = vpadalq_u16(vector_sum, vpaddlq_u8(vector_len));
+    }
+
+    vector_total = vpaddlq_u32(vector_sum);
+    total = (size_t)(vgetq_lane_u64(vector_total, 0) + vgetq_lane_u64(vector_total, 1));
+
+    for(; i < n; i++) {
+        total += varint_len_scalar(in[i]);
+    }
+
+    return total;
+}
@@ -0,0 +1,34 @@
+/* Leading-zero-count based bit length, floor(log2), normalization and
+ * varint (LEB128) length kernels using ARM NEON
+ *
+ * bitlen(x) is the number of significant bits (0 for x = 0), ilog2(x) is
+ * floor(log2(x)) = bitlen(x) - 1 and yields 0xff for x = 0. normalize shifts
+ * every value so its most significant set bit becomes the top bit and
+ * reports the shift (the full lane width for x = 0).
+ */
+
+#ifndef BITLEN_H
+#define BITLEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+void bitlen_u8(const uint8_t *in, size_t n, uint8_t *out);
+void bitlen_u16(const uint16_t *in, size_t n, uint8_t *out);
+void bitlen_u32(const uint32_t *in, size_t n, uint8_t *out);
+
+void ilog2_u8(const uint8_t *in, size_t n, uint8_t *out);
+void ilog2_u16(const uint16_t *in, size_t n, uint8_t *out);
+void ilog2_u32(const uint32_t *in, size_t n, uint8_t *out);
+
+void normalize_u8(const uint8_t *in, size_t n, uint8_t *out, uint8_t *shift);
+void normalize_u16(const uint16_t *in, size_t n, uint16_t *out, uint8_t *shift);
+void normalize_u32(const uint32_t *in, size_t n, uint32_t *out, uint8_t *shift);
+
+// number of bytes of the LEB128 encoding of each value (1..5)
+void varint_len_u32(const uint32_t *in, size_t n, uint8_t *out);
+
+// total number of bytes of the LEB128 encoding of all n values
+size_t varint_size_u32(const uint32_t *in, size_t n);
+
+#endif
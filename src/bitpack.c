@@ -0,0 +1,316 @@
+/* Bit packing of b-Bit unsigned integers (b = 1..8) and bit-plane splitting
+ * of 8-Bit unsigned integers using ARM NEON
+ */
+
+#include <string.h>
+#include "arm_neon.h"
+#include "bitpack.h"
+#include "neon_util.h"
+#include "stream.h"
+
+// bit weights of the 8 lanes of each 64-bit half: lane j -> (1 << j)
+static const uint8_t bit_weights[16] = {1,2,4,8,16,32,64,128,1,2,4,8,16,32,64,128};
+
+
+size_t bitpack_packed_size(size_t n, unsigned bits) {
+    return (n * bits + 7) / 8;
+}
+
+
+size_t bitplane_stride(size_t n) {
+    return (n + 7) / 8;
+}
+
+
+static size_t pack_scalar(const uint8_t *in, size_t n, unsigned bits, uint8_t *out) {
+    size_t i;
+    uint8_t *o = out;
+    uint32_t acc = 0;
+    unsigned acc_bits = 0;
+    uint8_t mask = (uint8_t)((1u << bits) - 1);
+
+    for(i = 0; i < n; i++) {
+        acc |= (uint32_t)(in[i] & mask) << acc_bits;
+        acc_bits += bits;
+        while(acc_bits >= 8) {
+            *o++ = (uint8_t)acc;
+            acc >>= 8;
+            acc_bits -= 8;
+        }
+    }
+    if(acc_bits > 0) {
+        *o++ = (uint8_t)acc;
+    }
+
+    return (size_t)(o - out);
+}
+
+
+static void unpack_scalar(const uint8_t *in, size_t n, unsigned bits, uint8_t *out) {
+    size_t i;
+    uint32_t acc = 0;
+    unsigned acc_bits = 0;
+    uint8_t mask = (uint8_t)((1u << bits) - 1);
+
+    for(i = 0; i < n; i++) {
+        if(acc_bits < bits) {
+            acc |= (uint32_t)(*in++) << acc_bits;
+            acc_bits += 8;
+        }
+        out[i] = (uint8_t)(acc & mask);
+        acc >>= bits;
+        acc_bits -= bits;
+    }
+}
+
+
+size_t bitpack_pack(const uint8_t *in, size_t n, unsigned bits, uint8_t *out) {
+    size_t i = 0;
+    size_t packed = bitpack_packed_size(n, bits);
+    size_t distance = stream_settings.prefetch_distance;
+    uint8_t *o = out;
+
+    if(bits == 8) {
+        memcpy(out, in, n);
+        return n;
+    }
+
+    if(bits == 1) {
+        uint8x16_t vector_one = vdupq_n_u8(1);
+
+        for(; i + 16 <= n; i += 16) {
+            uint8x16_t vector_data = vld1q_u8(in + i);
+            uint16_t word;
+
+            stream_prefetch_ahead(in + i, distance);
+
+            // lane j becomes bit j of the output bytes
+            word = movemask_u8x16(vtstq_u8(vector_data, vector_one));
+            memcpy(o, &word, 2);
+            o += 2;
+        }
+
+        return (size_t)(o - out) + pack_scalar(in + i, n - i, bits, o);
+    }
+
+    {
+        uint8x16_t vector_mask = vdupq_n_u8((uint8_t)((1u << bits) - 1));
+        uint32x4_t vector_mask16 = vdupq_n_u32(0xffff);
+        uint64x2_t vector_mask32 = vdupq_n_u64(0xffffffff);
+        int32x4_t shift16 = vdupq_n_s32((int32_t)bits - 16);
+        int64x2_t shift32 = vdupq_n_s64(2 * (int64_t)bits - 32);
+        int64x1_t shift64 = vdup_n_s64(4 * (int64_t)bits);
+
+        // every group of 8 values becomes `bits` bytes, but each group is
+        // written with a full 8-byte store whose upper bytes are zero and
+        // get overwritten by the next group, so stop before the last store
+        // would run past the end of the output
+        for(; i + 16 <= n && (i / 8 + 1) * bits + 8 <= packed; i += 16) {
+            uint8x16_t vector_data = vandq_u8(vld1q_u8(in + i), vector_mask);
+            uint32x4_t x0, x1;
+            uint64x2_t y0, y1;
+            uint64x1_t w0, w1;
+
+            stream_prefetch_ahead(in + i, distance);
+
+            // widen to 16 bit: each 32-bit lane holds v0 | v1 << 16
+            x0 = vreinterpretq_u32_u16(vmovl_u8(vget_low_u8(vector_data)));
+            x1 = vreinterpretq_u32_u16(vmovl_u8(vget_high_u8(vector_data)));
+
+            // v0 | v1 << bits, since v0 >> (16 - bits) is always zero
+            x0 = vaddq_u32(vandq_u32(x0, vector_mask16), vshlq_u32(x0, shift16));
+            x1 = vaddq_u32(vandq_u32(x1, vector_mask16), vshlq_u32(x1, shift16));
+
+            // same step on 64-bit lanes with pairs of 2*bits wide fields
+            y0 = vreinterpretq_u64_u32(x0);
+            y1 = vreinterpretq_u64_u32(x1);
+            y0 = vaddq_u64(vandq_u64(y0, vector_mask32), vshlq_u64(y0, shift32));
+            y1 = vaddq_u64(vandq_u64(y1, vector_mask32), vshlq_u64(y1, shift32));
+
+            // last step on the two halves: 8 fields of `bits` bits
+            w0 = vorr_u64(vget_low_u64(y0), vshl_u64(vget_high_u64(y0), shift64));
+            w1 = vorr_u64(vget_low_u64(y1), vshl_u64(vget_high_u64(y1), shift64));
+
+            vst1_u8(o, vreinterpret_u8_u64(w0));
+            vst1_u8(o + bits, vreinterpret_u8_u64(w1));
+            o += 2 * bits;
+        }
+    }
+
+    return (size_t)(o - out) + pack_scalar(in + i, n - i, bits, o);
+}
+
+
+void bitpack_unpack(const uint8_t *in, size_t n, unsigned bits, uint8_t *out) {
+    size_t i = 0;
+    size_t packed = bitpack_packed_size(n, bits);
+    size_t distance = stream_settings.prefetch_distance;
+    const uint8_t *p = in;
+
+    if(bits == 8) {
+        memcpy(out, in, n);
+        return;
+    }
+
+    if(bits == 1) {
+        uint8x16_t vector_weights = vld1q_u8(bit_weights);
+        uint8x16_t vector_one = vdupq_n_u8(1);
+
+        for(; i + 16 <= n; i += 16) {
+            uint8x16_t vector_data;
+
+            stream_prefetch_ahead(p, distance);
+
+            // broadcast each packed byte over the 8 lanes it describes
+            vector_data = vcombine_u8(vdup_n_u8(p[0]), vdup_n_u8(p[1]));
+            vector_data = vandq_u8(vtstq_u8(vector_data, vector_weights), vector_one);
+            vst1q_u8(out + i, vector_data);
+            p += 2;
+        }
+
+        unpack_scalar(p, n - i, bits, out + i);
+        return;
+    }
+
+    {
+        uint8x16_t vector_mask = vdupq_n_u8((uint8_t)((1u << bits) - 1));
+        int16x8_t shift8 = vdupq_n_s16(-(int16_t)bits);
+        int32x4_t shift16 = vdupq_n_s32(-2 * (int32_t)bits);
+        int64x2_t shift32 = vdupq_n_s64(-4 * (int64_t)bits);
+
+        // each 8-byte load only uses `bits` bytes, stop before reading past
+        // the end of the input
+        for(; i + 16 <= n && (i / 8 + 1) * bits + 8 <= packed; i += 16) {
+            uint64x2_t y;
+            uint32x4_t x;
+            uint16x8_t h;
+            uint8x16_t vector_data;
+            uint32x2x2_t zip32;
+            uint16x4x2_t zip16;
+            uint8x8x2_t zip8;
+
+            stream_prefetch_ahead(p, distance);
+
+            // two groups of 8 fields, garbage above bit 8*bits is masked at
+            // the end since right shifts never move it into lower fields
+            y = vcombine_u64(vreinterpret_u64_u8(vld1_u8(p)),
+                             vreinterpret_u64_u8(vld1_u8(p + bits)));
+
+            // split each 64-bit lane into its low and high 4 fields
+            zip32 = vzip_u32(vmovn_u64(y), vmovn_u64(vshlq_u64(y, shift32)));
+            x = vcombine_u32(zip32.val[0], zip32.val[1]);
+
+            zip16 = vzip_u16(vmovn_u32(x), vmovn_u32(vshlq_u32(x, shift16)));
+            h = vcombine_u16(zip16.val[0], zip16.val[1]);
+
+            zip8 = vzip_u8(vmovn_u16(h), vmovn_u16(vshlq_u16(h, shift8)));
+            vector_data = vcombine_u8(zip8.val[0], zip8.val[1]);
+
+            vst1q_u8(out + i, vandq_u8(vector_data, vector_mask));
+            p += 2 * bits;
+        }
+    }
+
+    unpack_scalar(p, n - i, bits, out + i);
+}
+
+
+void bitplane_split(const uint8_t *in, size_t n, uint8_t *planes) {
+    size_t i = 0, j;
+    size_t stride = bitplane_stride(n);
+    size_t distance = stream_settings.prefetch_distance;
+    int k, v;
+    uint8x16_t vector_weights = vld1q_u8(bit_weights);
+
+    // 64 input bytes produce 8 bytes in every plane
+    for(; i + 64 <= n; i += 64) {
+        uint8x16_t vector_data[4];
+
+        for(v = 0; v < 4; v++) {
+            vector_data[v] = vld1q_u8(in + i + 16 * v);
+        }
+        stream_prefetch_ahead(in + i, distance);
+
+        for(k = 0; k < 8; k++) {
+            uint8x16_t vector_bit = vdupq_n_u8((uint8_t)(1u << k));
+            uint8x8_t p[4];
+
+            // v: vector
+            // tst: test bits ((a & b) != 0 ? 0xff : 0)
+            // q: 128-bit registers
+            // u8: 8-bit unsigned integer
+            for(v = 0; v < 4; v++) {
+                uint8x16_t t = vandq_u8(vtstq_u8(vector_data[v], vector_bit), vector_weights);
+                p[v] = vpadd_u8(vget_low_u8(t), vget_high_u8(t));
+            }
+            p[0] = vpadd_u8(p[0], p[1]);
+            p[2] = vpadd_u8(p[2], p[3]);
+            p[0] = vpadd_u8(p[0], p[2]);
+
+            vst1_u8(planes + k * stride + i / 8, p[0]);
+        }
+    }
+
+    // tail: clear the remaining plane bytes, then set bits one by one
+    for(k = 0; k < 8; k++) {
+        for(j = i / 8; j < stride; j++) {
+            planes[k * stride + j] = 0;
+        }
+    }
+    for(; i < n; i++) {
+        for(k = 0; k < 8; k++) {
+            planes[k * stride + i / 8] |= (uint8_t)(((in[i] >> k) & 1) << (i % 8));
+        }
+    }
+}
+
+
+void bitplane_merge(const uint8_t *planes, size_t n, uint8_t *out) {
+    size_t i = 0;
+    size_t stride = bitplane_stride(n);
+    size_t distance = stream_settings.prefetch_distance;
+    int nontemporal = stream_nontemporal(2 * n);
+    int k, v;
+    uint8x16_t vector_weights = vld1q_u8(bit_weights);
+
+    // 8 bytes from every plane produce 64 output bytes, each plane is read
+    // at an eighth of the output rate and prefetched as far ahead in loop
+    // iterations
+    for(; i + 64 <= n; i += 64) {
+        uint8x16_t vector_result[4];
+
+        for(v = 0; v < 4; v++) {
+            vector_result[v] = vdupq_n_u8(0);
+        }
+
+        for(k = 0; k < 8; k++) {
+            uint8x8_t plane = vld1_u8(planes + k * stride + i / 8);
+            uint8x16_t vector_bit = vdupq_n_u8((uint8_t)(1u << k));
+
+            stream_prefetch_ahead(planes + k * stride + i / 8, distance / 8);
+
+            for(v = 0; v < 4; v++) {
+                uint8x16_t t;
+
+                // v: vector
+                // tbl1: table lookup in one d register
+                // broadcast plane bytes 2v and 2v+1 over 8 lanes each
+                t = vcombine_u8(vtbl1_u8(plane, vdup_n_u8((uint8_t)(2 * v))),
+                                vtbl1_u8(plane, vdup_n_u8((uint8_t)(2 * v + 1))));
+                t = vandq_u8(vtstq_u8(t, vector_weights), vector_bit);
+                vector_result[v] = vorrq_u8(vector_result[v], t);
+            }
+        }
+
+        stream_store_u8x16x2(out + i, vector_result[0], vector_result[1], nontemporal);
+        stream_store_u8x16x2(out + i + 32, vector_result[2], vector_result[3], nontemporal);
+    }
+
+    for(; i < n; i++) {
+        uint8_t byte = 0;
+        for(k = 0; k < 8; k++) {
+            byte |= (uint8_t)(((planes[k * stride + i / 8] >> (i % 8)) & 1) << k);
+        }
+        out[i] = byte;
+    }
+}
@@ -0,0 +1,37 @@
+/* Bit packing of b-Bit unsigned integers (b = 1..8) and bit-plane splitting
+ * of 8-Bit unsigned integers using ARM NEON
+ *
+ * Packed bitstreams are LSB-first: value i occupies bits [i*b, i*b+b) of the
+ * stream, where bit k of the stream is bit (k % 8) of byte (k / 8).
+ *
+ * Bit-planes are stored planar: plane k holds bit k of every input byte and
+ * starts at planes + k * bitplane_stride(n). Bit j of byte i in a plane
+ * belongs to input byte 8*i+j.
+ */
+
+#ifndef BITPACK_H
+#define BITPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// number of bytes needed to pack n values of the given bit width
+size_t bitpack_packed_size(size_t n, unsigned bits);
+
+// packs the low `bits` bits of each of the n input bytes into out
+// returns the number of bytes written (bitpack_packed_size(n, bits))
+size_t bitpack_pack(const uint8_t *in, size_t n, unsigned bits, uint8_t *out);
+
+// unpacks n values of the given bit width from in into one byte each
+void bitpack_unpack(const uint8_t *in, size_t n, unsigned bits, uint8_t *out);
+
+// number of bytes per bit-plane for n input bytes
+size_t bitplane_stride(size_t n);
+
+// splits n bytes into 8 bit-planes (8 * bitplane_stride(n) bytes)
+void bitplane_split(const uint8_t *in, size_t n, uint8_t *planes);
+
+// merges 8 bit-planes back into n bytes
+void bitplane_merge(const uint8_t *planes, size_t n, uint8_t *out);
+
+#endif
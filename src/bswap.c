@@ -0,0 +1,180 @@
+/* Byte order swapping of 16/32/64-Bit integers and big-endian to native
+ * conversion using ARM NEON
+ */
+
+#include <string.h>
+#include "arm_neon.h"
+#include "bswap.h"
+#include "stream.h"
+
+
+// the bswap*_buf loop with 1, 2 or 4 vectors in flight over the bytes of
+// elements of the given bits, each returns the number of bytes done; byte
+// loads and stores, in and out need no alignment beyond their type
+//
+// v: vector
+// rev16/rev32/rev64: reverse the bytes within each 16/32/64-bit element
+// q: 128-bit registers
+// u8: 8-bit unsigned integer
+#define BSWAP_BUF(bits) \
+    static size_t bswap##bits##_x1(const uint8_t *src, size_t bytes, uint8_t *dst, size_t distance) { \
+        size_t i = 0; \
+        \
+        for(; i + 16 <= bytes; i += 16) { \
+            uint8x16_t vector_data = vld1q_u8(src + i); \
+            \
+            stream_prefetch_ahead(src + i, distance); \
+            vst1q_u8(dst + i, vrev##bits##q_u8(vector_data)); \
+        } \
+        \
+        return i; \
+    } \
+    \
+    static size_t bswap##bits##_x2(const uint8_t *src, size_t bytes, uint8_t *dst, size_t distance, \
+                                   int nontemporal) { \
+        size_t i = 0; \
+        \
+        for(; i + 32 <= bytes; i += 32) { \
+            uint8x16_t vector_data0 = vld1q_u8(src + i); \
+            uint8x16_t vector_data1 = vld1q_u8(src + i + 16); \
+            \
+            stream_prefetch_ahead(src + i, distance); \
+            stream_store_u8x16x2(dst + i, vrev##bits##q_u8(vector_data0), vrev##bits##q_u8(vector_data1), \
+                                 nontemporal); \
+        } \
+        \
+        return i; \
+    } \
+    \
+    static size_t bswap##bits##_x4(const uint8_t *src, size_t bytes, uint8_t *dst, size_t distance, \
+                                   int nontemporal) { \
+        size_t i = 0; \
+        \
+        for(; i + 64 <= bytes; i += 64) { \
+            uint8x16_t vector_data0 = vld1q_u8(src + i); \
+            uint8x16_t vector_data1 = vld1q_u8(src + i + 16); \
+            uint8x16_t vector_data2 = vld1q_u8(src + i + 32); \
+            uint8x16_t vector_data3 = vld1q_u8(src + i + 48); \
+            \
+            stream_prefetch_ahead(src + i, distance); \
+            stream_store_u8x16x2(dst + i, vrev##bits##q_u8(vector_data0), vrev##bits##q_u8(vector_data1), \
+                                 nontemporal); \
+            stream_store_u8x16x2(dst + i + 32, vrev##bits##q_u8(vector_data2), vrev##bits##q_u8(vector_data3), \
+                                 nontemporal); \
+        } \
+        \
+        return i; \
+    } \
+    \
+    void bswap##bits##_buf(const uint##bits##_t *in, size_t n, uint##bits##_t *out) { \
+        size_t i; \
+        size_t bytes = n * (bits / 8); \
+        const uint8_t *src = (const uint8_t *)in; \
+        uint8_t *dst = (uint8_t *)out; \
+        size_t distance = stream_settings.prefetch_distance; \
+        /* input plus output bytes decide about bypassing the cache */ \
+        int nontemporal = stream_nontemporal(2 * bytes); \
+        \
+        /* the single vector loop has no pair of stores to bypass the cache with */ \
+        if(stream_settings.unroll >= 4) { \
+            i = bswap##bits##_x4(src, bytes, dst, distance, nontemporal); \
+        } else if(stream_settings.unroll == 2) { \
+            i = bswap##bits##_x2(src, bytes, dst, distance, nontemporal); \
+        } else { \
+            i = 0; \
+        } \
+        i += bswap##bits##_x1(src + i, bytes - i, dst + i, distance); \
+        \
+        for(i /= bits / 8; i < n; i++) { \
+            out[i] = __builtin_bswap##bits(in[i]); \
+        } \
+    }
+
+BSWAP_BUF(16)
+BSWAP_BUF(32)
+BSWAP_BUF(64)
+
+
+void be16_to_u16(const uint8_t *in, size_t n, uint16_t *out) {
+    size_t i = 0;
+
+    for(; i + 8 <= n; i += 8) {
+        uint8x16_t vector_data = vrev16q_u8(vld1q_u8(in + 2 * i));
+        vst1q_u16(out + i, vreinterpretq_u16_u8(vector_data));
+    }
+
+    for(; i < n; i++) {
+        out[i] = (uint16_t)((in[2 * i] << 8) | in[2 * i + 1]);
+    }
+}
+
+
+void be32_to_u32(const uint8_t *in, size_t n, uint32_t *out) {
+    size_t i = 0;
+
+    for(; i + 4 <= n; i += 4) {
+        uint8x16_t vector_data = vrev32q_u8(vld1q_u8(in + 4 * i));
+        vst1q_u32(out + i, vreinterpretq_u32_u8(vector_data));
+    }
+
+    for(; i < n; i++) {
+        out[i] = ((uint32_t)in[4 * i] << 24) | ((uint32_t)in[4 * i + 1] << 16) |
+                 ((uint32_t)in[4 * i + 2] << 8) | in[4 * i + 3];
+    }
+}
+
+
+void be16_to_u32(const uint8_t *in, size_t n, uint32_t *out) {
+    size_t i = 0;
+
+    for(; i + 8 <= n; i += 8) {
+        uint16x8_t vector_data = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(in + 2 * i)));
+
+        // v: vector
+        // movl: widen each lane to twice its size
+        vst1q_u32(out + i, vmovl_u16(vget_low_u16(vector_data)));
+        vst1q_u32(out + i + 4, vmovl_u16(vget_high_u16(vector_data)));
+    }
+
+    for(; i < n; i++) {
+        out[i] = (uint32_t)((in[2 * i] << 8) | in[2 * i + 1]);
+    }
+}
+
+
+void be16_to_f32(const uint8_t *in, size_t n, float scale, float *out) {
+    size_t i = 0;
+    float32x4_t vector_scale = vdupq_n_f32(scale);
+
+    for(; i + 8 <= n; i += 8) {
+        int16x8_t vector_data = vreinterpretq_s16_u8(vrev16q_u8(vld1q_u8(in + 2 * i)));
+        float32x4_t f0, f1;
+
+        // sign extend to 32 bits, convert and scale
+        f0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(vector_data)));
+        f1 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(vector_data)));
+        vst1q_f32(out + i, vmulq_f32(f0, vector_scale));
+        vst1q_f32(out + i + 4, vmulq_f32(f1, vector_scale));
+    }
+
+    for(; i < n; i++) {
+        int16_t value = (int16_t)((in[2 * i] << 8) | in[2 * i + 1]);
+        out[i] = (float)value * scale;
+    }
+}
+
+
+void be32_to_f32(const uint8_t *in, size_t n, float *out) {
+    size_t i = 0;
+
+    for(; i + 4 <= n; i += 4) {
+        uint8x16_t vector_data = vrev32q_u8(vld1q_u8(in + 4 * i));
+        vst1q_f32(out + i, vreinterpretq_f32_u8(vector_data));
+    }
+
+    for(; i < n; i++) {
+        uint32_t bits = ((uint32_t)in[4 * i] << 24) | ((uint32_t)in[4 * i + 1] << 16) |
+                        ((uint32_t)in[4 * i + 2] << 8) | in[4 * i + 3];
+        memcpy(out + i, &bits, 4);
+    }
+}
@@ -0,0 +1,34 @@
+/* Byte order swapping of 16/32/64-Bit integers and big-endian to native
+ * conversion using ARM NEON
+ *
+ * The functions writing as many bytes as they read (the bswap*_buf ones,
+ * be16_to_u16, be32_to_u32 and be32_to_f32) accept in == out for in-place
+ * operation. be16_to_u32 and be16_to_f32 write 4 bytes per 2 bytes read and
+ * need in and out not to overlap. The big-endian conversions read unaligned
+ * byte streams and assume a little-endian target (as built by
+ * CMakeLists.txt).
+ */
+
+#ifndef BSWAP_H
+#define BSWAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// swap the byte order of n elements
+void bswap16_buf(const uint16_t *in, size_t n, uint16_t *out);
+void bswap32_buf(const uint32_t *in, size_t n, uint32_t *out);
+void bswap64_buf(const uint64_t *in, size_t n, uint64_t *out);
+
+// read n big-endian elements from a byte stream
+void be16_to_u16(const uint8_t *in, size_t n, uint16_t *out);
+void be32_to_u32(const uint8_t *in, size_t n, uint32_t *out);
+void be16_to_u32(const uint8_t *in, size_t n, uint32_t *out);
+
+// big-endian signed 16-bit samples to float, multiplied by scale
+void be16_to_f32(const uint8_t *in, size_t n, float scale, float *out);
+
+// big-endian IEEE-754 single precision to float
+void be32_to_f32(const uint8_t *in, size_t n, float *out);
+
+#endif
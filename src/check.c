@@ -0,0 +1,2640 @@
+/* Differential checks of NEON intrinsics and kernels against scalar
+ * reference implementations
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "arm_neon.h"
+#include "check.h"
+#include "bitpack.h"
+#include "delta.h"
+#include "rle.h"
+#include "bswap.h"
+#include "stream.h"
+#include "bitlen.h"
+#include "streamvbyte.h"
+#include "utf8.h"
+#include "ascii.h"
+#include "checksum.h"
+#include "shift.h"
+#include "vecops.h"
+#include "normalize.h"
+#include "audio.h"
+#include "morph.h"
+#include "batch.h"
+#include "pipeline.h"
+#include "motion.h"
+#include "roaring.h"
+#include "sortedset.h"
+#include "sort.h"
+
+// longest random stream, offsets are added on top
+#define MAX_LEN 70000
+#define MAX_OFFSET 16
+#define GUARD 64
+#define GUARD_BYTE 0xa5
+#define BUFFER_SIZE (8 * (MAX_LEN + MAX_OFFSET) + GUARD)
+
+// mismatches printed per check
+#define MAX_REPORTS 4
+
+static uint32_t rng_state;
+static const char *check_name;
+static unsigned long check_failures;
+
+static uint8_t *buffer_in, *buffer_out, *buffer_tmp, *buffer_ref;
+
+
+static uint32_t rng(void) {
+    // xorshift32
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+
+// mostly short streams around the vector and block sizes, sometimes long ones
+static size_t random_length(void) {
+    uint32_t r = rng() % 100;
+
+    if(r < 50) {
+        return rng() % 80;
+    } else if(r < 85) {
+        return rng() % 1100;
+    }
+    return rng() % MAX_LEN;
+}
+
+
+// random bytes, sometimes biased towards runs and small values
+static void random_bytes(uint8_t *data, size_t n) {
+    size_t i;
+    uint32_t mode = rng() % 4;
+
+    for(i = 0; i < n; i++) {
+        switch(mode) {
+        case 0:
+            data[i] = (uint8_t)rng();
+            break;
+        case 1:
+            data[i] = (uint8_t)(rng() % 4);
+            break;
+        case 2:
+            data[i] = i > 0 && rng() % 8 != 0 ? data[i - 1] : (uint8_t)rng();
+            break;
+        default:
+            data[i] = (uint8_t)(0x20 + rng() % 0x60);
+            break;
+        }
+    }
+}
+
+
+static void begin_check(const char *name) {
+    check_name = name;
+    check_failures = 0;
+}
+
+
+static unsigned long end_check(void) {
+    printf("%-28s %s", check_name, check_failures == 0 ? "ok\n" : "");
+    if(check_failures > 0) {
+        printf("%lu mismatches\n", check_failures);
+    }
+    return check_failures;
+}
+
+
+static void fail(const char *what, size_t n, size_t index, unsigned long got, unsigned long expected) {
+    if(check_failures++ < MAX_REPORTS) {
+        printf("%s: %s (n = %zu) at %zu: got 0x%lx, expected 0x%lx\n",
+               check_name, what, n, index, got, expected);
+    }
+}
+
+
+static void compare(const char *what, size_t n, const uint8_t *got, const uint8_t *expected, size_t size) {
+    size_t i;
+
+    for(i = 0; i < size; i++) {
+        if(got[i] != expected[i]) {
+            fail(what, n, i, got[i], expected[i]);
+            return;
+        }
+    }
+}
+
+
+// fills the output and its guard bytes, the kernel must not touch the guard
+static void guard_fill(uint8_t *out, size_t size) {
+    memset(out, GUARD_BYTE, size + GUARD);
+}
+
+
+static void guard_check(const char *what, size_t n, const uint8_t *out, size_t size) {
+    size_t i;
+
+    for(i = size; i < size + GUARD; i++) {
+        if(out[i] != GUARD_BYTE) {
+            fail(what, n, i, out[i], GUARD_BYTE);
+            return;
+        }
+    }
+}
+
+
+// ----------------------------------------------------------------------------
+// exhaustive checks of single intrinsics
+
+static inline int8_t s8(uint8_t x) {
+    return (int8_t)x;
+}
+
+
+static uint8_t saturate_u8(int x) {
+    return (uint8_t)(x < 0 ? 0 : x > 255 ? 255 : x);
+}
+
+
+static uint8_t saturate_s8(int x) {
+    return (uint8_t)(int8_t)(x < -128 ? -128 : x > 127 ? 127 : x);
+}
+
+
+// NEON register shifts: the signed shift count shifts left if positive and
+// right if negative, rounding variants add 1 << (n - 1) before shifting right
+static int ref_shift_u8(uint8_t a, int8_t s, int rounding, int saturating) {
+    int n;
+
+    if(s >= 0) {
+        if(a == 0) {
+            return 0;
+        }
+        if(s >= 8) {
+            return saturating ? 255 : 0;
+        }
+        return saturating ? saturate_u8(a << s) : (uint8_t)(a << s);
+    }
+
+    n = -s;
+    if(n > 8) {
+        return 0;
+    }
+    return rounding ? (a + (1 << (n - 1))) >> n : a >> n;
+}
+
+
+static int ref_shift_s8(int8_t a, int8_t s, int rounding, int saturating) {
+    int n;
+
+    if(s >= 0) {
+        if(a == 0) {
+            return 0;
+        }
+        if(s >= 8) {
+            return saturating ? (a < 0 ? -128 : 127) : 0;
+        }
+        return saturating ? (int8_t)saturate_s8(a * (1 << s)) : (int8_t)(uint8_t)((unsigned)a << s);
+    }
+
+    n = -s;
+    if(n > 8) {
+        return rounding ? 0 : (a < 0 ? -1 : 0);
+    }
+    // >> of a negative int is arithmetic on all supported compilers
+    return rounding ? (a + (1 << (n - 1))) >> n : a >> n;
+}
+
+
+#define AS_S8(x) vreinterpretq_s8_u8(x)
+#define AS_U8(x) vreinterpretq_u8_s8(x)
+
+#define BINARY_U8(name, vector_expr, scalar_expr) \
+    static uint8x16_t vector_##name(uint8x16_t a, uint8x16_t b) { return vector_expr; } \
+    static uint8_t scalar_##name(uint8_t a, uint8_t b) { return (uint8_t)(scalar_expr); }
+
+BINARY_U8(vaddq_u8,   vaddq_u8(a, b),   a + b)
+BINARY_U8(vsubq_u8,   vsubq_u8(a, b),   a - b)
+BINARY_U8(vhaddq_u8,  vhaddq_u8(a, b),  (a + b) >> 1)
+BINARY_U8(vrhaddq_u8, vrhaddq_u8(a, b), (a + b + 1) >> 1)
+BINARY_U8(vhsubq_u8,  vhsubq_u8(a, b),  (a - b) >> 1)
+BINARY_U8(vqaddq_u8,  vqaddq_u8(a, b),  saturate_u8(a + b))
+BINARY_U8(vqsubq_u8,  vqsubq_u8(a, b),  saturate_u8(a - b))
+BINARY_U8(vmulq_u8,   vmulq_u8(a, b),   a * b)
+BINARY_U8(vabdq_u8,   vabdq_u8(a, b),   a > b ? a - b : b - a)
+BINARY_U8(vmaxq_u8,   vmaxq_u8(a, b),   a > b ? a : b)
+BINARY_U8(vminq_u8,   vminq_u8(a, b),   a < b ? a : b)
+BINARY_U8(vtstq_u8,   vtstq_u8(a, b),   (a & b) != 0 ? 0xff : 0)
+BINARY_U8(vceqq_u8,   vceqq_u8(a, b),   a == b ? 0xff : 0)
+BINARY_U8(vcgtq_u8,   vcgtq_u8(a, b),   a > b ? 0xff : 0)
+BINARY_U8(vcgeq_u8,   vcgeq_u8(a, b),   a >= b ? 0xff : 0)
+BINARY_U8(vbicq_u8,   vbicq_u8(a, b),   a & ~b)
+BINARY_U8(vshlq_u8,   vshlq_u8(a, AS_S8(b)),   ref_shift_u8(a, s8(b), 0, 0))
+BINARY_U8(vrshlq_u8,  vrshlq_u8(a, AS_S8(b)),  ref_shift_u8(a, s8(b), 1, 0))
+BINARY_U8(vqshlq_u8,  vqshlq_u8(a, AS_S8(b)),  ref_shift_u8(a, s8(b), 0, 1))
+BINARY_U8(vqrshlq_u8, vqrshlq_u8(a, AS_S8(b)), ref_shift_u8(a, s8(b), 1, 1))
+BINARY_U8(vqaddq_s8,  AS_U8(vqaddq_s8(AS_S8(a), AS_S8(b))),  saturate_s8(s8(a) + s8(b)))
+BINARY_U8(vqsubq_s8,  AS_U8(vqsubq_s8(AS_S8(a), AS_S8(b))),  saturate_s8(s8(a) - s8(b)))
+BINARY_U8(vhaddq_s8,  AS_U8(vhaddq_s8(AS_S8(a), AS_S8(b))),  (s8(a) + s8(b)) >> 1)
+BINARY_U8(vrhaddq_s8, AS_U8(vrhaddq_s8(AS_S8(a), AS_S8(b))), (s8(a) + s8(b) + 1) >> 1)
+BINARY_U8(vabdq_s8,   AS_U8(vabdq_s8(AS_S8(a), AS_S8(b))),   abs(s8(a) - s8(b)))
+BINARY_U8(vmaxq_s8,   AS_U8(vmaxq_s8(AS_S8(a), AS_S8(b))),   s8(a) > s8(b) ? a : b)
+BINARY_U8(vcgtq_s8,   vcgtq_s8(AS_S8(a), AS_S8(b)),          s8(a) > s8(b) ? 0xff : 0)
+BINARY_U8(vshlq_s8,   AS_U8(vshlq_s8(AS_S8(a), AS_S8(b))),   ref_shift_s8(s8(a), s8(b), 0, 0))
+BINARY_U8(vrshlq_s8,  AS_U8(vrshlq_s8(AS_S8(a), AS_S8(b))),  ref_shift_s8(s8(a), s8(b), 1, 0))
+BINARY_U8(vqshlq_s8,  AS_U8(vqshlq_s8(AS_S8(a), AS_S8(b))),  ref_shift_s8(s8(a), s8(b), 0, 1))
+BINARY_U8(vqrshlq_s8, AS_U8(vqrshlq_s8(AS_S8(a), AS_S8(b))), ref_shift_s8(s8(a), s8(b), 1, 1))
+
+#define BINARY_ENTRY(name) {#name, vector_##name, scalar_##name}
+
+static const struct {
+    const char *name;
+    uint8x16_t (*vector)(uint8x16_t a, uint8x16_t b);
+    uint8_t (*scalar)(uint8_t a, uint8_t b);
+} binary_u8_ops[] = {
+    BINARY_ENTRY(vaddq_u8), BINARY_ENTRY(vsubq_u8), BINARY_ENTRY(vhaddq_u8),
+    BINARY_ENTRY(vrhaddq_u8), BINARY_ENTRY(vhsubq_u8), BINARY_ENTRY(vqaddq_u8),
+    BINARY_ENTRY(vqsubq_u8), BINARY_ENTRY(vmulq_u8), BINARY_ENTRY(vabdq_u8),
+    BINARY_ENTRY(vmaxq_u8), BINARY_ENTRY(vminq_u8), BINARY_ENTRY(vtstq_u8),
+    BINARY_ENTRY(vceqq_u8), BINARY_ENTRY(vcgtq_u8), BINARY_ENTRY(vcgeq_u8),
+    BINARY_ENTRY(vbicq_u8), BINARY_ENTRY(vshlq_u8), BINARY_ENTRY(vrshlq_u8),
+    BINARY_ENTRY(vqshlq_u8), BINARY_ENTRY(vqrshlq_u8), BINARY_ENTRY(vqaddq_s8),
+    BINARY_ENTRY(vqsubq_s8), BINARY_ENTRY(vhaddq_s8), BINARY_ENTRY(vrhaddq_s8),
+    BINARY_ENTRY(vabdq_s8), BINARY_ENTRY(vmaxq_s8), BINARY_ENTRY(vcgtq_s8),
+    BINARY_ENTRY(vshlq_s8), BINARY_ENTRY(vrshlq_s8), BINARY_ENTRY(vqshlq_s8),
+    BINARY_ENTRY(vqrshlq_s8)
+};
+
+
+static unsigned long check_binary_u8(void) {
+    unsigned long failures = 0;
+    uint8_t a[16], b[16], result[16];
+    size_t op;
+    int hi, lo, lane;
+
+    for(op = 0; op < sizeof(binary_u8_ops) / sizeof(binary_u8_ops[0]); op++) {
+        begin_check(binary_u8_ops[op].name);
+
+        // lane l sees a = hi + 17 l and all b = l (mod 16), so every pair
+        // is covered and neighbouring lanes hold different values
+        for(hi = 0; hi < 256; hi++) {
+            for(lo = 0; lo < 256; lo += 16) {
+                for(lane = 0; lane < 16; lane++) {
+                    a[lane] = (uint8_t)(hi + 17 * lane);
+                    b[lane] = (uint8_t)(lo + lane);
+                }
+                vst1q_u8(result, binary_u8_ops[op].vector(vld1q_u8(a), vld1q_u8(b)));
+
+                for(lane = 0; lane < 16; lane++) {
+                    uint8_t expected = binary_u8_ops[op].scalar(a[lane], b[lane]);
+                    if(result[lane] != expected) {
+                        fail("a | b << 8", 0, (size_t)(a[lane] | b[lane] << 8), result[lane], expected);
+                    }
+                }
+            }
+        }
+
+        failures += end_check();
+    }
+
+    // three operands: all pairs of the factors with a random addend
+    begin_check("vmlaq_u8/vmlsq_u8");
+    for(hi = 0; hi < 256; hi++) {
+        for(lo = 0; lo < 256; lo += 16) {
+            uint8_t c[16], mla[16], mls[16];
+            uint8x16_t va, vb, vc;
+
+            for(lane = 0; lane < 16; lane++) {
+                a[lane] = (uint8_t)(hi + 17 * lane);
+                b[lane] = (uint8_t)(lo + lane);
+                c[lane] = (uint8_t)rng();
+            }
+            va = vld1q_u8(a);
+            vb = vld1q_u8(b);
+            vc = vld1q_u8(c);
+            vst1q_u8(mla, vmlaq_u8(vc, va, vb));
+            vst1q_u8(mls, vmlsq_u8(vc, va, vb));
+
+            for(lane = 0; lane < 16; lane++) {
+                if(mla[lane] != (uint8_t)(c[lane] + a[lane] * b[lane])) {
+                    fail("mla", 0, lane, mla[lane], (uint8_t)(c[lane] + a[lane] * b[lane]));
+                }
+                if(mls[lane] != (uint8_t)(c[lane] - a[lane] * b[lane])) {
+                    fail("mls", 0, lane, mls[lane], (uint8_t)(c[lane] - a[lane] * b[lane]));
+                }
+            }
+        }
+    }
+    failures += end_check();
+
+    return failures;
+}
+
+
+static uint8_t scalar_cnt(uint8_t x) {
+    return (uint8_t)__builtin_popcount(x);
+}
+
+
+static uint8_t scalar_clz(uint8_t x) {
+    return (uint8_t)(x == 0 ? 8 : __builtin_clz(x) - 24);
+}
+
+
+// leading bits equal to the sign bit, not counting the sign bit
+static uint8_t scalar_cls(uint8_t x) {
+    uint8_t bits = (uint8_t)(s8(x) < 0 ? ~x : x);
+    return (uint8_t)(scalar_clz(bits) - 1);
+}
+
+
+static unsigned long check_unary(void) {
+    unsigned long failures = 0;
+    uint8_t in[256];
+    int i;
+
+    for(i = 0; i < 256; i++) {
+        in[i] = (uint8_t)i;
+    }
+
+    begin_check("vcntq/vclzq/vclsq/vmvnq_u8");
+    for(i = 0; i < 256; i += 16) {
+        uint8_t cnt[16], clz[16], cls[16], mvn[16];
+        uint8x16_t v = vld1q_u8(in + i);
+        int lane;
+
+        vst1q_u8(cnt, vcntq_u8(v));
+        vst1q_u8(clz, vclzq_u8(v));
+        vst1q_u8(cls, AS_U8(vclsq_s8(AS_S8(v))));
+        vst1q_u8(mvn, vmvnq_u8(v));
+
+        for(lane = 0; lane < 16; lane++) {
+            uint8_t x = in[i + lane];
+            uint8_t not_x = (uint8_t)~x;
+
+            if(cnt[lane] != scalar_cnt(x)) fail("cnt", 0, x, cnt[lane], scalar_cnt(x));
+            if(clz[lane] != scalar_clz(x)) fail("clz", 0, x, clz[lane], scalar_clz(x));
+            if(cls[lane] != scalar_cls(x)) fail("cls", 0, x, cls[lane], scalar_cls(x));
+            if(mvn[lane] != not_x) fail("mvn", 0, x, mvn[lane], not_x);
+        }
+    }
+    failures += end_check();
+
+    begin_check("vabsq/vqabsq/vnegq/vqnegq_s8");
+    for(i = 0; i < 256; i += 16) {
+        uint8_t abs_[16], qabs[16], neg[16], qneg[16];
+        int8x16_t v = vld1q_s8((const int8_t *)in + i);
+        int lane;
+
+        vst1q_u8(abs_, AS_U8(vabsq_s8(v)));
+        vst1q_u8(qabs, AS_U8(vqabsq_s8(v)));
+        vst1q_u8(neg, AS_U8(vnegq_s8(v)));
+        vst1q_u8(qneg, AS_U8(vqnegq_s8(v)));
+
+        for(lane = 0; lane < 16; lane++) {
+            int x = s8(in[i + lane]);
+
+            if(abs_[lane] != (uint8_t)abs(x)) fail("abs", 0, (uint8_t)x, abs_[lane], (uint8_t)abs(x));
+            if(qabs[lane] != saturate_s8(abs(x))) fail("qabs", 0, (uint8_t)x, qabs[lane], saturate_s8(abs(x)));
+            if(neg[lane] != (uint8_t)-x) fail("neg", 0, (uint8_t)x, neg[lane], (uint8_t)-x);
+            if(qneg[lane] != saturate_s8(-x)) fail("qneg", 0, (uint8_t)x, qneg[lane], saturate_s8(-x));
+        }
+    }
+    failures += end_check();
+
+    // all 16-bit inputs of the narrowing conversions
+    begin_check("vqmovn/vqmovun/vrshrn_n_16");
+    for(i = 0; i < 65536; i += 8) {
+        uint16_t x[8];
+        uint8_t qmovn_u[8], qmovun[8], rshrn[8];
+        int8_t qmovn_s[8];
+        uint16x8_t v;
+        int lane;
+
+        for(lane = 0; lane < 8; lane++) {
+            x[lane] = (uint16_t)(i + lane);
+        }
+        v = vld1q_u16(x);
+        vst1_u8(qmovn_u, vqmovn_u16(v));
+        vst1_s8(qmovn_s, vqmovn_s16(vreinterpretq_s16_u16(v)));
+        vst1_u8(qmovun, vqmovun_s16(vreinterpretq_s16_u16(v)));
+        vst1_u8(rshrn, vrshrn_n_u16(v, 4));
+
+        for(lane = 0; lane < 8; lane++) {
+            int s = (int16_t)x[lane];
+            uint8_t expected_u = (uint8_t)(x[lane] > 255 ? 255 : x[lane]);
+            uint8_t expected_s = saturate_s8(s);
+            uint8_t expected_un = saturate_u8(s);
+            uint8_t expected_r = (uint8_t)((x[lane] + 8) >> 4);
+
+            if(qmovn_u[lane] != expected_u) fail("qmovn_u16", 0, x[lane], qmovn_u[lane], expected_u);
+            if((uint8_t)qmovn_s[lane] != expected_s) fail("qmovn_s16", 0, x[lane], (uint8_t)qmovn_s[lane], expected_s);
+            if(qmovun[lane] != expected_un) fail("qmovun_s16", 0, x[lane], qmovun[lane], expected_un);
+            if(rshrn[lane] != expected_r) fail("rshrn_n_u16", 0, x[lane], rshrn[lane], expected_r);
+        }
+    }
+    failures += end_check();
+
+    return failures;
+}
+
+
+static int16_t saturate_s16(int64_t x) {
+    return (int16_t)(x < -32768 ? -32768 : x > 32767 ? 32767 : x);
+}
+
+
+// Q15 multiplies are too wide for exhaustive checks: edge values against
+// each other plus random pairs
+static unsigned long check_q15(unsigned iterations) {
+    static const int16_t edges[8] = {-32768, -32767, -16384, -1, 0, 1, 16384, 32767};
+    unsigned long samples = 4096ul * iterations;
+    unsigned long s;
+
+    begin_check("vqdmulhq/vqrdmulhq_s16");
+    for(s = 0; s < samples; s++) {
+        int16_t a[8], b[8], qdmulh[8], qrdmulh[8];
+        int lane;
+
+        for(lane = 0; lane < 8; lane++) {
+            a[lane] = s < 8 ? edges[s] : (int16_t)rng();
+            b[lane] = s < 8 ? edges[lane] : (int16_t)rng();
+        }
+        vst1q_s16(qdmulh, vqdmulhq_s16(vld1q_s16(a), vld1q_s16(b)));
+        vst1q_s16(qrdmulh, vqrdmulhq_s16(vld1q_s16(a), vld1q_s16(b)));
+
+        for(lane = 0; lane < 8; lane++) {
+            int64_t product = 2 * (int64_t)a[lane] * b[lane];
+            int16_t expected = saturate_s16(product >> 16);
+            int16_t expected_r = saturate_s16((product + (1 << 15)) >> 16);
+
+            if(qdmulh[lane] != expected) {
+                fail("qdmulh", 0, lane, (uint16_t)qdmulh[lane], (uint16_t)expected);
+            }
+            if(qrdmulh[lane] != expected_r) {
+                fail("qrdmulh", 0, lane, (uint16_t)qrdmulh[lane], (uint16_t)expected_r);
+            }
+        }
+    }
+
+    return end_check();
+}
+
+
+// ----------------------------------------------------------------------------
+// scalar references of the stream kernels
+
+static size_t ref_pack(const uint8_t *in, size_t n, unsigned bits, uint8_t *out) {
+    size_t size = bitpack_packed_size(n, bits), i;
+
+    memset(out, 0, size);
+    for(i = 0; i < n * bits; i++) {
+        if((in[i / bits] >> (i % bits)) & 1) {
+            out[i / 8] |= (uint8_t)(1u << (i % 8));
+        }
+    }
+    return size;
+}
+
+
+static size_t ref_rle(const uint8_t *in, size_t n, uint8_t *out) {
+    size_t i = 0, o = 0;
+
+    while(i < n) {
+        size_t run = 1;
+
+        while(i + run < n && run < 255 && in[i + run] == in[i]) {
+            run++;
+        }
+        out[o++] = (uint8_t)run;
+        out[o++] = in[i];
+        i += run;
+    }
+    return o;
+}
+
+
+static unsigned bit_length(uint32_t x) {
+    return x == 0 ? 0 : 32 - (unsigned)__builtin_clz(x);
+}
+
+
+static size_t ref_svb(const uint32_t *in, size_t n, uint8_t *out) {
+    size_t control = (n + 3) / 4, o = control, i;
+    unsigned k;
+
+    memset(out, 0, control);
+    for(i = 0; i < n; i++) {
+        unsigned bytes = bit_length(in[i]) <= 8 ? 1 : (bit_length(in[i]) + 7) / 8;
+
+        out[i / 4] |= (uint8_t)((bytes - 1) << (2 * (i % 4)));
+        for(k = 0; k < bytes; k++) {
+            out[o++] = (uint8_t)(in[i] >> (8 * k));
+        }
+    }
+    return o;
+}
+
+
+// decodes one code point, returns its length or 0 if invalid
+static size_t ref_utf8_decode(const uint8_t *in, size_t len, uint32_t *code_point) {
+    static const uint32_t min_value[5] = {0, 0, 0x80, 0x800, 0x10000};
+    size_t length, k;
+    uint32_t c = in[0];
+
+    if(c < 0x80) {
+        *code_point = c;
+        return 1;
+    } else if((c & 0xe0) == 0xc0) {
+        length = 2;
+        c &= 0x1f;
+    } else if((c & 0xf0) == 0xe0) {
+        length = 3;
+        c &= 0x0f;
+    } else if((c & 0xf8) == 0xf0) {
+        length = 4;
+        c &= 0x07;
+    } else {
+        return 0;
+    }
+
+    if(length > len) {
+        return 0;
+    }
+    for(k = 1; k < length; k++) {
+        if((in[k] & 0xc0) != 0x80) {
+            return 0;
+        }
+        c = (c << 6) | (in[k] & 0x3f);
+    }
+    if(c < min_value[length] || c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff)) {
+        return 0;
+    }
+
+    *code_point = c;
+    return length;
+}
+
+
+// returns the number of UTF-16 units, 0 for invalid input; latin1 gets the
+// Latin-1 length or 0 if a code point does not fit
+static size_t ref_utf8(const uint8_t *in, size_t len, uint16_t *utf16, uint8_t *latin1, size_t *latin1_len) {
+    size_t i = 0, units = 0, bytes = 0;
+    int fits = 1;
+
+    while(i < len) {
+        uint32_t c;
+        size_t length = ref_utf8_decode(in + i, len - i, &c);
+
+        if(length == 0) {
+            *latin1_len = 0;
+            return 0;
+        }
+        if(c >= 0x10000) {
+            utf16[units++] = (uint16_t)(0xd800 + ((c - 0x10000) >> 10));
+            utf16[units++] = (uint16_t)(0xdc00 + ((c - 0x10000) & 0x3ff));
+        } else {
+            utf16[units++] = (uint16_t)c;
+        }
+        if(c <= 0xff) {
+            latin1[bytes++] = (uint8_t)c;
+        } else {
+            fits = 0;
+        }
+        i += length;
+    }
+
+    *latin1_len = fits ? bytes : 0;
+    return units;
+}
+
+
+// random mix of 1 to 4 byte sequences, sometimes with a broken byte
+static size_t random_utf8(uint8_t *out, size_t max) {
+    size_t o = 0;
+    uint32_t mode = rng() % 3;
+
+    while(o + 4 <= max) {
+        uint32_t c, r = rng() % 16;
+
+        if(mode == 0 || r < 8) {
+            c = rng() % 0x80;
+        } else if(mode == 1 || r < 12) {
+            c = 0x80 + rng() % 0x780;
+        } else if(r < 14) {
+            c = 0x800 + rng() % 0xf800;
+            if(c >= 0xd800 && c <= 0xdfff) {
+                c -= 0x800;
+            }
+        } else {
+            c = 0x10000 + rng() % 0x100000;
+        }
+
+        if(c < 0x80) {
+            out[o++] = (uint8_t)c;
+        } else if(c < 0x800) {
+            out[o++] = (uint8_t)(0xc0 | c >> 6);
+            out[o++] = (uint8_t)(0x80 | (c & 0x3f));
+        } else if(c < 0x10000) {
+            out[o++] = (uint8_t)(0xe0 | c >> 12);
+            out[o++] = (uint8_t)(0x80 | ((c >> 6) & 0x3f));
+            out[o++] = (uint8_t)(0x80 | (c & 0x3f));
+        } else {
+            out[o++] = (uint8_t)(0xf0 | c >> 18);
+            out[o++] = (uint8_t)(0x80 | ((c >> 12) & 0x3f));
+            out[o++] = (uint8_t)(0x80 | ((c >> 6) & 0x3f));
+            out[o++] = (uint8_t)(0x80 | (c & 0x3f));
+        }
+    }
+
+    if(o > 0 && rng() % 2 == 0) {
+        out[rng() % o] = (uint8_t)rng();
+    }
+    return o;
+}
+
+
+static int ref_class(uint8_t c, unsigned classes) {
+    return ((classes & ASCII_CLASS_DIGIT) && c >= '0' && c <= '9') ||
+           ((classes & ASCII_CLASS_ALPHA) && ((c | 0x20) >= 'a' && (c | 0x20) <= 'z')) ||
+           ((classes & ASCII_CLASS_SPACE) && (c == ' ' || (c >= '\t' && c <= '\r')));
+}
+
+
+static uint32_t ref_crc32c(uint32_t crc, const uint8_t *data, size_t n) {
+    size_t i;
+    int k;
+
+    crc = ~crc;
+    for(i = 0; i < n; i++) {
+        crc ^= data[i];
+        for(k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0x82f63b78u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+
+// ----------------------------------------------------------------------------
+// stream kernels
+
+static unsigned long check_bitpack(unsigned iterations) {
+    unsigned it;
+
+    begin_check("bitpack/bitplane");
+    for(it = 0; it < iterations; it++) {
+        size_t n = random_length();
+        unsigned bits = 1 + rng() % 8;
+        uint8_t *in = buffer_in + rng() % MAX_OFFSET;
+        uint8_t *out = buffer_out + rng() % MAX_OFFSET;
+        size_t size, i;
+
+        random_bytes(in, n);
+
+        size = ref_pack(in, n, bits, buffer_ref);
+        guard_fill(out, size);
+        if(bitpack_pack(in, n, bits, out) != size) {
+            fail("pack size", n, 0, bitpack_pack(in, n, bits, out), size);
+        }
+        compare("pack", n, out, buffer_ref, size);
+        guard_check("pack guard", n, out, size);
+
+        guard_fill(buffer_tmp, n);
+        bitpack_unpack(out, n, bits, buffer_tmp);
+        for(i = 0; i < n; i++) {
+            buffer_ref[i] = (uint8_t)(in[i] & ((1u << bits) - 1));
+        }
+        compare("unpack", n, buffer_tmp, buffer_ref, n);
+        guard_check("unpack guard", n, buffer_tmp, n);
+
+        size = 8 * bitplane_stride(n);
+        guard_fill(out, size);
+        bitplane_split(in, n, out);
+        guard_check("split guard", n, out, size);
+        for(i = 0; i < n; i++) {
+            unsigned k;
+            for(k = 0; k < 8; k++) {
+                unsigned bit = (out[k * bitplane_stride(n) + i / 8] >> (i % 8)) & 1;
+                if(bit != ((in[i] >> k) & 1u)) {
+                    fail("split", n, i, bit, (in[i] >> k) & 1u);
+                }
+            }
+        }
+
+        guard_fill(buffer_tmp, n);
+        bitplane_merge(out, n, buffer_tmp);
+        compare("merge", n, buffer_tmp, in, n);
+        guard_check("merge guard", n, buffer_tmp, n);
+    }
+
+    return end_check();
+}
+
+
+static unsigned long check_delta_rle(unsigned iterations) {
+    unsigned it;
+
+    begin_check("delta/rle");
+    for(it = 0; it < iterations; it++) {
+        size_t n = random_length();
+        uint8_t *in = buffer_in + rng() % MAX_OFFSET;
+        uint8_t *out = buffer_out + rng() % MAX_OFFSET;
+        size_t size, i;
+
+        random_bytes(in, n);
+
+        for(i = 0; i < n; i++) {
+            buffer_ref[i] = (uint8_t)(in[i] - (i > 0 ? in[i - 1] : 0));
+        }
+        guard_fill(out, n);
+        delta_encode_u8(in, n, out);
+        compare("delta encode", n, out, buffer_ref, n);
+        guard_check("delta encode guard", n, out, n);
+
+        guard_fill(buffer_tmp, n);
+        delta_decode_u8(out, n, buffer_tmp);
+        compare("delta decode", n, buffer_tmp, in, n);
+        guard_check("delta decode guard", n, buffer_tmp, n);
+
+        size = ref_rle(in, n, buffer_ref);
+        guard_fill(out, size);
+        if(rle_encode(in, n, out) != size) {
+            fail("rle size", n, 0, rle_encode(in, n, out), size);
+        }
+        compare("rle encode", n, out, buffer_ref, size);
+        guard_check("rle encode guard", n, out, size);
+
+        guard_fill(buffer_tmp, n);
+        if(rle_decode(out, size, buffer_tmp, n) != n) {
+            fail("rle decode size", n, 0, rle_decode(out, size, buffer_tmp, n), n);
+        }
+        compare("rle decode", n, buffer_tmp, in, n);
+        guard_check("rle decode guard", n, buffer_tmp, n);
+    }
+
+    return end_check();
+}
+
+
+static unsigned long check_bswap(unsigned iterations) {
+    unsigned default_unroll = stream_settings.unroll, unroll, it;
+
+    begin_check("bswap/big-endian");
+    for(it = 0; it < iterations; it++) {
+        size_t n = random_length() / 4;
+        // element aligned offsets for the typed kernels, any offset for the
+        // byte stream conversions
+        size_t offset = 8 * (rng() % (MAX_OFFSET / 8));
+        uint8_t *in = buffer_in + offset;
+        uint8_t *stream = buffer_in + rng() % MAX_OFFSET;
+        uint8_t *out = buffer_out + offset;
+        size_t i;
+
+        random_bytes(buffer_in, 8 * n + MAX_OFFSET);
+
+        // every unrolled variant (vectors in flight)
+        for(unroll = 1; unroll <= 4; unroll *= 2) {
+            stream_settings.unroll = unroll;
+
+            guard_fill(out, 2 * n);
+            bswap16_buf((const uint16_t *)in, n, (uint16_t *)out);
+            for(i = 0; i < 2 * n; i++) {
+                buffer_ref[i] = in[i ^ 1];
+            }
+            compare("bswap16", n * 10 + unroll, out, buffer_ref, 2 * n);
+            guard_check("bswap16 guard", n * 10 + unroll, out, 2 * n);
+
+            guard_fill(out, 4 * n);
+            bswap32_buf((const uint32_t *)in, n, (uint32_t *)out);
+            for(i = 0; i < 4 * n; i++) {
+                buffer_ref[i] = in[i ^ 3];
+            }
+            compare("bswap32", n * 10 + unroll, out, buffer_ref, 4 * n);
+            guard_check("bswap32 guard", n * 10 + unroll, out, 4 * n);
+
+            guard_fill(out, 8 * n);
+            bswap64_buf((const uint64_t *)in, n, (uint64_t *)out);
+            for(i = 0; i < 8 * n; i++) {
+                buffer_ref[i] = in[i ^ 7];
+            }
+            compare("bswap64", n * 10 + unroll, out, buffer_ref, 8 * n);
+            guard_check("bswap64 guard", n * 10 + unroll, out, 8 * n);
+        }
+        stream_settings.unroll = default_unroll;
+
+        // the conversions are checked value by value on little-endian hosts
+        guard_fill(out, 4 * n);
+        be16_to_u32(stream, n, (uint32_t *)out);
+        guard_check("be16_to_u32 guard", n, out, 4 * n);
+        for(i = 0; i < n; i++) {
+            uint32_t expected = (uint32_t)stream[2 * i] << 8 | stream[2 * i + 1], got;
+            memcpy(&got, out + 4 * i, 4);
+            if(got != expected) {
+                fail("be16_to_u32", n, i, got, expected);
+            }
+        }
+
+        guard_fill(out, 4 * n);
+        be32_to_u32(stream, n, (uint32_t *)out);
+        guard_check("be32_to_u32 guard", n, out, 4 * n);
+        for(i = 0; i < n; i++) {
+            uint32_t expected = (uint32_t)stream[4 * i] << 24 | (uint32_t)stream[4 * i + 1] << 16 |
+                                (uint32_t)stream[4 * i + 2] << 8 | stream[4 * i + 3], got;
+            memcpy(&got, out + 4 * i, 4);
+            if(got != expected) {
+                fail("be32_to_u32", n, i, got, expected);
+            }
+        }
+
+        guard_fill(out, 4 * n);
+        be16_to_f32(stream, n, 1.0f / 32768.0f, (float *)out);
+        guard_check("be16_to_f32 guard", n, out, 4 * n);
+        for(i = 0; i < n; i++) {
+            float expected = (float)(int16_t)(stream[2 * i] << 8 | stream[2 * i + 1]) * (1.0f / 32768.0f), got;
+            memcpy(&got, out + 4 * i, 4);
+            if(memcmp(&got, &expected, 4) != 0) {
+                fail("be16_to_f32", n, i, (unsigned long)(got * 32768.0f), (unsigned long)(expected * 32768.0f));
+            }
+        }
+    }
+
+    return end_check();
+}
+
+
+static unsigned long check_bitlen(unsigned iterations) {
+    unsigned it;
+
+    begin_check("bitlen/ilog2/normalize");
+    for(it = 0; it < iterations; it++) {
+        size_t n = random_length() / 4;
+        uint32_t *in = (uint32_t *)(buffer_in + 4 * (rng() % (MAX_OFFSET / 4)));
+        uint8_t *out = buffer_out + rng() % MAX_OFFSET;
+        uint32_t *normalized = (uint32_t *)buffer_tmp;
+        size_t i, total = 0;
+
+        // random bit lengths rather than random values
+        for(i = 0; i < n; i++) {
+            in[i] = rng() >> (rng() % 32);
+            if(rng() % 16 == 0) {
+                in[i] = 0;
+            }
+        }
+
+        guard_fill(out, n);
+        bitlen_u32(in, n, out);
+        guard_check("bitlen_u32 guard", n, out, n);
+        for(i = 0; i < n; i++) {
+            if(out[i] != bit_length(in[i])) {
+                fail("bitlen_u32", n, i, out[i], bit_length(in[i]));
+            }
+        }
+
+        guard_fill(out, n);
+        ilog2_u32(in, n, out);
+        guard_check("ilog2_u32 guard", n, out, n);
+        for(i = 0; i < n; i++) {
+            uint8_t expected = (uint8_t)(bit_length(in[i]) - 1);
+            if(out[i] != expected) {
+                fail("ilog2_u32", n, i, out[i], expected);
+            }
+        }
+
+        guard_fill(out, n);
+        normalize_u32(in, n, normalized, out);
+        guard_check("normalize_u32 guard", n, out, n);
+        for(i = 0; i < n; i++) {
+            unsigned shift = 32 - bit_length(in[i]);
+            uint32_t expected = shift == 32 ? 0 : in[i] << shift;
+            if(out[i] != shift || normalized[i] != expected) {
+                fail("normalize_u32", n, i, normalized[i], expected);
+            }
+        }
+
+        guard_fill(out, n);
+        varint_len_u32(in, n, out);
+        guard_check("varint_len guard", n, out, n);
+        for(i = 0; i < n; i++) {
+            unsigned expected = in[i] == 0 ? 1 : (bit_length(in[i]) + 6) / 7;
+            if(out[i] != expected) {
+                fail("varint_len_u32", n, i, out[i], expected);
+            }
+            total += expected;
+        }
+        if(varint_size_u32(in, n) != total) {
+            fail("varint_size_u32", n, 0, varint_size_u32(in, n), total);
+        }
+
+        // 8 and 16 bit variants on the low bits of the same values
+        {
+            uint8_t *in8 = (uint8_t *)in;
+            uint16_t *in16 = (uint16_t *)in;
+
+            guard_fill(out, n);
+            bitlen_u8(in8, n, out);
+            guard_check("bitlen_u8 guard", n, out, n);
+            for(i = 0; i < n; i++) {
+                if(out[i] != bit_length(in8[i])) {
+                    fail("bitlen_u8", n, i, out[i], bit_length(in8[i]));
+                }
+            }
+
+            guard_fill(out, n);
+            bitlen_u16(in16, n, out);
+            guard_check("bitlen_u16 guard", n, out, n);
+            for(i = 0; i < n; i++) {
+                if(out[i] != bit_length(in16[i])) {
+                    fail("bitlen_u16", n, i, out[i], bit_length(in16[i]));
+                }
+            }
+        }
+    }
+
+    return end_check();
+}
+
+
+static unsigned long check_streamvbyte(unsigned iterations) {
+    unsigned it;
+
+    begin_check("streamvbyte");
+    for(it = 0; it < iterations; it++) {
+        size_t n = random_length() / 4;
+        uint32_t *in = (uint32_t *)(buffer_in + 4 * (rng() % (MAX_OFFSET / 4)));
+        uint8_t *out = buffer_out + rng() % MAX_OFFSET;
+        uint32_t *decoded = (uint32_t *)buffer_tmp;
+        size_t size, i;
+
+        for(i = 0; i < n; i++) {
+            in[i] = rng() >> (8 * (rng() % 4));
+        }
+
+        // the encoder may write up to the worst case size
+        size = ref_svb(in, n, buffer_ref);
+        guard_fill(out, svb_max_encoded_size(n));
+        if(svb_encode(in, n, out) != size) {
+            fail("encode size", n, 0, svb_encode(in, n, out), size);
+        }
+        compare("encode", n, out, buffer_ref, size);
+        guard_check("encode guard", n, out, svb_max_encoded_size(n));
+
+        guard_fill(buffer_tmp, 4 * n);
+        if(svb_decode(out, size, decoded, n) != size) {
+            fail("decode size", n, 0, svb_decode(out, size, decoded, n), size);
+        }
+        compare("decode", n, buffer_tmp, (const uint8_t *)in, 4 * n);
+        guard_check("decode guard", n, buffer_tmp, 4 * n);
+
+        if(size > (n + 3) / 4 && svb_decode(out, size - 1, decoded, n) != 0) {
+            fail("truncated", n, 0, svb_decode(out, size - 1, decoded, n), 0);
+        }
+    }
+
+    return end_check();
+}
+
+
+static unsigned long check_utf8(unsigned iterations) {
+    unsigned it;
+
+    begin_check("utf8");
+    for(it = 0; it < iterations; it++) {
+        uint8_t *in = buffer_in + rng() % MAX_OFFSET;
+        size_t len = random_utf8(in, random_length());
+        uint16_t *utf16 = (uint16_t *)(buffer_out + 2 * (rng() % (MAX_OFFSET / 2)));
+        uint16_t *ref_utf16 = (uint16_t *)buffer_ref;
+        uint8_t *ref_latin1 = buffer_ref + 2 * len + 2;
+        size_t units, latin1_len, i;
+        int valid;
+
+        units = ref_utf8(in, len, ref_utf16, ref_latin1, &latin1_len);
+        valid = len == 0 || units > 0;
+
+        if(utf8_validate(in, len) != valid) {
+            fail("validate", len, 0, utf8_validate(in, len), valid);
+        }
+
+        for(i = 0; i < len && in[i] < 0x80; i++) {
+        }
+        if(utf8_is_ascii(in, len) != (i == len)) {
+            fail("is_ascii", len, 0, utf8_is_ascii(in, len), i == len);
+        }
+
+        guard_fill((uint8_t *)utf16, 2 * units);
+        if(utf8_to_utf16(in, len, utf16) != units) {
+            fail("utf16 size", len, 0, utf8_to_utf16(in, len, utf16), units);
+        }
+        compare("utf16", len, (const uint8_t *)utf16, (const uint8_t *)ref_utf16, 2 * units);
+        guard_check("utf16 guard", len, (const uint8_t *)utf16, 2 * units);
+
+        guard_fill(buffer_tmp, latin1_len);
+        if(utf8_to_latin1(in, len, buffer_tmp) != latin1_len) {
+            fail("latin1 size", len, 0, utf8_to_latin1(in, len, buffer_tmp), latin1_len);
+        }
+        compare("latin1", len, buffer_tmp, ref_latin1, latin1_len);
+    }
+
+    return end_check();
+}
+
+
+static unsigned long check_ascii(unsigned iterations) {
+    unsigned it;
+
+    begin_check("ascii");
+    for(it = 0; it < iterations; it++) {
+        size_t n = random_length();
+        unsigned classes = 1 + rng() % 7;
+        uint8_t *in = buffer_in + rng() % MAX_OFFSET;
+        uint8_t *out = buffer_out + rng() % MAX_OFFSET;
+        uint8_t *ends = buffer_tmp + MAX_LEN;
+        size_t bitmap_size = (n + 7) / 8, tokens = 0, i;
+        int equal;
+
+        random_bytes(in, n);
+
+        for(i = 0; i < n; i++) {
+            buffer_ref[i] = (uint8_t)(in[i] >= 'a' && in[i] <= 'z' ? in[i] - 0x20 : in[i]);
+        }
+        guard_fill(out, n);
+        ascii_toupper(in, n, out);
+        compare("toupper", n, out, buffer_ref, n);
+        guard_check("toupper guard", n, out, n);
+
+        for(i = 0; i < n; i++) {
+            buffer_ref[i] = (uint8_t)(in[i] >= 'A' && in[i] <= 'Z' ? in[i] + 0x20 : in[i]);
+        }
+        guard_fill(out, n);
+        ascii_tolower(in, n, out);
+        compare("tolower", n, out, buffer_ref, n);
+        guard_check("tolower guard", n, out, n);
+
+        // equal ignoring case to the lower case copy unless a byte is flipped
+        if(n > 0 && rng() % 2 == 0) {
+            out[rng() % n] ^= (uint8_t)(1u << (rng() % 8));
+        }
+        equal = 1;
+        for(i = 0; i < n; i++) {
+            equal &= buffer_ref[i] == (out[i] >= 'A' && out[i] <= 'Z' ? out[i] + 0x20 : out[i]);
+        }
+        if(ascii_equal_ignore_case(in, out, n) != equal) {
+            fail("equal_ignore_case", n, 0, ascii_equal_ignore_case(in, out, n), equal);
+        }
+
+        memset(buffer_ref, 0, bitmap_size);
+        for(i = 0; i < n; i++) {
+            if(ref_class(in[i], classes)) {
+                buffer_ref[i / 8] |= (uint8_t)(1u << (i % 8));
+            }
+        }
+        guard_fill(out, bitmap_size);
+        ascii_class_bitmap(in, n, classes, out);
+        compare("class_bitmap", n, out, buffer_ref, bitmap_size);
+        guard_check("class_bitmap guard", n, out, bitmap_size);
+
+        // tokens start where the class bit switches on and end where it
+        // switches off
+        memset(buffer_ref, 0, 2 * bitmap_size);
+        for(i = 0; i < n; i++) {
+            int in_class = ref_class(in[i], classes);
+            int previous = i > 0 && ref_class(in[i - 1], classes);
+
+            if(in_class && !previous) {
+                buffer_ref[i / 8] |= (uint8_t)(1u << (i % 8));
+                tokens++;
+            }
+            if(!in_class && previous) {
+                buffer_ref[bitmap_size + i / 8] |= (uint8_t)(1u << (i % 8));
+            }
+        }
+        guard_fill(out, bitmap_size);
+        guard_fill(ends, bitmap_size);
+        if(ascii_tokenize(in, n, classes, out, ends) != tokens) {
+            fail("tokenize count", n, 0, ascii_tokenize(in, n, classes, out, ends), tokens);
+        }
+        compare("tokenize starts", n, out, buffer_ref, bitmap_size);
+        compare("tokenize ends", n, ends, buffer_ref + bitmap_size, bitmap_size);
+        guard_check("tokenize starts guard", n, out, bitmap_size);
+        guard_check("tokenize ends guard", n, ends, bitmap_size);
+    }
+
+    return end_check();
+}
+
+
+static unsigned long check_checksum(unsigned iterations) {
+    unsigned it;
+
+    begin_check("checksum");
+    for(it = 0; it < iterations; it++) {
+        size_t n = random_length();
+        // a chunk boundary for the streaming interface, even for Fletcher-32
+        size_t split = n > 0 ? (rng() % (n + 1)) & ~(size_t)1 : 0;
+        uint8_t *in = buffer_in + rng() % MAX_OFFSET;
+        uint32_t s1 = 1, s2 = 0, f1 = 0, f2 = 0, w1 = 0, w2 = 0, expected;
+        size_t i;
+
+        random_bytes(in, n);
+        if(rng() % 4 == 0) {
+            // worst case for the deferred modulo reductions
+            memset(in, 0xff, n);
+        }
+
+        for(i = 0; i < n; i++) {
+            s1 = (s1 + in[i]) % 65521;
+            s2 = (s2 + s1) % 65521;
+            f1 = (f1 + in[i]) % 255;
+            f2 = (f2 + f1) % 255;
+        }
+        for(i = 0; i < n; i += 2) {
+            uint32_t word = in[i] | (i + 1 < n ? (uint32_t)in[i + 1] << 8 : 0);
+            w1 = (w1 + word) % 65535;
+            w2 = (w2 + w1) % 65535;
+        }
+
+        expected = s2 << 16 | s1;
+        if(adler32_update(adler32_update(ADLER32_INIT, in, split), in + split, n - split) != expected) {
+            fail("adler32", n, split, adler32_update(ADLER32_INIT, in, n), expected);
+        }
+        expected = f2 << 8 | f1;
+        if(fletcher16_update(fletcher16_update(FLETCHER16_INIT, in, split), in + split, n - split) != expected) {
+            fail("fletcher16", n, split, fletcher16_update(FLETCHER16_INIT, in, n), expected);
+        }
+        expected = w2 << 16 | w1;
+        if(fletcher32_update(fletcher32_update(FLETCHER32_INIT, in, split), in + split, n - split) != expected) {
+            fail("fletcher32", n, split, fletcher32_update(FLETCHER32_INIT, in, n), expected);
+        }
+        expected = ref_crc32c(CRC32C_INIT, in, n);
+        if(crc32c_update(crc32c_update(CRC32C_INIT, in, split), in + split, n - split) != expected) {
+            fail("crc32c", n, split, crc32c_update(CRC32C_INIT, in, n), expected);
+        }
+    }
+
+    return end_check();
+}
+
+
+static int ref_shift_s16(int16_t a, int s, int rounding, int saturating) {
+    int n;
+
+    if(s >= 0) {
+        if(a == 0) {
+            return 0;
+        }
+        if(s >= 16) {
+            return saturating ? (a < 0 ? -32768 : 32767) : 0;
+        }
+        return saturating ? saturate_s16((int64_t)a * (1 << s)) : (int16_t)(uint16_t)((unsigned)a << s);
+    }
+
+    n = -s;
+    if(n > 16) {
+        return rounding ? 0 : (a < 0 ? -1 : 0);
+    }
+    return rounding ? (a + (1 << (n - 1))) >> n : a >> n;
+}
+
+
+static unsigned long check_shift(unsigned iterations) {
+    unsigned it;
+
+    begin_check("shift");
+    for(it = 0; it < iterations; it++) {
+        size_t n = random_length() / 2;
+        int shift = (int)(rng() % 49) - 24;
+        int right = 1 + (int)(rng() % 16), left = (int)(rng() % 16);
+        shift_mode mode = (shift_mode)(rng() % 4);
+        int rounding = mode == SHIFT_ROUNDING || mode == SHIFT_SATURATING_ROUNDING;
+        int saturating = mode == SHIFT_SATURATING || mode == SHIFT_SATURATING_ROUNDING;
+        uint8_t *in = buffer_in + 2 * (rng() % (MAX_OFFSET / 2));
+        uint8_t *out = buffer_out + 2 * (rng() % (MAX_OFFSET / 2));
+        const int16_t *in16 = (const int16_t *)in;
+        int16_t *out16 = (int16_t *)out;
+        int8_t *shifts8 = (int8_t *)buffer_tmp;
+        int16_t *shifts16 = (int16_t *)(buffer_tmp + MAX_LEN);
+        size_t i;
+
+        random_bytes(in, 2 * n);
+        for(i = 0; i < n; i++) {
+            shifts8[i] = (int8_t)((int)(rng() % 21) - 10);
+            shifts16[i] = (int16_t)((int)(rng() % 37) - 18);
+        }
+
+        guard_fill(out, n);
+        shift_u8(in, n, shift, mode, out);
+        guard_check("shift_u8 guard", n, out, n);
+        for(i = 0; i < n; i++) {
+            uint8_t expected = (uint8_t)ref_shift_u8(in[i], (int8_t)shift, rounding, saturating);
+            if(out[i] != expected) {
+                fail("shift_u8", n, i, out[i], expected);
+            }
+        }
+
+        guard_fill(out, n);
+        shift_lanes_u8(in, shifts8, n, mode, out);
+        guard_check("shift_lanes_u8 guard", n, out, n);
+        for(i = 0; i < n; i++) {
+            uint8_t expected = (uint8_t)ref_shift_u8(in[i], shifts8[i], rounding, saturating);
+            if(out[i] != expected) {
+                fail("shift_lanes_u8", n, i, out[i], expected);
+            }
+        }
+
+        guard_fill(out, 2 * n);
+        shift_s16(in16, n, shift, mode, out16);
+        guard_check("shift_s16 guard", n, out, 2 * n);
+        for(i = 0; i < n; i++) {
+            int16_t expected = (int16_t)ref_shift_s16(in16[i], shift, rounding, saturating);
+            if(out16[i] != expected) {
+                fail("shift_s16", n, i, (uint16_t)out16[i], (uint16_t)expected);
+            }
+        }
+
+        guard_fill(out, 2 * n);
+        shift_lanes_s16(in16, shifts16, n, mode, out16);
+        guard_check("shift_lanes_s16 guard", n, out, 2 * n);
+        for(i = 0; i < n; i++) {
+            int16_t expected = (int16_t)ref_shift_s16(in16[i], shifts16[i], rounding, saturating);
+            if(out16[i] != expected) {
+                fail("shift_lanes_s16", n, i, (uint16_t)out16[i], (uint16_t)expected);
+            }
+        }
+
+        // accumulate and insert on top of a copy of the input
+        memcpy(out, in + n, 2 * n);
+        memset(out + 2 * n, GUARD_BYTE, GUARD);
+        shift_right_accumulate_s16(out16, in16, n, right, rounding);
+        guard_check("accumulate_s16 guard", n, out, 2 * n);
+        for(i = 0; i < n; i++) {
+            int16_t acc, expected;
+            memcpy(&acc, in + n + 2 * i, 2);
+            expected = (int16_t)(uint16_t)(acc + ref_shift_s16(in16[i], -right, rounding, 0));
+            if(out16[i] != expected) {
+                fail("accumulate_s16", n, i, (uint16_t)out16[i], (uint16_t)expected);
+            }
+        }
+
+        memcpy(out, in + n, n);
+        memset(out + n, GUARD_BYTE, GUARD);
+        shift_right_accumulate_u8(out, in, n, 1 + right % 8, rounding);
+        guard_check("accumulate_u8 guard", n, out, n);
+        for(i = 0; i < n; i++) {
+            uint8_t expected = (uint8_t)(in[n + i] + ref_shift_u8(in[i], (int8_t)-(1 + right % 8), rounding, 0));
+            if(out[i] != expected) {
+                fail("accumulate_u8", n, i, out[i], expected);
+            }
+        }
+
+        memcpy(out, in + n, 2 * n);
+        shift_left_insert_s16(out16, in16, n, left);
+        for(i = 0; i < n; i++) {
+            uint16_t dst, expected;
+            memcpy(&dst, in + n + 2 * i, 2);
+            expected = (uint16_t)(((unsigned)(uint16_t)in16[i] << left) | (dst & ((1u << left) - 1)));
+            if((uint16_t)out16[i] != expected) {
+                fail("left_insert_s16", n, i, (uint16_t)out16[i], expected);
+            }
+        }
+
+        memcpy(out, in + n, 2 * n);
+        shift_right_insert_s16(out16, in16, n, right);
+        for(i = 0; i < n; i++) {
+            uint16_t dst, expected, keep = (uint16_t)~(0xffffu >> right);
+            memcpy(&dst, in + n + 2 * i, 2);
+            expected = (uint16_t)(((uint16_t)in16[i] >> right) | (dst & keep));
+            if((uint16_t)out16[i] != expected) {
+                fail("right_insert_s16", n, i, (uint16_t)out16[i], expected);
+            }
+        }
+
+        memcpy(out, in + n, n);
+        shift_left_insert_u8(out, in, n, left % 8);
+        for(i = 0; i < n; i++) {
+            uint8_t expected = (uint8_t)((in[i] << (left % 8)) | (in[n + i] & ((1u << (left % 8)) - 1)));
+            if(out[i] != expected) {
+                fail("left_insert_u8", n, i, out[i], expected);
+            }
+        }
+
+        memcpy(out, in + n, n);
+        shift_right_insert_u8(out, in, n, 1 + right % 8);
+        for(i = 0; i < n; i++) {
+            unsigned keep = ~(0xffu >> (1 + right % 8)) & 0xff;
+            uint8_t expected = (uint8_t)((in[i] >> (1 + right % 8)) | (in[n + i] & keep));
+            if(out[i] != expected) {
+                fail("right_insert_u8", n, i, out[i], expected);
+            }
+        }
+
+        guard_fill(out, 2 * n);
+        rotate_left_u16((const uint16_t *)in, n, shift, (uint16_t *)out);
+        guard_check("rotate_u16 guard", n, out, 2 * n);
+        for(i = 0; i < n; i++) {
+            unsigned x = (uint16_t)in16[i], k = (unsigned)shift & 15;
+            uint16_t expected = (uint16_t)((x << k) | (x >> (16 - k))), got;
+            memcpy(&got, out + 2 * i, 2);
+            if(got != expected) {
+                fail("rotate_u16", n, i, got, expected);
+            }
+        }
+
+        guard_fill(out, n);
+        rotate_left_u8(in, n, shift, out);
+        guard_check("rotate_u8 guard", n, out, n);
+        for(i = 0; i < n; i++) {
+            unsigned k = (unsigned)shift & 7;
+            uint8_t expected = (uint8_t)((in[i] << k) | (in[i] >> (8 - k)));
+            if(out[i] != expected) {
+                fail("rotate_u8", n, i, out[i], expected);
+            }
+        }
+    }
+
+    if(shift_right_accumulate_u8(NULL, NULL, 0, 9, 0) != -1 || shift_left_insert_s16(NULL, NULL, 0, 16) != -1) {
+        fail("invalid shift", 0, 0, 0, (unsigned long)-1);
+    }
+
+    return end_check();
+}
+
+
+// one kernel per lane type and operation class, the tails of all of them run
+// through the same loop macros
+static unsigned long check_vecops(unsigned iterations) {
+    unsigned it;
+
+    begin_check("vecops");
+    for(it = 0; it < iterations; it++) {
+        size_t n = random_length() / 4;
+        int shift = (int)(rng() % 41) - 20;
+        uint8_t *a = buffer_in + 4 * (rng() % (MAX_OFFSET / 4));
+        uint8_t *b = buffer_tmp + 4 * (rng() % (MAX_OFFSET / 4));
+        uint8_t *out = buffer_out + 4 * (rng() % (MAX_OFFSET / 4));
+        const int8_t *a8 = (const int8_t *)a, *b8 = (const int8_t *)b;
+        const uint16_t *a16 = (const uint16_t *)a, *b16 = (const uint16_t *)b;
+        const int16_t *as16 = (const int16_t *)a, *bs16 = (const int16_t *)b;
+        const uint32_t *a32 = (const uint32_t *)a, *b32 = (const uint32_t *)b;
+        const int32_t *as32 = (const int32_t *)a, *bs32 = (const int32_t *)b;
+        float *af = (float *)buffer_ref, *bf = af + n;
+        uint16_t *out16 = (uint16_t *)out;
+        int16_t *outs16 = (int16_t *)out;
+        uint32_t *out32 = (uint32_t *)out;
+        int32_t *outs32 = (int32_t *)out;
+        float *outf = (float *)out;
+        size_t i;
+
+        random_bytes(a, 4 * n);
+        random_bytes(b, 4 * n);
+        for(i = 0; i < 2 * n; i++) {
+            af[i] = (float)((int)(rng() % 2001) - 1000) / 8.0f;
+        }
+
+        guard_fill(out, n);
+        vec_cmpgt_s8(a8, b8, n, out);
+        guard_check("cmpgt_s8 guard", n, out, n);
+        for(i = 0; i < n; i++) {
+            uint8_t expected = a8[i] > b8[i] ? 0xff : 0;
+            if(out[i] != expected) {
+                fail("cmpgt_s8", n, i, out[i], expected);
+            }
+        }
+
+        guard_fill(out, n);
+        vec_qabs_s8(a8, n, (int8_t *)out);
+        guard_check("qabs_s8 guard", n, out, n);
+        for(i = 0; i < n; i++) {
+            uint8_t expected = (uint8_t)(a8[i] == -128 ? 127 : a8[i] < 0 ? -a8[i] : a8[i]);
+            if(out[i] != expected) {
+                fail("qabs_s8", n, i, out[i], expected);
+            }
+        }
+
+        guard_fill(out, 2 * n);
+        vec_abd_u16(a16, b16, n, out16);
+        guard_check("abd_u16 guard", n, out, 2 * n);
+        for(i = 0; i < n; i++) {
+            uint16_t expected = (uint16_t)(a16[i] > b16[i] ? a16[i] - b16[i] : b16[i] - a16[i]);
+            if(out16[i] != expected) {
+                fail("abd_u16", n, i, out16[i], expected);
+            }
+        }
+
+        guard_fill(out, 2 * ((n + 1) / 2));
+        vec_padd_u16(a16, n, out16);
+        guard_check("padd_u16 guard", n, out, 2 * ((n + 1) / 2));
+        for(i = 0; i < n; i += 2) {
+            uint16_t expected = (uint16_t)(a16[i] + (i + 1 < n ? a16[i + 1] : 0));
+            if(out16[i / 2] != expected) {
+                fail("padd_u16", n, i / 2, out16[i / 2], expected);
+            }
+        }
+
+        guard_fill(out, 2 * n);
+        vec_qadd_s16(as16, bs16, n, outs16);
+        guard_check("qadd_s16 guard", n, out, 2 * n);
+        for(i = 0; i < n; i++) {
+            int16_t expected = saturate_s16((int64_t)as16[i] + bs16[i]);
+            if(outs16[i] != expected) {
+                fail("qadd_s16", n, i, (uint16_t)outs16[i], (uint16_t)expected);
+            }
+        }
+
+        guard_fill(out, 2 * n);
+        vec_qshl_s16(as16, n, shift, outs16);
+        guard_check("qshl_s16 guard", n, out, 2 * n);
+        for(i = 0; i < n; i++) {
+            int16_t expected = (int16_t)ref_shift_s16(as16[i], shift, 0, 1);
+            if(outs16[i] != expected) {
+                fail("qshl_s16", n, i, (uint16_t)outs16[i], (uint16_t)expected);
+            }
+        }
+
+        // a width without immediate shift kernels
+        guard_fill(out, n);
+        vec_rshl_s8(a8, n, shift, (int8_t *)out);
+        guard_check("rshl_s8 guard", n, out, n);
+        for(i = 0; i < n; i++) {
+            int8_t expected = (int8_t)ref_shift_s8(a8[i], (int8_t)shift, 1, 0);
+            if((int8_t)out[i] != expected) {
+                fail("rshl_s8", n, i, out[i], (uint8_t)expected);
+            }
+        }
+
+        guard_fill(out, 4 * n);
+        vec_rhadd_u32(a32, b32, n, out32);
+        guard_check("rhadd_u32 guard", n, out, 4 * n);
+        for(i = 0; i < n; i++) {
+            uint32_t expected = (uint32_t)(((uint64_t)a32[i] + b32[i] + 1) >> 1);
+            if(out32[i] != expected) {
+                fail("rhadd_u32", n, i, out32[i], expected);
+            }
+        }
+
+        guard_fill(out, 4 * n);
+        vec_qsub_s32(as32, bs32, n, outs32);
+        guard_check("qsub_s32 guard", n, out, 4 * n);
+        for(i = 0; i < n; i++) {
+            int64_t d = (int64_t)as32[i] - bs32[i];
+            int32_t expected = d > INT32_MAX ? INT32_MAX : d < INT32_MIN ? INT32_MIN : (int32_t)d;
+            if(outs32[i] != expected) {
+                fail("qsub_s32", n, i, (uint32_t)outs32[i], (uint32_t)expected);
+            }
+        }
+
+        guard_fill(out, 4 * n);
+        vec_bic_u32(a32, b32, n, out32);
+        guard_check("bic_u32 guard", n, out, 4 * n);
+        for(i = 0; i < n; i++) {
+            if(out32[i] != (a32[i] & ~b32[i])) {
+                fail("bic_u32", n, i, out32[i], a32[i] & ~b32[i]);
+            }
+        }
+
+        // the inputs are multiples of 1/8, sums and products are exact
+        guard_fill(out, 4 * n);
+        vec_mul_f32(af, bf, n, outf);
+        guard_check("mul_f32 guard", n, out, 4 * n);
+        for(i = 0; i < n; i++) {
+            if(outf[i] != af[i] * bf[i]) {
+                fail("mul_f32", n, i, (unsigned long)(long)outf[i], (unsigned long)(long)(af[i] * bf[i]));
+            }
+        }
+
+        guard_fill(out, 4 * n);
+        vec_cmpge_f32(af, bf, n, out32);
+        guard_check("cmpge_f32 guard", n, out, 4 * n);
+        for(i = 0; i < n; i++) {
+            uint32_t expected = af[i] >= bf[i] ? 0xffffffffu : 0;
+            if(out32[i] != expected) {
+                fail("cmpge_f32", n, i, out32[i], expected);
+            }
+        }
+    }
+
+    return end_check();
+}
+
+
+static uint32_t float_bits(float x) {
+    uint32_t bits;
+
+    memcpy(&bits, &x, 4);
+    return bits;
+}
+
+
+// round(x * scale + offset) saturated to 0..max, NaN to 0
+static uint32_t ref_quantize(float x, float scale, float offset, uint32_t max) {
+    float y = x * scale + (offset + 0.5f);
+
+    if(!(y > 0.0f)) {
+        return 0;
+    }
+    return y >= (float)max ? max : (uint32_t)y;
+}
+
+
+static unsigned long check_normalize(unsigned iterations) {
+    unsigned it;
+
+    begin_check("normalize");
+    for(it = 0; it < iterations; it++) {
+        unsigned channels = 1 + rng() % 4, c;
+        size_t pixels = random_length() / 16;
+        size_t n = pixels * channels;
+        normalize_layout layout = rng() % 2 ? NORMALIZE_NCHW : NORMALIZE_NHWC;
+        float mean[4], inv_std[4], scale[4], offset[4];
+        uint8_t *in = buffer_in + 4 * (rng() % (MAX_OFFSET / 4));
+        uint8_t *out = buffer_out + 4 * (rng() % (MAX_OFFSET / 4));
+        const uint16_t *in16 = (const uint16_t *)in;
+        uint16_t *out16 = (uint16_t *)out;
+        float *tensor = (float *)out;
+        float *values = (float *)buffer_ref;
+        size_t i;
+
+        for(c = 0; c < channels; c++) {
+            mean[c] = (float)(rng() % 256);
+            inv_std[c] = 1.0f / (float)(1 + rng() % 100);
+            scale[c] = (float)(1 + rng() % 100) / 3.0f;
+            offset[c] = (float)(rng() % 256) - 64.0f;
+        }
+        random_bytes(in, 2 * n);
+
+        guard_fill(out, 4 * n);
+        normalize_u8_f32(in, pixels, channels, mean, inv_std, layout, tensor);
+        guard_check("normalize_u8 guard", n, out, 4 * n);
+        for(i = 0; i < n; i++) {
+            size_t p = i / channels, index = layout == NORMALIZE_NCHW ? (i % channels) * pixels + p : i;
+            float expected = ((float)in[i] - mean[i % channels]) * inv_std[i % channels];
+            if(float_bits(tensor[index]) != float_bits(expected)) {
+                fail("normalize_u8", n, index, float_bits(tensor[index]), float_bits(expected));
+            }
+        }
+
+        guard_fill(out, 4 * n);
+        normalize_u16_f32(in16, pixels, channels, mean, inv_std, layout, tensor);
+        guard_check("normalize_u16 guard", n, out, 4 * n);
+        for(i = 0; i < n; i++) {
+            size_t p = i / channels, index = layout == NORMALIZE_NCHW ? (i % channels) * pixels + p : i;
+            float expected = ((float)in16[i] - mean[i % channels]) * inv_std[i % channels];
+            if(float_bits(tensor[index]) != float_bits(expected)) {
+                fail("normalize_u16", n, index, float_bits(tensor[index]), float_bits(expected));
+            }
+        }
+
+        // values around and beyond both ends of the output ranges, some NaN
+        for(i = 0; i < n; i++) {
+            uint32_t r = rng();
+            values[i] = r % 64 == 0 ? (float)NAN : (float)((int)(r % 8192) - 2048) / 7.0f;
+        }
+
+        guard_fill(out, n);
+        quantize_f32_u8(values, pixels, channels, scale, offset, layout, out);
+        guard_check("quantize_u8 guard", n, out, n);
+        for(i = 0; i < n; i++) {
+            size_t p = i / channels, index = layout == NORMALIZE_NCHW ? (i % channels) * pixels + p : i;
+            uint32_t expected = ref_quantize(values[index], scale[i % channels], offset[i % channels], UINT8_MAX);
+            if(out[i] != expected) {
+                fail("quantize_u8", n, i, out[i], expected);
+            }
+        }
+
+        guard_fill(out, 2 * n);
+        quantize_f32_u16(values, pixels, channels, scale, offset, layout, out16);
+        guard_check("quantize_u16 guard", n, out, 2 * n);
+        for(i = 0; i < n; i++) {
+            size_t p = i / channels, index = layout == NORMALIZE_NCHW ? (i % channels) * pixels + p : i;
+            uint32_t expected = ref_quantize(values[index], scale[i % channels], offset[i % channels], UINT16_MAX);
+            if(out16[i] != expected) {
+                fail("quantize_u16", n, i, out16[i], expected);
+            }
+        }
+    }
+
+    if(normalize_u8_f32(NULL, 0, 5, NULL, NULL, NORMALIZE_NHWC, NULL) != -1) {
+        fail("invalid channels", 0, 0, 0, (unsigned long)-1);
+    }
+
+    return end_check();
+}
+
+
+static int16_t ref_round_narrow(int64_t acc, int shift) {
+    return saturate_s16((acc + (1 << (shift - 1))) >> shift);
+}
+
+
+// random block lengths, the filters must give the same result as at once
+static size_t random_block(size_t remaining) {
+    size_t m = rng() % 4 == 0 ? remaining : rng() % 300;
+
+    return m < remaining ? m : remaining;
+}
+
+
+static unsigned long check_audio(unsigned iterations) {
+    static audio_fir fir;
+    static audio_biquad biquad;
+    unsigned it;
+
+    begin_check("audio");
+    for(it = 0; it < iterations; it++) {
+        size_t n = random_length() / 8, done, m;
+        unsigned count = 1 + rng() % 8, channels = 1 + rng() % 12, stages = 1 + rng() % 3, j, k, c;
+        int16_t *in = (int16_t *)buffer_in;
+        int16_t *out = (int16_t *)(buffer_out + 2 * (rng() % (MAX_OFFSET / 2)));
+        int16_t *ref = (int16_t *)buffer_ref;
+        int16_t *planar = (int16_t *)buffer_tmp;
+        const int16_t *inputs[8];
+        int16_t gains[8], taps[AUDIO_FIR_MAX_TAPS];
+        int16_t gain_start = (int16_t)rng(), gain_end = (int16_t)rng();
+        unsigned tap_count = 1 + rng() % AUDIO_FIR_MAX_TAPS;
+        audio_biquad_coeffs coeffs[3];
+        int16_t history[3][4][12];
+        int32_t sum_taps = 0;
+        size_t i, frames = n / channels;
+
+        random_bytes(buffer_in, 2 * n * 8);
+        for(j = 0; j < count; j++) {
+            inputs[j] = in + j * n;
+            gains[j] = (int16_t)rng();
+        }
+
+        guard_fill((uint8_t *)out, 2 * n);
+        audio_mix_s16(inputs, NULL, count, n, out);
+        guard_check("mix guard", n, (uint8_t *)out, 2 * n);
+        for(i = 0; i < n; i++) {
+            int64_t sum = 0;
+            for(j = 0; j < count; j++) {
+                sum += inputs[j][i];
+            }
+            if(out[i] != saturate_s16(sum)) {
+                fail("mix", n, i, (uint16_t)out[i], (uint16_t)saturate_s16(sum));
+            }
+        }
+
+        audio_mix_s16(inputs, gains, count, n, out);
+        for(i = 0; i < n; i++) {
+            int64_t acc = 0;
+            for(j = 0; j < count; j++) {
+                int64_t product = 2 * (int64_t)inputs[j][i] * gains[j];
+                acc += product > INT32_MAX ? INT32_MAX : product;
+                acc = acc > INT32_MAX ? INT32_MAX : acc < INT32_MIN ? INT32_MIN : acc;
+            }
+            if(out[i] != ref_round_narrow(acc, 16)) {
+                fail("mix gains", n, i, (uint16_t)out[i], (uint16_t)ref_round_narrow(acc, 16));
+            }
+        }
+
+        guard_fill((uint8_t *)out, 2 * n);
+        audio_gain_ramp_s16(in, n, gain_start, gain_end, out);
+        guard_check("gain ramp guard", n, (uint8_t *)out, 2 * n);
+        for(i = 0; i < n; i++) {
+            int64_t step = ((int64_t)gain_end - gain_start) * 65536 / (int64_t)n;
+            int64_t gain = ((int64_t)gain_start * 65536 + step * (int64_t)i) >> 16;
+            int16_t expected = saturate_s16((2 * in[i] * gain + 32768) >> 16);
+            if(out[i] != expected) {
+                fail("gain ramp", n, i, (uint16_t)out[i], (uint16_t)expected);
+            }
+        }
+
+        audio_deinterleave_s16(in, n / 2, planar, planar + n / 2);
+        for(i = 0; i < n / 2 * 2; i++) {
+            int16_t got = planar[(i % 2) * (n / 2) + i / 2];
+            if(got != in[i]) {
+                fail("deinterleave", n, i, (uint16_t)got, (uint16_t)in[i]);
+            }
+        }
+        guard_fill((uint8_t *)out, 2 * (n / 2 * 2));
+        audio_interleave_s16(planar, planar + n / 2, n / 2, out);
+        guard_check("interleave guard", n, (uint8_t *)out, 2 * (n / 2 * 2));
+        for(i = 0; i < n / 2 * 2; i++) {
+            if(out[i] != in[i]) {
+                fail("interleave", n, i, (uint16_t)out[i], (uint16_t)in[i]);
+            }
+        }
+
+        // gain of at most 1.0, the accumulator cannot wrap
+        for(k = 0; k < tap_count; k++) {
+            int32_t limit = 32767 - sum_taps;
+            taps[k] = (int16_t)(limit > 0 ? (int32_t)(rng() % (uint32_t)(2 * limit / (int32_t)tap_count + 1)) - limit / (int32_t)tap_count : 0);
+            sum_taps += taps[k] < 0 ? -taps[k] : taps[k];
+        }
+        audio_fir_init(&fir, taps, tap_count);
+        guard_fill((uint8_t *)out, 2 * n);
+        for(done = 0; done < n; done += m) {
+            m = random_block(n - done);
+            audio_fir_process(&fir, in + done, m, out + done);
+        }
+        guard_check("fir guard", n, (uint8_t *)out, 2 * n);
+        for(i = 0; i < n; i++) {
+            int64_t acc = 0;
+            for(k = 0; k < tap_count && k <= i; k++) {
+                acc += (int64_t)taps[k] * in[i - k];
+            }
+            if(out[i] != ref_round_narrow(acc, 15)) {
+                fail("fir", n, i, (uint16_t)out[i], (uint16_t)ref_round_narrow(acc, 15));
+            }
+        }
+
+        // coefficients below 0.5, five products cannot wrap
+        for(j = 0; j < stages; j++) {
+            coeffs[j].b0 = (int16_t)((int)(rng() % 16384) - 8192);
+            coeffs[j].b1 = (int16_t)((int)(rng() % 16384) - 8192);
+            coeffs[j].b2 = (int16_t)((int)(rng() % 16384) - 8192);
+            coeffs[j].a1 = (int16_t)((int)(rng() % 16384) - 8192);
+            coeffs[j].a2 = (int16_t)((int)(rng() % 16384) - 8192);
+        }
+        audio_biquad_init(&biquad, coeffs, stages, channels);
+        memcpy(ref, in, 2 * frames * channels);
+        guard_fill((uint8_t *)out, 2 * frames * channels);
+        for(done = 0; done < frames; done += m) {
+            m = random_block(frames - done);
+            audio_biquad_process(&biquad, in + done * channels, m, out + done * channels);
+        }
+        guard_check("biquad guard", n, (uint8_t *)out, 2 * frames * channels);
+        memset(history, 0, sizeof(history));
+        for(i = 0; i < frames * channels; i++) {
+            int16_t x = ref[i];
+            c = (unsigned)(i % channels);
+            for(j = 0; j < stages; j++) {
+                int64_t acc = (int64_t)coeffs[j].b0 * x + (int64_t)coeffs[j].b1 * history[j][0][c] +
+                              (int64_t)coeffs[j].b2 * history[j][1][c] - (int64_t)coeffs[j].a1 * history[j][2][c] -
+                              (int64_t)coeffs[j].a2 * history[j][3][c];
+                history[j][1][c] = history[j][0][c];
+                history[j][0][c] = x;
+                history[j][3][c] = history[j][2][c];
+                x = ref_round_narrow(acc, 14);
+                history[j][2][c] = x;
+            }
+            if(out[i] != x) {
+                fail("biquad", n, i, (uint16_t)out[i], (uint16_t)x);
+            }
+        }
+    }
+
+    if(audio_fir_init(&fir, NULL, AUDIO_FIR_MAX_TAPS + 1) != -1 || audio_biquad_init(&biquad, NULL, 1, 0) != -1) {
+        fail("invalid init", 0, 0, 0, (unsigned long)-1);
+    }
+
+    return end_check();
+}
+
+
+static size_t clamp_index(ptrdiff_t i, size_t n) {
+    return i < 0 ? 0 : i >= (ptrdiff_t)n ? n - 1 : (size_t)i;
+}
+
+
+static unsigned long check_morph(unsigned iterations) {
+    static const unsigned sizes[] = {1, 3, 5, 7, 9, 11, 15, 31};
+    unsigned it;
+
+    begin_check("morph");
+    for(it = 0; it < iterations; it++) {
+        size_t width = 1 + rng() % 100, height = 1 + rng() % 60;
+        size_t stride = width + rng() % 20, out_stride = width + rng() % 20;
+        unsigned size = sizes[rng() % 8], op;
+        int r = (int)size / 2;
+        uint8_t *in = buffer_in, *out = buffer_out;
+        size_t x, y, total = out_stride * height;
+
+        random_bytes(in, stride * height);
+        for(op = 0; op < 3; op++) {
+            const char *what = op == 0 ? "erode" : op == 1 ? "dilate" : "median3x3";
+
+            guard_fill(out, total);
+            if(op == 0) {
+                morph_erode_u8(in, width, height, stride, size, out, out_stride);
+            } else if(op == 1) {
+                morph_dilate_u8(in, width, height, stride, size, out, out_stride);
+            } else {
+                morph_median3x3_u8(in, width, height, stride, out, out_stride);
+            }
+            guard_check(what, width * height, out, total);
+
+            for(y = 0; y < height; y++) {
+                for(x = 0; x < width; x++) {
+                    unsigned counts[256] = {0}, seen = 0, expected = op == 0 ? 255 : 0;
+                    int radius = op == 2 ? 1 : r, dx, dy;
+
+                    for(dy = -radius; dy <= radius; dy++) {
+                        for(dx = -radius; dx <= radius; dx++) {
+                            uint8_t v = in[clamp_index((ptrdiff_t)y + dy, height) * stride +
+                                           clamp_index((ptrdiff_t)x + dx, width)];
+                            counts[v]++;
+                            expected = op == 0 ? (v < expected ? v : expected) : op == 1 ? (v > expected ? v : expected) : expected;
+                        }
+                    }
+                    if(op == 2) {
+                        for(expected = 0; seen + counts[expected] < 5; expected++) {
+                            seen += counts[expected];
+                        }
+                    }
+                    if(out[y * out_stride + x] != expected) {
+                        fail(what, width * 1000 + height, y * width + x, out[y * out_stride + x], expected);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    if(morph_erode_u8(buffer_in, 1, 1, 1, 4, buffer_out, 1) != -1) {
+        fail("even size", 0, 0, 0, (unsigned long)-1);
+    }
+
+    return end_check();
+}
+
+
+static unsigned long check_motion(unsigned iterations) {
+    uint32_t *counts = (uint32_t *)buffer_tmp;
+    unsigned it;
+
+    begin_check("motion");
+    for(it = 0; it < iterations; it++) {
+        // tall frames cross the 255 row flush of the column counters
+        size_t width = 1 + rng() % 100, height = 1 + rng() % (it % 4 == 0 ? 600 : 40);
+        size_t stride = width + rng() % 20, reference_stride = width + rng() % 20;
+        size_t tile_width = 16 * (1 + rng() % 4), tile_height = 1 + rng() % 300;
+        size_t tiles_x = (width + tile_width - 1) / tile_width;
+        size_t tiles = motion_tile_count(width, height, tile_width, tile_height);
+        uint8_t threshold = (uint8_t)(rng() % 64);
+        unsigned learn_shift = rng() % (MOTION_MAX_SHIFT + 1), k;
+        uint8_t *frame = buffer_in, *reference = buffer_out, *expected = buffer_ref;
+        size_t x, y, t;
+
+        // references close to the frame, so that the threshold matters
+        random_bytes(frame, stride * height);
+        random_bytes(reference, reference_stride * height);
+        for(y = 0; y < height; y++) {
+            for(x = 0; x < width; x++) {
+                if(rng() % 2 == 0) {
+                    reference[y * reference_stride + x] = (uint8_t)(frame[y * stride + x] + rng() % 128 - 64);
+                }
+            }
+        }
+        memcpy(expected, reference, reference_stride * height);
+
+        if(motion_detect_u8(frame, width, height, stride, reference, reference_stride, threshold,
+                            learn_shift, tile_width, tile_height, counts) != 0) {
+            fail("detect", width * 1000 + height, 0, 1, 0);
+            continue;
+        }
+
+        for(t = 0; t < tiles; t++) {
+            size_t x0 = t % tiles_x * tile_width, y0 = t / tiles_x * tile_height;
+            uint32_t count = 0;
+
+            for(y = y0; y < y0 + tile_height && y < height; y++) {
+                for(x = x0; x < x0 + tile_width && x < width; x++) {
+                    int difference = frame[y * stride + x] - expected[y * reference_stride + x];
+                    count += (unsigned)abs(difference) > threshold;
+                }
+            }
+            if(counts[t] != count) {
+                fail("counts", width * 1000 + height, t, counts[t], count);
+                break;
+            }
+        }
+
+        for(y = 0; y < height; y++) {
+            for(x = 0; x < width; x++) {
+                unsigned v = frame[y * stride + x], r = expected[y * reference_stride + x];
+
+                if(learn_shift != 0) {
+                    for(k = 0; k < learn_shift; k++) {
+                        v = (r + v + 1) >> 1;
+                    }
+                    r = v;
+                }
+                if(reference[y * reference_stride + x] != r) {
+                    fail("reference", width * 1000 + height, y * width + x, reference[y * reference_stride + x], r);
+                    y = height;
+                    break;
+                }
+            }
+        }
+    }
+
+    if(motion_detect_u8(buffer_in, 16, 1, 16, buffer_out, 16, 0, 0, 24, 1, counts) != -1) {
+        fail("tile width", 0, 0, 0, (unsigned long)-1);
+    }
+
+    return end_check();
+}
+
+
+// value of position u of the roaring check universe: 4 keys, one of them
+// far from the others
+static uint32_t roaring_value(size_t u) {
+    static const uint32_t keys[4] = {0, 1, 2, 0x8005};
+
+    return keys[u >> 16] << 16 | (uint32_t)(u & 0xffff);
+}
+
+
+// adds values in each key of the universe at a random density, from empty to
+// bitmap containers, and marks them in member
+static int random_roaring(roaring_bitmap *bitmap, uint8_t *member) {
+    static const uint32_t densities[5] = {0, 50, 3000, 5000, 30000};
+    size_t key, k;
+
+    memset(member, 0, 4 << 16);
+    for(key = 0; key < 4; key++) {
+        uint32_t n = densities[rng() % 5];
+
+        for(k = 0; k < n; k++) {
+            size_t u = key << 16 | (rng() & 0xffff);
+
+            member[u] = 1;
+            if(roaring_add(bitmap, roaring_value(u)) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+static void check_roaring_result(const char *what, const roaring_bitmap *result, const uint8_t *a,
+                                 const uint8_t *b, const uint8_t *c) {
+    uint64_t expected_cardinality = 0;
+    size_t u;
+
+    for(u = 0; u < 4 << 16; u++) {
+        int expected;
+
+        switch(what[0]) {
+        case '&':
+            expected = a[u] & b[u];
+            break;
+        case '|':
+            expected = a[u] | b[u];
+            break;
+        case '^':
+            expected = a[u] ^ b[u];
+            break;
+        case '-':
+            expected = a[u] & !b[u];
+            break;
+        case 'O':
+            expected = a[u] | b[u] | c[u];
+            break;
+        default:
+            expected = a[u] & b[u] & c[u];
+            break;
+        }
+        expected_cardinality += (uint64_t)expected;
+
+        if(roaring_contains(result, roaring_value(u)) != expected) {
+            fail(what, (size_t)roaring_cardinality(result), u, (unsigned long)!expected, (unsigned long)expected);
+            return;
+        }
+    }
+
+    if(roaring_cardinality(result) != expected_cardinality) {
+        fail(what, 0, 0, (unsigned long)roaring_cardinality(result), (unsigned long)expected_cardinality);
+    }
+}
+
+
+static unsigned long check_roaring(unsigned iterations) {
+    uint8_t *member_a = buffer_ref, *member_b = buffer_tmp, *member_c = buffer_in;
+    uint32_t *values = (uint32_t *)buffer_out;
+    unsigned it;
+
+    begin_check("roaring");
+    // large sets, a fraction of the iterations is plenty
+    for(it = 0; it < (iterations + 9) / 10; it++) {
+        roaring_bitmap a, b, c, result;
+        const roaring_bitmap *inputs[3] = {&a, &b, &c};
+        size_t n, u, k;
+
+        roaring_init(&a);
+        roaring_init(&b);
+        roaring_init(&c);
+        roaring_init(&result);
+
+        if(random_roaring(&a, member_a) != 0 || random_roaring(&b, member_b) != 0 ||
+           random_roaring(&c, member_c) != 0) {
+            fail("out of memory", 0, 0, 1, 0);
+        } else {
+            // sorted values of a
+            n = roaring_to_array(&a, values);
+            for(u = 0, k = 0; u < 4 << 16; u++) {
+                if(member_a[u] && (k >= n || values[k++] != roaring_value(u))) {
+                    fail("to_array", n, k, k <= n ? values[k - 1] : 0, roaring_value(u));
+                    break;
+                }
+            }
+            if(n != roaring_cardinality(&a)) {
+                fail("to_array", 0, 0, n, (unsigned long)roaring_cardinality(&a));
+            }
+
+            roaring_and(&a, &b, &result);
+            check_roaring_result("&", &result, member_a, member_b, NULL);
+            if(roaring_and_cardinality(&a, &b) != roaring_cardinality(&result)) {
+                fail("and_cardinality", 0, 0, (unsigned long)roaring_and_cardinality(&a, &b),
+                     (unsigned long)roaring_cardinality(&result));
+            }
+            roaring_or(&a, &b, &result);
+            check_roaring_result("|", &result, member_a, member_b, NULL);
+            roaring_xor(&a, &b, &result);
+            check_roaring_result("^", &result, member_a, member_b, NULL);
+            roaring_andnot(&a, &b, &result);
+            check_roaring_result("-", &result, member_a, member_b, NULL);
+            roaring_or_many(inputs, 3, &result);
+            check_roaring_result("OR", &result, member_a, member_b, member_c);
+            roaring_and_many(inputs, 3, &result);
+            check_roaring_result("AND", &result, member_a, member_b, member_c);
+        }
+
+        roaring_free(&a);
+        roaring_free(&b);
+        roaring_free(&c);
+        roaring_free(&result);
+    }
+
+    return end_check();
+}
+
+
+// sorted values below universe, about n of them, each up to repeat times
+static size_t random_sorted(uint32_t *out, size_t n, uint32_t universe, unsigned repeat) {
+    size_t count = 0;
+    uint32_t v;
+    unsigned r;
+
+    for(v = 0; v < universe; v++) {
+        for(r = 0; r < repeat; r++) {
+            if(rng() % universe < n) {
+                out[count++] = v;
+            }
+        }
+    }
+
+    return count;
+}
+
+
+// op 0: intersection, 1: union, 2: difference, 3: merge
+static size_t ref_sorted(const uint32_t *a, size_t na, const uint32_t *b, size_t nb, unsigned op, uint32_t *out) {
+    size_t i = 0, j = 0, n = 0;
+
+    while(i < na || j < nb) {
+        if(j == nb || (i < na && a[i] < b[j])) {
+            if(op == 1 || op == 2 || op == 3) {
+                out[n++] = a[i];
+            }
+            i++;
+        } else if(i == na || b[j] < a[i]) {
+            if(op == 1 || op == 3) {
+                out[n++] = b[j];
+            }
+            j++;
+        } else {
+            if(op == 3) {
+                out[n++] = a[i];
+                out[n++] = b[j];
+            } else if(op == 0 || op == 1) {
+                out[n++] = a[i];
+            }
+            i++;
+            j++;
+        }
+    }
+
+    return n;
+}
+
+
+static unsigned long check_sortedset(unsigned iterations) {
+    static const char *names[4] = {"intersect", "union", "difference", "merge"};
+    uint32_t *a = (uint32_t *)buffer_in, *b = a + 40000, *expected = (uint32_t *)buffer_ref;
+    uint16_t *a16 = (uint16_t *)buffer_tmp, *b16 = a16 + 40000;
+    unsigned it, op, wide;
+
+    begin_check("sortedset");
+    for(it = 0; it < iterations; it++) {
+        // sizes from empty to far apart (galloping), in a small or the full
+        // 16-bit universe
+        uint32_t universe = it % 2 ? 65536 : 1 + rng() % 4000;
+        size_t sizes[4] = {0, 1 + rng() % 16, rng() % 2000, rng() % 20000};
+        size_t want_a = sizes[rng() % 4], want_b = sizes[rng() % 4];
+        uint32_t base = it % 3 == 0 ? 0xfff00000u : 0;
+
+        for(op = 0; op < 4; op++) {
+            unsigned repeat = op == 3 ? 2 : 1;
+            size_t na = random_sorted(a, want_a < universe ? want_a : universe, universe, repeat);
+            size_t nb = random_sorted(b, want_b < universe ? want_b : universe, universe, repeat);
+            size_t room = op == 0 ? (na < nb ? na : nb) : op == 2 ? na : na + nb;
+            size_t n_expected = ref_sorted(a, na, b, nb, op, expected);
+            size_t n, k;
+
+            for(k = 0; k < na; k++) {
+                a16[k] = (uint16_t)a[k];
+            }
+            for(k = 0; k < nb; k++) {
+                b16[k] = (uint16_t)b[k];
+            }
+
+            for(wide = 0; wide < 2; wide++) {
+                size_t size = room * (wide ? 4 : 2);
+
+                guard_fill(buffer_out, size);
+                if(wide) {
+                    uint32_t *out = (uint32_t *)buffer_out;
+
+                    // values near the top of the range
+                    for(k = 0; k < na; k++) {
+                        a[k] += base;
+                    }
+                    for(k = 0; k < nb; k++) {
+                        b[k] += base;
+                    }
+                    n = op == 0 ? sorted_intersect_u32(a, na, b, nb, out) :
+                        op == 1 ? sorted_union_u32(a, na, b, nb, out) :
+                        op == 2 ? sorted_difference_u32(a, na, b, nb, out) :
+                                  sorted_merge_u32(a, na, b, nb, out);
+                    for(k = 0; k < na; k++) {
+                        a[k] -= base;
+                    }
+                    for(k = 0; k < nb; k++) {
+                        b[k] -= base;
+                    }
+                    for(k = 0; k < n && k < n_expected; k++) {
+                        if(out[k] != expected[k] + base) {
+                            fail(names[op], na * 100000 + nb, k, out[k], expected[k] + base);
+                            break;
+                        }
+                    }
+                } else {
+                    uint16_t *out = (uint16_t *)buffer_out;
+
+                    n = op == 0 ? sorted_intersect_u16(a16, na, b16, nb, out) :
+                        op == 1 ? sorted_union_u16(a16, na, b16, nb, out) :
+                        op == 2 ? sorted_difference_u16(a16, na, b16, nb, out) :
+                                  sorted_merge_u16(a16, na, b16, nb, out);
+                    for(k = 0; k < n && k < n_expected; k++) {
+                        if(out[k] != expected[k]) {
+                            fail(names[op], na * 100000 + nb, k, out[k], expected[k]);
+                            break;
+                        }
+                    }
+                }
+
+                if(n != n_expected) {
+                    fail(names[op], na * 100000 + nb, 0, n, n_expected);
+                }
+                guard_check(names[op], na * 100000 + nb, buffer_out, size);
+            }
+        }
+    }
+
+    return end_check();
+}
+
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+static uint32_t key_at(const uint8_t *keys, unsigned width, size_t i) {
+    return width == 1 ? keys[i] : width == 2 ? ((const uint16_t *)keys)[i] : ((const uint32_t *)keys)[i];
+}
+
+
+static unsigned long check_sort(unsigned iterations) {
+    uint32_t *keys = (uint32_t *)buffer_in, *expected = (uint32_t *)buffer_ref;
+    uint8_t *out = buffer_out, *top = buffer_tmp;
+    unsigned it, width;
+    size_t i;
+
+    begin_check("sort");
+    for(it = 0; it < iterations; it++) {
+        // lengths around a block, a few blocks (uneven merge rounds) and long
+        // arrays; a small range of keys gives many duplicates
+        size_t sizes[3] = {rng() % 80, rng() % 2000, rng() % 40000};
+        size_t n = sizes[it % 3];
+        size_t k = rng() % 2 ? rng() % 40 : rng() % (n + 2);
+        size_t kept = k < n ? k : n;
+        uint32_t range = rng() % 2 ? 0 : 1 + rng() % 100;
+
+        for(i = 0; i < n; i++) {
+            keys[i] = range ? 0xffffffffu - rng() % range : rng();
+        }
+
+        for(width = 1; width <= 4; width *= 2) {
+            uint32_t mask = width == 4 ? 0xffffffffu : (1u << (8 * width)) - 1;
+            int result = 0;
+
+            for(i = 0; i < n; i++) {
+                expected[i] = keys[i] & mask;
+                if(width == 1) {
+                    out[i] = (uint8_t)expected[i];
+                } else if(width == 2) {
+                    ((uint16_t *)out)[i] = (uint16_t)expected[i];
+                } else {
+                    ((uint32_t *)out)[i] = expected[i];
+                }
+            }
+            qsort(expected, n, sizeof(uint32_t), compare_u32);
+
+            // top-k of the unsorted keys, expected largest first
+            if(width > 1) {
+                guard_fill(top, kept * width);
+                result = width == 2 ? sort_top_k_u16((const uint16_t *)out, n, k, (uint16_t *)top) :
+                                      sort_top_k_u32((const uint32_t *)out, n, k, (uint32_t *)top);
+                if(result != 0) {
+                    fail("top_k", n, 0, result, 0);
+                }
+                for(i = 0; i < kept; i++) {
+                    if(key_at(top, width, i) != expected[n - 1 - i]) {
+                        fail("top_k", n * 100 + width, i, key_at(top, width, i), expected[n - 1 - i]);
+                        break;
+                    }
+                }
+                guard_check("top_k", n * 100 + width, top, kept * width);
+            }
+
+            memset(out + n * width, GUARD_BYTE, GUARD);
+            if(width == 1) {
+                sort_u8(out, n);
+            } else if(width == 2) {
+                result = sort_u16((uint16_t *)out, n);
+            } else {
+                result = sort_u32((uint32_t *)out, n);
+            }
+            if(result != 0) {
+                fail("sort", n, 0, result, 0);
+            }
+            for(i = 0; i < n; i++) {
+                if(key_at(out, width, i) != expected[i]) {
+                    fail("sort", n * 100 + width, i, key_at(out, width, i), expected[i]);
+                    break;
+                }
+            }
+            guard_check("sort", n * 100 + width, out, n * width);
+        }
+    }
+
+    return end_check();
+}
+
+
+static uint32_t ref_adler32(const uint8_t *data, size_t n) {
+    uint32_t s1 = 1, s2 = 0;
+    size_t i;
+
+    for(i = 0; i < n; i++) {
+        s1 = (s1 + data[i]) % 65521;
+        s2 = (s2 + s1) % 65521;
+    }
+    return s2 << 16 | s1;
+}
+
+
+// records of b end at an inaccessible page, reading past them faults
+static void check_batch_page_end(void) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE), n, i;
+    batch_record a[3], b[3];
+    uint32_t results[3], expected;
+    uint8_t flags[3];
+    uint8_t *pages = mmap(NULL, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(pages == MAP_FAILED) {
+        return;
+    }
+    if(mprotect(pages + page, page, PROT_NONE) == 0) {
+        random_bytes(buffer_in, 3 * 100);
+        for(n = 0; n < 100; n++) {
+            // shorter b records (and a same length one for the SAD), one of
+            // them the odd last record
+            for(i = 0; i < 3; i++) {
+                a[i].data = buffer_in + i * 100;
+                a[i].length = n + 1 + i;
+                b[i].data = pages + page - n;
+                b[i].length = n;
+            }
+            memcpy(pages + page - n, buffer_in, n);
+
+            batch_equal(a, b, 3, flags);
+            for(i = 0; i < 3; i++) {
+                if(flags[i] != 0) {
+                    fail("equal page end", n, i, flags[i], 0);
+                }
+            }
+
+            a[2].length = n;
+            batch_sad(a + 2, b + 2, 1, results);
+            expected = 0;
+            for(i = 0; i < n; i++) {
+                expected += (uint32_t)abs(a[2].data[i] - b[2].data[i]);
+            }
+            if(results[0] != expected) {
+                fail("sad page end", n, 0, results[0], expected);
+            }
+        }
+    }
+
+    munmap(pages, 2 * page);
+}
+
+
+static unsigned long check_batch(unsigned iterations) {
+    static batch_record a[256], b[256];
+    static uint32_t results[256];
+    static uint8_t flags[256];
+    unsigned it;
+
+    begin_check("batch");
+    check_batch_page_end();
+    for(it = 0; it < iterations; it++) {
+        size_t count = rng() % 256, stride = 1 + rng() % 80, length = rng() % (stride + 1);
+        size_t max_length = rng() % 8 == 0 ? 6000 : 100, used = 0, i, j;
+        uint8_t *copy = buffer_tmp;
+
+        random_bytes(buffer_in, MAX_LEN);
+        memcpy(copy, buffer_in, MAX_LEN);
+        for(i = 0; i < count; i++) {
+            size_t n = rng() % (max_length + 1);
+
+            if(used + n > MAX_LEN) {
+                used = 0;
+            }
+            a[i].data = buffer_in + used;
+            a[i].length = n;
+            b[i].data = copy + used;
+            b[i].length = rng() % 16 == 0 ? rng() % (n + 1) : n;
+            // some pairs differ in one bit
+            if(n > 0 && rng() % 2 == 0) {
+                copy[used + rng() % n] ^= (uint8_t)(1u << (rng() % 8));
+            }
+            used += n;
+        }
+
+        batch_popcount(a, count, results);
+        for(i = 0; i < count; i++) {
+            uint32_t expected = 0;
+            for(j = 0; j < a[i].length; j++) {
+                expected += (uint32_t)__builtin_popcount(a[i].data[j]);
+            }
+            if(results[i] != expected) {
+                fail("popcount", a[i].length, i, results[i], expected);
+            }
+        }
+
+        batch_equal(a, b, count, flags);
+        for(i = 0; i < count; i++) {
+            uint8_t expected = a[i].length == b[i].length && memcmp(a[i].data, b[i].data, a[i].length) == 0;
+            if(flags[i] != expected) {
+                fail("equal", a[i].length, i, flags[i], expected);
+            }
+        }
+
+        // b must be at least as long for the SAD
+        for(i = 0; i < count; i++) {
+            b[i].length = a[i].length;
+        }
+        batch_sad(a, b, count, results);
+        for(i = 0; i < count; i++) {
+            uint32_t expected = 0;
+            for(j = 0; j < a[i].length; j++) {
+                expected += (uint32_t)abs(a[i].data[j] - b[i].data[j]);
+            }
+            if(results[i] != expected) {
+                fail("sad", a[i].length, i, results[i], expected);
+            }
+        }
+
+        batch_adler32(a, count, results);
+        for(i = 0; i < count; i++) {
+            uint32_t expected = ref_adler32(a[i].data, a[i].length);
+            if(results[i] != expected) {
+                fail("adler32", a[i].length, i, results[i], expected);
+            }
+        }
+
+        // fixed stride records over the same bytes
+        count = count * stride > MAX_LEN ? MAX_LEN / stride : count;
+        batch_popcount_strided(buffer_in, stride, length, count, results);
+        for(i = 0; i < count; i++) {
+            uint32_t expected = 0;
+            for(j = 0; j < length; j++) {
+                expected += (uint32_t)__builtin_popcount(buffer_in[i * stride + j]);
+            }
+            if(results[i] != expected) {
+                fail("popcount strided", length, i, results[i], expected);
+            }
+        }
+
+        batch_equal_strided(buffer_in, copy, stride, length, count, flags);
+        batch_sad_strided(buffer_in, copy, stride, length, count, results);
+        for(i = 0; i < count; i++) {
+            uint32_t expected = 0;
+            for(j = 0; j < length; j++) {
+                expected += (uint32_t)abs(buffer_in[i * stride + j] - copy[i * stride + j]);
+            }
+            if(results[i] != expected) {
+                fail("sad strided", length, i, results[i], expected);
+            }
+            if(flags[i] != (memcmp(buffer_in + i * stride, copy + i * stride, length) == 0)) {
+                fail("equal strided", length, i, flags[i], !flags[i]);
+            }
+        }
+
+        batch_adler32_strided(buffer_in, stride, length, count, results);
+        for(i = 0; i < count; i++) {
+            uint32_t expected = ref_adler32(buffer_in + i * stride, length);
+            if(results[i] != expected) {
+                fail("adler32 strided", length, i, results[i], expected);
+            }
+        }
+    }
+
+    return end_check();
+}
+
+
+typedef struct {
+    pipeline *p;
+    uint64_t frames;
+} pipeline_check_capture;
+
+
+static void fill_frame(uint8_t *data, size_t size, uint64_t sequence) {
+    size_t i;
+
+    for(i = 0; i < size; i++) {
+        data[i] = (uint8_t)('a' + (sequence + i) % 26);
+    }
+}
+
+
+static void *pipeline_capture(void *ptr) {
+    pipeline_check_capture *capture = ptr;
+    uint64_t i;
+
+    for(i = 0; i < capture->frames; i++) {
+        pipeline_frame *frame = pipeline_acquire(capture->p);
+
+        frame->size = 16 + frame->sequence % 1000;
+        fill_frame(frame->data, frame->size, frame->sequence);
+        pipeline_submit(capture->p, frame);
+    }
+    return NULL;
+}
+
+
+static int pipeline_upper(pipeline_frame *frame, void *context) {
+    (void)context;
+    ascii_toupper(frame->data, frame->size, frame->data);
+    return 0;
+}
+
+
+// drops every 7th frame, appends the CRC32C to the others
+static int pipeline_crc(pipeline_frame *frame, void *context) {
+    uint32_t crc;
+
+    (void)context;
+    if(frame->sequence % 7 == 3) {
+        return -1;
+    }
+    crc = crc32c_update(CRC32C_INIT, frame->data, frame->size);
+    memcpy(frame->data + frame->size, &crc, 4);
+    return 0;
+}
+
+
+// capture on its own thread, two stage threads, output on this thread
+static unsigned long check_pipeline(unsigned iterations) {
+    const pipeline_config config = {4, 1024 + 4, 1, 0};
+    const pipeline_stage stages[2] = {{pipeline_upper, NULL, -1}, {pipeline_crc, NULL, -1}};
+    pipeline_check_capture capture;
+    pipeline_statistics stats;
+    pthread_t thread;
+    uint64_t expected = 0, i, next = 0;
+
+    begin_check("pipeline");
+    capture.frames = 10 * (uint64_t)iterations;
+    for(i = 0; i < capture.frames; i++) {
+        expected += i % 7 != 3;
+    }
+    capture.p = pipeline_create(&config, stages, 2);
+    if(capture.p == NULL || pthread_create(&thread, NULL, pipeline_capture, &capture) != 0) {
+        fail("create", 0, 0, 0, 1);
+        pipeline_destroy(capture.p);
+        return end_check();
+    }
+
+    for(i = 0; i < expected; i++) {
+        pipeline_frame *frame = pipeline_receive(capture.p, 1);
+        uint32_t crc;
+        size_t j;
+
+        while(next % 7 == 3) {
+            next++;
+        }
+        if(frame->sequence != next) {
+            fail("order", i, 0, frame->sequence, next);
+        }
+        next = frame->sequence + 1;
+        memcpy(&crc, frame->data + frame->size, 4);
+        fill_frame(buffer_ref, frame->size, frame->sequence);
+        ascii_toupper(buffer_ref, frame->size, buffer_ref);
+        for(j = 0; j < frame->size; j++) {
+            if(frame->data[j] != buffer_ref[j]) {
+                fail("frame", frame->size, j, frame->data[j], buffer_ref[j]);
+                break;
+            }
+        }
+        if(crc != crc32c_update(CRC32C_INIT, buffer_ref, frame->size)) {
+            fail("crc", frame->size, 0, crc, 0);
+        }
+        pipeline_release(capture.p, frame);
+    }
+    pthread_join(thread, NULL);
+
+    // frames dropped after the last one received may still be in flight
+    for(i = 0; i < 10000; i++) {
+        const struct timespec pause = {0, 1000000};
+
+        pipeline_get_statistics(capture.p, &stats);
+        if(stats.completed + stats.dropped_kernel >= capture.frames) {
+            break;
+        }
+        nanosleep(&pause, NULL);
+    }
+    if(stats.submitted != capture.frames || stats.completed != expected ||
+       stats.dropped_kernel != capture.frames - expected || stats.dropped_no_frame != 0 ||
+       stats.stage_frames[0] != capture.frames || stats.latency_min_ns > stats.latency_p50_ns ||
+       stats.latency_p50_ns > stats.latency_p99_ns || stats.latency_p99_ns > stats.latency_max_ns) {
+        fail("statistics", capture.frames, 0, stats.completed, expected);
+    }
+    pipeline_destroy(capture.p);
+
+    return end_check();
+}
+
+
+unsigned long check_all(unsigned iterations, uint32_t seed) {
+    unsigned long failures = 0;
+
+    rng_state = seed != 0 ? seed : 1;
+
+    buffer_in = malloc(BUFFER_SIZE);
+    buffer_out = malloc(BUFFER_SIZE);
+    buffer_tmp = malloc(BUFFER_SIZE);
+    buffer_ref = malloc(BUFFER_SIZE);
+    if(buffer_in == NULL || buffer_out == NULL || buffer_tmp == NULL || buffer_ref == NULL) {
+        printf("out of memory\n");
+        failures = 1;
+    } else {
+        failures += check_binary_u8();
+        failures += check_unary();
+        failures += check_q15(iterations);
+        failures += check_bitpack(iterations);
+        failures += check_delta_rle(iterations);
+        failures += check_bswap(iterations);
+        failures += check_bitlen(iterations);
+        failures += check_streamvbyte(iterations);
+        failures += check_utf8(iterations);
+        failures += check_ascii(iterations);
+        failures += check_checksum(iterations);
+        failures += check_shift(iterations);
+        failures += check_vecops(iterations);
+        failures += check_normalize(iterations);
+        failures += check_audio(iterations);
+        failures += check_morph(iterations);
+        failures += check_motion(iterations);
+        failures += check_batch(iterations);
+        failures += check_roaring(iterations);
+        failures += check_sortedset(iterations);
+        failures += check_sort(iterations);
+        failures += check_pipeline(iterations);
+    }
+
+    free(buffer_in);
+    free(buffer_out);
+    free(buffer_tmp);
+    free(buffer_ref);
+
+    printf("%lu mismatches (seed %u, %u iterations)\n", failures, seed, iterations);
+
+    return failures;
+}
@@ -0,0 +1,20 @@
+/* Differential checks of NEON intrinsics and kernels against scalar
+ * reference implementations
+ *
+ * Binary 8-bit intrinsics are checked on all 65536 input pairs, unary and
+ * narrowing ones on all inputs, the stream kernels on random data with
+ * random lengths and buffer offsets and guard bytes behind every output.
+ * Run as `arm_neon_examples check [iterations] [seed]`, on x86 hosts with
+ * qemu-arm -L /usr/arm-linux-gnueabihf ./arm_neon_examples check
+ */
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdint.h>
+
+// runs all checks, prints one line per check and the first mismatches,
+// returns the total number of mismatches
+unsigned long check_all(unsigned iterations, uint32_t seed);
+
+#endif
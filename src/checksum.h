@@ -0,0 +1,31 @@
+/* Adler-32, Fletcher-16/32 and CRC32C checksums using ARM NEON
+ *
+ * All checksums are streaming: pass the initial value for the first chunk
+ * and the returned value for every following chunk. Chunked and one-shot
+ * results are identical, except that Fletcher-32 works on 16-bit little-
+ * endian words so only the last chunk may have an odd length (its last byte
+ * is padded with a zero byte).
+ */
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ADLER32_INIT    1
+#define FLETCHER16_INIT 0
+#define FLETCHER32_INIT 0
+#define CRC32C_INIT     0
+
+uint32_t adler32_update(uint32_t adler, const uint8_t *data, size_t n);
+
+uint16_t fletcher16_update(uint16_t fletcher, const uint8_t *data, size_t n);
+
+uint32_t fletcher32_update(uint32_t fletcher, const uint8_t *data, size_t n);
+
+// CRC-32C (Castagnoli), with ARMv8 CRC32 instructions when available and a
+// slicing-by-4 table otherwise
+uint32_t crc32c_update(uint32_t crc, const uint8_t *data, size_t n);
+
+#endif
@@ -0,0 +1,72 @@
+/* Delta coding of 8-Bit unsigned integer streams using ARM NEON
+ */
+
+#include "arm_neon.h"
+#include "delta.h"
+#include "stream.h"
+
+
+void delta_encode_u8(const uint8_t *in, size_t n, uint8_t *out) {
+    size_t i = 0;
+    uint8_t prev;
+    size_t distance = stream_settings.prefetch_distance;
+    uint8x16_t vector_prev = vdupq_n_u8(0);
+
+    for(; i + 16 <= n; i += 16) {
+        uint8x16_t vector_data = vld1q_u8(in + i);
+
+        stream_prefetch_ahead(in + i, distance);
+
+        // v: vector
+        // ext: extract
+        // q: 128-bit registers
+        // u8: 8-bit unsigned integer
+        // predecessors: last lane of the previous block followed by lanes 0..14
+        uint8x16_t vector_shifted = vextq_u8(vector_prev, vector_data, 15);
+
+        vst1q_u8(out + i, vsubq_u8(vector_data, vector_shifted));
+        vector_prev = vector_data;
+    }
+
+    prev = vgetq_lane_u8(vector_prev, 15);
+    for(; i < n; i++) {
+        uint8_t value = in[i];
+        out[i] = (uint8_t)(value - prev);
+        prev = value;
+    }
+}
+
+
+void delta_decode_u8(const uint8_t *in, size_t n, uint8_t *out) {
+    size_t i = 0;
+    uint8_t prev;
+    uint8x16_t vector_zero = vdupq_n_u8(0);
+    size_t distance = stream_settings.prefetch_distance;
+    uint8x16_t vector_carry = vdupq_n_u8(0);
+
+    for(; i + 16 <= n; i += 16) {
+        uint8x16_t vector_data = vld1q_u8(in + i);
+
+        stream_prefetch_ahead(in + i, distance);
+
+        // inclusive prefix sum in log2(16) = 4 steps: add the vector shifted
+        // up by 1, 2, 4 and 8 lanes (zeros shifted in)
+        vector_data = vaddq_u8(vector_data, vextq_u8(vector_zero, vector_data, 15));
+        vector_data = vaddq_u8(vector_data, vextq_u8(vector_zero, vector_data, 14));
+        vector_data = vaddq_u8(vector_data, vextq_u8(vector_zero, vector_data, 12));
+        vector_data = vaddq_u8(vector_data, vextq_u8(vector_zero, vector_data, 8));
+
+        // add the running total of all previous blocks
+        vector_data = vaddq_u8(vector_data, vector_carry);
+        vst1q_u8(out + i, vector_data);
+
+        // broadcast the last lane as carry for the next block
+        vector_carry = vdupq_lane_u8(vget_high_u8(vector_data), 7);
+    }
+
+    prev = vgetq_lane_u8(vector_carry, 0);
+    for(; i < n; i++) {
+        prev = (uint8_t)(prev + in[i]);
+        out[i] = prev;
+    }
+}
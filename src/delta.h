@@ -0,0 +1,18 @@
+/* Delta coding of 8-Bit unsigned integer streams using ARM NEON
+ *
+ * Encoding stores the wrapping difference to the predecessor
+ * (out[i] = in[i] - in[i-1], with in[-1] = 0), decoding is the wrapping
+ * prefix sum. Both work in-place (in == out).
+ */
+
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+void delta_encode_u8(const uint8_t *in, size_t n, uint8_t *out);
+
+void delta_decode_u8(const uint8_t *in, size_t n, uint8_t *out);
+
+#endif
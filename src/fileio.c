@@ -0,0 +1,494 @@
+/* Zero-copy file input and output for the NEON kernels
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "fileio.h"
+#include "trace.h"
+
+// bytes mapped at a time by file_process()
+#define MAP_WINDOW (64u << 20)
+
+// alignment required for O_DIRECT buffers and file offsets
+#define DIRECT_ALIGN 4096
+
+
+static size_t page_round_up(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    if(size == 0) {
+        return page;
+    }
+    return (size + page - 1) / page * page;
+}
+
+
+// reads exactly len bytes unless the end of the file is reached
+static ssize_t read_full(int fd, uint8_t *buffer, size_t len) {
+    size_t done = 0;
+
+    while(done < len) {
+        ssize_t r = read(fd, buffer + done, len - done);
+
+        if(r < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if(r == 0) {
+            break;
+        }
+        done += (size_t)r;
+    }
+
+    return (ssize_t)done;
+}
+
+
+static int write_full(int fd, const uint8_t *buffer, size_t len) {
+    size_t done = 0;
+
+    while(done < len) {
+        ssize_t w = write(fd, buffer + done, len - done);
+
+        if(w < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        done += (size_t)w;
+    }
+
+    return 0;
+}
+
+
+// *unmappable is set if the very first mapping fails, before fn was called
+static int process_mapped(int fd, uint64_t file_size, size_t chunk_size,
+                          file_chunk_fn fn, void *ctx, int *unmappable) {
+    uint64_t offset = 0;
+    size_t window_size = MAP_WINDOW < chunk_size ? chunk_size : MAP_WINDOW / chunk_size * chunk_size;
+
+    while(offset < file_size) {
+        size_t window = file_size - offset < window_size ? (size_t)(file_size - offset) : window_size;
+        size_t pos;
+        uint8_t *data;
+        int ret = 0;
+
+        data = mmap(NULL, window, PROT_READ, MAP_PRIVATE, fd, (off_t)offset);
+        if(data == MAP_FAILED) {
+            *unmappable = offset == 0;
+            return -1;
+        }
+        madvise(data, window, MADV_SEQUENTIAL);
+
+        // start reading the next window while this one is processed
+        if(offset + window < file_size) {
+            posix_fadvise(fd, (off_t)(offset + window), (off_t)window_size, POSIX_FADV_WILLNEED);
+        }
+
+        for(pos = 0; pos < window && ret == 0; pos += chunk_size) {
+            size_t len = window - pos < chunk_size ? window - pos : chunk_size;
+
+            if(pos + len < window) {
+                size_t next = window - pos - len < chunk_size ? window - pos - len : chunk_size;
+                madvise(data + pos + len, next, MADV_WILLNEED);
+            }
+
+            TRACE_KERNEL("file_chunk", len, ret = fn(data + pos, len, offset + pos, ctx));
+
+            // processed pages are not needed again
+            madvise(data + pos, len, MADV_DONTNEED);
+        }
+
+        munmap(data, window);
+        if(ret != 0) {
+            return ret;
+        }
+        offset += window;
+    }
+
+    return 0;
+}
+
+
+// two buffers handed between a reader thread and the caller of the
+// callback: the reader fills one while the other is processed
+typedef struct {
+    int fd;
+    size_t chunk_size;
+    uint8_t *buffer[2];
+    // bytes in a full buffer, 0 at the end of the file, -1 on errors
+    ssize_t len[2];
+    int full[2];
+    int read_errno;
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} read_ahead;
+
+
+static void *read_ahead_thread(void *ptr) {
+    read_ahead *r = ptr;
+    int current = 0, state;
+    ssize_t len;
+
+    // only a blocking read() may be cancelled, never with the lock held
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
+    do {
+        pthread_mutex_lock(&r->lock);
+        while(r->full[current] && !r->stop) {
+            pthread_cond_wait(&r->changed, &r->lock);
+        }
+        if(r->stop) {
+            pthread_mutex_unlock(&r->lock);
+            break;
+        }
+        pthread_mutex_unlock(&r->lock);
+
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &state);
+        len = read_full(r->fd, r->buffer[current], r->chunk_size);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
+
+        pthread_mutex_lock(&r->lock);
+        r->len[current] = len;
+        r->read_errno = len < 0 ? errno : 0;
+        r->full[current] = 1;
+        pthread_cond_broadcast(&r->changed);
+        pthread_mutex_unlock(&r->lock);
+
+        current ^= 1;
+    } while(len == (ssize_t)r->chunk_size);
+
+    return NULL;
+}
+
+
+static int process_read(int fd, size_t chunk_size, file_chunk_fn fn, void *ctx) {
+    read_ahead r;
+    pthread_t thread;
+    uint64_t offset = 0;
+    int current = 0, ret = 0, err;
+    ssize_t len;
+
+    memset(&r, 0, sizeof(r));
+    r.fd = fd;
+    r.chunk_size = chunk_size;
+    if(posix_memalign((void **)&r.buffer[0], DIRECT_ALIGN, chunk_size) != 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    if(posix_memalign((void **)&r.buffer[1], DIRECT_ALIGN, chunk_size) != 0) {
+        free(r.buffer[0]);
+        errno = ENOMEM;
+        return -1;
+    }
+    pthread_mutex_init(&r.lock, NULL);
+    pthread_cond_init(&r.changed, NULL);
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    err = pthread_create(&thread, NULL, read_ahead_thread, &r);
+    if(err != 0) {
+        pthread_cond_destroy(&r.changed);
+        pthread_mutex_destroy(&r.lock);
+        free(r.buffer[0]);
+        free(r.buffer[1]);
+        errno = err;
+        return -1;
+    }
+
+    // the reader fills the other buffer while fn processes this one
+    do {
+        pthread_mutex_lock(&r.lock);
+        while(!r.full[current]) {
+            pthread_cond_wait(&r.changed, &r.lock);
+        }
+        len = r.len[current];
+        err = r.read_errno;
+        pthread_mutex_unlock(&r.lock);
+
+        if(len < 0) {
+            errno = err;
+            ret = -1;
+            break;
+        }
+        if(len > 0) {
+            TRACE_KERNEL("file_chunk", (uint64_t)len, ret = fn(r.buffer[current], (size_t)len, offset, ctx));
+            offset += (uint64_t)len;
+        }
+
+        pthread_mutex_lock(&r.lock);
+        r.full[current] = 0;
+        pthread_cond_broadcast(&r.changed);
+        pthread_mutex_unlock(&r.lock);
+
+        current ^= 1;
+    } while(len == (ssize_t)chunk_size && ret == 0);
+
+    // stopped early: the reader may wait for a buffer or block in read()
+    pthread_mutex_lock(&r.lock);
+    r.stop = 1;
+    pthread_cond_broadcast(&r.changed);
+    pthread_mutex_unlock(&r.lock);
+    pthread_cancel(thread);
+    pthread_join(thread, NULL);
+
+    pthread_cond_destroy(&r.changed);
+    pthread_mutex_destroy(&r.lock);
+    free(r.buffer[0]);
+    free(r.buffer[1]);
+
+    return ret;
+}
+
+
+int file_process(const char *path, size_t chunk_size, file_chunk_fn fn, void *ctx) {
+    struct stat st;
+    int fd, ret, unmappable = 1;
+
+    chunk_size = page_round_up(chunk_size);
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return -1;
+    }
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    ret = -1;
+    if(S_ISREG(st.st_mode)) {
+        if(st.st_size == 0) {
+            close(fd);
+            return 0;
+        }
+        unmappable = 0;
+        ret = process_mapped(fd, (uint64_t)st.st_size, chunk_size, fn, ctx, &unmappable);
+    }
+    if(unmappable) {
+        ret = process_read(fd, chunk_size, fn, ctx);
+    }
+
+    close(fd);
+
+    return ret;
+}
+
+
+int file_map_read(file_map *map, const char *path) {
+    struct stat st;
+
+    memset(map, 0, sizeof(*map));
+    map->fd = open(path, O_RDONLY);
+    if(map->fd < 0) {
+        return -1;
+    }
+    if(fstat(map->fd, &st) != 0) {
+        close(map->fd);
+        return -1;
+    }
+
+    // the whole file must fit into the address space, 32-bit size_t on ARMv7
+    if((uint64_t)st.st_size > SIZE_MAX) {
+        close(map->fd);
+        errno = EFBIG;
+        return -1;
+    }
+
+    map->size = (size_t)st.st_size;
+    if(map->size > 0) {
+        map->data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, map->fd, 0);
+        if(map->data == MAP_FAILED) {
+            close(map->fd);
+            map->data = NULL;
+            return -1;
+        }
+        madvise(map->data, map->size, MADV_SEQUENTIAL);
+    }
+
+    return 0;
+}
+
+
+int file_map_write(file_map *map, const char *path, size_t size) {
+    memset(map, 0, sizeof(*map));
+    map->writable = 1;
+    map->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(map->fd < 0) {
+        return -1;
+    }
+    if(ftruncate(map->fd, (off_t)size) != 0) {
+        close(map->fd);
+        return -1;
+    }
+
+    map->size = size;
+    if(size > 0) {
+        map->data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, map->fd, 0);
+        if(map->data == MAP_FAILED) {
+            close(map->fd);
+            map->data = NULL;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+int file_map_close(file_map *map) {
+    int ret = 0;
+
+    if(map->data != NULL) {
+        if(map->writable && msync(map->data, map->size, MS_SYNC) != 0) {
+            ret = -1;
+        }
+        munmap(map->data, map->size);
+    }
+    if(close(map->fd) != 0) {
+        ret = -1;
+    }
+    map->data = NULL;
+
+    return ret;
+}
+
+
+int file_writer_open(file_writer *writer, const char *path, size_t buffer_size) {
+    memset(writer, 0, sizeof(*writer));
+
+    writer->capacity = (page_round_up(buffer_size) + DIRECT_ALIGN - 1) / DIRECT_ALIGN * DIRECT_ALIGN;
+    if(posix_memalign((void **)&writer->buffer, DIRECT_ALIGN, writer->capacity) != 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    writer->direct = 1;
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if(writer->fd < 0 && errno == EINVAL) {
+        // the file system does not support O_DIRECT
+        writer->direct = 0;
+        writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if(writer->fd < 0) {
+        free(writer->buffer);
+        writer->buffer = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+
+// writes the buffer out; with O_DIRECT only whole aligned blocks can be
+// written, a partial last block is padded and the file trimmed on close
+static int writer_flush(file_writer *writer, int final) {
+    size_t len = writer->used;
+
+    if(len == 0) {
+        return 0;
+    }
+    if(writer->direct) {
+        len = final ? (len + DIRECT_ALIGN - 1) / DIRECT_ALIGN * DIRECT_ALIGN
+                    : len / DIRECT_ALIGN * DIRECT_ALIGN;
+        memset(writer->buffer + writer->used, 0, len > writer->used ? len - writer->used : 0);
+    }
+    if(len == 0) {
+        return 0;
+    }
+
+    if(write_full(writer->fd, writer->buffer, len) != 0) {
+        return -1;
+    }
+
+    if(len >= writer->used) {
+        writer->written += writer->used;
+        writer->used = 0;
+    } else {
+        // keep the unaligned rest at the start of the buffer
+        memmove(writer->buffer, writer->buffer + len, writer->used - len);
+        writer->written += len;
+        writer->used -= len;
+    }
+
+    return 0;
+}
+
+
+uint8_t *file_writer_reserve(file_writer *writer, size_t *available) {
+    if(writer->used == writer->capacity && writer_flush(writer, 0) != 0) {
+        *available = 0;
+        return NULL;
+    }
+
+    *available = writer->capacity - writer->used;
+    return writer->buffer + writer->used;
+}
+
+
+int file_writer_commit(file_writer *writer, size_t len) {
+    writer->used += len;
+
+    if(writer->used == writer->capacity) {
+        return writer_flush(writer, 0);
+    }
+    return 0;
+}
+
+
+int file_writer_write(file_writer *writer, const uint8_t *data, size_t len) {
+    while(len > 0) {
+        size_t available;
+        uint8_t *dst = file_writer_reserve(writer, &available);
+
+        if(dst == NULL) {
+            return -1;
+        }
+        if(available > len) {
+            available = len;
+        }
+        memcpy(dst, data, available);
+        if(file_writer_commit(writer, available) != 0) {
+            return -1;
+        }
+        data += available;
+        len -= available;
+    }
+
+    return 0;
+}
+
+
+int file_writer_close(file_writer *writer) {
+    int ret = 0;
+    uint64_t total = writer->written + writer->used;
+
+    if(writer_flush(writer, 1) != 0) {
+        ret = -1;
+    }
+    // drop the padding of the last O_DIRECT block
+    if(writer->direct && ftruncate(writer->fd, (off_t)total) != 0) {
+        ret = -1;
+    }
+    if(close(writer->fd) != 0) {
+        ret = -1;
+    }
+
+    free(writer->buffer);
+    writer->buffer = NULL;
+
+    return ret;
+}
@@ -0,0 +1,75 @@
+/* Zero-copy file input and output for the NEON kernels
+ *
+ * Input is memory mapped in windows (the whole file does not have to fit
+ * into the 32-bit address space) and handed to a callback in page-aligned
+ * chunks, with sequential/readahead hints for the kernel. Files that cannot
+ * be mapped (pipes, some special files) fall back to read() into two
+ * page-aligned buffers: a reader thread fills one while the callback
+ * processes the other.
+ *
+ * Output goes either into a shared writable mapping of the final file size
+ * or through a page-aligned buffer that is written with O_DIRECT where the
+ * file system supports it.
+ *
+ * Functions returning int return 0 on success and -1 with errno set on
+ * failure.
+ */
+
+#ifndef FILEIO_H
+#define FILEIO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// called for every chunk, a non-zero return value stops processing and is
+// returned by file_process()
+typedef int (*file_chunk_fn)(const uint8_t *chunk, size_t len, uint64_t offset, void *ctx);
+
+// processes a whole file in chunks of chunk_size (rounded up to pages),
+// only the last chunk may be shorter
+int file_process(const char *path, size_t chunk_size, file_chunk_fn fn, void *ctx);
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    int fd;
+    int writable;
+} file_map;
+
+// maps a whole file read-only, fails with EFBIG if its size does not fit
+// into size_t (files that large, or too large for the address space, go
+// through file_process())
+int file_map_read(file_map *map, const char *path);
+
+// creates (or truncates) a file of the given size and maps it writable
+int file_map_write(file_map *map, const char *path, size_t size);
+
+// unmaps, writable mappings are synced first
+int file_map_close(file_map *map);
+
+typedef struct {
+    int fd;
+    int direct;
+    uint8_t *buffer;
+    size_t capacity;
+    size_t used;
+    uint64_t written;
+} file_writer;
+
+// opens a buffered writer, buffer_size is rounded up to pages
+int file_writer_open(file_writer *writer, const char *path, size_t buffer_size);
+
+// free space in the buffer for kernels to write to directly, flushes first
+// if the buffer is full
+uint8_t *file_writer_reserve(file_writer *writer, size_t *available);
+
+// marks len bytes of the reserved space as written
+int file_writer_commit(file_writer *writer, size_t len);
+
+// copies len bytes through the buffer
+int file_writer_write(file_writer *writer, const uint8_t *data, size_t len);
+
+// flushes, trims the file to the bytes written and closes it
+int file_writer_close(file_writer *writer);
+
+#endif
@@ -4,12 +4,155 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include "arm_neon.h"
+#include "bitpack.h"
+#include "delta.h"
+#include "rle.h"
+#include "bswap.h"
+#include "bitlen.h"
+#include "streamvbyte.h"
+#include "utf8.h"
+#include "ascii.h"
+#include "checksum.h"
+#include "fileio.h"
+#include "neon_alloc.h"
+#include "stream.h"
+#include "trace.h"
+#include "check.h"
+#include "shift.h"
+#include "vecops.h"
+#include "normalize.h"
+#include "audio.h"
+#include "morph.h"
+#include "batch.h"
+#include "pipeline.h"
+#include "tune.h"
+#include "motion.h"
+#include "roaring.h"
+#include "sortedset.h"
+#include "sort.h"
+
+// file_process() callback: checksum every chunk
+static int file_adler32_chunk(const uint8_t *chunk, size_t len, uint64_t offset, void *ctx) {
+    uint32_t *adler = ctx;
+
+    (void)offset;
+    *adler = adler32_update(*adler, chunk, len);
 
-int main() {
+    return 0;
+}
+
+// pipeline stages: upper case the frame, then append its CRC32C
+static int frame_toupper(pipeline_frame *frame, void *context) {
+    (void)context;
+    ascii_toupper(frame->data, frame->size, frame->data);
+
+    return 0;
+}
+
+static int frame_crc32c(pipeline_frame *frame, void *context) {
+    uint32_t crc = crc32c_update(CRC32C_INIT, frame->data, frame->size);
+
+    (void)context;
+    memcpy(frame->data + frame->size, &crc, 4);
+
+    return 0;
+}
+
+#ifdef NEON_TRACE
+// traced work of the trace subcommand and the example: buffer kernels, the
+// chunks of a file and the stage kernels of a pipeline
+static void trace_workload(const char *path) {
+    uint8_t *buffer = neon_alloc(1 << 20);
+    uint32_t crc = CRC32C_INIT, adler = ADLER32_INIT;
+    const pipeline_config config = {4, 4096, 1, 0};
+    const pipeline_stage stages[2] = {{frame_toupper, NULL, -1}, {frame_crc32c, NULL, -1}};
+    pipeline *p = pipeline_create(&config, stages, 2);
+    pipeline_frame *frame;
+    int i;
+
+    if(buffer != NULL) {
+        memset(buffer, 'x', 1 << 20);
+        for(i = 0; i < 8; i++) {
+            TRACE_KERNEL("ascii_toupper", 2 << 20, ascii_toupper(buffer, 1 << 20, buffer));
+            TRACE_KERNEL("bswap32_buf", 2 << 20, bswap32_buf((uint32_t *)buffer, 1 << 18, (uint32_t *)buffer));
+            TRACE_KERNEL("crc32c", 1 << 20, crc = crc32c_update(crc, buffer, 1 << 20));
+        }
+        neon_free(buffer);
+    }
+
+    file_process(path, 1 << 16, file_adler32_chunk, &adler);
+
+    if(p != NULL) {
+        // room for the CRC appended by the second stage
+        for(i = 0; i < 16; i++) {
+            frame = pipeline_acquire(p);
+            frame->size = 4000;
+            memset(frame->data, 'a' + i % 26, frame->size);
+            pipeline_submit(p, frame);
+            pipeline_release(p, pipeline_receive(p, 1));
+        }
+        pipeline_destroy(p);
+    }
+}
+#endif
+
+int main(int argc, char **argv) {
 
     printf("ARM NEON Examples\n");
 
+    // prefetch distance and non-temporal threshold of the streaming kernels,
+    // replaced by the tuned ones if the cache file fits this board
+    stream_init();
+    const char *tune_path = getenv("NEON_TUNE_FILE") != NULL ? getenv("NEON_TUNE_FILE") : "arm_neon_examples.tune";
+    tune_load(tune_path);
+
+    // benchmarks the settings on this board and writes them to the cache
+    // file: arm_neon_examples tune
+    if(argc > 1 && strcmp(argv[1], "tune") == 0) {
+        tune_result tuned;
+
+        if(tune_run(0, &tuned) != 0) {
+            return 1;
+        }
+        printf("prefetch distance %zu bytes, unroll %u, non-temporal from %zu bytes: %.0f MB/s (before %.0f MB/s)\n",
+               tuned.prefetch_distance, tuned.unroll, tuned.nontemporal_threshold, tuned.tuned_mbps,
+               tuned.default_mbps);
+
+        return tune_save(tune_path) == 0 ? 0 : 1;
+    }
+
+    // differential checks instead of the examples:
+    // arm_neon_examples check [iterations] [seed]
+    if(argc > 1 && strcmp(argv[1], "check") == 0) {
+        unsigned iterations = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 0) : 200;
+        uint32_t seed = argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 0) : 1;
+
+        return check_all(iterations, seed) == 0 ? 0 : 1;
+    }
+
+    // traces kernel calls (with this binary as the file input) and writes
+    // them as CSV: arm_neon_examples trace [file]
+    if(argc > 1 && strcmp(argv[1], "trace") == 0) {
+#ifdef NEON_TRACE
+        if(trace_init(TRACE_PMU) != 0) {
+            fprintf(stderr, "PMU counters unavailable (perf_event_paranoid?)\n");
+        }
+        trace_workload(argv[0]);
+        if(argc > 2) {
+            return trace_dump_file(argv[2]) == 0 ? 0 : 1;
+        }
+        trace_dump(stdout);
+        return 0;
+#else
+        fprintf(stderr, "tracing is compiled out, configure with -DNEON_TRACE=ON\n");
+        return 1;
+#endif
+    }
+
     int i;
 
     // data
@@ -1309,5 +1452,684 @@ int main() {
     }
     printf("\n");
 
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Bit Packing 3-Bit Unsigned Integer (x16):\n");
+
+    uint8_t data_packed[16];
+    size_t packed_size;
+
+    for(i = 0; i < 16; i++) {
+        data0[i] = i & 7;
+    }
+
+    // 16 values of 3 bits are packed into 6 bytes (LSB first)
+    packed_size = bitpack_pack(data0, 16, 3, data_packed);
+    bitpack_unpack(data_packed, 16, 3, result);
+
+    printf("packed:   ");
+    for(i = 0; i < (int)packed_size; i++) {
+        printf("0x%02x ", data_packed[i]);
+    }
+    printf("\n");
+    for(i = 0; i < 16; i++) {
+        printf("%u -> %u\n", data0[i], result[i]);
+    }
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Bit-Planes 8-Bit Unsigned Integer (x16):\n");
+
+    uint8_t data_planes[16];
+
+    for(i = 0; i < 16; i++) {
+        data0[i] = i * 17;
+    }
+
+    // plane k holds bit k of every byte, 2 bytes per plane for 16 bytes
+    bitplane_split(data0, 16, data_planes);
+    bitplane_merge(data_planes, 16, result);
+
+    for(i = 0; i < 8; i++) {
+        printf("plane %d: 0x%02x 0x%02x\n", i, data_planes[2*i], data_planes[2*i+1]);
+    }
+    for(i = 0; i < 16; i++) {
+        printf("%u -> %u\n", data0[i], result[i]);
+    }
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Delta Coding 8-Bit Unsigned Integer (x16):\n");
+
+    for(i = 0; i < 16; i++) {
+        data0[i] = 100 + i * i;
+    }
+
+    // result[i] = data0[i] - data0[i-1], decoded back in-place with a
+    // prefix sum
+    delta_encode_u8(data0, 16, result);
+
+    for(i = 0; i < 16; i++) {
+        printf("%u -> %u\n", data0[i], result[i]);
+    }
+
+    delta_decode_u8(result, 16, result);
+
+    printf("decoded: ");
+    for(i = 0; i < 16; i++) {
+        printf("%u ", result[i]);
+    }
+    printf("\n");
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Run-Length Coding 8-Bit Unsigned Integer (x32):\n");
+
+    uint8_t data_rle[64];
+    size_t rle_size;
+
+    for(i = 0; i < 32; i++) {
+        result_x2[i] = i < 20 ? 7 : i < 28 ? 0 : i;
+    }
+
+    // (count, value) pairs, runs are skipped 16 bytes at a time
+    rle_size = rle_encode(result_x2, 32, data_rle);
+
+    for(i = 0; i < (int)rle_size; i += 2) {
+        printf("%u x %u\n", data_rle[i], data_rle[i+1]);
+    }
+    printf("decoded %zu bytes\n", rle_decode(data_rle, rle_size, result_x2, 32));
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Byte Swap 16/32-Bit Unsigned Integer and Big-Endian to Float:\n");
+
+    uint8_t data_be[16] = {0x12,0x34, 0x56,0x78, 0x9a,0xbc, 0xde,0xf0,
+                           0x3f,0x80,0x00,0x00, 0xc0,0x20,0x00,0x00};
+    uint32_t result_uint32[4];
+    float result_float32[4];
+
+    // vrev16q_u8 / vrev32q_u8 on the raw bytes
+    be16_to_u16(data_be, 8, result_uint16);
+    be32_to_u32(data_be, 4, result_uint32);
+    be32_to_f32(data_be + 8, 2, result_float32);
+
+    printf("be16: ");
+    for(i = 0; i < 8; i++) {
+        printf("0x%04x ", result_uint16[i]);
+    }
+    printf("\n");
+    printf("be32: ");
+    for(i = 0; i < 4; i++) {
+        printf("0x%08x ", result_uint32[i]);
+    }
+    printf("\n");
+    printf("be32 float: %f %f\n", result_float32[0], result_float32[1]);
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Bit Length, floor(log2) and Varint Length 32-Bit Unsigned Integer (x16):\n");
+
+    uint32_t data_varint[16];
+    uint8_t result_bitlen[16], result_log2[16], result_varint[16];
+
+    for(i = 0; i < 16; i++) {
+        data_varint[i] = i == 0 ? 0 : 1u << (2 * i - 1);
+    }
+
+    // 32 - vclzq_u32, narrowed to bytes
+    bitlen_u32(data_varint, 16, result_bitlen);
+    ilog2_u32(data_varint, 16, result_log2);
+    varint_len_u32(data_varint, 16, result_varint);
+
+    for(i = 0; i < 16; i++) {
+        printf("%10u: bitlen %2u  log2 %3d  varint %u\n", data_varint[i],
+               result_bitlen[i], (int8_t)result_log2[i], result_varint[i]);
+    }
+    printf("varint size: %zu\n", varint_size_u32(data_varint, 16));
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("StreamVByte 32-Bit Unsigned Integer (x8):\n");
+
+    uint32_t data_svb[8] = {1, 300, 70000, 20000000, 5, 255, 256, 4000000000u};
+    uint32_t result_svb[8];
+    uint8_t data_svb_encoded[42];
+    size_t svb_size;
+
+    // one control byte per 4 integers, decoded with a vtbl2_u8 shuffle
+    svb_size = svb_encode(data_svb, 8, data_svb_encoded);
+    svb_decode(data_svb_encoded, svb_size, result_svb, 8);
+
+    printf("control: 0x%02x 0x%02x, %zu bytes\n", data_svb_encoded[0], data_svb_encoded[1], svb_size);
+    for(i = 0; i < 8; i++) {
+        printf("%u -> %u\n", data_svb[i], result_svb[i]);
+    }
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("UTF-8 Validation and Transcoding:\n");
+
+    const char *text_valid = "ARM NEON \xc3\xa4\xc3\xb6\xc3\xbc \xe2\x82\xac \xf0\x9f\x98\x80";
+    const char *text_invalid = "ARM NEON \xc0\xaf overlong";
+    uint16_t result_utf16[32];
+    size_t utf16_size;
+
+    printf("valid:   %d\n", utf8_validate((const uint8_t *)text_valid, strlen(text_valid)));
+    printf("invalid: %d\n", utf8_validate((const uint8_t *)text_invalid, strlen(text_invalid)));
+
+    utf16_size = utf8_to_utf16((const uint8_t *)text_valid, strlen(text_valid), result_utf16);
+
+    printf("utf-16:  ");
+    for(i = 0; i < (int)utf16_size; i++) {
+        printf("%04x ", result_utf16[i]);
+    }
+    printf("\n");
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("ASCII Case Conversion and Tokenizing:\n");
+
+    const char *text_header = "Content-Type: text/html; charset=UTF-8";
+    uint8_t result_text[64], result_starts[8], result_ends[8];
+    size_t text_size = strlen(text_header), tokens;
+
+    ascii_toupper((const uint8_t *)text_header, text_size, result_text);
+    printf("upper: %.*s\n", (int)text_size, result_text);
+    ascii_tolower((const uint8_t *)text_header, text_size, result_text);
+    printf("lower: %.*s\n", (int)text_size, result_text);
+    printf("equal ignoring case: %d\n",
+           ascii_equal_ignore_case((const uint8_t *)text_header, result_text, text_size));
+
+    // token starts/ends as bitmaps over alphanumeric runs
+    tokens = ascii_tokenize((const uint8_t *)text_header, text_size, ASCII_CLASS_ALNUM,
+                            result_starts, result_ends);
+
+    printf("%zu tokens: ", tokens);
+    for(i = 0; i < (int)text_size; i++) {
+        if(result_ends[i / 8] & (1 << (i % 8))) {
+            printf("]");
+        }
+        if(result_starts[i / 8] & (1 << (i % 8))) {
+            printf("[");
+        }
+        printf("%c", text_header[i]);
+    }
+    printf("]\n");
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Checksums 8-Bit Unsigned Integer (x32):\n");
+
+    uint32_t checksum;
+
+    for(i = 0; i < 32; i++) {
+        result_x2[i] = i;
+    }
+
+    // one shot and in two chunks
+    printf("adler-32:    0x%08x\n", adler32_update(ADLER32_INIT, result_x2, 32));
+    checksum = adler32_update(ADLER32_INIT, result_x2, 10);
+    checksum = adler32_update(checksum, result_x2 + 10, 22);
+    printf("adler-32:    0x%08x (chunked)\n", checksum);
+    printf("fletcher-16: 0x%04x\n", fletcher16_update(FLETCHER16_INIT, result_x2, 32));
+    printf("fletcher-32: 0x%08x\n", fletcher32_update(FLETCHER32_INIT, result_x2, 32));
+    printf("crc-32c:     0x%08x\n", crc32c_update(CRC32C_INIT, result_x2, 32));
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Memory Mapped File Processing:\n");
+
+    char file_path[] = "/tmp/arm_neon_examples_XXXXXX";
+    file_writer writer;
+    uint32_t file_adler = ADLER32_INIT;
+    int file_fd;
+
+    // write 1 MiB through the (O_DIRECT) writer, read it back mapped in
+    // 256 KiB chunks and checksum every chunk in place
+    file_fd = mkstemp(file_path);
+    if(file_fd >= 0 && close(file_fd) == 0 && file_writer_open(&writer, file_path, 65536) == 0) {
+        for(i = 0; i < 4096; i++) {
+            size_t available;
+            uint8_t *dst = file_writer_reserve(&writer, &available);
+            memset(dst, i, 256);
+            file_writer_commit(&writer, 256);
+        }
+        file_writer_close(&writer);
+
+        if(file_process(file_path, 256 * 1024, file_adler32_chunk, &file_adler) == 0) {
+            printf("adler-32 of %s: 0x%08x (O_DIRECT: %d)\n", file_path, file_adler, writer.direct);
+        }
+        unlink(file_path);
+    }
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Aligned Buffer Allocation:\n");
+
+    uint8_t *aligned_buffer = neon_alloc(100);
+    neon_arena frame_arena;
+
+    if(aligned_buffer != NULL) {
+        printf("neon_alloc(100): aligned to 64: %d, usable size: %zu, padding: %d\n",
+               ((uintptr_t)aligned_buffer % NEON_ALLOC_ALIGN) == 0,
+               neon_alloc_usable_size(aligned_buffer), NEON_ALLOC_PADDING);
+        neon_free(aligned_buffer);
+    }
+
+    // per frame scratch buffers, released together by the reset
+    if(neon_arena_init(&frame_arena, 4096) == 0) {
+        for(i = 0; i < 3; i++) {
+            uint8_t *scratch = neon_arena_alloc(&frame_arena, 1000);
+            printf("frame %d: scratch at arena offset %zu\n", i,
+                   (size_t)(scratch - frame_arena.base));
+            neon_arena_reset(&frame_arena);
+        }
+        neon_arena_destroy(&frame_arena);
+    }
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Prefetching and Non-Temporal Stores:\n");
+
+    size_t stream_size = 4 * stream_settings.nontemporal_threshold;
+    uint8_t *stream_buffer = neon_alloc(stream_size);
+
+    printf("L2 cache: %zu bytes, prefetch distance: %zu bytes, non-temporal from %zu bytes\n",
+           stream_l2_cache_size(), stream_settings.prefetch_distance,
+           stream_settings.nontemporal_threshold);
+
+    // larger than the L2: prefetched loads, stores around the cache
+    if(stream_buffer != NULL) {
+        memset(stream_buffer, 'a', stream_size);
+        ascii_toupper(stream_buffer, stream_size, stream_buffer);
+        printf("ascii_toupper of %zu bytes (non-temporal: %d): %c\n", stream_size,
+               stream_nontemporal(2 * stream_size), stream_buffer[stream_size - 1]);
+        neon_free(stream_buffer);
+    }
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Kernel Instrumentation:\n");
+
+#ifdef NEON_TRACE
+    // counters are optional, times and bytes are always recorded
+    if(trace_init(TRACE_PMU) != 0) {
+        printf("PMU counters unavailable (perf_event_paranoid?)\n");
+    }
+    trace_workload(argv[0]);
+    trace_summary(stdout);
+#else
+    printf("tracing is compiled out, configure with -DNEON_TRACE=ON\n");
+#endif
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Constant Shift Kernels 8-Bit Unsigned Integer:\n");
+
+    uint8_t shift_result[16];
+
+    // the same shift amount for all elements selects the immediate forms
+    for(i = 0; i < 16; i++) {
+        data0[i] = (uint8_t)(i * 17);
+    }
+    shift_u8(data0, 16, 3, SHIFT_SATURATING, result);
+    shift_u8(data0, 16, -3, SHIFT_ROUNDING, shift_result);
+    for(i = 0; i < 16; i++) {
+        printf("min(%u << 3, UINT8_MAX) = %u, round(%u / 8) = %u\n",
+               data0[i], result[i], data0[i], shift_result[i]);
+    }
+
+    // acc += data0 >> 4 (vsraq_n) and rotate by 1 (vshrq_n + vsliq_n)
+    memcpy(result, data1, 16);
+    shift_right_accumulate_u8(result, data0, 16, 4, 0);
+    rotate_left_u8(data0, 16, 1, shift_result);
+    for(i = 0; i < 16; i++) {
+        printf("%u + (%u >> 4) = %u, rotl(%u, 1) = %u\n",
+               data1[i], data0[i], result[i], data0[i], shift_result[i]);
+    }
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Mixed Width Element-wise Operations:\n");
+
+    int16_t samples0[12], samples1[12], samples_sum[12];
+    float scale0[6], scale1[6], scale_max[6];
+    uint32_t scale_mask[6];
+
+    // 12 lanes of int16 are one full vector of 8 and a padded tail of 4
+    for(i = 0; i < 12; i++) {
+        samples0[i] = (int16_t)(i * 5000 - 27000);
+        samples1[i] = (int16_t)(i * 2000);
+    }
+    vec_qadd_s16(samples0, samples1, 12, samples_sum);
+    for(i = 0; i < 12; i++) {
+        printf("sat(%d + %d) = %d\n", samples0[i], samples1[i], samples_sum[i]);
+    }
+
+    for(i = 0; i < 6; i++) {
+        scale0[i] = (float)i * 0.5f;
+        scale1[i] = 2.5f - (float)i * 0.25f;
+    }
+    vec_max_f32(scale0, scale1, 6, scale_max);
+    vec_cmpgt_f32(scale0, scale1, 6, scale_mask);
+    for(i = 0; i < 6; i++) {
+        printf("max(%.2f, %.2f) = %.2f, %.2f > %.2f = 0x%08x\n",
+               scale0[i], scale1[i], scale_max[i], scale0[i], scale1[i], (unsigned)scale_mask[i]);
+    }
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Normalization 8-Bit Unsigned Integer RGB to Float NCHW and Back:\n");
+
+    uint8_t rgb[3 * 20], rgb_back[3 * 20];
+    float planes[3 * 20];
+    const float rgb_mean[3] = {123.675f, 116.28f, 103.53f};
+    const float rgb_inv_std[3] = {1.0f / 58.395f, 1.0f / 57.12f, 1.0f / 57.375f};
+    const float rgb_std[3] = {58.395f, 57.12f, 57.375f};
+
+    // 20 pixels are one block of 16 (vld3q_u8, vmovl, vcvtq) and a scalar tail
+    for(i = 0; i < 3 * 20; i++) {
+        rgb[i] = (uint8_t)(i * 13);
+    }
+    normalize_u8_f32(rgb, 20, 3, rgb_mean, rgb_inv_std, NORMALIZE_NCHW, planes);
+    quantize_f32_u8(planes, 20, 3, rgb_std, rgb_mean, NORMALIZE_NCHW, rgb_back);
+    for(i = 0; i < 20; i++) {
+        printf("(%3u %3u %3u) -> (%6.3f %6.3f %6.3f) -> (%3u %3u %3u)\n",
+               rgb[3 * i], rgb[3 * i + 1], rgb[3 * i + 2],
+               planes[i], planes[20 + i], planes[40 + i],
+               rgb_back[3 * i], rgb_back[3 * i + 1], rgb_back[3 * i + 2]);
+    }
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Audio Mixing, Gain Ramp and Filters 16-Bit Signed Integer:\n");
+
+    int16_t voice[16], music[16], mixed[16], faded[16], smoothed[16];
+    const int16_t *tracks[2] = {voice, music};
+    const int16_t track_gains[2] = {24576, 16384};   // 0.75, 0.5
+    const int16_t smoothing_taps[4] = {8192, 8192, 8192, 8192};
+    const audio_biquad_coeffs lowpass = {256, 512, 256, -24576, 9216};   // unity gain at DC
+    static audio_fir smoothing;
+    static audio_biquad filter;
+
+    for(i = 0; i < 16; i++) {
+        voice[i] = (int16_t)(i % 2 ? 20000 : -20000);
+        music[i] = (int16_t)(i * 2000);
+    }
+    // saturating sum (vqdmlal_n + vqrshrn_n), then a fade out (vqrdmulhq)
+    audio_mix_s16(tracks, track_gains, 2, 16, mixed);
+    audio_gain_ramp_s16(mixed, 16, 32767, 0, faded);
+    for(i = 0; i < 16; i++) {
+        printf("0.75 * %d + 0.5 * %d = %d, faded %d\n", voice[i], music[i], mixed[i], faded[i]);
+    }
+
+    // 4-tap moving average and a 2nd order low-pass (Q14) on the voice
+    audio_fir_init(&smoothing, smoothing_taps, 4);
+    audio_fir_process(&smoothing, voice, 16, smoothed);
+    audio_biquad_init(&filter, &lowpass, 1, 1);
+    audio_biquad_process(&filter, voice, 16, faded);
+    for(i = 0; i < 16; i++) {
+        printf("%d: moving average %d, low-pass %d\n", voice[i], smoothed[i], faded[i]);
+    }
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Morphology and Median Filter 8-Bit Unsigned Integer:\n");
+
+    uint8_t mask[8 * 20], cleaned[8 * 20], denoised[8 * 20];
+    size_t x, y;
+
+    // a block with salt and pepper noise: dilate(erode()) (an opening)
+    // removes the specks but opens up the hole, the median removes both
+    // and only rounds the corners
+    for(y = 0; y < 8; y++) {
+        for(x = 0; x < 20; x++) {
+            mask[y * 20 + x] = (x >= 4 && x < 16 && y >= 2 && y < 6) ? 255 : 0;
+        }
+    }
+    mask[0 * 20 + 1] = 255;
+    mask[7 * 20 + 18] = 255;
+    mask[3 * 20 + 9] = 0;
+    morph_erode_u8(mask, 20, 8, 20, 3, denoised, 20);
+    morph_dilate_u8(denoised, 20, 8, 20, 3, cleaned, 20);
+    morph_median3x3_u8(mask, 20, 8, 20, denoised, 20);
+    for(y = 0; y < 8; y++) {
+        for(x = 0; x < 20; x++) {
+            printf("%c", mask[y * 20 + x] ? '#' : '.');
+        }
+        printf("   ");
+        for(x = 0; x < 20; x++) {
+            printf("%c", cleaned[y * 20 + x] ? '#' : '.');
+        }
+        printf("   ");
+        for(x = 0; x < 20; x++) {
+            printf("%c", denoised[y * 20 + x] ? '#' : '.');
+        }
+        printf("\n");
+    }
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Batched Operations on Small Records:\n");
+
+    uint8_t patches[4 * 24], reference[4 * 24];
+    uint32_t bits[4], distances[4], sums[4];
+    uint8_t same[4];
+
+    // four 20-byte patches 24 bytes apart, processed in pairs by one call
+    for(i = 0; i < 4 * 24; i++) {
+        patches[i] = (uint8_t)(i * 7);
+        reference[i] = (uint8_t)(i * 7 + (i / 24 == 2 ? 3 : 0));
+    }
+    batch_popcount_strided(patches, 24, 20, 4, bits);
+    batch_equal_strided(patches, reference, 24, 20, 4, same);
+    batch_sad_strided(patches, reference, 24, 20, 4, distances);
+    batch_adler32_strided(patches, 24, 20, 4, sums);
+    for(i = 0; i < 4; i++) {
+        printf("patch %u: popcount %u, equal %u, SAD %u, Adler-32 0x%08x\n",
+               i, bits[i], same[i], distances[i], sums[i]);
+    }
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Frame Pipeline with Two Stage Threads:\n");
+
+    const pipeline_config frame_config = {3, 64, 0, 0};
+    const pipeline_stage frame_stages[2] = {{frame_toupper, NULL, -1}, {frame_crc32c, NULL, -1}};
+    pipeline *frames = pipeline_create(&frame_config, frame_stages, 2);
+    pipeline_statistics frame_stats;
+    pipeline_frame *frame;
+    uint32_t frame_crc;
+
+    if(frames != NULL) {
+        // capture and output on this thread, with block = 0 a full pool
+        // drops the new frame instead of stalling the capture; the demo
+        // waits for each frame so that none are dropped
+        for(i = 0; i < 8; i++) {
+            frame = pipeline_acquire(frames);
+            if(frame != NULL) {
+                frame->size = (size_t)snprintf((char *)frame->data, 60, "frame %d", i);
+                pipeline_submit(frames, frame);
+            }
+            do {
+                while((frame = pipeline_receive(frames, 0)) != NULL) {
+                    memcpy(&frame_crc, frame->data + frame->size, 4);
+                    printf("%.*s crc32c 0x%08x\n", (int)frame->size, (const char *)frame->data, frame_crc);
+                    pipeline_release(frames, frame);
+                }
+                pipeline_get_statistics(frames, &frame_stats);
+            } while(frame_stats.completed < frame_stats.submitted);
+        }
+        printf("submitted %llu, completed %llu, dropped %llu, latency p50 %llu ns, max %llu ns\n",
+               (unsigned long long)frame_stats.submitted, (unsigned long long)frame_stats.completed,
+               (unsigned long long)frame_stats.dropped_no_frame,
+               (unsigned long long)frame_stats.latency_p50_ns, (unsigned long long)frame_stats.latency_max_ns);
+        pipeline_destroy(frames);
+    }
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Motion Detection:\n");
+
+    // a bright 12x12 square moving over a flat background, 16x16 tiles
+    static uint8_t motion_frame[32 * 64], motion_background[32 * 64];
+    uint32_t motion_counts[8];
+    size_t motion_tile;
+
+    memset(motion_background, 100, sizeof(motion_background));
+    for(i = 0; i < 3; i++) {
+        int x, y;
+
+        memset(motion_frame, 100, sizeof(motion_frame));
+        for(y = 4; y < 16; y++) {
+            for(x = 10 + 16 * i; x < 22 + 16 * i; x++) {
+                motion_frame[(y + 4 * i) * 64 + x] = 200;
+            }
+        }
+        // background moves a quarter of the way towards every frame
+        motion_detect_u8(motion_frame, 64, 32, 64, motion_background, 64, 30, 2, 16, 16, motion_counts);
+        printf("frame %d: changed pixels per tile", i);
+        for(motion_tile = 0; motion_tile < 8; motion_tile++) {
+            printf("%s%3u", motion_tile == 4 ? " |" : " ", motion_counts[motion_tile]);
+        }
+        printf("\n");
+    }
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Roaring Bitmaps:\n");
+
+    // documents tagged "red", "large" and "new": multiples of 3 (bitmap
+    // containers), a dense range and a sparse set across three keys
+    roaring_bitmap tag_red, tag_large, tag_new, tag_query;
+    const roaring_bitmap *tags[3] = {&tag_red, &tag_large, &tag_new};
+    uint32_t tag_values[8];
+    size_t tag_count;
+
+    roaring_init(&tag_red);
+    roaring_init(&tag_large);
+    roaring_init(&tag_new);
+    roaring_init(&tag_query);
+    for(i = 0; i < 200000; i += 3) {
+        roaring_add(&tag_red, (uint32_t)i);
+    }
+    for(i = 60000; i < 140000; i++) {
+        roaring_add(&tag_large, (uint32_t)i);
+    }
+    for(i = 0; i < 200000; i += 9973) {
+        roaring_add(&tag_new, (uint32_t)i);
+    }
+
+    printf("red %llu, large %llu, new %llu documents\n",
+           (unsigned long long)roaring_cardinality(&tag_red),
+           (unsigned long long)roaring_cardinality(&tag_large),
+           (unsigned long long)roaring_cardinality(&tag_new));
+    printf("red and large: %llu\n", (unsigned long long)roaring_and_cardinality(&tag_red, &tag_large));
+    if(roaring_or(&tag_red, &tag_large, &tag_query) == 0) {
+        printf("red or large: %llu\n", (unsigned long long)roaring_cardinality(&tag_query));
+    }
+    if(roaring_andnot(&tag_large, &tag_red, &tag_query) == 0) {
+        printf("large but not red: %llu\n", (unsigned long long)roaring_cardinality(&tag_query));
+    }
+    if(roaring_and_many(tags, 3, &tag_query) == 0 && roaring_cardinality(&tag_query) <= 8) {
+        tag_count = roaring_to_array(&tag_query, tag_values);
+        printf("red, large and new:");
+        for(i = 0; i < (int)tag_count; i++) {
+            printf(" %u", tag_values[i]);
+        }
+        printf("\n");
+    }
+
+    roaring_free(&tag_red);
+    roaring_free(&tag_large);
+    roaring_free(&tag_new);
+    roaring_free(&tag_query);
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Sorted Set Operations 32-Bit Unsigned Integer:\n");
+
+    // posting lists of two terms: every 3rd and every 5th document, and a
+    // rare term with a handful of documents (galloping)
+    static uint32_t posting_a[400], posting_b[240], posting_rare[5] = {15, 150, 301, 600, 1185};
+    static uint32_t posting_out[640];
+    size_t posting_n;
+
+    for(i = 0; i < 400; i++) {
+        posting_a[i] = 3 * (uint32_t)i;
+    }
+    for(i = 0; i < 240; i++) {
+        posting_b[i] = 5 * (uint32_t)i;
+    }
+
+    posting_n = sorted_intersect_u32(posting_a, 400, posting_b, 240, posting_out);
+    printf("intersection: %zu documents, first %u %u %u, last %u\n", posting_n,
+           posting_out[0], posting_out[1], posting_out[2], posting_out[posting_n - 1]);
+    posting_n = sorted_union_u32(posting_a, 400, posting_b, 240, posting_out);
+    printf("union: %zu documents\n", posting_n);
+    posting_n = sorted_difference_u32(posting_a, 400, posting_b, 240, posting_out);
+    printf("difference: %zu documents\n", posting_n);
+    posting_n = sorted_merge_u32(posting_a, 400, posting_b, 240, posting_out);
+    printf("merge: %zu values, %u %u %u %u ...\n", posting_n,
+           posting_out[0], posting_out[1], posting_out[2], posting_out[3]);
+    posting_n = sorted_intersect_u32(posting_rare, 5, posting_a, 400, posting_out);
+    printf("rare term and every 3rd:");
+    for(i = 0; i < (int)posting_n; i++) {
+        printf(" %u", posting_out[i]);
+    }
+    printf("\n");
+
+
+    // ------------------------------------------------------------------------
+    printf("\n");
+    printf("Sorting 16-Bit Unsigned Integer:\n");
+
+    // request latencies in microseconds: mostly around 200, a slow tail
+    static uint16_t latency[1000], latency_sorted[1000], latency_top[5];
+    uint32_t latency_seed = 12345;
+
+    for(i = 0; i < 1000; i++) {
+        latency_seed = latency_seed * 1103515245u + 12345u;
+        latency[i] = (uint16_t)(150 + (latency_seed >> 16) % 100);
+        if(i % 97 == 0) {
+            latency[i] = (uint16_t)(2000 + 37 * i);
+        }
+    }
+    memcpy(latency_sorted, latency, sizeof(latency));
+
+    if(sort_u16(latency_sorted, 1000) == 0 && sort_top_k_u16(latency, 1000, 5, latency_top) == 0) {
+        printf("p50 %u us, p99 %u us, max %u us\n", latency_sorted[499], latency_sorted[989], latency_sorted[999]);
+        printf("slowest 5:");
+        for(i = 0; i < 5; i++) {
+            printf(" %u", latency_top[i]);
+        }
+        printf("\n");
+    }
+
     return 0;
 }
@@ -0,0 +1,344 @@
+/* Morphological erosion and dilation and the 3x3 median filter for 8-Bit
+ * unsigned integer images using ARM NEON
+ */
+
+#include <string.h>
+#include "arm_neon.h"
+#include "morph.h"
+#include "neon_alloc.h"
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+// bytes after a padded scratch row that the vector loops may read
+#define ROW_SLACK 64
+
+typedef void (*direct_kernel)(const uint8_t *in, size_t width, size_t height, size_t stride, unsigned r,
+                              uint8_t *out, size_t out_stride, uint8_t *row);
+typedef void (*vertical_kernel)(const uint8_t *in, size_t width, size_t height, size_t stride, unsigned size,
+                                uint8_t *out, size_t out_stride, uint8x16_t *g, uint8x16_t *h);
+
+
+// row y of the image, rows above and below repeat the first and last row
+static inline const uint8_t *clamped_row(const uint8_t *in, ptrdiff_t y, size_t height, size_t stride) {
+    y = y < 0 ? 0 : y >= (ptrdiff_t)height ? (ptrdiff_t)height - 1 : y;
+    return in + (size_t)y * stride;
+}
+
+
+// repeats the edge pixels of the row stored at row + r into the r bytes on
+// either side
+static inline void pad_row(uint8_t *row, size_t width, unsigned r) {
+    memset(row, row[r], r);
+    memset(row + r + width, row[r + width - 1], r);
+}
+
+
+// 3x3 and 5x5 windows: op over the 2r + 1 rows into a padded scratch row,
+// then op over the 2r + 1 neighbours in the row
+// v: vector
+// ext: extract a vector from a pair of vectors, starting at lane n of the
+// first, i.e. the neighbours n pixels to the right
+#define DIRECT_KERNEL(name, op, scalar_op) \
+    static void name(const uint8_t *in, size_t width, size_t height, size_t stride, unsigned r, \
+                     uint8_t *out, size_t out_stride, uint8_t *row) { \
+        const uint8_t *rows[5]; \
+        size_t x, y; \
+        unsigned d; \
+        \
+        for(y = 0; y < height; y++) { \
+            uint8_t *dst = out + y * out_stride; \
+            \
+            for(d = 0; d <= 2 * r; d++) { \
+                rows[d] = clamped_row(in, (ptrdiff_t)(y + d) - (ptrdiff_t)r, height, stride); \
+            } \
+            for(x = 0; x + 16 <= width; x += 16) { \
+                uint8x16_t v = vld1q_u8(rows[0] + x); \
+                for(d = 1; d <= 2 * r; d++) { \
+                    v = op(v, vld1q_u8(rows[d] + x)); \
+                } \
+                vst1q_u8(row + r + x, v); \
+            } \
+            for(; x < width; x++) { \
+                uint8_t v = rows[0][x]; \
+                for(d = 1; d <= 2 * r; d++) { \
+                    v = scalar_op(v, rows[d][x]); \
+                } \
+                row[r + x] = v; \
+            } \
+            pad_row(row, width, r); \
+            \
+            x = 0; \
+            if(r == 1) { \
+                for(; x + 16 <= width; x += 16) { \
+                    uint8x16_t a = vld1q_u8(row + x), b = vld1q_u8(row + x + 16); \
+                    vst1q_u8(dst + x, op(op(a, vextq_u8(a, b, 1)), vextq_u8(a, b, 2))); \
+                } \
+            } else if(r == 2) { \
+                for(; x + 16 <= width; x += 16) { \
+                    uint8x16_t a = vld1q_u8(row + x), b = vld1q_u8(row + x + 16); \
+                    uint8x16_t v = op(op(a, vextq_u8(a, b, 1)), vextq_u8(a, b, 2)); \
+                    vst1q_u8(dst + x, op(v, op(vextq_u8(a, b, 3), vextq_u8(a, b, 4)))); \
+                } \
+            } \
+            for(; x < width; x++) { \
+                uint8_t v = row[x]; \
+                for(d = 1; d <= 2 * r; d++) { \
+                    v = scalar_op(v, row[x + d]); \
+                } \
+                dst[x] = v; \
+            } \
+        } \
+    }
+
+// van Herk/Gil-Werman along the columns: the padded column is cut into
+// blocks of size rows, g holds the running op from the start of each block,
+// h the one from its end, the window starting at row y spans at most two
+// blocks and is op(h[y], g[y + size - 1]). 16 columns per strip, the last
+// strip overlaps the previous one instead of a scalar tail.
+#define VERTICAL_KERNEL(name, op, scalar_op) \
+    static void name(const uint8_t *in, size_t width, size_t height, size_t stride, unsigned size, \
+                     uint8_t *out, size_t out_stride, uint8x16_t *g, uint8x16_t *h) { \
+        ptrdiff_t r = (ptrdiff_t)(size / 2); \
+        size_t length = (height + 2 * (size - 1)) / size * size; \
+        size_t x, next, y, j; \
+        unsigned phase; \
+        \
+        if(width < 16) { \
+            for(y = 0; y < height; y++) { \
+                for(x = 0; x < width; x++) { \
+                    uint8_t v = in[y * stride + x]; \
+                    for(j = 0; j <= 2 * (size_t)r; j++) { \
+                        v = scalar_op(v, clamped_row(in, (ptrdiff_t)(y + j) - r, height, stride)[x]); \
+                    } \
+                    out[y * out_stride + x] = v; \
+                } \
+            } \
+            return; \
+        } \
+        \
+        for(x = 0; x < width; x = next) { \
+            if(x + 16 > width) { \
+                x = width - 16; \
+            } \
+            next = x + 16; \
+            \
+            for(j = 0, phase = 0; j < length; j++) { \
+                uint8x16_t v = vld1q_u8(clamped_row(in, (ptrdiff_t)j - r, height, stride) + x); \
+                g[j] = phase == 0 ? v : op(g[j - 1], v); \
+                h[j] = v; \
+                phase = phase + 1 == size ? 0 : phase + 1; \
+            } \
+            for(j = length - 1, phase = size - 1; j-- > 0;) { \
+                phase = phase == 0 ? size - 1 : phase - 1; \
+                if(phase != size - 1) { \
+                    h[j] = op(h[j], h[j + 1]); \
+                } \
+            } \
+            for(y = 0; y < height; y++) { \
+                vst1q_u8(out + y * out_stride + x, op(h[y], g[y + size - 1])); \
+            } \
+        } \
+    }
+
+DIRECT_KERNEL(erode_direct, vminq_u8, MIN)
+DIRECT_KERNEL(dilate_direct, vmaxq_u8, MAX)
+VERTICAL_KERNEL(erode_vertical, vminq_u8, MIN)
+VERTICAL_KERNEL(dilate_vertical, vmaxq_u8, MAX)
+
+
+static inline void transpose_8x8(const uint8_t *in, size_t stride, uint8_t *out, size_t out_stride) {
+    uint8x8x2_t t01, t23, t45, t67;
+    uint16x4x2_t u02, u13, u46, u57;
+    uint32x2x2_t c04, c15, c26, c37;
+
+    // v: vector
+    // trn: transpose the 2x2 blocks of lanes of two vectors, on 8, then 16,
+    // then 32-bit lanes for an 8x8 transpose
+    t01 = vtrn_u8(vld1_u8(in), vld1_u8(in + stride));
+    t23 = vtrn_u8(vld1_u8(in + 2 * stride), vld1_u8(in + 3 * stride));
+    t45 = vtrn_u8(vld1_u8(in + 4 * stride), vld1_u8(in + 5 * stride));
+    t67 = vtrn_u8(vld1_u8(in + 6 * stride), vld1_u8(in + 7 * stride));
+
+    u02 = vtrn_u16(vreinterpret_u16_u8(t01.val[0]), vreinterpret_u16_u8(t23.val[0]));
+    u13 = vtrn_u16(vreinterpret_u16_u8(t01.val[1]), vreinterpret_u16_u8(t23.val[1]));
+    u46 = vtrn_u16(vreinterpret_u16_u8(t45.val[0]), vreinterpret_u16_u8(t67.val[0]));
+    u57 = vtrn_u16(vreinterpret_u16_u8(t45.val[1]), vreinterpret_u16_u8(t67.val[1]));
+
+    c04 = vtrn_u32(vreinterpret_u32_u16(u02.val[0]), vreinterpret_u32_u16(u46.val[0]));
+    c26 = vtrn_u32(vreinterpret_u32_u16(u02.val[1]), vreinterpret_u32_u16(u46.val[1]));
+    c15 = vtrn_u32(vreinterpret_u32_u16(u13.val[0]), vreinterpret_u32_u16(u57.val[0]));
+    c37 = vtrn_u32(vreinterpret_u32_u16(u13.val[1]), vreinterpret_u32_u16(u57.val[1]));
+
+    vst1_u8(out, vreinterpret_u8_u32(c04.val[0]));
+    vst1_u8(out + out_stride, vreinterpret_u8_u32(c15.val[0]));
+    vst1_u8(out + 2 * out_stride, vreinterpret_u8_u32(c26.val[0]));
+    vst1_u8(out + 3 * out_stride, vreinterpret_u8_u32(c37.val[0]));
+    vst1_u8(out + 4 * out_stride, vreinterpret_u8_u32(c04.val[1]));
+    vst1_u8(out + 5 * out_stride, vreinterpret_u8_u32(c15.val[1]));
+    vst1_u8(out + 6 * out_stride, vreinterpret_u8_u32(c26.val[1]));
+    vst1_u8(out + 7 * out_stride, vreinterpret_u8_u32(c37.val[1]));
+}
+
+
+// out[x][y] = in[y][x]
+static void transpose_u8(const uint8_t *in, size_t width, size_t height, size_t stride,
+                         uint8_t *out, size_t out_stride) {
+    size_t x, y, i;
+
+    for(y = 0; y + 8 <= height; y += 8) {
+        for(x = 0; x + 8 <= width; x += 8) {
+            transpose_8x8(in + y * stride + x, stride, out + x * out_stride + y, out_stride);
+        }
+        for(; x < width; x++) {
+            for(i = 0; i < 8; i++) {
+                out[x * out_stride + y + i] = in[(y + i) * stride + x];
+            }
+        }
+    }
+    for(; y < height; y++) {
+        for(x = 0; x < width; x++) {
+            out[x * out_stride + y] = in[y * stride + x];
+        }
+    }
+}
+
+
+static int morph_u8(const uint8_t *in, size_t width, size_t height, size_t stride, unsigned size,
+                    uint8_t *out, size_t out_stride, direct_kernel direct, vertical_kernel vertical) {
+    uint8_t *row, *columns, *transposed;
+    uint8x16_t *lines;
+    size_t length = MAX(width, height) + 2 * size;
+
+    if(size % 2 == 0 || size > MORPH_MAX_SIZE) {
+        return -1;
+    }
+    if(width == 0 || height == 0) {
+        return 0;
+    }
+
+    if(size <= 5) {
+        row = neon_alloc(width + size + ROW_SLACK);
+        if(row == NULL) {
+            return -1;
+        }
+        direct(in, width, height, stride, size / 2, out, out_stride, row);
+        neon_free(row);
+        return 0;
+    }
+
+    // columns, then the columns of the transposed image, i.e. the rows
+    columns = neon_alloc(width * height);
+    transposed = neon_alloc(width * height);
+    lines = neon_alloc(2 * length * sizeof(uint8x16_t));
+    if(columns == NULL || transposed == NULL || lines == NULL) {
+        neon_free(columns);
+        neon_free(transposed);
+        neon_free(lines);
+        return -1;
+    }
+    vertical(in, width, height, stride, size, columns, width, lines, lines + length);
+    transpose_u8(columns, width, height, width, transposed, height);
+    vertical(transposed, height, width, height, size, columns, height, lines, lines + length);
+    transpose_u8(columns, height, width, height, out, out_stride);
+
+    neon_free(columns);
+    neon_free(transposed);
+    neon_free(lines);
+    return 0;
+}
+
+
+int morph_erode_u8(const uint8_t *in, size_t width, size_t height, size_t stride,
+                   unsigned size, uint8_t *out, size_t out_stride) {
+    return morph_u8(in, width, height, stride, size, out, out_stride, erode_direct, erode_vertical);
+}
+
+
+int morph_dilate_u8(const uint8_t *in, size_t width, size_t height, size_t stride,
+                    unsigned size, uint8_t *out, size_t out_stride) {
+    return morph_u8(in, width, height, stride, size, out, out_stride, dilate_direct, dilate_vertical);
+}
+
+
+static inline uint8_t median3(uint8_t a, uint8_t b, uint8_t c) {
+    return MAX(MIN(a, b), MIN(MAX(a, b), c));
+}
+
+
+// v: vector
+// min/max: a compare-exchange, the median of three is three of them
+static inline uint8x16_t vector_median3(uint8x16_t a, uint8x16_t b, uint8x16_t c) {
+    return vmaxq_u8(vminq_u8(a, b), vminq_u8(vmaxq_u8(a, b), c));
+}
+
+
+int morph_median3x3_u8(const uint8_t *in, size_t width, size_t height, size_t stride,
+                       uint8_t *out, size_t out_stride) {
+    uint8_t *scratch, *low, *mid, *high;
+    size_t row_size = width + 2 + ROW_SLACK;
+    size_t x, y;
+
+    if(width == 0 || height == 0) {
+        return 0;
+    }
+    scratch = neon_alloc(3 * row_size);
+    if(scratch == NULL) {
+        return -1;
+    }
+    low = scratch;
+    mid = scratch + row_size;
+    high = scratch + 2 * row_size;
+
+    // sorting the three pixels of every column once serves the three
+    // windows containing it: the median of the 3x3 window is the median of
+    // the largest column minimum, the median column median and the smallest
+    // column maximum
+    for(y = 0; y < height; y++) {
+        const uint8_t *above = clamped_row(in, (ptrdiff_t)y - 1, height, stride);
+        const uint8_t *center = in + y * stride;
+        const uint8_t *below = clamped_row(in, (ptrdiff_t)y + 1, height, stride);
+        uint8_t *dst = out + y * out_stride;
+
+        for(x = 0; x + 16 <= width; x += 16) {
+            uint8x16_t a = vld1q_u8(above + x), b = vld1q_u8(center + x), c = vld1q_u8(below + x);
+            uint8x16_t ab_low = vminq_u8(a, b), ab_high = vmaxq_u8(a, b);
+            uint8x16_t bc_low = vminq_u8(ab_high, c);
+
+            vst1q_u8(low + 1 + x, vminq_u8(ab_low, bc_low));
+            vst1q_u8(mid + 1 + x, vmaxq_u8(ab_low, bc_low));
+            vst1q_u8(high + 1 + x, vmaxq_u8(ab_high, c));
+        }
+        for(; x < width; x++) {
+            uint8_t a = above[x], b = center[x], c = below[x];
+            uint8_t ab_low = MIN(a, b), ab_high = MAX(a, b), bc_low = MIN(ab_high, c);
+
+            low[1 + x] = MIN(ab_low, bc_low);
+            mid[1 + x] = MAX(ab_low, bc_low);
+            high[1 + x] = MAX(ab_high, c);
+        }
+        pad_row(low, width, 1);
+        pad_row(mid, width, 1);
+        pad_row(high, width, 1);
+
+        for(x = 0; x + 16 <= width; x += 16) {
+            uint8x16_t l0 = vld1q_u8(low + x), l1 = vld1q_u8(low + x + 16);
+            uint8x16_t m0 = vld1q_u8(mid + x), m1 = vld1q_u8(mid + x + 16);
+            uint8x16_t h0 = vld1q_u8(high + x), h1 = vld1q_u8(high + x + 16);
+            uint8x16_t max_low = vmaxq_u8(vmaxq_u8(l0, vextq_u8(l0, l1, 1)), vextq_u8(l0, l1, 2));
+            uint8x16_t min_high = vminq_u8(vminq_u8(h0, vextq_u8(h0, h1, 1)), vextq_u8(h0, h1, 2));
+            uint8x16_t median_mid = vector_median3(m0, vextq_u8(m0, m1, 1), vextq_u8(m0, m1, 2));
+
+            vst1q_u8(dst + x, vector_median3(max_low, median_mid, min_high));
+        }
+        for(; x < width; x++) {
+            uint8_t max_low = MAX(MAX(low[x], low[x + 1]), low[x + 2]);
+            uint8_t min_high = MIN(MIN(high[x], high[x + 1]), high[x + 2]);
+
+            dst[x] = median3(max_low, median3(mid[x], mid[x + 1], mid[x + 2]), min_high);
+        }
+    }
+
+    neon_free(scratch);
+    return 0;
+}
@@ -0,0 +1,35 @@
+/* Morphological erosion and dilation and the 3x3 median filter for 8-Bit
+ * unsigned integer images using ARM NEON
+ *
+ * Images are height rows of width pixels, rows stride bytes apart. Pixels
+ * outside the image repeat the nearest edge pixel. The windows are square
+ * with an odd side: 3 and 5 are a vertical pass over the window rows and a
+ * horizontal pass over vextq shifted neighbours, larger windows use the van
+ * Herk/Gil-Werman algorithm (3 vminq/vmaxq per pixel and direction for any
+ * size) on columns and on the transposed image. in and out must not
+ * overlap. All functions return 0, or -1 for an invalid window size or if
+ * out of memory for the scratch rows.
+ */
+
+#ifndef MORPH_H
+#define MORPH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MORPH_MAX_SIZE 255
+
+// out = minimum of the size x size window around every pixel
+int morph_erode_u8(const uint8_t *in, size_t width, size_t height, size_t stride,
+                   unsigned size, uint8_t *out, size_t out_stride);
+
+// out = maximum of the size x size window around every pixel
+int morph_dilate_u8(const uint8_t *in, size_t width, size_t height, size_t stride,
+                    unsigned size, uint8_t *out, size_t out_stride);
+
+// out = median of the 3x3 window around every pixel, a min/max network on
+// the sorted columns of the window
+int morph_median3x3_u8(const uint8_t *in, size_t width, size_t height, size_t stride,
+                       uint8_t *out, size_t out_stride);
+
+#endif
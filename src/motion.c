@@ -0,0 +1,122 @@
+/* Change detection for motion detection on 8-Bit grayscale frames using ARM
+ * NEON
+ */
+
+#include <string.h>
+#include "arm_neon.h"
+#include "motion.h"
+#include "neon_alloc.h"
+
+// rows the 8-bit column counters can take before they are flushed
+#define MAX_ROWS 255
+
+
+// adds the column counters of every tile to its count, counters beyond
+// width are zero
+static void flush_tiles(const uint8_t *columns, size_t width, size_t tile_width, uint32_t *counts) {
+    size_t padded = (width + 15) & ~(size_t)15;
+    size_t x, t;
+
+    for(t = 0; t * tile_width < width; t++) {
+        size_t end = (t + 1) * tile_width < padded ? (t + 1) * tile_width : padded;
+        uint32x4_t sum = vdupq_n_u32(0);
+        uint32x2_t half;
+
+        for(x = t * tile_width; x < end; x += 16) {
+            // v: vector
+            // padal: pairwise addition with accumulate (widening)
+            // paddl: pairwise addition (long)
+            // q: 128-bit registers
+            // u16/u8: 16/8-bit unsigned integer
+            sum = vpadalq_u16(sum, vpaddlq_u8(vld1q_u8(columns + x)));
+        }
+
+        half = vadd_u32(vget_low_u32(sum), vget_high_u32(sum));
+        counts[t] += vget_lane_u32(vpadd_u32(half, half), 0);
+    }
+}
+
+
+int motion_detect_u8(const uint8_t *frame, size_t width, size_t height, size_t stride,
+                     uint8_t *reference, size_t reference_stride, uint8_t threshold,
+                     unsigned learn_shift, size_t tile_width, size_t tile_height, uint32_t *counts) {
+    const uint8x16_t vector_threshold = vdupq_n_u8(threshold);
+    size_t tiles_x, padded, band, row_end, x, y;
+    uint8_t *columns;
+    unsigned k;
+
+    if(tile_width == 0 || tile_width % 16 != 0 || tile_height == 0 || learn_shift > MOTION_MAX_SHIFT) {
+        return -1;
+    }
+
+    tiles_x = (width + tile_width - 1) / tile_width;
+    memset(counts, 0, motion_tile_count(width, height, tile_width, tile_height) * sizeof(uint32_t));
+    if(width == 0 || height == 0) {
+        return 0;
+    }
+
+    padded = (width + 15) & ~(size_t)15;
+    columns = neon_alloc(padded);
+    if(columns == NULL) {
+        return -1;
+    }
+
+    for(band = 0, y = 0; y < height; band++) {
+        size_t band_end = y + tile_height < height ? y + tile_height : height;
+
+        // at most MAX_ROWS rows per flush so that the counters cannot wrap
+        for(; y < band_end; y = row_end) {
+            row_end = y + MAX_ROWS < band_end ? y + MAX_ROWS : band_end;
+            memset(columns, 0, padded);
+
+            for(; y < row_end; y++) {
+                const uint8_t *src = frame + y * stride;
+                uint8_t *ref = reference + y * reference_stride;
+
+                for(x = 0; x + 16 <= width; x += 16) {
+                    uint8x16_t current = vld1q_u8(src + x);
+                    uint8x16_t background = vld1q_u8(ref + x);
+
+                    // v: vector
+                    // abd: absolute difference
+                    // cgt: compare greater than, all ones if true
+                    // rhadd: rounding halving add, (a + b + 1) >> 1
+                    // q: 128-bit registers
+                    // u8: 8-bit unsigned integer
+                    uint8x16_t changed = vcgtq_u8(vabdq_u8(current, background), vector_threshold);
+
+                    // subtracting the all ones mask counts one up
+                    vst1q_u8(columns + x, vsubq_u8(vld1q_u8(columns + x), changed));
+
+                    if(learn_shift != 0) {
+                        // each step moves the current pixel halfway to the
+                        // background
+                        for(k = 0; k < learn_shift; k++) {
+                            current = vrhaddq_u8(background, current);
+                        }
+                        vst1q_u8(ref + x, current);
+                    }
+                }
+
+                for(; x < width; x++) {
+                    unsigned current = src[x];
+                    unsigned difference = current > ref[x] ? current - ref[x] : ref[x] - current;
+
+                    columns[x] += difference > threshold;
+                    if(learn_shift != 0) {
+                        for(k = 0; k < learn_shift; k++) {
+                            current = (ref[x] + current + 1) >> 1;
+                        }
+                        ref[x] = (uint8_t)current;
+                    }
+                }
+            }
+
+            flush_tiles(columns, width, tile_width, counts + band * tiles_x);
+        }
+    }
+
+    neon_free(columns);
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+/* Change detection for motion detection on 8-Bit grayscale frames using ARM
+ * NEON
+ *
+ * One pass over the frame computes the absolute difference to a reference
+ * frame (vabdq_u8), compares it with a threshold (vcgtq_u8) and counts the
+ * changed pixels per tile: the 0xff compare masks are subtracted from 8-bit
+ * per-column counters for up to 255 rows and then added pairwise per tile
+ * (vpaddlq/vpadalq). The same pass may move the reference towards the frame,
+ * an exponential background model built from rounding halving adds
+ * (vrhaddq_u8).
+ *
+ * Frames are height rows of width pixels, rows stride bytes apart. For
+ * change detection between consecutive frames pass the previous frame as
+ * reference and learn_shift 0.
+ */
+
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MOTION_MAX_SHIFT 8
+
+// number of tiles, and of counts written by motion_detect_u8()
+static inline size_t motion_tile_count(size_t width, size_t height, size_t tile_width, size_t tile_height) {
+    return (width + tile_width - 1) / tile_width * ((height + tile_height - 1) / tile_height);
+}
+
+// counts[ty * tiles_x + tx] = pixels of the tile with |frame - reference| >
+// threshold, tiles at the right and bottom edge may be smaller. learn_shift k
+// > 0 then sets reference += (frame - reference) / 2^k, rounded (k rounding
+// halving adds). tile_width must be a multiple of 16, learn_shift at most
+// MOTION_MAX_SHIFT; returns 0, -1 for invalid tiles or shift or if out of
+// memory for the column counters
+int motion_detect_u8(const uint8_t *frame, size_t width, size_t height, size_t stride,
+                     uint8_t *reference, size_t reference_stride, uint8_t threshold,
+                     unsigned learn_shift, size_t tile_width, size_t tile_height, uint32_t *counts);
+
+#endif
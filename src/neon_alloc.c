@@ -0,0 +1,309 @@
+/* Aligned, padded buffer allocation for the NEON kernels
+ *
+ * Every block starts with a NEON_ALLOC_ALIGN-byte header holding its size
+ * class, the buffer follows it. Classes are powers of two from 64 bytes to
+ * 1 MiB (buffer plus padding); larger requests go straight to
+ * posix_memalign(). Classes up to 4 KiB are carved from 64 KiB slabs.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "neon_alloc.h"
+
+#define MIN_CLASS   6
+#define MAX_CLASS   20
+#define SLAB_CLASS  12
+#define SLAB_SIZE   (64 * 1024)
+#define NUM_CLASSES (MAX_CLASS + 1)
+#define LARGE_CLASS 0xff
+
+#define HEADER_SIZE NEON_ALLOC_ALIGN
+#define ALLOC_MAGIC 0x4e454f4eu
+
+typedef struct {
+    uint32_t magic;
+    uint32_t size_class;
+    size_t size;
+} block_header;
+
+// free blocks are linked through their first bytes
+typedef struct free_block {
+    struct free_block *next;
+} free_block;
+
+typedef struct {
+    free_block *head;
+    size_t count;
+} free_list;
+
+static free_list pool[NUM_CLASSES];
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread free_list cache[NUM_CLASSES];
+static __thread int cache_registered;
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+
+static inline block_header *header_of(const void *ptr) {
+    return (block_header *)((uint8_t *)ptr - HEADER_SIZE);
+}
+
+
+static inline size_t class_bytes(unsigned size_class) {
+    return (size_t)1 << size_class;
+}
+
+
+// number of blocks a thread keeps per class before returning half of them
+static inline size_t cache_limit(unsigned size_class) {
+    return size_class <= SLAB_CLASS ? 64 : 4;
+}
+
+
+static unsigned size_class_of(size_t size) {
+    unsigned size_class = MIN_CLASS;
+
+    while(size_class <= MAX_CLASS && class_bytes(size_class) < size + NEON_ALLOC_PADDING) {
+        size_class++;
+    }
+
+    return size_class;
+}
+
+
+// moves up to count blocks from one list to another
+static void move_blocks(free_list *from, free_list *to, size_t count) {
+    while(count-- > 0 && from->head != NULL) {
+        free_block *block = from->head;
+
+        from->head = block->next;
+        from->count--;
+        block->next = to->head;
+        to->head = block;
+        to->count++;
+    }
+}
+
+
+static void flush_cache(void *unused) {
+    unsigned c;
+
+    (void)unused;
+
+    pthread_mutex_lock(&pool_lock);
+    for(c = MIN_CLASS; c <= MAX_CLASS; c++) {
+        move_blocks(&cache[c], &pool[c], cache[c].count);
+    }
+    pthread_mutex_unlock(&pool_lock);
+}
+
+
+static void create_cache_key(void) {
+    pthread_key_create(&cache_key, flush_cache);
+}
+
+
+// hands the cache of an exiting thread back to the pool
+static void register_cache(void) {
+    pthread_once(&cache_key_once, create_cache_key);
+    pthread_setspecific(cache_key, cache);
+    cache_registered = 1;
+}
+
+
+static void *new_block(unsigned size_class, size_t block_size) {
+    void *block;
+
+    if(posix_memalign(&block, NEON_ALLOC_ALIGN, block_size) != 0) {
+        return NULL;
+    }
+    ((block_header *)block)->magic = ALLOC_MAGIC;
+    ((block_header *)block)->size_class = size_class;
+
+    return block;
+}
+
+
+// refills the thread cache from the pool or new memory, returns 0 on success
+static int refill_cache(unsigned size_class) {
+    size_t block_size = HEADER_SIZE + class_bytes(size_class);
+
+    pthread_mutex_lock(&pool_lock);
+    move_blocks(&pool[size_class], &cache[size_class], cache_limit(size_class) / 2);
+    pthread_mutex_unlock(&pool_lock);
+
+    if(cache[size_class].head != NULL) {
+        return 0;
+    }
+
+    if(size_class <= SLAB_CLASS) {
+        // carve a slab into blocks of this class, the slab itself is never
+        // freed
+        uint8_t *slab;
+        size_t offset;
+
+        if(posix_memalign((void **)&slab, NEON_ALLOC_ALIGN, SLAB_SIZE) != 0) {
+            return -1;
+        }
+        for(offset = 0; offset + block_size <= SLAB_SIZE; offset += block_size) {
+            block_header *header = (block_header *)(slab + offset);
+            free_block *block = (free_block *)(slab + offset + HEADER_SIZE);
+
+            header->magic = ALLOC_MAGIC;
+            header->size_class = size_class;
+            block->next = cache[size_class].head;
+            cache[size_class].head = block;
+            cache[size_class].count++;
+        }
+    } else {
+        uint8_t *block = new_block(size_class, block_size);
+        free_block *free_entry;
+
+        if(block == NULL) {
+            return -1;
+        }
+        free_entry = (free_block *)(block + HEADER_SIZE);
+        free_entry->next = NULL;
+        cache[size_class].head = free_entry;
+        cache[size_class].count = 1;
+    }
+
+    return 0;
+}
+
+
+void *neon_alloc(size_t size) {
+    unsigned size_class;
+    free_block *block;
+
+    // the padded size would wrap and select a small class
+    if(size > SIZE_MAX - HEADER_SIZE - NEON_ALLOC_PADDING) {
+        return NULL;
+    }
+    size_class = size_class_of(size);
+
+    if(size_class > MAX_CLASS) {
+        uint8_t *large;
+
+        large = new_block(LARGE_CLASS, HEADER_SIZE + size + NEON_ALLOC_PADDING);
+        if(large == NULL) {
+            return NULL;
+        }
+        ((block_header *)large)->size = size;
+        return large + HEADER_SIZE;
+    }
+
+    if(!cache_registered) {
+        register_cache();
+    }
+    if(cache[size_class].head == NULL && refill_cache(size_class) != 0) {
+        return NULL;
+    }
+
+    block = cache[size_class].head;
+    cache[size_class].head = block->next;
+    cache[size_class].count--;
+
+    header_of(block)->size = size;
+
+    return block;
+}
+
+
+void neon_free(void *ptr) {
+    block_header *header;
+    unsigned size_class;
+    free_block *block = ptr;
+
+    if(ptr == NULL) {
+        return;
+    }
+
+    header = header_of(ptr);
+    size_class = header->size_class;
+
+    if(size_class == LARGE_CLASS) {
+        free(header);
+        return;
+    }
+
+    if(!cache_registered) {
+        register_cache();
+    }
+    block->next = cache[size_class].head;
+    cache[size_class].head = block;
+    cache[size_class].count++;
+
+    if(cache[size_class].count > cache_limit(size_class)) {
+        pthread_mutex_lock(&pool_lock);
+        move_blocks(&cache[size_class], &pool[size_class], cache[size_class].count / 2);
+        pthread_mutex_unlock(&pool_lock);
+    }
+}
+
+
+size_t neon_alloc_usable_size(const void *ptr) {
+    const block_header *header = header_of(ptr);
+
+    if(header->size_class == LARGE_CLASS) {
+        return header->size;
+    }
+    return class_bytes(header->size_class) - NEON_ALLOC_PADDING;
+}
+
+
+void neon_alloc_trim(void) {
+    unsigned c;
+
+    flush_cache(NULL);
+
+    pthread_mutex_lock(&pool_lock);
+    for(c = SLAB_CLASS + 1; c <= MAX_CLASS; c++) {
+        while(pool[c].head != NULL) {
+            free_block *block = pool[c].head;
+
+            pool[c].head = block->next;
+            pool[c].count--;
+            free(header_of(block));
+        }
+    }
+    pthread_mutex_unlock(&pool_lock);
+}
+
+
+int neon_arena_init(neon_arena *arena, size_t capacity) {
+    arena->base = neon_alloc(capacity);
+    arena->capacity = capacity;
+    arena->used = 0;
+
+    return arena->base == NULL ? -1 : 0;
+}
+
+
+void *neon_arena_alloc(neon_arena *arena, size_t size) {
+    size_t offset = (arena->used + NEON_ALLOC_ALIGN - 1) & ~(size_t)(NEON_ALLOC_ALIGN - 1);
+
+    // the padding of the last allocation may overlap the arena buffer's own
+    // padding, earlier allocations are padded by the following ones
+    if(offset > arena->capacity || size > arena->capacity - offset) {
+        return NULL;
+    }
+
+    arena->used = offset + size + NEON_ALLOC_PADDING;
+    return arena->base + offset;
+}
+
+
+void neon_arena_reset(neon_arena *arena) {
+    arena->used = 0;
+}
+
+
+void neon_arena_destroy(neon_arena *arena) {
+    neon_free(arena->base);
+    arena->base = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+}
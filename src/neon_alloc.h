@@ -0,0 +1,53 @@
+/* Aligned, padded buffer allocation for the NEON kernels
+ *
+ * Every buffer is NEON_ALLOC_ALIGN-byte aligned (a cache line) and followed
+ * by at least NEON_ALLOC_PADDING writable bytes, so kernels may load and
+ * store whole 16-byte vectors (up to four of them) past the requested size
+ * instead of handling tails. The padding contents are unspecified.
+ *
+ * neon_alloc() serves power-of-two size classes from thread-local caches
+ * backed by a shared pool; freed buffers are kept for reuse instead of being
+ * returned to malloc. A neon_arena is a bump allocator on top of it for
+ * per-frame scratch buffers that are all released at once.
+ */
+
+#ifndef NEON_ALLOC_H
+#define NEON_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define NEON_ALLOC_ALIGN   64
+#define NEON_ALLOC_PADDING 64
+
+// returns NULL if out of memory
+void *neon_alloc(size_t size);
+
+// neon_free(NULL) does nothing, buffers may be freed by any thread
+void neon_free(void *ptr);
+
+// usable size of a buffer, excluding the padding
+size_t neon_alloc_usable_size(const void *ptr);
+
+// releases the buffers cached by the calling thread and the shared pool
+// (slabs of small buffers are kept)
+void neon_alloc_trim(void);
+
+typedef struct {
+    uint8_t *base;
+    size_t capacity;
+    size_t used;
+} neon_arena;
+
+// returns 0 on success, -1 if out of memory
+int neon_arena_init(neon_arena *arena, size_t capacity);
+
+// aligned and padded like neon_alloc(), NULL if the arena is full
+void *neon_arena_alloc(neon_arena *arena, size_t size);
+
+// releases all allocations of the arena at once
+void neon_arena_reset(neon_arena *arena);
+
+void neon_arena_destroy(neon_arena *arena);
+
+#endif
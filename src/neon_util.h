@@ -0,0 +1,97 @@
+/* Small ARM NEON helpers shared by the kernels: mask extraction and
+ * horizontal reductions of 8-Bit unsigned integer vectors, and the lane
+ * type tables of the macro generated kernels
+ */
+
+#ifndef NEON_UTIL_H
+#define NEON_UTIL_H
+
+#include <stdint.h>
+#include "arm_neon.h"
+
+// lane type tables, indexed by pasting the intrinsic suffix: element type,
+// q register type, lanes per q register and the unsigned suffix of compare
+// masks
+#define TYPE_u8    uint8_t
+#define TYPE_s8    int8_t
+#define TYPE_u16   uint16_t
+#define TYPE_s16   int16_t
+#define TYPE_u32   uint32_t
+#define TYPE_s32   int32_t
+#define TYPE_f32   float32_t
+
+#define VECTOR_u8  uint8x16_t
+#define VECTOR_s8  int8x16_t
+#define VECTOR_u16 uint16x8_t
+#define VECTOR_s16 int16x8_t
+#define VECTOR_u32 uint32x4_t
+#define VECTOR_s32 int32x4_t
+#define VECTOR_f32 float32x4_t
+
+#define LANES_u8   16
+#define LANES_s8   16
+#define LANES_u16  8
+#define LANES_s16  8
+#define LANES_u32  4
+#define LANES_s32  4
+#define LANES_f32  4
+
+#define MASK_u8    u8
+#define MASK_s8    u8
+#define MASK_u16   u16
+#define MASK_s16   u16
+#define MASK_u32   u32
+#define MASK_s32   u32
+#define MASK_f32   u32
+
+// token pasting after expansion of the arguments
+#define CAT(a, b)  CAT_(a, b)
+#define CAT_(a, b) a##b
+
+
+// packs a compare mask (lanes 0xff or 0x00) into 16 bits, lane i -> bit i
+static inline uint16_t movemask_u8x16(uint8x16_t mask) {
+    static const uint8_t weights[16] = {1,2,4,8,16,32,64,128,1,2,4,8,16,32,64,128};
+    uint8x16_t t = vandq_u8(mask, vld1q_u8(weights));
+    uint8x8_t p;
+
+    // v: vector
+    // padd: pairwise addition (d registers only)
+    // u8: 8-bit unsigned integer
+    // the weights do not overlap so the sums are bitwise ORs
+    p = vpadd_u8(vget_low_u8(t), vget_high_u8(t));
+    p = vpadd_u8(p, p);
+    p = vpadd_u8(p, p);
+
+    return vget_lane_u16(vreinterpret_u16_u8(p), 0);
+}
+
+
+// compresses a compare mask to 64 bits, 4 bits per lane (lane i -> bits 4i..4i+3)
+static inline uint64_t nibble_mask_u8x16(uint8x16_t mask) {
+    // v: vector
+    // shrn: shift right and narrow
+    // n: immediate shift count
+    // u16: 16-bit unsigned integer
+    // the high nibble of lane 2k and the low nibble of lane 2k+1 end up in
+    // byte k of the result
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(mask), 4);
+
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+
+// maximum of all 16 lanes
+static inline uint8_t max_u8x16(uint8x16_t v) {
+    // v: vector
+    // pmax: pairwise maximum (d registers only)
+    uint8x8_t m = vpmax_u8(vget_low_u8(v), vget_high_u8(v));
+
+    m = vpmax_u8(m, m);
+    m = vpmax_u8(m, m);
+    m = vpmax_u8(m, m);
+
+    return vget_lane_u8(m, 0);
+}
+
+#endif
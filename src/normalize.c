@@ -0,0 +1,430 @@
+/* Conversion between 8/16-Bit unsigned integer images and normalized
+ * single precision float tensors using ARM NEON
+ */
+
+#include "arm_neon.h"
+#include "normalize.h"
+#include "stream.h"
+
+#define MAX_CHANNELS 4
+
+
+// deinterleaves 16 pixels into one vector per channel
+static inline void load_pixels_u8(const uint8_t *in, unsigned channels, uint8x16_t *v) {
+    uint8x16x2_t v2;
+    uint8x16x3_t v3;
+    uint8x16x4_t v4;
+
+    // v: vector
+    // ld2/ld3/ld4: load and deinterleave 2/3/4 element structures
+    switch(channels) {
+    case 1:
+        v[0] = vld1q_u8(in);
+        break;
+    case 2:
+        v2 = vld2q_u8(in);
+        v[0] = v2.val[0];
+        v[1] = v2.val[1];
+        break;
+    case 3:
+        v3 = vld3q_u8(in);
+        v[0] = v3.val[0];
+        v[1] = v3.val[1];
+        v[2] = v3.val[2];
+        break;
+    default:
+        v4 = vld4q_u8(in);
+        v[0] = v4.val[0];
+        v[1] = v4.val[1];
+        v[2] = v4.val[2];
+        v[3] = v4.val[3];
+        break;
+    }
+}
+
+
+// deinterleaves 8 pixels into one vector per channel
+static inline void load_pixels_u16(const uint16_t *in, unsigned channels, uint16x8_t *v) {
+    uint16x8x2_t v2;
+    uint16x8x3_t v3;
+    uint16x8x4_t v4;
+
+    switch(channels) {
+    case 1:
+        v[0] = vld1q_u16(in);
+        break;
+    case 2:
+        v2 = vld2q_u16(in);
+        v[0] = v2.val[0];
+        v[1] = v2.val[1];
+        break;
+    case 3:
+        v3 = vld3q_u16(in);
+        v[0] = v3.val[0];
+        v[1] = v3.val[1];
+        v[2] = v3.val[2];
+        break;
+    default:
+        v4 = vld4q_u16(in);
+        v[0] = v4.val[0];
+        v[1] = v4.val[1];
+        v[2] = v4.val[2];
+        v[3] = v4.val[3];
+        break;
+    }
+}
+
+
+// interleaves one vector per channel into 16 pixels
+static inline void store_pixels_u8(uint8_t *out, unsigned channels, const uint8x16_t *v) {
+    uint8x16x2_t v2;
+    uint8x16x3_t v3;
+    uint8x16x4_t v4;
+
+    // st2/st3/st4: interleave and store 2/3/4 element structures
+    switch(channels) {
+    case 1:
+        vst1q_u8(out, v[0]);
+        break;
+    case 2:
+        v2.val[0] = v[0];
+        v2.val[1] = v[1];
+        vst2q_u8(out, v2);
+        break;
+    case 3:
+        v3.val[0] = v[0];
+        v3.val[1] = v[1];
+        v3.val[2] = v[2];
+        vst3q_u8(out, v3);
+        break;
+    default:
+        v4.val[0] = v[0];
+        v4.val[1] = v[1];
+        v4.val[2] = v[2];
+        v4.val[3] = v[3];
+        vst4q_u8(out, v4);
+        break;
+    }
+}
+
+
+// interleaves one vector per channel into 8 pixels
+static inline void store_pixels_u16(uint16_t *out, unsigned channels, const uint16x8_t *v) {
+    uint16x8x2_t v2;
+    uint16x8x3_t v3;
+    uint16x8x4_t v4;
+
+    switch(channels) {
+    case 1:
+        vst1q_u16(out, v[0]);
+        break;
+    case 2:
+        v2.val[0] = v[0];
+        v2.val[1] = v[1];
+        vst2q_u16(out, v2);
+        break;
+    case 3:
+        v3.val[0] = v[0];
+        v3.val[1] = v[1];
+        v3.val[2] = v[2];
+        vst3q_u16(out, v3);
+        break;
+    default:
+        v4.val[0] = v[0];
+        v4.val[1] = v[1];
+        v4.val[2] = v[2];
+        v4.val[3] = v[3];
+        vst4q_u16(out, v4);
+        break;
+    }
+}
+
+
+// stores quarters * 4 pixels starting at pixel i, f[c][k] holds pixels
+// i + 4k to i + 4k + 3 of channel c
+static inline void store_tensor(float *out, size_t i, size_t pixels, unsigned channels,
+                                normalize_layout layout, float32x4_t f[][4], unsigned quarters) {
+    float32x4x2_t f2;
+    float32x4x3_t f3;
+    float32x4x4_t f4;
+    unsigned c, k;
+
+    if(layout == NORMALIZE_NCHW) {
+        for(c = 0; c < channels; c++) {
+            for(k = 0; k < quarters; k++) {
+                vst1q_f32(out + c * pixels + i + 4 * k, f[c][k]);
+            }
+        }
+        return;
+    }
+
+    for(k = 0; k < quarters; k++) {
+        float *dst = out + (i + 4 * k) * channels;
+
+        switch(channels) {
+        case 1:
+            vst1q_f32(dst, f[0][k]);
+            break;
+        case 2:
+            f2.val[0] = f[0][k];
+            f2.val[1] = f[1][k];
+            vst2q_f32(dst, f2);
+            break;
+        case 3:
+            f3.val[0] = f[0][k];
+            f3.val[1] = f[1][k];
+            f3.val[2] = f[2][k];
+            vst3q_f32(dst, f3);
+            break;
+        default:
+            f4.val[0] = f[0][k];
+            f4.val[1] = f[1][k];
+            f4.val[2] = f[2][k];
+            f4.val[3] = f[3][k];
+            vst4q_f32(dst, f4);
+            break;
+        }
+    }
+}
+
+
+// loads quarters * 4 pixels starting at pixel i into f[c][k], see above
+static inline void load_tensor(const float *in, size_t i, size_t pixels, unsigned channels,
+                               normalize_layout layout, float32x4_t f[][4], unsigned quarters) {
+    float32x4x2_t f2;
+    float32x4x3_t f3;
+    float32x4x4_t f4;
+    unsigned c, k;
+
+    if(layout == NORMALIZE_NCHW) {
+        for(c = 0; c < channels; c++) {
+            for(k = 0; k < quarters; k++) {
+                f[c][k] = vld1q_f32(in + c * pixels + i + 4 * k);
+            }
+        }
+        return;
+    }
+
+    for(k = 0; k < quarters; k++) {
+        const float *src = in + (i + 4 * k) * channels;
+
+        switch(channels) {
+        case 1:
+            f[0][k] = vld1q_f32(src);
+            break;
+        case 2:
+            f2 = vld2q_f32(src);
+            f[0][k] = f2.val[0];
+            f[1][k] = f2.val[1];
+            break;
+        case 3:
+            f3 = vld3q_f32(src);
+            f[0][k] = f3.val[0];
+            f[1][k] = f3.val[1];
+            f[2][k] = f3.val[2];
+            break;
+        default:
+            f4 = vld4q_f32(src);
+            f[0][k] = f4.val[0];
+            f[1][k] = f4.val[1];
+            f[2][k] = f4.val[2];
+            f[3][k] = f4.val[3];
+            break;
+        }
+    }
+}
+
+
+// (v - mean) * inv_std for the 8 lanes of v into f[0] and f[1]
+static inline void normalize_u16x8(uint16x8_t v, float32x4_t mean, float32x4_t inv_std, float32x4_t *f) {
+    // v: vector
+    // movl: widen every lane to twice its width
+    // cvtq_f32_u32: convert 32-bit unsigned integer lanes to float
+    // sub/mul: subtract/multiply lane by lane
+    f[0] = vmulq_f32(vsubq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(v))), mean), inv_std);
+    f[1] = vmulq_f32(vsubq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(v))), mean), inv_std);
+}
+
+
+// in * scale + bias truncated to 32-bit unsigned integers, negative values
+// and NaN become 0
+static inline uint32x4_t quantize_f32x4(float32x4_t in, float32x4_t scale, float32x4_t bias) {
+    // mla: multiply-accumulate, bias + in * scale
+    // cvtq_u32_f32: convert to 32-bit unsigned integer, rounding towards zero
+    // with saturation
+    return vcvtq_u32_f32(vmlaq_f32(bias, in, scale));
+}
+
+
+// scalar version of the above
+static inline uint32_t quantize_f32(float in, float scale, float bias) {
+    float x = in * scale + bias;
+
+    if(!(x > 0.0f)) {
+        return 0;
+    }
+    return x >= 4294967296.0f ? UINT32_MAX : (uint32_t)x;
+}
+
+
+static inline size_t tensor_index(size_t i, unsigned c, size_t pixels, unsigned channels,
+                                  normalize_layout layout) {
+    return layout == NORMALIZE_NCHW ? c * pixels + i : i * channels + c;
+}
+
+
+int normalize_u8_f32(const uint8_t *in, size_t pixels, unsigned channels,
+                     const float *mean, const float *inv_std, normalize_layout layout, float *out) {
+    size_t i = 0;
+    unsigned c;
+    size_t distance = stream_settings.prefetch_distance;
+    float32x4_t vector_mean[MAX_CHANNELS], vector_inv_std[MAX_CHANNELS];
+    float32x4_t f[MAX_CHANNELS][4];
+    uint8x16_t v[MAX_CHANNELS];
+
+    if(channels == 0 || channels > MAX_CHANNELS) {
+        return -1;
+    }
+    for(c = 0; c < channels; c++) {
+        vector_mean[c] = vdupq_n_f32(mean[c]);
+        vector_inv_std[c] = vdupq_n_f32(inv_std[c]);
+    }
+
+    for(; i + 16 <= pixels; i += 16) {
+        stream_prefetch_ahead(in + i * channels, distance);
+        load_pixels_u8(in + i * channels, channels, v);
+        for(c = 0; c < channels; c++) {
+            normalize_u16x8(vmovl_u8(vget_low_u8(v[c])), vector_mean[c], vector_inv_std[c], f[c]);
+            normalize_u16x8(vmovl_u8(vget_high_u8(v[c])), vector_mean[c], vector_inv_std[c], f[c] + 2);
+        }
+        store_tensor(out, i, pixels, channels, layout, f, 4);
+    }
+
+    for(; i < pixels; i++) {
+        for(c = 0; c < channels; c++) {
+            out[tensor_index(i, c, pixels, channels, layout)] =
+                ((float)in[i * channels + c] - mean[c]) * inv_std[c];
+        }
+    }
+    return 0;
+}
+
+
+int normalize_u16_f32(const uint16_t *in, size_t pixels, unsigned channels,
+                      const float *mean, const float *inv_std, normalize_layout layout, float *out) {
+    size_t i = 0;
+    unsigned c;
+    size_t distance = stream_settings.prefetch_distance;
+    float32x4_t vector_mean[MAX_CHANNELS], vector_inv_std[MAX_CHANNELS];
+    float32x4_t f[MAX_CHANNELS][4];
+    uint16x8_t v[MAX_CHANNELS];
+
+    if(channels == 0 || channels > MAX_CHANNELS) {
+        return -1;
+    }
+    for(c = 0; c < channels; c++) {
+        vector_mean[c] = vdupq_n_f32(mean[c]);
+        vector_inv_std[c] = vdupq_n_f32(inv_std[c]);
+    }
+
+    for(; i + 8 <= pixels; i += 8) {
+        stream_prefetch_ahead(in + i * channels, distance);
+        load_pixels_u16(in + i * channels, channels, v);
+        for(c = 0; c < channels; c++) {
+            normalize_u16x8(v[c], vector_mean[c], vector_inv_std[c], f[c]);
+        }
+        store_tensor(out, i, pixels, channels, layout, f, 2);
+    }
+
+    for(; i < pixels; i++) {
+        for(c = 0; c < channels; c++) {
+            out[tensor_index(i, c, pixels, channels, layout)] =
+                ((float)in[i * channels + c] - mean[c]) * inv_std[c];
+        }
+    }
+    return 0;
+}
+
+
+int quantize_f32_u8(const float *in, size_t pixels, unsigned channels,
+                    const float *scale, const float *offset, normalize_layout layout, uint8_t *out) {
+    size_t i = 0;
+    unsigned c;
+    float bias[MAX_CHANNELS];
+    float32x4_t vector_scale[MAX_CHANNELS], vector_bias[MAX_CHANNELS];
+    float32x4_t f[MAX_CHANNELS][4];
+    uint8x16_t v[MAX_CHANNELS];
+
+    if(channels == 0 || channels > MAX_CHANNELS) {
+        return -1;
+    }
+    // + 0.5 turns the truncating conversion into rounding to nearest
+    for(c = 0; c < channels; c++) {
+        bias[c] = offset[c] + 0.5f;
+        vector_scale[c] = vdupq_n_f32(scale[c]);
+        vector_bias[c] = vdupq_n_f32(bias[c]);
+    }
+
+    for(; i + 16 <= pixels; i += 16) {
+        load_tensor(in, i, pixels, channels, layout, f, 4);
+        for(c = 0; c < channels; c++) {
+            uint32x4_t u0 = quantize_f32x4(f[c][0], vector_scale[c], vector_bias[c]);
+            uint32x4_t u1 = quantize_f32x4(f[c][1], vector_scale[c], vector_bias[c]);
+            uint32x4_t u2 = quantize_f32x4(f[c][2], vector_scale[c], vector_bias[c]);
+            uint32x4_t u3 = quantize_f32x4(f[c][3], vector_scale[c], vector_bias[c]);
+
+            // qmovn: narrow every lane to half its width with saturation
+            // combine: join two d registers into a q register
+            v[c] = vcombine_u8(vqmovn_u16(vcombine_u16(vqmovn_u32(u0), vqmovn_u32(u1))),
+                               vqmovn_u16(vcombine_u16(vqmovn_u32(u2), vqmovn_u32(u3))));
+        }
+        store_pixels_u8(out + i * channels, channels, v);
+    }
+
+    for(; i < pixels; i++) {
+        for(c = 0; c < channels; c++) {
+            uint32_t x = quantize_f32(in[tensor_index(i, c, pixels, channels, layout)], scale[c], bias[c]);
+            out[i * channels + c] = x > UINT8_MAX ? UINT8_MAX : (uint8_t)x;
+        }
+    }
+    return 0;
+}
+
+
+int quantize_f32_u16(const float *in, size_t pixels, unsigned channels,
+                     const float *scale, const float *offset, normalize_layout layout, uint16_t *out) {
+    size_t i = 0;
+    unsigned c;
+    float bias[MAX_CHANNELS];
+    float32x4_t vector_scale[MAX_CHANNELS], vector_bias[MAX_CHANNELS];
+    float32x4_t f[MAX_CHANNELS][4];
+    uint16x8_t v[MAX_CHANNELS];
+
+    if(channels == 0 || channels > MAX_CHANNELS) {
+        return -1;
+    }
+    for(c = 0; c < channels; c++) {
+        bias[c] = offset[c] + 0.5f;
+        vector_scale[c] = vdupq_n_f32(scale[c]);
+        vector_bias[c] = vdupq_n_f32(bias[c]);
+    }
+
+    for(; i + 8 <= pixels; i += 8) {
+        load_tensor(in, i, pixels, channels, layout, f, 2);
+        for(c = 0; c < channels; c++) {
+            uint32x4_t u0 = quantize_f32x4(f[c][0], vector_scale[c], vector_bias[c]);
+            uint32x4_t u1 = quantize_f32x4(f[c][1], vector_scale[c], vector_bias[c]);
+
+            v[c] = vcombine_u16(vqmovn_u32(u0), vqmovn_u32(u1));
+        }
+        store_pixels_u16(out + i * channels, channels, v);
+    }
+
+    for(; i < pixels; i++) {
+        for(c = 0; c < channels; c++) {
+            uint32_t x = quantize_f32(in[tensor_index(i, c, pixels, channels, layout)], scale[c], bias[c]);
+            out[i * channels + c] = x > UINT16_MAX ? UINT16_MAX : (uint16_t)x;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+/* Conversion between 8/16-Bit unsigned integer images and normalized
+ * single precision float tensors using ARM NEON
+ *
+ * Images are interleaved (height x width x channels, 1 to 4 channels).
+ * Tensors are either interleaved as well (NHWC) or hold one plane per
+ * channel (NCHW), each plane pixels floats long.
+ *
+ * The integer to float direction widens with vmovl and converts with
+ * vcvtq, the float to integer direction rounds to nearest (ties up),
+ * converts with vcvtq and narrows with the saturating vqmovn, so values
+ * outside the integer range clamp to 0 or the maximum and NaN becomes 0.
+ */
+
+#ifndef NORMALIZE_H
+#define NORMALIZE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    NORMALIZE_NHWC,   // out[pixel * channels + channel]
+    NORMALIZE_NCHW    // out[channel * pixels + pixel]
+} normalize_layout;
+
+// out = (in - mean[c]) * inv_std[c] for the channel c of every value,
+// returns 0 or -1 for an unsupported channel count
+int normalize_u8_f32(const uint8_t *in, size_t pixels, unsigned channels,
+                     const float *mean, const float *inv_std, normalize_layout layout, float *out);
+int normalize_u16_f32(const uint16_t *in, size_t pixels, unsigned channels,
+                      const float *mean, const float *inv_std, normalize_layout layout, float *out);
+
+// out = saturate(round(in * scale[c] + offset[c])), the inverse of the
+// above for scale = 1 / inv_std and offset = mean, returns 0 or -1 for an
+// unsupported channel count
+int quantize_f32_u8(const float *in, size_t pixels, unsigned channels,
+                    const float *scale, const float *offset, normalize_layout layout, uint8_t *out);
+int quantize_f32_u16(const float *in, size_t pixels, unsigned channels,
+                     const float *scale, const float *offset, normalize_layout layout, uint16_t *out);
+
+#endif
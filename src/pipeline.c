@@ -0,0 +1,384 @@
+/* Multi-threaded frame pipeline: capture, vector kernel stages on their own
+ * threads and output, connected by lock-free single-producer/single-consumer
+ * rings of frame buffers
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include "neon_alloc.h"
+#include "pipeline.h"
+#include "trace.h"
+
+// slots per ring, power of two, every ring can hold all frames
+#define RING_SIZE PIPELINE_MAX_FRAMES
+
+#define CACHE_LINE 64
+
+// polls before an idle thread starts sleeping, and the sleep per poll
+#define SPIN_COUNT 256
+#define SLEEP_NS   50000
+
+// latency histogram, 4 buckets per power of two nanoseconds
+#define LATENCY_BUCKETS 256
+
+typedef struct {
+    // head is only written by the producer, tail only by the consumer, each
+    // on its own cache line
+    uint64_t head __attribute__((aligned(CACHE_LINE)));
+    uint64_t tail __attribute__((aligned(CACHE_LINE)));
+    pipeline_frame *slots[RING_SIZE] __attribute__((aligned(CACHE_LINE)));
+} frame_ring;
+
+typedef struct {
+    pipeline *p;
+    unsigned index;
+} stage_thread_arg;
+
+struct pipeline {
+    // rings[0] runs from capture to stage 0, rings[k] from stage k - 1 to
+    // stage k, rings[count] to the output, free_frames back to capture
+    frame_ring rings[PIPELINE_MAX_STAGES + 1];
+    frame_ring free_frames;
+
+    pipeline_config config;
+    pipeline_stage stages[PIPELINE_MAX_STAGES];
+    unsigned count;
+    pipeline_frame frames[PIPELINE_MAX_FRAMES];
+    pthread_t threads[PIPELINE_MAX_STAGES];
+    stage_thread_arg args[PIPELINE_MAX_STAGES];
+    unsigned started;
+    int stop;
+
+    // statistics, every counter has a single writer: capture
+    uint64_t sequence;
+    uint64_t submitted;
+    uint64_t dropped_no_frame;
+    // the stage threads
+    uint64_t dropped_late[PIPELINE_MAX_STAGES];
+    uint64_t dropped_kernel[PIPELINE_MAX_STAGES];
+    uint64_t stage_frames[PIPELINE_MAX_STAGES];
+    uint64_t stage_busy_ns[PIPELINE_MAX_STAGES];
+    // output
+    uint64_t completed;
+    uint64_t latency_sum_ns;
+    uint64_t latency_min_ns;
+    uint64_t latency_max_ns;
+    uint64_t latency_histogram[LATENCY_BUCKETS];
+};
+
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+
+// counters are only written by their owning thread, atomic so that 64-bit
+// values are never read torn
+static inline void counter_add(uint64_t *counter, uint64_t value) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+
+static inline uint64_t counter_get(const uint64_t *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+
+// never full, every ring has room for all frames
+static inline void ring_push(frame_ring *ring, pipeline_frame *frame) {
+    uint64_t head = ring->head;
+
+    ring->slots[head & (RING_SIZE - 1)] = frame;
+    // publish the slot (and the frame contents) to the consumer
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+
+// NULL if empty
+static inline pipeline_frame *ring_pop(frame_ring *ring) {
+    uint64_t tail = ring->tail;
+    pipeline_frame *frame;
+
+    if(__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail) {
+        return NULL;
+    }
+    frame = ring->slots[tail & (RING_SIZE - 1)];
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return frame;
+}
+
+
+static inline void backoff(unsigned *polls) {
+    struct timespec sleep = {0, SLEEP_NS};
+
+    if(*polls < SPIN_COUNT) {
+        (*polls)++;
+#if defined(__arm__) || defined(__aarch64__)
+        __asm__ volatile("yield");
+#endif
+        return;
+    }
+    nanosleep(&sleep, NULL);
+}
+
+
+static inline int stopping(pipeline *p) {
+    return __atomic_load_n(&p->stop, __ATOMIC_ACQUIRE);
+}
+
+
+static void *stage_thread(void *ptr) {
+    stage_thread_arg *arg = ptr;
+    pipeline *p = arg->p;
+    unsigned k = arg->index, polls = 0;
+    const pipeline_stage *stage = &p->stages[k];
+    frame_ring *in = &p->rings[k], *out = &p->rings[k + 1];
+
+    while(!stopping(p)) {
+        pipeline_frame *frame = ring_pop(in);
+        uint64_t start;
+
+        if(frame == NULL) {
+            backoff(&polls);
+            continue;
+        }
+        polls = 0;
+
+        if(!frame->dropped) {
+            int rejected;
+
+            start = now_ns();
+            if(p->config.max_latency_ns != 0 && start - frame->submit_ns > p->config.max_latency_ns) {
+                frame->dropped = 1;
+                counter_add(&p->dropped_late[k], 1);
+            } else {
+                TRACE_KERNEL("pipeline_stage", frame->size, rejected = stage->kernel(frame, stage->context));
+                if(rejected != 0) {
+                    frame->dropped = 1;
+                    counter_add(&p->dropped_kernel[k], 1);
+                }
+                counter_add(&p->stage_frames[k], 1);
+                counter_add(&p->stage_busy_ns[k], now_ns() - start);
+            }
+        }
+        ring_push(out, frame);
+    }
+
+    return NULL;
+}
+
+
+pipeline *pipeline_create(const pipeline_config *config, const pipeline_stage *stages, unsigned count) {
+    pipeline *p;
+    unsigned i;
+
+    if(config->frames < 2 || config->frames > PIPELINE_MAX_FRAMES || count > PIPELINE_MAX_STAGES) {
+        return NULL;
+    }
+    for(i = 0; i < count; i++) {
+        if(stages[i].kernel == NULL) {
+            return NULL;
+        }
+    }
+
+    // neon_alloc() for the cache line alignment of the rings
+    p = neon_alloc(sizeof(*p));
+    if(p == NULL) {
+        return NULL;
+    }
+    memset(p, 0, sizeof(*p));
+    p->config = *config;
+    memcpy(p->stages, stages, count * sizeof(pipeline_stage));
+    p->count = count;
+    p->latency_min_ns = UINT64_MAX;
+
+    for(i = 0; i < config->frames; i++) {
+        p->frames[i].data = neon_alloc(config->frame_size);
+        if(p->frames[i].data == NULL) {
+            pipeline_destroy(p);
+            return NULL;
+        }
+        ring_push(&p->free_frames, &p->frames[i]);
+    }
+
+    for(i = 0; i < count; i++) {
+        p->args[i].p = p;
+        p->args[i].index = i;
+        if(pthread_create(&p->threads[i], NULL, stage_thread, &p->args[i]) != 0) {
+            pipeline_destroy(p);
+            return NULL;
+        }
+        p->started++;
+        // best effort, the core may not exist or be allowed
+        if(stages[i].cpu >= 0) {
+            cpu_set_t cpus;
+
+            CPU_ZERO(&cpus);
+            CPU_SET(stages[i].cpu, &cpus);
+            pthread_setaffinity_np(p->threads[i], sizeof(cpus), &cpus);
+        }
+    }
+
+    return p;
+}
+
+
+void pipeline_destroy(pipeline *p) {
+    unsigned i;
+
+    if(p == NULL) {
+        return;
+    }
+    __atomic_store_n(&p->stop, 1, __ATOMIC_RELEASE);
+    for(i = 0; i < p->started; i++) {
+        pthread_join(p->threads[i], NULL);
+    }
+    for(i = 0; i < p->config.frames; i++) {
+        neon_free(p->frames[i].data);
+    }
+    neon_free(p);
+}
+
+
+pipeline_frame *pipeline_acquire(pipeline *p) {
+    unsigned polls = 0;
+    pipeline_frame *frame;
+
+    for(;;) {
+        frame = ring_pop(&p->free_frames);
+        if(frame != NULL) {
+            frame->sequence = p->sequence++;
+            frame->size = 0;
+            frame->dropped = 0;
+            return frame;
+        }
+        if(!p->config.block || stopping(p)) {
+            // the frame that could not be captured still takes its number
+            p->sequence++;
+            counter_add(&p->dropped_no_frame, 1);
+            return NULL;
+        }
+        backoff(&polls);
+    }
+}
+
+
+void pipeline_submit(pipeline *p, pipeline_frame *frame) {
+    frame->submit_ns = now_ns();
+    counter_add(&p->submitted, 1);
+    ring_push(&p->rings[0], frame);
+}
+
+
+static unsigned latency_bucket(uint64_t ns) {
+    unsigned e;
+
+    if(ns < 4) {
+        return (unsigned)ns;
+    }
+    e = 63 - (unsigned)__builtin_clzll(ns);
+    return 4 * e + (unsigned)((ns >> (e - 2)) & 3);
+}
+
+
+// largest latency falling into a bucket
+static uint64_t latency_bucket_limit(unsigned bucket) {
+    unsigned e = bucket / 4;
+
+    if(bucket < 4) {
+        return bucket;
+    }
+    return ((uint64_t)(5 + bucket % 4) << (e - 2)) - 1;
+}
+
+
+pipeline_frame *pipeline_receive(pipeline *p, int wait) {
+    unsigned polls = 0;
+    pipeline_frame *frame;
+    uint64_t latency;
+
+    for(;;) {
+        frame = ring_pop(&p->rings[p->count]);
+        if(frame == NULL) {
+            if(!wait || stopping(p)) {
+                return NULL;
+            }
+            backoff(&polls);
+            continue;
+        }
+        if(frame->dropped) {
+            ring_push(&p->free_frames, frame);
+            continue;
+        }
+
+        latency = now_ns() - frame->submit_ns;
+        counter_add(&p->completed, 1);
+        counter_add(&p->latency_sum_ns, latency);
+        counter_add(&p->latency_histogram[latency_bucket(latency)], 1);
+        if(latency < p->latency_min_ns) {
+            __atomic_store_n(&p->latency_min_ns, latency, __ATOMIC_RELAXED);
+        }
+        if(latency > p->latency_max_ns) {
+            __atomic_store_n(&p->latency_max_ns, latency, __ATOMIC_RELAXED);
+        }
+        return frame;
+    }
+}
+
+
+void pipeline_release(pipeline *p, pipeline_frame *frame) {
+    ring_push(&p->free_frames, frame);
+}
+
+
+// latency below which the fraction q of the completed frames falls, as the
+// upper end of its histogram bucket
+static uint64_t latency_percentile(pipeline *p, uint64_t completed, double q) {
+    uint64_t rank = (uint64_t)(q * (double)completed + 0.999999), seen = 0;
+    unsigned b;
+
+    for(b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += counter_get(&p->latency_histogram[b]);
+        if(seen >= rank) {
+            return latency_bucket_limit(b);
+        }
+    }
+    return latency_bucket_limit(LATENCY_BUCKETS - 1);
+}
+
+
+void pipeline_get_statistics(pipeline *p, pipeline_statistics *stats) {
+    unsigned k;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->submitted = counter_get(&p->submitted);
+    stats->completed = counter_get(&p->completed);
+    stats->dropped_no_frame = counter_get(&p->dropped_no_frame);
+    for(k = 0; k < p->count; k++) {
+        stats->dropped_late += counter_get(&p->dropped_late[k]);
+        stats->dropped_kernel += counter_get(&p->dropped_kernel[k]);
+        stats->stage_frames[k] = counter_get(&p->stage_frames[k]);
+        stats->stage_busy_ns[k] = counter_get(&p->stage_busy_ns[k]);
+    }
+
+    if(stats->completed > 0) {
+        stats->latency_min_ns = counter_get(&p->latency_min_ns);
+        stats->latency_max_ns = counter_get(&p->latency_max_ns);
+        stats->latency_mean_ns = counter_get(&p->latency_sum_ns) / stats->completed;
+        stats->latency_p50_ns = latency_percentile(p, stats->completed, 0.50);
+        stats->latency_p99_ns = latency_percentile(p, stats->completed, 0.99);
+        // the bucket ends may lie outside the observed range
+        if(stats->latency_p50_ns > stats->latency_max_ns) {
+            stats->latency_p50_ns = stats->latency_max_ns;
+        }
+        if(stats->latency_p99_ns > stats->latency_max_ns) {
+            stats->latency_p99_ns = stats->latency_max_ns;
+        }
+    }
+}
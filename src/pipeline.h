@@ -0,0 +1,90 @@
+/* Multi-threaded frame pipeline: capture, vector kernel stages on their own
+ * threads and output, connected by lock-free single-producer/single-consumer
+ * rings of frame buffers
+ *
+ * A fixed pool of frames circulates: the capture thread takes a free frame
+ * with pipeline_acquire(), fills it and hands it on with pipeline_submit();
+ * every stage thread runs its kernel on it and passes it to the next stage;
+ * the output thread gets it from pipeline_receive() and returns it to the
+ * pool with pipeline_release(). Capture and output may be the same thread
+ * or two threads, but each of the two roles must stay on one thread.
+ *
+ * When all frames are in flight, acquire either waits (back-pressure) or
+ * returns NULL and counts a dropped frame. A stage drops frames older than
+ * max_latency_ns instead of processing them, and frames its kernel rejects;
+ * dropped frames travel on to the output side, which recycles them without
+ * returning them. Idle threads spin briefly, then sleep in 50 us steps.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PIPELINE_MAX_STAGES 8
+#define PIPELINE_MAX_FRAMES 64
+
+typedef struct {
+    uint8_t *data;      // frame_size bytes, NEON_ALLOC_ALIGN aligned
+    size_t size;        // bytes in use, set by the producer
+    uint64_t sequence;  // numbered by pipeline_acquire()
+    uint64_t submit_ns; // CLOCK_MONOTONIC time of pipeline_submit()
+    int dropped;        // set by the pipeline, see above
+} pipeline_frame;
+
+// processes a frame in place, returns 0, or -1 to drop the frame
+typedef int (*pipeline_kernel)(pipeline_frame *frame, void *context);
+
+typedef struct {
+    pipeline_kernel kernel;
+    void *context;
+    int cpu;            // core to pin the stage thread to, -1 for any
+} pipeline_stage;
+
+typedef struct {
+    unsigned frames;           // frames in the pool, 2 to PIPELINE_MAX_FRAMES
+    size_t frame_size;
+    int block;                 // acquire waits for a free frame instead of dropping
+    uint64_t max_latency_ns;   // 0 processes frames of any age
+} pipeline_config;
+
+typedef struct {
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t dropped_no_frame;   // acquire found the pool empty
+    uint64_t dropped_late;       // older than max_latency_ns at a stage
+    uint64_t dropped_kernel;     // rejected by a stage kernel
+    // submit to receive of the completed frames; the percentiles are the upper
+    // ends of quarter-octave buckets, up to 25% above the true latency
+    uint64_t latency_min_ns;
+    uint64_t latency_mean_ns;
+    uint64_t latency_p50_ns;
+    uint64_t latency_p99_ns;
+    uint64_t latency_max_ns;
+    uint64_t stage_frames[PIPELINE_MAX_STAGES];
+    uint64_t stage_busy_ns[PIPELINE_MAX_STAGES];
+} pipeline_statistics;
+
+typedef struct pipeline pipeline;
+
+// starts one thread per stage, returns NULL for an invalid configuration or
+// if out of memory or threads
+pipeline *pipeline_create(const pipeline_config *config, const pipeline_stage *stages, unsigned count);
+
+// stops and joins the stage threads and frees all frames, frames still in
+// flight are discarded
+void pipeline_destroy(pipeline *p);
+
+// capture side
+pipeline_frame *pipeline_acquire(pipeline *p);
+void pipeline_submit(pipeline *p, pipeline_frame *frame);
+
+// output side, wait = 0 returns NULL if no frame is ready
+pipeline_frame *pipeline_receive(pipeline *p, int wait);
+void pipeline_release(pipeline *p, pipeline_frame *frame);
+
+// may be called from any thread while the pipeline runs
+void pipeline_get_statistics(pipeline *p, pipeline_statistics *stats);
+
+#endif
@@ -0,0 +1,81 @@
+/* Run-length coding of 8-Bit unsigned integer streams using ARM NEON
+ */
+
+#include "arm_neon.h"
+#include "rle.h"
+#include "neon_util.h"
+#include "stream.h"
+
+#define RLE_MAX_RUN 255
+
+
+size_t rle_max_encoded_size(size_t n) {
+    return 2 * n;
+}
+
+
+size_t rle_encode(const uint8_t *in, size_t n, uint8_t *out) {
+    size_t i = 0, j, end;
+    size_t distance = stream_settings.prefetch_distance;
+    uint8_t *o = out;
+
+    while(i < n) {
+        uint8_t value = in[i];
+        uint8x16_t vector_value = vdupq_n_u8(value);
+
+        end = n - i > RLE_MAX_RUN ? i + RLE_MAX_RUN : n;
+        j = i + 1;
+
+        // skip 16 equal bytes at a time, stop at the first mismatch
+        while(j + 16 <= end) {
+            // v: vector
+            // ceq: compare equal
+            // q: 128-bit registers
+            // u8: 8-bit unsigned integer
+            uint64_t mismatch = ~nibble_mask_u8x16(vceqq_u8(vld1q_u8(in + j), vector_value));
+
+            stream_prefetch_ahead(in + j, distance);
+
+            if(mismatch != 0) {
+                j += (size_t)(__builtin_ctzll(mismatch) >> 2);
+                end = j;
+                break;
+            }
+            j += 16;
+        }
+        while(j < end && in[j] == value) {
+            j++;
+        }
+
+        *o++ = (uint8_t)(j - i);
+        *o++ = value;
+        i = j;
+    }
+
+    return (size_t)(o - out);
+}
+
+
+size_t rle_decode(const uint8_t *in, size_t len, uint8_t *out, size_t out_size) {
+    size_t i, j, count;
+    uint8_t *o = out;
+
+    for(i = 0; i + 1 < len; i += 2) {
+        uint8x16_t vector_value = vdupq_n_u8(in[i + 1]);
+
+        count = in[i];
+        if(count > out_size - (size_t)(o - out)) {
+            count = out_size - (size_t)(o - out);
+        }
+
+        for(j = 0; j + 16 <= count; j += 16) {
+            vst1q_u8(o + j, vector_value);
+        }
+        for(; j < count; j++) {
+            o[j] = in[i + 1];
+        }
+        o += count;
+    }
+
+    return (size_t)(o - out);
+}
@@ -0,0 +1,22 @@
+/* Run-length coding of 8-Bit unsigned integer streams using ARM NEON
+ *
+ * The encoded stream is a sequence of (count, value) byte pairs with
+ * count = 1..255, so it is at most rle_max_encoded_size(n) = 2*n bytes.
+ */
+
+#ifndef RLE_H
+#define RLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+size_t rle_max_encoded_size(size_t n);
+
+// returns the number of bytes written to out
+size_t rle_encode(const uint8_t *in, size_t n, uint8_t *out);
+
+// decodes at most out_size bytes, returns the number of bytes written
+// (runs that do not fit are truncated, a trailing odd byte is ignored)
+size_t rle_decode(const uint8_t *in, size_t len, uint8_t *out, size_t out_size);
+
+#endif
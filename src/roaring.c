@@ -0,0 +1,852 @@
+/* Roaring bitmaps: compressed sets of 32-Bit unsigned integers with set
+ * operations and cardinality using ARM NEON
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "arm_neon.h"
+#include "neon_alloc.h"
+#include "roaring.h"
+#include "sortedset.h"
+
+// array containers hold at most this many values, bitmaps more
+#define ARRAY_MAX    4096
+#define BITMAP_WORDS 1024
+#define BITMAP_BYTES (8 * BITMAP_WORDS)
+
+enum {
+    CONTAINER_ARRAY,
+    CONTAINER_BITMAP
+};
+
+// an operation keeps the values only in a, only in b and in both, which
+// decides about the containers of keys present in one bitmap only
+#define KEEP_A    1
+#define KEEP_B    2
+#define KEEP_BOTH 4
+
+enum {
+    OP_AND = KEEP_BOTH,
+    OP_OR = KEEP_A | KEEP_B | KEEP_BOTH,
+    OP_XOR = KEEP_A | KEEP_B,
+    OP_ANDNOT = KEEP_A
+};
+
+struct roaring_container {
+    uint16_t key;
+    uint16_t type;
+    uint32_t cardinality;
+    // CONTAINER_ARRAY: cardinality sorted values, room for capacity
+    uint16_t *values;
+    uint32_t capacity;
+    // CONTAINER_BITMAP: BITMAP_WORDS words, value v is bit v % 64 of word v / 64
+    uint64_t *words;
+};
+
+
+static inline uint32_t sum_u16x8(uint16x8_t v) {
+    // v: vector
+    // paddl: pairwise addition (long)
+    // padd: pairwise addition (d registers only)
+    uint32x4_t wide = vpaddlq_u16(v);
+    uint32x2_t sum = vpadd_u32(vget_low_u32(wide), vget_high_u32(wide));
+
+    return vget_lane_u32(vpadd_u32(sum, sum), 0);
+}
+
+
+// set bits of four vectors, added to the lanes of counts; a lane gains at
+// most 64 per call, 128 calls per bitmap cannot wrap it
+static inline uint16x8_t count_bits(uint16x8_t counts, uint8x16_t r0, uint8x16_t r1, uint8x16_t r2, uint8x16_t r3) {
+    // v: vector
+    // cnt: number of set bits per lane
+    // padal: pairwise addition with accumulate (widening)
+    // q: 128-bit registers
+    // u8: 8-bit unsigned integer
+    uint8x16_t bits = vaddq_u8(vaddq_u8(vcntq_u8(r0), vcntq_u8(r1)), vaddq_u8(vcntq_u8(r2), vcntq_u8(r3)));
+
+    return vpadalq_u8(counts, bits);
+}
+
+
+// out = op(a, b) over whole bitmaps, returns the set bits of out; out may be
+// a or b
+#define BITMAP_KERNEL(name, op) \
+    static uint32_t name(const uint64_t *a, const uint64_t *b, uint64_t *out) { \
+        const uint8_t *pa = (const uint8_t *)a, *pb = (const uint8_t *)b; \
+        uint8_t *po = (uint8_t *)out; \
+        uint16x8_t counts = vdupq_n_u16(0); \
+        size_t i; \
+        \
+        for(i = 0; i < BITMAP_BYTES; i += 64) { \
+            uint8x16_t r0 = op(vld1q_u8(pa + i), vld1q_u8(pb + i)); \
+            uint8x16_t r1 = op(vld1q_u8(pa + i + 16), vld1q_u8(pb + i + 16)); \
+            uint8x16_t r2 = op(vld1q_u8(pa + i + 32), vld1q_u8(pb + i + 32)); \
+            uint8x16_t r3 = op(vld1q_u8(pa + i + 48), vld1q_u8(pb + i + 48)); \
+            \
+            vst1q_u8(po + i, r0); \
+            vst1q_u8(po + i + 16, r1); \
+            vst1q_u8(po + i + 32, r2); \
+            vst1q_u8(po + i + 48, r3); \
+            counts = count_bits(counts, r0, r1, r2, r3); \
+        } \
+        \
+        return sum_u16x8(counts); \
+    }
+
+// v: vector
+// and/orr/eor: bitwise and, or, exclusive or
+// bic: bit clear, a & ~b
+// q: 128-bit registers
+// u8: 8-bit unsigned integer
+BITMAP_KERNEL(bitmap_and, vandq_u8)
+BITMAP_KERNEL(bitmap_or, vorrq_u8)
+BITMAP_KERNEL(bitmap_xor, veorq_u8)
+BITMAP_KERNEL(bitmap_andnot, vbicq_u8)
+
+
+// |a & b| without storing it
+static uint32_t bitmap_and_count(const uint64_t *a, const uint64_t *b) {
+    const uint8_t *pa = (const uint8_t *)a, *pb = (const uint8_t *)b;
+    uint16x8_t counts = vdupq_n_u16(0);
+    size_t i;
+
+    for(i = 0; i < BITMAP_BYTES; i += 64) {
+        counts = count_bits(counts,
+                            vandq_u8(vld1q_u8(pa + i), vld1q_u8(pb + i)),
+                            vandq_u8(vld1q_u8(pa + i + 16), vld1q_u8(pb + i + 16)),
+                            vandq_u8(vld1q_u8(pa + i + 32), vld1q_u8(pb + i + 32)),
+                            vandq_u8(vld1q_u8(pa + i + 48), vld1q_u8(pb + i + 48)));
+    }
+
+    return sum_u16x8(counts);
+}
+
+
+static inline int bitmap_get(const uint64_t *words, uint16_t v) {
+    return (int)(words[v >> 6] >> (v & 63) & 1);
+}
+
+
+// sets bit v, returns 1 if it was clear
+static inline uint32_t bitmap_set(uint64_t *words, uint16_t v) {
+    uint64_t bit = (uint64_t)1 << (v & 63);
+    uint32_t was_clear = (words[v >> 6] & bit) == 0;
+
+    words[v >> 6] |= bit;
+    return was_clear;
+}
+
+
+static void array_to_bitmap(const uint16_t *values, uint32_t n, uint64_t *words) {
+    uint32_t i;
+
+    memset(words, 0, BITMAP_BYTES);
+    for(i = 0; i < n; i++) {
+        bitmap_set(words, values[i]);
+    }
+}
+
+
+// the set bits in ascending order, returns their number
+static uint32_t bitmap_to_array(const uint64_t *words, uint16_t *values) {
+    uint32_t n = 0, w;
+
+    for(w = 0; w < BITMAP_WORDS; w++) {
+        uint64_t word = words[w];
+
+        while(word != 0) {
+            values[n++] = (uint16_t)(w * 64 + (uint32_t)__builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+
+    return n;
+}
+
+
+// position of v in the sorted values, or of the first larger value
+static inline uint32_t array_search(const uint16_t *values, uint32_t n, uint16_t v) {
+    uint32_t low = 0, high = n;
+
+    while(low < high) {
+        uint32_t middle = (low + high) / 2;
+
+        if(values[middle] < v) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+
+static int container_contains(const roaring_container *c, uint16_t v) {
+    uint32_t position;
+
+    if(c->type == CONTAINER_BITMAP) {
+        return bitmap_get(c->words, v);
+    }
+    position = array_search(c->values, c->cardinality, v);
+    return position < c->cardinality && c->values[position] == v;
+}
+
+
+static void container_free(roaring_container *c) {
+    free(c->values);
+    neon_free(c->words);
+}
+
+
+// a container of the n sorted values, a bitmap if there are too many for an
+// array
+static int container_from_array(roaring_container *c, uint16_t key, const uint16_t *values, uint32_t n) {
+    memset(c, 0, sizeof(*c));
+    c->key = key;
+    c->cardinality = n;
+    if(n == 0) {
+        return 0;
+    }
+
+    if(n > ARRAY_MAX) {
+        c->type = CONTAINER_BITMAP;
+        c->words = neon_alloc(BITMAP_BYTES);
+        if(c->words == NULL) {
+            return -1;
+        }
+        array_to_bitmap(values, n, c->words);
+        return 0;
+    }
+
+    c->type = CONTAINER_ARRAY;
+    c->values = malloc(n * sizeof(uint16_t));
+    if(c->values == NULL) {
+        return -1;
+    }
+    memcpy(c->values, values, n * sizeof(uint16_t));
+    c->capacity = n;
+
+    return 0;
+}
+
+
+// a container of the bitmap words (taken over) with cardinality set bits,
+// an array if they are few enough
+static int container_from_bitmap(roaring_container *c, uint16_t key, uint64_t *words, uint32_t cardinality) {
+    memset(c, 0, sizeof(*c));
+    c->key = key;
+    c->cardinality = cardinality;
+
+    if(cardinality > ARRAY_MAX) {
+        c->type = CONTAINER_BITMAP;
+        c->words = words;
+        return 0;
+    }
+
+    c->type = CONTAINER_ARRAY;
+    if(cardinality != 0) {
+        c->values = malloc(cardinality * sizeof(uint16_t));
+        if(c->values == NULL) {
+            neon_free(words);
+            return -1;
+        }
+        bitmap_to_array(words, c->values);
+        c->capacity = cardinality;
+    }
+    neon_free(words);
+
+    return 0;
+}
+
+
+static int container_copy(const roaring_container *src, roaring_container *dst) {
+    if(src->type == CONTAINER_ARRAY) {
+        return container_from_array(dst, src->key, src->values, src->cardinality);
+    }
+
+    memset(dst, 0, sizeof(*dst));
+    dst->key = src->key;
+    dst->type = CONTAINER_BITMAP;
+    dst->cardinality = src->cardinality;
+    dst->words = neon_alloc(BITMAP_BYTES);
+    if(dst->words == NULL) {
+        return -1;
+    }
+    memcpy(dst->words, src->words, BITMAP_BYTES);
+
+    return 0;
+}
+
+
+// appends c (taken over) to out, empty containers are dropped
+static int append_container(roaring_bitmap *out, roaring_container *c) {
+    if(c->cardinality == 0) {
+        container_free(c);
+        return 0;
+    }
+
+    if(out->count == out->capacity) {
+        size_t capacity = out->capacity != 0 ? 2 * out->capacity : 4;
+        roaring_container *containers = realloc(out->containers, capacity * sizeof(roaring_container));
+
+        if(containers == NULL) {
+            container_free(c);
+            return -1;
+        }
+        out->containers = containers;
+        out->capacity = capacity;
+    }
+    out->containers[out->count++] = *c;
+
+    return 0;
+}
+
+
+// position of the container for key, or where it would be inserted
+static size_t find_container(const roaring_bitmap *bitmap, uint16_t key) {
+    size_t low = 0, high = bitmap->count;
+
+    while(low < high) {
+        size_t middle = (low + high) / 2;
+
+        if(bitmap->containers[middle].key < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+
+// scratch space of an operation: merged arrays (2 * ARRAY_MAX values, then
+// room for the two differences of a symmetric difference) and one array
+// operand as a bitmap
+typedef struct {
+    uint16_t *values;
+    uint64_t *words;
+} workspace;
+
+static int workspace_init(workspace *w) {
+    w->values = malloc(4 * ARRAY_MAX * sizeof(uint16_t));
+    w->words = neon_alloc(BITMAP_BYTES);
+    if(w->values == NULL || w->words == NULL) {
+        free(w->values);
+        neon_free(w->words);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void workspace_free(workspace *w) {
+    free(w->values);
+    neon_free(w->words);
+}
+
+
+static int container_op(const roaring_container *a, const roaring_container *b, unsigned op,
+                        workspace *w, roaring_container *out) {
+    const uint64_t *words_a, *words_b;
+    uint64_t *words;
+    uint32_t cardinality, i, n;
+
+    if(a->type == CONTAINER_ARRAY && b->type == CONTAINER_ARRAY) {
+        uint16_t *only_a = w->values + 2 * ARRAY_MAX;
+        uint16_t *only_b = w->values + 3 * ARRAY_MAX;
+        size_t na, nb;
+
+        switch(op) {
+        case OP_AND:
+            n = (uint32_t)sorted_intersect_u16(a->values, a->cardinality, b->values, b->cardinality, w->values);
+            break;
+        case OP_OR:
+            n = (uint32_t)sorted_union_u16(a->values, a->cardinality, b->values, b->cardinality, w->values);
+            break;
+        case OP_ANDNOT:
+            n = (uint32_t)sorted_difference_u16(a->values, a->cardinality, b->values, b->cardinality, w->values);
+            break;
+        default:
+            // symmetric difference: the two differences are disjoint, merging
+            // them gives a sorted set
+            na = sorted_difference_u16(a->values, a->cardinality, b->values, b->cardinality, only_a);
+            nb = sorted_difference_u16(b->values, b->cardinality, a->values, a->cardinality, only_b);
+            n = (uint32_t)sorted_merge_u16(only_a, na, only_b, nb, w->values);
+            break;
+        }
+        return container_from_array(out, a->key, w->values, n);
+    }
+
+    // the result is a subset of the array: keep the values that are (AND)
+    // or are not (ANDNOT) in the bitmap
+    if((op == OP_AND && (a->type == CONTAINER_ARRAY || b->type == CONTAINER_ARRAY)) ||
+       (op == OP_ANDNOT && a->type == CONTAINER_ARRAY)) {
+        const roaring_container *array = a->type == CONTAINER_ARRAY ? a : b;
+        const roaring_container *bitmap = a->type == CONTAINER_ARRAY ? b : a;
+        int keep = op == OP_AND;
+
+        for(i = 0, n = 0; i < array->cardinality; i++) {
+            w->values[n] = array->values[i];
+            n += bitmap_get(bitmap->words, array->values[i]) == keep;
+        }
+        return container_from_array(out, a->key, w->values, n);
+    }
+
+    // otherwise at most one of them is an array, as a bitmap in the workspace
+    words_a = a->words;
+    words_b = b->words;
+    if(a->type == CONTAINER_ARRAY) {
+        array_to_bitmap(a->values, a->cardinality, w->words);
+        words_a = w->words;
+    } else if(b->type == CONTAINER_ARRAY) {
+        array_to_bitmap(b->values, b->cardinality, w->words);
+        words_b = w->words;
+    }
+
+    words = neon_alloc(BITMAP_BYTES);
+    if(words == NULL) {
+        return -1;
+    }
+    switch(op) {
+    case OP_AND:
+        cardinality = bitmap_and(words_a, words_b, words);
+        break;
+    case OP_OR:
+        cardinality = bitmap_or(words_a, words_b, words);
+        break;
+    case OP_XOR:
+        cardinality = bitmap_xor(words_a, words_b, words);
+        break;
+    default:
+        cardinality = bitmap_andnot(words_a, words_b, words);
+        break;
+    }
+
+    return container_from_bitmap(out, a->key, words, cardinality);
+}
+
+
+static int binary_op(const roaring_bitmap *a, const roaring_bitmap *b, roaring_bitmap *out, unsigned op) {
+    roaring_container result;
+    workspace w;
+    size_t i = 0, j = 0;
+
+    roaring_free(out);
+    if(workspace_init(&w) != 0) {
+        return -1;
+    }
+
+    while(i < a->count || j < b->count) {
+        const roaring_container *ca = i < a->count ? &a->containers[i] : NULL;
+        const roaring_container *cb = j < b->count ? &b->containers[j] : NULL;
+        int error = 0;
+
+        if(cb == NULL || (ca != NULL && ca->key < cb->key)) {
+            // only in a
+            if(op & KEEP_A) {
+                error = container_copy(ca, &result) != 0 || append_container(out, &result) != 0;
+            }
+            i++;
+        } else if(ca == NULL || cb->key < ca->key) {
+            // only in b
+            if(op & KEEP_B) {
+                error = container_copy(cb, &result) != 0 || append_container(out, &result) != 0;
+            }
+            j++;
+        } else {
+            error = container_op(ca, cb, op, &w, &result) != 0 || append_container(out, &result) != 0;
+            i++;
+            j++;
+        }
+
+        if(error) {
+            workspace_free(&w);
+            roaring_free(out);
+            return -1;
+        }
+    }
+
+    workspace_free(&w);
+
+    return 0;
+}
+
+
+void roaring_init(roaring_bitmap *bitmap) {
+    bitmap->containers = NULL;
+    bitmap->count = 0;
+    bitmap->capacity = 0;
+}
+
+
+void roaring_free(roaring_bitmap *bitmap) {
+    size_t i;
+
+    for(i = 0; i < bitmap->count; i++) {
+        container_free(&bitmap->containers[i]);
+    }
+    free(bitmap->containers);
+    roaring_init(bitmap);
+}
+
+
+int roaring_add(roaring_bitmap *bitmap, uint32_t value) {
+    uint16_t key = (uint16_t)(value >> 16), low = (uint16_t)value;
+    size_t index = find_container(bitmap, key);
+    roaring_container *c;
+    uint32_t position;
+
+    if(index == bitmap->count || bitmap->containers[index].key != key) {
+        roaring_container created;
+
+        if(container_from_array(&created, key, &low, 1) != 0) {
+            return -1;
+        }
+        // append and move into place
+        if(append_container(bitmap, &created) != 0) {
+            return -1;
+        }
+        memmove(bitmap->containers + index + 1, bitmap->containers + index,
+                (bitmap->count - 1 - index) * sizeof(roaring_container));
+        bitmap->containers[index] = created;
+        return 0;
+    }
+
+    c = &bitmap->containers[index];
+    if(c->type == CONTAINER_BITMAP) {
+        c->cardinality += bitmap_set(c->words, low);
+        return 0;
+    }
+
+    position = array_search(c->values, c->cardinality, low);
+    if(position < c->cardinality && c->values[position] == low) {
+        return 0;
+    }
+
+    // a full array becomes a bitmap
+    if(c->cardinality == ARRAY_MAX) {
+        uint64_t *words = neon_alloc(BITMAP_BYTES);
+
+        if(words == NULL) {
+            return -1;
+        }
+        array_to_bitmap(c->values, c->cardinality, words);
+        free(c->values);
+        c->values = NULL;
+        c->capacity = 0;
+        c->words = words;
+        c->type = CONTAINER_BITMAP;
+        c->cardinality += bitmap_set(c->words, low);
+        return 0;
+    }
+
+    if(c->cardinality == c->capacity) {
+        uint32_t capacity = c->capacity < ARRAY_MAX / 2 ? 2 * c->capacity : ARRAY_MAX;
+        uint16_t *values = realloc(c->values, capacity * sizeof(uint16_t));
+
+        if(values == NULL) {
+            return -1;
+        }
+        c->values = values;
+        c->capacity = capacity;
+    }
+    memmove(c->values + position + 1, c->values + position, (c->cardinality - position) * sizeof(uint16_t));
+    c->values[position] = low;
+    c->cardinality++;
+
+    return 0;
+}
+
+
+int roaring_contains(const roaring_bitmap *bitmap, uint32_t value) {
+    size_t index = find_container(bitmap, (uint16_t)(value >> 16));
+
+    return index < bitmap->count && bitmap->containers[index].key == value >> 16 &&
+           container_contains(&bitmap->containers[index], (uint16_t)value);
+}
+
+
+uint64_t roaring_cardinality(const roaring_bitmap *bitmap) {
+    uint64_t cardinality = 0;
+    size_t i;
+
+    for(i = 0; i < bitmap->count; i++) {
+        cardinality += bitmap->containers[i].cardinality;
+    }
+
+    return cardinality;
+}
+
+
+size_t roaring_to_array(const roaring_bitmap *bitmap, uint32_t *out) {
+    size_t n = 0, i;
+    uint32_t j;
+
+    for(i = 0; i < bitmap->count; i++) {
+        const roaring_container *c = &bitmap->containers[i];
+        uint32_t high = (uint32_t)c->key << 16;
+
+        if(c->type == CONTAINER_ARRAY) {
+            for(j = 0; j < c->cardinality; j++) {
+                out[n++] = high | c->values[j];
+            }
+        } else {
+            for(j = 0; j < BITMAP_WORDS; j++) {
+                uint64_t word = c->words[j];
+
+                while(word != 0) {
+                    out[n++] = high | (j * 64 + (uint32_t)__builtin_ctzll(word));
+                    word &= word - 1;
+                }
+            }
+        }
+    }
+
+    return n;
+}
+
+
+int roaring_and(const roaring_bitmap *a, const roaring_bitmap *b, roaring_bitmap *out) {
+    return binary_op(a, b, out, OP_AND);
+}
+
+int roaring_or(const roaring_bitmap *a, const roaring_bitmap *b, roaring_bitmap *out) {
+    return binary_op(a, b, out, OP_OR);
+}
+
+int roaring_xor(const roaring_bitmap *a, const roaring_bitmap *b, roaring_bitmap *out) {
+    return binary_op(a, b, out, OP_XOR);
+}
+
+int roaring_andnot(const roaring_bitmap *a, const roaring_bitmap *b, roaring_bitmap *out) {
+    return binary_op(a, b, out, OP_ANDNOT);
+}
+
+
+uint64_t roaring_and_cardinality(const roaring_bitmap *a, const roaring_bitmap *b) {
+    uint64_t cardinality = 0;
+    size_t i = 0, j = 0;
+    uint32_t k;
+    // intersections of array containers, the values themselves are unused
+    uint16_t values[ARRAY_MAX];
+
+    while(i < a->count && j < b->count) {
+        const roaring_container *ca = &a->containers[i], *cb = &b->containers[j];
+
+        if(ca->key < cb->key) {
+            i++;
+            continue;
+        }
+        if(cb->key < ca->key) {
+            j++;
+            continue;
+        }
+
+        if(ca->type == CONTAINER_BITMAP && cb->type == CONTAINER_BITMAP) {
+            cardinality += bitmap_and_count(ca->words, cb->words);
+        } else if(ca->type == CONTAINER_ARRAY && cb->type == CONTAINER_ARRAY) {
+            cardinality += sorted_intersect_u16(ca->values, ca->cardinality, cb->values, cb->cardinality, values);
+        } else {
+            const roaring_container *array = ca->type == CONTAINER_ARRAY ? ca : cb;
+            const roaring_container *bitmap = ca->type == CONTAINER_ARRAY ? cb : ca;
+
+            for(k = 0; k < array->cardinality; k++) {
+                cardinality += (uint64_t)bitmap_get(bitmap->words, array->values[k]);
+            }
+        }
+        i++;
+        j++;
+    }
+
+    return cardinality;
+}
+
+
+// union of the m containers of one key: bitmaps ORed into one, then the
+// array values set in it
+static int union_group(const roaring_container *const *group, size_t m, roaring_container *out) {
+    uint64_t *words;
+    uint32_t cardinality = 0, i;
+    size_t k;
+    int first = 1;
+
+    if(m == 1) {
+        return container_copy(group[0], out);
+    }
+
+    words = neon_alloc(BITMAP_BYTES);
+    if(words == NULL) {
+        return -1;
+    }
+
+    for(k = 0; k < m; k++) {
+        if(group[k]->type != CONTAINER_BITMAP) {
+            continue;
+        }
+        if(first) {
+            memcpy(words, group[k]->words, BITMAP_BYTES);
+            cardinality = group[k]->cardinality;
+            first = 0;
+        } else {
+            cardinality = bitmap_or(words, group[k]->words, words);
+        }
+    }
+    if(first) {
+        memset(words, 0, BITMAP_BYTES);
+    }
+
+    for(k = 0; k < m; k++) {
+        if(group[k]->type != CONTAINER_ARRAY) {
+            continue;
+        }
+        for(i = 0; i < group[k]->cardinality; i++) {
+            cardinality += bitmap_set(words, group[k]->values[i]);
+        }
+    }
+
+    return container_from_bitmap(out, group[0]->key, words, cardinality);
+}
+
+
+// intersection of the m containers of one key: the smallest array filtered
+// against all others, or the bitmaps ANDed
+static int intersect_group(const roaring_container *const *group, size_t m, uint16_t *values,
+                           roaring_container *out) {
+    const roaring_container *smallest = NULL;
+    uint64_t *words;
+    uint32_t cardinality, i, n;
+    size_t k;
+
+    if(m == 1) {
+        return container_copy(group[0], out);
+    }
+
+    for(k = 0; k < m; k++) {
+        if(group[k]->type == CONTAINER_ARRAY &&
+           (smallest == NULL || group[k]->cardinality < smallest->cardinality)) {
+            smallest = group[k];
+        }
+    }
+
+    if(smallest != NULL) {
+        for(i = 0, n = 0; i < smallest->cardinality; i++) {
+            for(k = 0; k < m; k++) {
+                if(group[k] != smallest && !container_contains(group[k], smallest->values[i])) {
+                    break;
+                }
+            }
+            values[n] = smallest->values[i];
+            n += k == m;
+        }
+        return container_from_array(out, smallest->key, values, n);
+    }
+
+    words = neon_alloc(BITMAP_BYTES);
+    if(words == NULL) {
+        return -1;
+    }
+    cardinality = bitmap_and(group[0]->words, group[1]->words, words);
+    for(k = 2; k < m && cardinality != 0; k++) {
+        cardinality = bitmap_and(words, group[k]->words, words);
+    }
+
+    return container_from_bitmap(out, group[0]->key, words, cardinality);
+}
+
+
+int roaring_or_many(const roaring_bitmap *const *inputs, size_t n, roaring_bitmap *out) {
+    size_t *positions = calloc(n + 1, sizeof(size_t));
+    const roaring_container **group = malloc((n + 1) * sizeof(roaring_container *));
+    roaring_container result;
+    size_t k, m;
+
+    roaring_free(out);
+    if(positions == NULL || group == NULL) {
+        free(positions);
+        free(group);
+        return -1;
+    }
+
+    // one key at a time, the smallest key not yet done of all inputs
+    for(;;) {
+        uint32_t key = UINT32_MAX;
+
+        for(k = 0; k < n; k++) {
+            if(positions[k] < inputs[k]->count && inputs[k]->containers[positions[k]].key < key) {
+                key = inputs[k]->containers[positions[k]].key;
+            }
+        }
+        if(key == UINT32_MAX) {
+            break;
+        }
+
+        for(k = 0, m = 0; k < n; k++) {
+            if(positions[k] < inputs[k]->count && inputs[k]->containers[positions[k]].key == key) {
+                group[m++] = &inputs[k]->containers[positions[k]++];
+            }
+        }
+
+        if(union_group(group, m, &result) != 0 || append_container(out, &result) != 0) {
+            free(positions);
+            free(group);
+            roaring_free(out);
+            return -1;
+        }
+    }
+
+    free(positions);
+    free(group);
+
+    return 0;
+}
+
+
+int roaring_and_many(const roaring_bitmap *const *inputs, size_t n, roaring_bitmap *out) {
+    size_t *positions = calloc(n + 1, sizeof(size_t));
+    const roaring_container **group = malloc((n + 1) * sizeof(roaring_container *));
+    uint16_t *values = malloc(ARRAY_MAX * sizeof(uint16_t));
+    roaring_container result;
+    size_t i, k;
+    int error = 0;
+
+    roaring_free(out);
+    if(positions == NULL || group == NULL || values == NULL) {
+        error = 1;
+    }
+
+    // the keys of the first input that all others have as well
+    for(i = 0; !error && n != 0 && i < inputs[0]->count; i++) {
+        uint16_t key = inputs[0]->containers[i].key;
+
+        group[0] = &inputs[0]->containers[i];
+        for(k = 1; k < n; k++) {
+            const roaring_bitmap *input = inputs[k];
+
+            while(positions[k] < input->count && input->containers[positions[k]].key < key) {
+                positions[k]++;
+            }
+            if(positions[k] == input->count || input->containers[positions[k]].key != key) {
+                break;
+            }
+            group[k] = &input->containers[positions[k]];
+        }
+        if(k < n) {
+            continue;
+        }
+
+        error = intersect_group(group, n, values, &result) != 0 || append_container(out, &result) != 0;
+    }
+
+    free(positions);
+    free(group);
+    free(values);
+    if(error) {
+        roaring_free(out);
+        return -1;
+    }
+
+    return 0;
+}
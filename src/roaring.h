@@ -0,0 +1,66 @@
+/* Roaring bitmaps: compressed sets of 32-Bit unsigned integers with set
+ * operations and cardinality using ARM NEON
+ *
+ * The upper 16 bits of a value select a container, the lower 16 bits are
+ * stored in it: up to 4096 values as a sorted uint16_t array, more as a
+ * 65536-bit bitmap. Bitmap containers are combined 64 bytes per iteration
+ * with vandq_u8/vorrq_u8/veorq_u8/vbicq_u8 and the cardinality of the result
+ * is counted in the same pass (vcntq_u8 and pairwise accumulation); results
+ * of up to 4096 values are turned back into arrays. Array containers are
+ * combined with the vectorized set operations of sortedset.h and filtered
+ * against bitmaps. There are no run containers.
+ *
+ * A roaring_bitmap must be set up with roaring_init() and released with
+ * roaring_free(). The operations replace the contents of out, which must not
+ * be one of the inputs; on failure out is left empty. Functions returning
+ * int return 0, or -1 if out of memory.
+ */
+
+#ifndef ROARING_H
+#define ROARING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct roaring_container roaring_container;
+
+typedef struct {
+    // sorted by key
+    roaring_container *containers;
+    size_t count;
+    size_t capacity;
+} roaring_bitmap;
+
+void roaring_init(roaring_bitmap *bitmap);
+void roaring_free(roaring_bitmap *bitmap);
+
+int roaring_add(roaring_bitmap *bitmap, uint32_t value);
+
+// 1 if value is in the set, 0 otherwise
+int roaring_contains(const roaring_bitmap *bitmap, uint32_t value);
+
+uint64_t roaring_cardinality(const roaring_bitmap *bitmap);
+
+// writes the values in ascending order, out needs roaring_cardinality()
+// entries; returns their number
+size_t roaring_to_array(const roaring_bitmap *bitmap, uint32_t *out);
+
+// out = a & b, a | b, a ^ b and a & ~b
+int roaring_and(const roaring_bitmap *a, const roaring_bitmap *b, roaring_bitmap *out);
+int roaring_or(const roaring_bitmap *a, const roaring_bitmap *b, roaring_bitmap *out);
+int roaring_xor(const roaring_bitmap *a, const roaring_bitmap *b, roaring_bitmap *out);
+int roaring_andnot(const roaring_bitmap *a, const roaring_bitmap *b, roaring_bitmap *out);
+
+// |a & b| without building the result, the other cardinalities follow:
+// |a | b| = |a| + |b| - |a & b|, |a ^ b| = |a| + |b| - 2 |a & b| and
+// |a & ~b| = |a| - |a & b|
+uint64_t roaring_and_cardinality(const roaring_bitmap *a, const roaring_bitmap *b);
+
+// out = union and intersection of n bitmaps in one pass over the keys,
+// containers of the same key are combined in a single scratch bitmap (or
+// the smallest array is filtered) instead of building n - 1 intermediate
+// results
+int roaring_or_many(const roaring_bitmap *const *inputs, size_t n, roaring_bitmap *out);
+int roaring_and_many(const roaring_bitmap *const *inputs, size_t n, roaring_bitmap *out);
+
+#endif
@@ -0,0 +1,268 @@
+/* Shift, shift-accumulate, shift-insert and rotate kernels for 8-Bit
+ * unsigned and 16-Bit signed integers, and register shifts of all integer
+ * widths using ARM NEON
+ *
+ * The kernels are generated by the macros below, one per operation and
+ * constant shift amount, and collected in tables indexed by the amount.
+ */
+
+#include <string.h>
+#include "arm_neon.h"
+#include "shift.h"
+#include "neon_util.h"
+
+// shift count types of the register shifts
+#define COUNT_TYPE_u8    int8_t
+#define COUNT_TYPE_s8    int8_t
+#define COUNT_TYPE_u16   int16_t
+#define COUNT_TYPE_s16   int16_t
+#define COUNT_TYPE_u32   int32_t
+#define COUNT_TYPE_s32   int32_t
+#define COUNT_LOAD_u8    vld1q_s8
+#define COUNT_LOAD_s8    vld1q_s8
+#define COUNT_LOAD_u16   vld1q_s16
+#define COUNT_LOAD_s16   vld1q_s16
+#define COUNT_LOAD_u32   vld1q_s32
+#define COUNT_LOAD_s32   vld1q_s32
+
+// immediate shift ranges: left 0..width-1, right 1..width
+#define AMOUNTS_LEFT_8(M, op, s) \
+    M(op, s, 0) M(op, s, 1) M(op, s, 2) M(op, s, 3) M(op, s, 4) M(op, s, 5) M(op, s, 6) M(op, s, 7)
+#define AMOUNTS_RIGHT_8(M, op, s) \
+    M(op, s, 1) M(op, s, 2) M(op, s, 3) M(op, s, 4) M(op, s, 5) M(op, s, 6) M(op, s, 7) M(op, s, 8)
+#define AMOUNTS_LEFT_16(M, op, s) AMOUNTS_LEFT_8(M, op, s) \
+    M(op, s, 8) M(op, s, 9) M(op, s, 10) M(op, s, 11) M(op, s, 12) M(op, s, 13) M(op, s, 14) M(op, s, 15)
+#define AMOUNTS_RIGHT_16(M, op, s) AMOUNTS_RIGHT_8(M, op, s) \
+    M(op, s, 9) M(op, s, 10) M(op, s, 11) M(op, s, 12) M(op, s, 13) M(op, s, 14) M(op, s, 15) M(op, s, 16)
+
+#define AMOUNTS_LEFT_u8   AMOUNTS_LEFT_8
+#define AMOUNTS_RIGHT_u8  AMOUNTS_RIGHT_8
+#define AMOUNTS_LEFT_u16  AMOUNTS_LEFT_16
+#define AMOUNTS_LEFT_s16  AMOUNTS_LEFT_16
+#define AMOUNTS_RIGHT_s16 AMOUNTS_RIGHT_16
+
+
+// out = expr(v) for every vector v of in, the tail runs through a zero
+// padded vector so every element sees the same instruction
+#define UNARY_KERNEL(op, s, k, expr) \
+    static void op##_##s##_##k(const TYPE_##s *in, size_t n, TYPE_##s *out) { \
+        TYPE_##s tail[LANES_##s]; \
+        VECTOR_##s v; \
+        size_t i = 0; \
+        for(; i + LANES_##s <= n; i += LANES_##s) { \
+            v = vld1q_##s(in + i); \
+            vst1q_##s(out + i, expr); \
+        } \
+        if(i < n) { \
+            memset(tail, 0, sizeof(tail)); \
+            memcpy(tail, in + i, (n - i) * sizeof(TYPE_##s)); \
+            v = vld1q_##s(tail); \
+            vst1q_##s(tail, expr); \
+            memcpy(out + i, tail, (n - i) * sizeof(TYPE_##s)); \
+        } \
+    }
+
+// acc = expr(acc, v) in place
+#define BINARY_KERNEL(op, s, k, expr) \
+    static void op##_##s##_##k(TYPE_##s *acc, const TYPE_##s *in, size_t n) { \
+        TYPE_##s tail_acc[LANES_##s], tail_in[LANES_##s]; \
+        VECTOR_##s a, v; \
+        size_t i = 0; \
+        for(; i + LANES_##s <= n; i += LANES_##s) { \
+            a = vld1q_##s(acc + i); \
+            v = vld1q_##s(in + i); \
+            vst1q_##s(acc + i, expr); \
+        } \
+        if(i < n) { \
+            memset(tail_in, 0, sizeof(tail_in)); \
+            memcpy(tail_acc, acc + i, (n - i) * sizeof(TYPE_##s)); \
+            memcpy(tail_in, in + i, (n - i) * sizeof(TYPE_##s)); \
+            a = vld1q_##s(tail_acc); \
+            v = vld1q_##s(tail_in); \
+            vst1q_##s(tail_acc, expr); \
+            memcpy(acc + i, tail_acc, (n - i) * sizeof(TYPE_##s)); \
+        } \
+    }
+
+// v: vector
+// shl/qshl: shift left (saturating)
+// shr/rshr: shift right (rounding)
+// sra/rsra: shift right and accumulate (rounding)
+// sli/sri: shift left/right and insert
+// _n: immediate shift amount
+#define SHL(op, s, k)    UNARY_KERNEL(op, s, k, vshlq_n_##s(v, k))
+#define QSHL(op, s, k)   UNARY_KERNEL(op, s, k, vqshlq_n_##s(v, k))
+#define SHR(op, s, k)    UNARY_KERNEL(op, s, k, vshrq_n_##s(v, k))
+#define RSHR(op, s, k)   UNARY_KERNEL(op, s, k, vrshrq_n_##s(v, k))
+#define SRA(op, s, k)    BINARY_KERNEL(op, s, k, vsraq_n_##s(a, v, k))
+#define RSRA(op, s, k)   BINARY_KERNEL(op, s, k, vrsraq_n_##s(a, v, k))
+#define SLI(op, s, k)    BINARY_KERNEL(op, s, k, vsliq_n_##s(a, v, k))
+#define SRI(op, s, k)    BINARY_KERNEL(op, s, k, vsriq_n_##s(a, v, k))
+// rotate: the bits shifted out at the top are inserted at the bottom
+#define ROTL(op, s, k)   UNARY_KERNEL(op, s, k, vsliq_n_##s(vshrq_n_##s(v, (int)(8 * sizeof(TYPE_##s)) - k), v, k))
+
+#define ENTRY(op, s, k)  op##_##s##_##k,
+
+#define SHIFT_KERNELS(s) \
+    AMOUNTS_LEFT_##s(SHL, shl, s) \
+    AMOUNTS_LEFT_##s(QSHL, qshl, s) \
+    AMOUNTS_RIGHT_##s(SHR, shr, s) \
+    AMOUNTS_RIGHT_##s(RSHR, rshr, s) \
+    AMOUNTS_RIGHT_##s(SRA, sra, s) \
+    AMOUNTS_RIGHT_##s(RSRA, rsra, s) \
+    AMOUNTS_LEFT_##s(SLI, sli, s) \
+    AMOUNTS_RIGHT_##s(SRI, sri, s) \
+    \
+    typedef void unary_kernel_##s(const TYPE_##s *in, size_t n, TYPE_##s *out); \
+    typedef void binary_kernel_##s(TYPE_##s *acc, const TYPE_##s *in, size_t n); \
+    \
+    static unary_kernel_##s *const shl_##s[] = {AMOUNTS_LEFT_##s(ENTRY, shl, s)}; \
+    static unary_kernel_##s *const qshl_##s[] = {AMOUNTS_LEFT_##s(ENTRY, qshl, s)}; \
+    static unary_kernel_##s *const shr_##s[] = {AMOUNTS_RIGHT_##s(ENTRY, shr, s)}; \
+    static unary_kernel_##s *const rshr_##s[] = {AMOUNTS_RIGHT_##s(ENTRY, rshr, s)}; \
+    static binary_kernel_##s *const sra_##s[] = {AMOUNTS_RIGHT_##s(ENTRY, sra, s)}; \
+    static binary_kernel_##s *const rsra_##s[] = {AMOUNTS_RIGHT_##s(ENTRY, rsra, s)}; \
+    static binary_kernel_##s *const sli_##s[] = {AMOUNTS_LEFT_##s(ENTRY, sli, s)}; \
+    static binary_kernel_##s *const sri_##s[] = {AMOUNTS_RIGHT_##s(ENTRY, sri, s)};
+
+SHIFT_KERNELS(u8)
+SHIFT_KERNELS(s16)
+
+AMOUNTS_LEFT_u8(ROTL, rotl, u8)
+AMOUNTS_LEFT_u16(ROTL, rotl, u16)
+
+typedef void unary_kernel_u16(const uint16_t *in, size_t n, uint16_t *out);
+
+static unary_kernel_u8 *const rotl_u8[] = {AMOUNTS_LEFT_u8(ENTRY, rotl, u8)};
+static unary_kernel_u16 *const rotl_u16[] = {AMOUNTS_LEFT_u16(ENTRY, rotl, u16)};
+
+
+// per element shift counts with the register shifts, indexed by shift_mode
+#define REGISTER_KERNEL(op, s) \
+    static void register_##op##_##s(const TYPE_##s *in, const COUNT_TYPE_##s *shifts, size_t n, TYPE_##s *out) { \
+        TYPE_##s tail[LANES_##s]; \
+        COUNT_TYPE_##s tail_shifts[LANES_##s]; \
+        size_t i = 0; \
+        for(; i + LANES_##s <= n; i += LANES_##s) { \
+            vst1q_##s(out + i, op##_##s(vld1q_##s(in + i), COUNT_LOAD_##s(shifts + i))); \
+        } \
+        if(i < n) { \
+            memset(tail, 0, sizeof(tail)); \
+            memset(tail_shifts, 0, sizeof(tail_shifts)); \
+            memcpy(tail, in + i, (n - i) * sizeof(TYPE_##s)); \
+            memcpy(tail_shifts, shifts + i, (n - i) * sizeof(COUNT_TYPE_##s)); \
+            vst1q_##s(tail, op##_##s(vld1q_##s(tail), COUNT_LOAD_##s(tail_shifts))); \
+            memcpy(out + i, tail, (n - i) * sizeof(TYPE_##s)); \
+        } \
+    }
+
+#define REGISTER_KERNELS(s) \
+    REGISTER_KERNEL(vshlq, s) \
+    REGISTER_KERNEL(vrshlq, s) \
+    REGISTER_KERNEL(vqshlq, s) \
+    REGISTER_KERNEL(vqrshlq, s) \
+    \
+    static void (*const register_##s[])(const TYPE_##s *, const COUNT_TYPE_##s *, size_t, TYPE_##s *) = { \
+        register_vshlq_##s, register_vrshlq_##s, register_vqshlq_##s, register_vqrshlq_##s \
+    };
+
+REGISTER_KERNELS(u8)
+REGISTER_KERNELS(s8)
+REGISTER_KERNELS(u16)
+REGISTER_KERNELS(s16)
+REGISTER_KERNELS(u32)
+REGISTER_KERNELS(s32)
+
+
+// uniform shift amounts outside the immediate ranges, the register shifts
+// only use the low byte of the count, so clamp it first
+#define UNIFORM_SHIFT(s) \
+    static void uniform_shift_##s(const TYPE_##s *in, size_t n, int shift, shift_mode mode, TYPE_##s *out) { \
+        COUNT_TYPE_##s shifts[256]; \
+        size_t i, j; \
+        shift = shift < -64 ? -64 : shift > 64 ? 64 : shift; \
+        for(j = 0; j < 256; j++) { \
+            shifts[j] = (COUNT_TYPE_##s)shift; \
+        } \
+        for(i = 0; i < n; i += 256) { \
+            register_##s[mode](in + i, shifts, n - i < 256 ? n - i : 256, out + i); \
+        } \
+    }
+
+UNIFORM_SHIFT(u8)
+UNIFORM_SHIFT(s8)
+UNIFORM_SHIFT(u16)
+UNIFORM_SHIFT(s16)
+UNIFORM_SHIFT(u32)
+UNIFORM_SHIFT(s32)
+
+
+#define SHIFT_LANES_API(s) \
+    void shift_lanes_##s(const TYPE_##s *in, const COUNT_TYPE_##s *shifts, size_t n, shift_mode mode, TYPE_##s *out) { \
+        register_##s[mode](in, shifts, n, out); \
+    }
+
+// the widths without immediate kernels always use the register shifts
+#define REGISTER_SHIFT_API(s) \
+    SHIFT_LANES_API(s) \
+    \
+    void shift_##s(const TYPE_##s *in, size_t n, int shift, shift_mode mode, TYPE_##s *out) { \
+        uniform_shift_##s(in, n, shift, mode, out); \
+    }
+
+#define SHIFT_API(s, width) \
+    SHIFT_LANES_API(s) \
+    \
+    void shift_##s(const TYPE_##s *in, size_t n, int shift, shift_mode mode, TYPE_##s *out) { \
+        int rounding = mode == SHIFT_ROUNDING || mode == SHIFT_SATURATING_ROUNDING; \
+        int saturating = mode == SHIFT_SATURATING || mode == SHIFT_SATURATING_ROUNDING; \
+        /* right shifts cannot overflow, so saturation only matters for left shifts */ \
+        if(shift >= 0 && shift < width) { \
+            (saturating ? qshl_##s : shl_##s)[shift](in, n, out); \
+        } else if(shift < 0 && shift >= -width) { \
+            (rounding ? rshr_##s : shr_##s)[-shift - 1](in, n, out); \
+        } else { \
+            uniform_shift_##s(in, n, shift, mode, out); \
+        } \
+    } \
+    \
+    int shift_right_accumulate_##s(TYPE_##s *acc, const TYPE_##s *in, size_t n, int shift, int rounding) { \
+        if(shift < 1 || shift > width) { \
+            return -1; \
+        } \
+        (rounding ? rsra_##s : sra_##s)[shift - 1](acc, in, n); \
+        return 0; \
+    } \
+    \
+    int shift_left_insert_##s(TYPE_##s *dst, const TYPE_##s *in, size_t n, int shift) { \
+        if(shift < 0 || shift >= width) { \
+            return -1; \
+        } \
+        sli_##s[shift](dst, in, n); \
+        return 0; \
+    } \
+    \
+    int shift_right_insert_##s(TYPE_##s *dst, const TYPE_##s *in, size_t n, int shift) { \
+        if(shift < 1 || shift > width) { \
+            return -1; \
+        } \
+        sri_##s[shift - 1](dst, in, n); \
+        return 0; \
+    }
+
+SHIFT_API(u8, 8)
+SHIFT_API(s16, 16)
+REGISTER_SHIFT_API(s8)
+REGISTER_SHIFT_API(u16)
+REGISTER_SHIFT_API(u32)
+REGISTER_SHIFT_API(s32)
+
+
+void rotate_left_u8(const uint8_t *in, size_t n, int shift, uint8_t *out) {
+    rotl_u8[shift & 7](in, n, out);
+}
+
+
+void rotate_left_u16(const uint16_t *in, size_t n, int shift, uint16_t *out) {
+    rotl_u16[shift & 15](in, n, out);
+}
@@ -0,0 +1,63 @@
+/* Shift, shift-accumulate, shift-insert and rotate kernels for 8-Bit
+ * unsigned and 16-Bit signed integers, and register shifts of all integer
+ * widths using ARM NEON
+ *
+ * Every constant shift amount has its own kernel built around the immediate
+ * instructions (vshlq_n, vshrq_n, vrshrq_n, vqshlq_n, vsraq_n, vrsraq_n,
+ * vsliq_n, vsriq_n), the shift amount passed at run time only selects the
+ * kernel once per call. Amounts beyond the immediate range, per-element
+ * amounts and the other widths (s8, u16, u32, s32) use the register shifts
+ * (vshlq, vrshlq, vqshlq, vqrshlq).
+ */
+
+#ifndef SHIFT_H
+#define SHIFT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// the four register shift flavours of the examples in main.c
+typedef enum {
+    SHIFT_PLAIN,                // vshlq
+    SHIFT_ROUNDING,             // vrshlq
+    SHIFT_SATURATING,           // vqshlq
+    SHIFT_SATURATING_ROUNDING   // vqrshlq
+} shift_mode;
+
+// out[i] = in[i] shifted left by shift bits (right for negative shift)
+void shift_u8(const uint8_t *in, size_t n, int shift, shift_mode mode, uint8_t *out);
+void shift_s8(const int8_t *in, size_t n, int shift, shift_mode mode, int8_t *out);
+void shift_u16(const uint16_t *in, size_t n, int shift, shift_mode mode, uint16_t *out);
+void shift_s16(const int16_t *in, size_t n, int shift, shift_mode mode, int16_t *out);
+void shift_u32(const uint32_t *in, size_t n, int shift, shift_mode mode, uint32_t *out);
+void shift_s32(const int32_t *in, size_t n, int shift, shift_mode mode, int32_t *out);
+
+// per element shift amounts, same semantics as above
+void shift_lanes_u8(const uint8_t *in, const int8_t *shifts, size_t n, shift_mode mode, uint8_t *out);
+void shift_lanes_s8(const int8_t *in, const int8_t *shifts, size_t n, shift_mode mode, int8_t *out);
+void shift_lanes_u16(const uint16_t *in, const int16_t *shifts, size_t n, shift_mode mode, uint16_t *out);
+void shift_lanes_s16(const int16_t *in, const int16_t *shifts, size_t n, shift_mode mode, int16_t *out);
+void shift_lanes_u32(const uint32_t *in, const int32_t *shifts, size_t n, shift_mode mode, uint32_t *out);
+void shift_lanes_s32(const int32_t *in, const int32_t *shifts, size_t n, shift_mode mode, int32_t *out);
+
+// acc[i] += in[i] >> shift (rounding like vrsraq_n if set), shift is
+// 1..8 / 1..16, returns 0 or -1 for an invalid shift
+int shift_right_accumulate_u8(uint8_t *acc, const uint8_t *in, size_t n, int shift, int rounding);
+int shift_right_accumulate_s16(int16_t *acc, const int16_t *in, size_t n, int shift, int rounding);
+
+// inserts in[i] << shift into dst[i], keeping its low shift bits (vsliq_n),
+// shift is 0..7 / 0..15, returns 0 or -1 for an invalid shift
+int shift_left_insert_u8(uint8_t *dst, const uint8_t *in, size_t n, int shift);
+int shift_left_insert_s16(int16_t *dst, const int16_t *in, size_t n, int shift);
+
+// inserts in[i] >> shift into dst[i], keeping its high shift bits (vsriq_n),
+// shift is 1..8 / 1..16, returns 0 or -1 for an invalid shift
+int shift_right_insert_u8(uint8_t *dst, const uint8_t *in, size_t n, int shift);
+int shift_right_insert_s16(int16_t *dst, const int16_t *in, size_t n, int shift);
+
+// rotates every element left by shift bits (any shift, taken modulo the
+// element width)
+void rotate_left_u8(const uint8_t *in, size_t n, int shift, uint8_t *out);
+void rotate_left_u16(const uint16_t *in, size_t n, int shift, uint16_t *out);
+
+#endif
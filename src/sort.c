@@ -0,0 +1,303 @@
+/* Sorting of 8/16/32-Bit unsigned integer keys with bitonic networks using
+ * ARM NEON
+ */
+
+#include <string.h>
+#include "arm_neon.h"
+#include "neon_alloc.h"
+#include "neon_util.h"
+#include "sort.h"
+#include "sortedset.h"
+
+static const uint8_t lane_index_u8[16] = {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15};
+static const uint16_t lane_index_u16[8] = {0,1,2,3,4,5,6,7};
+static const uint32_t lane_index_u32[4] = {0,1,2,3};
+
+
+// compare-exchange of every lane with its partner lane, the lanes set in
+// upper keep the maximum and the others the minimum
+// v: vector
+// bsl: bitwise select, upper ? max : min
+#define EXCHANGE(s, v, partner, upper) vbslq_##s(upper, vmaxq_##s(v, partner), vminq_##s(v, partner))
+
+// lanes whose index has bit 1, 2, 4 or 8 set: the upper lane of each pair
+// of partners that far apart
+// v: vector
+// tst: test bits, all ones if a & b is not zero
+#define MASKS(s) \
+    typedef struct { \
+        VECTOR_##s bit1, bit2, bit4, bit8; \
+    } masks_##s; \
+    \
+    static inline masks_##s get_masks_##s(void) { \
+        VECTOR_##s index = vld1q_##s(lane_index_##s); \
+        masks_##s m; \
+        \
+        m.bit1 = vtstq_##s(index, vdupq_n_##s(1)); \
+        m.bit2 = vtstq_##s(index, vdupq_n_##s(2)); \
+        m.bit4 = vtstq_##s(index, vdupq_n_##s(4)); \
+        m.bit8 = vtstq_##s(index, vdupq_n_##s(8)); \
+        return m; \
+    }
+
+MASKS(u8)
+MASKS(u16)
+MASKS(u32)
+
+
+// lane partners i ^ 1, i ^ 2, i ^ 4 and i ^ 8 (swapping neighbouring
+// groups of lanes) and mirrored lanes within groups of 4, 8 and 16 lanes
+// v: vector
+// rev16/32/64: reverse the lanes within each 16/32/64-bit group
+// ext: extract a vector from a pair of vectors starting at lane n, of the
+// same vector twice a rotation
+static inline uint8x16_t swap2_u8(uint8x16_t v) {
+    return vreinterpretq_u8_u16(vrev32q_u16(vreinterpretq_u16_u8(v)));
+}
+
+static inline uint8x16_t swap4_u8(uint8x16_t v) {
+    return vreinterpretq_u8_u32(vrev64q_u32(vreinterpretq_u32_u8(v)));
+}
+
+static inline uint8x16_t reverse_u8(uint8x16_t v) {
+    v = vrev64q_u8(v);
+    return vextq_u8(v, v, 8);
+}
+
+static inline uint16x8_t swap2_u16(uint16x8_t v) {
+    return vreinterpretq_u16_u32(vrev64q_u32(vreinterpretq_u32_u16(v)));
+}
+
+static inline uint16x8_t reverse_u16(uint16x8_t v) {
+    v = vrev64q_u16(v);
+    return vextq_u16(v, v, 4);
+}
+
+static inline uint32x4_t reverse_u32(uint32x4_t v) {
+    v = vrev64q_u32(v);
+    return vextq_u32(v, v, 2);
+}
+
+
+// bitonic sort of the lanes of one vector: for blocks of 2, 4, ... lanes
+// a mirrored compare-exchange, then exchanges at half the distance down to
+// neighbours
+static inline uint8x16_t sort_vector_u8(uint8x16_t v, const masks_u8 *m) {
+    v = EXCHANGE(u8, v, vrev16q_u8(v), m->bit1);
+
+    v = EXCHANGE(u8, v, vrev32q_u8(v), m->bit2);
+    v = EXCHANGE(u8, v, vrev16q_u8(v), m->bit1);
+
+    v = EXCHANGE(u8, v, vrev64q_u8(v), m->bit4);
+    v = EXCHANGE(u8, v, swap2_u8(v), m->bit2);
+    v = EXCHANGE(u8, v, vrev16q_u8(v), m->bit1);
+
+    v = EXCHANGE(u8, v, reverse_u8(v), m->bit8);
+    v = EXCHANGE(u8, v, swap4_u8(v), m->bit4);
+    v = EXCHANGE(u8, v, swap2_u8(v), m->bit2);
+    return EXCHANGE(u8, v, vrev16q_u8(v), m->bit1);
+}
+
+static inline uint16x8_t sort_vector_u16(uint16x8_t v, const masks_u16 *m) {
+    v = EXCHANGE(u16, v, vrev32q_u16(v), m->bit1);
+
+    v = EXCHANGE(u16, v, vrev64q_u16(v), m->bit2);
+    v = EXCHANGE(u16, v, vrev32q_u16(v), m->bit1);
+
+    v = EXCHANGE(u16, v, reverse_u16(v), m->bit4);
+    v = EXCHANGE(u16, v, swap2_u16(v), m->bit2);
+    return EXCHANGE(u16, v, vrev32q_u16(v), m->bit1);
+}
+
+static inline uint32x4_t sort_vector_u32(uint32x4_t v, const masks_u32 *m) {
+    v = EXCHANGE(u32, v, vrev64q_u32(v), m->bit1);
+
+    v = EXCHANGE(u32, v, reverse_u32(v), m->bit2);
+    return EXCHANGE(u32, v, vrev64q_u32(v), m->bit1);
+}
+
+
+// sorts a bitonic vector (rising then falling): half cleaners from half the
+// vector apart down to neighbours
+static inline uint8x16_t clean_u8(uint8x16_t v, const masks_u8 *m) {
+    v = EXCHANGE(u8, v, vextq_u8(v, v, 8), m->bit8);
+    v = EXCHANGE(u8, v, swap4_u8(v), m->bit4);
+    v = EXCHANGE(u8, v, swap2_u8(v), m->bit2);
+    return EXCHANGE(u8, v, vrev16q_u8(v), m->bit1);
+}
+
+static inline uint16x8_t clean_u16(uint16x8_t v, const masks_u16 *m) {
+    v = EXCHANGE(u16, v, vextq_u16(v, v, 4), m->bit4);
+    v = EXCHANGE(u16, v, swap2_u16(v), m->bit2);
+    return EXCHANGE(u16, v, vrev32q_u16(v), m->bit1);
+}
+
+static inline uint32x4_t clean_u32(uint32x4_t v, const masks_u32 *m) {
+    v = EXCHANGE(u32, v, vextq_u32(v, v, 2), m->bit2);
+    return EXCHANGE(u32, v, vrev64q_u32(v), m->bit1);
+}
+
+
+// block sort: four sorted vectors, merged pairwise into two runs of two
+// vectors, merged into one run. A bitonic merge reverses the second run,
+// takes the lane-wise minima and maxima (two bitonic halves, all minima
+// below all maxima) and cleans both halves.
+#define SORT_BLOCK(s) \
+    static inline void merge_vectors_##s(VECTOR_##s a, VECTOR_##s b, VECTOR_##s *low, VECTOR_##s *high, \
+                                         const masks_##s *m) { \
+        VECTOR_##s reversed = reverse_##s(b); \
+        \
+        *low = clean_##s(vminq_##s(a, reversed), m); \
+        *high = clean_##s(vmaxq_##s(a, reversed), m); \
+    } \
+    \
+    void sort_block_##s(TYPE_##s *keys) { \
+        masks_##s m = get_masks_##s(); \
+        VECTOR_##s a0, a1, b0, b1, r0, r1, l0, l1, h0, h1; \
+        \
+        merge_vectors_##s(sort_vector_##s(vld1q_##s(keys), &m), \
+                          sort_vector_##s(vld1q_##s(keys + LANES_##s), &m), &a0, &a1, &m); \
+        merge_vectors_##s(sort_vector_##s(vld1q_##s(keys + 2 * LANES_##s), &m), \
+                          sort_vector_##s(vld1q_##s(keys + 3 * LANES_##s), &m), &b0, &b1, &m); \
+        \
+        r0 = reverse_##s(b1); \
+        r1 = reverse_##s(b0); \
+        l0 = vminq_##s(a0, r0); \
+        l1 = vminq_##s(a1, r1); \
+        h0 = vmaxq_##s(a0, r0); \
+        h1 = vmaxq_##s(a1, r1); \
+        \
+        /* the halves span two vectors: one exchange a vector apart first */ \
+        vst1q_##s(keys, clean_##s(vminq_##s(l0, l1), &m)); \
+        vst1q_##s(keys + LANES_##s, clean_##s(vmaxq_##s(l0, l1), &m)); \
+        vst1q_##s(keys + 2 * LANES_##s, clean_##s(vminq_##s(h0, h1), &m)); \
+        vst1q_##s(keys + 3 * LANES_##s, clean_##s(vmaxq_##s(h0, h1), &m)); \
+    } \
+    \
+    /* sorts every block, a shorter last block padded with the largest key */ \
+    static void sort_blocks_##s(TYPE_##s *keys, size_t n) { \
+        TYPE_##s padded[4 * LANES_##s]; \
+        size_t i; \
+        \
+        for(i = 0; i + 4 * LANES_##s <= n; i += 4 * LANES_##s) { \
+            sort_block_##s(keys + i); \
+        } \
+        if(i < n) { \
+            memset(padded, 0xff, sizeof(padded)); \
+            memcpy(padded, keys + i, (n - i) * sizeof(TYPE_##s)); \
+            sort_block_##s(padded); \
+            memcpy(keys + i, padded, (n - i) * sizeof(TYPE_##s)); \
+        } \
+    }
+
+SORT_BLOCK(u8)
+SORT_BLOCK(u16)
+SORT_BLOCK(u32)
+
+
+void sort_u8(uint8_t *keys, size_t n) {
+    size_t counts[256] = {0};
+    size_t i;
+    unsigned v;
+
+    if(n <= SORT_BLOCK_U8) {
+        sort_blocks_u8(keys, n);
+        return;
+    }
+
+    // with 256 possible keys counting beats comparing
+    for(i = 0; i < n; i++) {
+        counts[keys[i]]++;
+    }
+    for(v = 0; v < 256; v++) {
+        memset(keys, (int)v, counts[v]);
+        keys += counts[v];
+    }
+}
+
+
+// sorted blocks, then rounds of merging neighbouring runs of twice the
+// length between keys and the scratch buffer
+#define SORT_ARRAY(s) \
+    int sort_##s(TYPE_##s *keys, size_t n) { \
+        TYPE_##s *scratch, *from = keys, *to, *swap; \
+        size_t width, i; \
+        \
+        if(n <= 4 * LANES_##s) { \
+            sort_blocks_##s(keys, n); \
+            return 0; \
+        } \
+        scratch = neon_alloc(n * sizeof(TYPE_##s)); \
+        if(scratch == NULL) { \
+            return -1; \
+        } \
+        \
+        sort_blocks_##s(keys, n); \
+        to = scratch; \
+        for(width = 4 * LANES_##s; width < n; width *= 2) { \
+            for(i = 0; i < n; i += 2 * width) { \
+                size_t middle = i + width < n ? i + width : n; \
+                size_t end = i + 2 * width < n ? i + 2 * width : n; \
+                \
+                sorted_merge_##s(from + i, middle - i, from + middle, end - middle, to + i); \
+            } \
+            swap = from; \
+            from = to; \
+            to = swap; \
+        } \
+        if(from != keys) { \
+            memcpy(keys, from, n * sizeof(TYPE_##s)); \
+        } \
+        \
+        neon_free(scratch); \
+        return 0; \
+    }
+
+SORT_ARRAY(u16)
+SORT_ARRAY(u32)
+
+
+// the k largest so far in ascending order; a sorted block is merged in only
+// if its largest key beats the smallest of them
+#define TOP_K(s) \
+    int sort_top_k_##s(const TYPE_##s *keys, size_t n, size_t k, TYPE_##s *out) { \
+        TYPE_##s block[4 * LANES_##s]; \
+        TYPE_##s *top, *merged; \
+        size_t kept = 0, i, j, count, total; \
+        \
+        k = k < n ? k : n; \
+        if(k == 0) { \
+            return 0; \
+        } \
+        top = neon_alloc((2 * k + 4 * LANES_##s) * sizeof(TYPE_##s)); \
+        if(top == NULL) { \
+            return -1; \
+        } \
+        merged = top + k; \
+        \
+        for(i = 0; i < n; i += count) { \
+            /* a shorter last block is padded with zeros, its keys end up \
+               as the last count after sorting */ \
+            count = n - i < 4 * LANES_##s ? n - i : 4 * LANES_##s; \
+            memset(block, 0, sizeof(block)); \
+            memcpy(block + 4 * LANES_##s - count, keys + i, count * sizeof(TYPE_##s)); \
+            sort_block_##s(block); \
+            \
+            if(kept == k && block[4 * LANES_##s - 1] <= top[0]) { \
+                continue; \
+            } \
+            total = sorted_merge_##s(top, kept, block + 4 * LANES_##s - count, count, merged); \
+            kept = total < k ? total : k; \
+            memcpy(top, merged + total - kept, kept * sizeof(TYPE_##s)); \
+        } \
+        \
+        for(j = 0; j < kept; j++) { \
+            out[j] = top[kept - 1 - j]; \
+        } \
+        \
+        neon_free(top); \
+        return 0; \
+    }
+
+TOP_K(u16)
+TOP_K(u32)
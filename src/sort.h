@@ -0,0 +1,40 @@
+/* Sorting of 8/16/32-Bit unsigned integer keys with bitonic networks using
+ * ARM NEON
+ *
+ * A block of four q registers (64 u8, 32 u16 or 16 u32 keys) is sorted in
+ * registers: each vector by a bitonic network of vminq/vmaxq steps whose
+ * lane partners come from vrev16/32/64 and vext shuffles, then the vectors
+ * are merged pairwise by bitonic merges (reverse, min/max, half cleaners).
+ * Longer arrays sort their blocks and merge the runs with sorted_merge_u16/
+ * sorted_merge_u32 (sortedset.h); 8-bit keys longer than a block are
+ * counted instead. Top-k selection sorts blocks and merges only those whose
+ * largest key beats the current k-th largest.
+ */
+
+#ifndef SORT_H
+#define SORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SORT_BLOCK_U8  64
+#define SORT_BLOCK_U16 32
+#define SORT_BLOCK_U32 16
+
+// sorts one block of keys ascending in place
+void sort_block_u8(uint8_t *keys);
+void sort_block_u16(uint16_t *keys);
+void sort_block_u32(uint32_t *keys);
+
+// sorts n keys ascending in place; the 16/32-bit versions return 0, -1 if
+// out of memory for the scratch buffer of n keys
+void sort_u8(uint8_t *keys, size_t n);
+int sort_u16(uint16_t *keys, size_t n);
+int sort_u32(uint32_t *keys, size_t n);
+
+// writes the min(k, n) largest keys to out, largest first; returns 0, -1 if
+// out of memory
+int sort_top_k_u16(const uint16_t *keys, size_t n, size_t k, uint16_t *out);
+int sort_top_k_u32(const uint32_t *keys, size_t n, size_t k, uint32_t *out);
+
+#endif
@@ -0,0 +1,427 @@
+/* Intersection, union, difference and merge of sorted arrays of 16/32-Bit
+ * unsigned integers using ARM NEON
+ */
+
+#include <string.h>
+#include "arm_neon.h"
+#include "neon_util.h"
+#include "sortedset.h"
+
+// galloping pays off once one input is this many times larger
+#define GALLOP_RATIO 32
+
+// packs the 32-bit lanes selected by a 4-bit mask (bit k: lane k) to the
+// front: output byte j takes input byte compact_u32[mask][j], 255 is out of
+// range and yields zero
+static const uint8_t compact_u32[16][16] = {
+    {255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255},
+    {0,1,2,3,255,255,255,255,255,255,255,255,255,255,255,255},
+    {4,5,6,7,255,255,255,255,255,255,255,255,255,255,255,255},
+    {0,1,2,3,4,5,6,7,255,255,255,255,255,255,255,255},
+    {8,9,10,11,255,255,255,255,255,255,255,255,255,255,255,255},
+    {0,1,2,3,8,9,10,11,255,255,255,255,255,255,255,255},
+    {4,5,6,7,8,9,10,11,255,255,255,255,255,255,255,255},
+    {0,1,2,3,4,5,6,7,8,9,10,11,255,255,255,255},
+    {12,13,14,15,255,255,255,255,255,255,255,255,255,255,255,255},
+    {0,1,2,3,12,13,14,15,255,255,255,255,255,255,255,255},
+    {4,5,6,7,12,13,14,15,255,255,255,255,255,255,255,255},
+    {0,1,2,3,4,5,6,7,12,13,14,15,255,255,255,255},
+    {8,9,10,11,12,13,14,15,255,255,255,255,255,255,255,255},
+    {0,1,2,3,8,9,10,11,12,13,14,15,255,255,255,255},
+    {4,5,6,7,8,9,10,11,12,13,14,15,255,255,255,255},
+    {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15},
+};
+
+// the same for the 4 16-bit lanes of a d register
+static const uint8_t compact_u16[16][8] = {
+    {255,255,255,255,255,255,255,255},
+    {0,1,255,255,255,255,255,255},
+    {2,3,255,255,255,255,255,255},
+    {0,1,2,3,255,255,255,255},
+    {4,5,255,255,255,255,255,255},
+    {0,1,4,5,255,255,255,255},
+    {2,3,4,5,255,255,255,255},
+    {0,1,2,3,4,5,255,255},
+    {6,7,255,255,255,255,255,255},
+    {0,1,6,7,255,255,255,255},
+    {2,3,6,7,255,255,255,255},
+    {0,1,2,3,6,7,255,255},
+    {4,5,6,7,255,255,255,255},
+    {0,1,4,5,6,7,255,255},
+    {2,3,4,5,6,7,255,255},
+    {0,1,2,3,4,5,6,7},
+};
+
+
+// lane k of a compare mask to bit k
+static inline unsigned lane_mask_u32(uint32x4_t mask) {
+    static const uint32_t weights[4] = {1, 2, 4, 8};
+    uint32x4_t t = vandq_u32(mask, vld1q_u32(weights));
+    uint32x2_t sum = vpadd_u32(vget_low_u32(t), vget_high_u32(t));
+
+    return vget_lane_u32(vpadd_u32(sum, sum), 0);
+}
+
+static inline unsigned lane_mask_u16(uint16x8_t mask) {
+    // v: vector
+    // movn: narrow, keeping the low half of each lane
+    uint8x8_t narrowed = vmovn_u16(mask);
+
+    return movemask_u8x16(vcombine_u8(narrowed, narrowed)) & 0xff;
+}
+
+
+// all ones in the lanes of a that equal any lane of b: a against every
+// rotation of b
+// v: vector
+// ceq: compare equal, all ones if true
+// ext: extract a vector from a pair of vectors starting at lane n, of the
+// same vector twice a rotation
+static inline uint32x4_t match_any_u32(uint32x4_t a, uint32x4_t b) {
+    uint32x4_t m0 = vceqq_u32(a, b);
+    uint32x4_t m1 = vceqq_u32(a, vextq_u32(b, b, 1));
+    uint32x4_t m2 = vceqq_u32(a, vextq_u32(b, b, 2));
+    uint32x4_t m3 = vceqq_u32(a, vextq_u32(b, b, 3));
+
+    return vorrq_u32(vorrq_u32(m0, m1), vorrq_u32(m2, m3));
+}
+
+static inline uint16x8_t match_any_u16(uint16x8_t a, uint16x8_t b) {
+    uint16x8_t m0 = vorrq_u16(vceqq_u16(a, b), vceqq_u16(a, vextq_u16(b, b, 1)));
+    uint16x8_t m1 = vorrq_u16(vceqq_u16(a, vextq_u16(b, b, 2)), vceqq_u16(a, vextq_u16(b, b, 3)));
+    uint16x8_t m2 = vorrq_u16(vceqq_u16(a, vextq_u16(b, b, 4)), vceqq_u16(a, vextq_u16(b, b, 5)));
+    uint16x8_t m3 = vorrq_u16(vceqq_u16(a, vextq_u16(b, b, 6)), vceqq_u16(a, vextq_u16(b, b, 7)));
+
+    return vorrq_u16(vorrq_u16(m0, m1), vorrq_u16(m2, m3));
+}
+
+
+// writes the lanes of v selected by keep to out, whole vectors only if
+// there is room for them; returns the number of lanes written
+static inline size_t store_kept_u32(uint32_t *out, uint32x4_t v, unsigned keep, size_t room) {
+    uint8x16_t bytes = vreinterpretq_u8_u32(v);
+    uint8x8x2_t table;
+    uint8x16_t packed;
+    size_t count = (size_t)__builtin_popcount(keep);
+
+    // v: vector
+    // tbl2: table lookup in two d registers (16 bytes)
+    table.val[0] = vget_low_u8(bytes);
+    table.val[1] = vget_high_u8(bytes);
+    packed = vcombine_u8(vtbl2_u8(table, vld1_u8(compact_u32[keep])),
+                         vtbl2_u8(table, vld1_u8(compact_u32[keep] + 8)));
+
+    if(room >= 4) {
+        vst1q_u8((uint8_t *)out, packed);
+    } else {
+        uint32_t kept[4];
+
+        vst1q_u8((uint8_t *)kept, packed);
+        memcpy(out, kept, count * sizeof(uint32_t));
+    }
+
+    return count;
+}
+
+static inline size_t store_kept_u16(uint16_t *out, uint16x8_t v, unsigned keep, size_t room) {
+    uint8x16_t bytes = vreinterpretq_u8_u16(v);
+    size_t count_low = (size_t)__builtin_popcount(keep & 15);
+    size_t count = (size_t)__builtin_popcount(keep);
+
+    // v: vector
+    // tbl1: table lookup in one d register, each half packed on its own
+    uint8x8_t low = vtbl1_u8(vget_low_u8(bytes), vld1_u8(compact_u16[keep & 15]));
+    uint8x8_t high = vtbl1_u8(vget_high_u8(bytes), vld1_u8(compact_u16[keep >> 4]));
+
+    if(room >= 8) {
+        vst1_u8((uint8_t *)out, low);
+        vst1_u8((uint8_t *)(out + count_low), high);
+    } else {
+        uint16_t kept[12];
+
+        vst1_u8((uint8_t *)kept, low);
+        vst1_u8((uint8_t *)(kept + count_low), high);
+        memcpy(out, kept, count * sizeof(uint16_t));
+    }
+
+    return count;
+}
+
+
+static inline uint32_t sum_lanes_u32(uint32x4_t v) {
+    uint32x2_t sum = vpadd_u32(vget_low_u32(v), vget_high_u32(v));
+
+    return vget_lane_u32(vpadd_u32(sum, sum), 0);
+}
+
+static inline uint32_t sum_lanes_u16(uint16x8_t v) {
+    // v: vector
+    // paddl: pairwise addition (long)
+    return sum_lanes_u32(vpaddlq_u16(v));
+}
+
+
+// min/max network on two sorted vectors: low gets the smaller, high the
+// larger half of their lanes, both sorted. Every round rotates the minima
+// by one lane against the maxima.
+// v: vector
+// min/max: lane-wise minimum and maximum
+#define MERGE_NETWORK(s) \
+    static inline void merge_network_##s(VECTOR_##s a, VECTOR_##s b, VECTOR_##s *low, VECTOR_##s *high) { \
+        VECTOR_##s l = vminq_##s(a, b), h = vmaxq_##s(a, b); \
+        int r; \
+        \
+        for(r = 1; r < LANES_##s; r++) { \
+            VECTOR_##s rotated = vextq_##s(l, l, 1); \
+            l = vminq_##s(rotated, h); \
+            h = vmaxq_##s(rotated, h); \
+        } \
+        *low = vextq_##s(l, l, 1); \
+        *high = h; \
+    }
+
+MERGE_NETWORK(u16)
+MERGE_NETWORK(u32)
+
+
+// galloping through the larger input: exponential then binary search, the
+// last 4 vectors by counting the lanes below x
+// v: vector
+// clt: compare less than, all ones (minus one) if true
+#define GALLOP(s) \
+    /* first position from start on with array[position] >= x, n if none */ \
+    static size_t gallop_##s(const TYPE_##s *array, size_t start, size_t n, TYPE_##s x) { \
+        size_t low = start, high, step = 1, middle, k; \
+        \
+        if(start >= n || array[start] >= x) { \
+            return start; \
+        } \
+        /* array[low] < x and array[high] >= x (or high == n) */ \
+        while(low + step < n && array[low + step] < x) { \
+            low += step; \
+            step *= 2; \
+        } \
+        high = low + step < n ? low + step : n; \
+        while(high - low > 4 * LANES_##s) { \
+            middle = low + (high - low) / 2; \
+            if(array[middle] < x) { \
+                low = middle; \
+            } else { \
+                high = middle; \
+            } \
+        } \
+        \
+        if(low + 1 + 4 * LANES_##s <= n) { \
+            VECTOR_##s vector_x = vdupq_n_##s(x); \
+            VECTOR_##s below = vdupq_n_##s(0); \
+            \
+            for(k = 0; k < 4; k++) { \
+                below = vsubq_##s(below, vcltq_##s(vld1q_##s(array + low + 1 + k * LANES_##s), vector_x)); \
+            } \
+            return low + 1 + sum_lanes_##s(below); \
+        } \
+        \
+        for(low++; low < high && array[low] < x; low++) { \
+        } \
+        return low; \
+    }
+
+GALLOP(u16)
+GALLOP(u32)
+
+
+// the set operations and the merge per lane type
+#define SORTEDSET(s) \
+    size_t sorted_intersect_##s(const TYPE_##s *a, size_t na, const TYPE_##s *b, size_t nb, TYPE_##s *out) { \
+        size_t room = na < nb ? na : nb; \
+        size_t i = 0, j = 0, n = 0; \
+        \
+        /* every value of the smaller input is looked up in the larger */ \
+        if(na > nb) { \
+            const TYPE_##s *t = a; \
+            a = b; \
+            b = t; \
+            i = na; \
+            na = nb; \
+            nb = i; \
+            i = 0; \
+        } \
+        if(na * GALLOP_RATIO < nb) { \
+            for(; i < na; i++) { \
+                j = gallop_##s(b, j, nb, a[i]); \
+                if(j == nb) { \
+                    break; \
+                } \
+                if(b[j] == a[i]) { \
+                    out[n++] = a[i]; \
+                    j++; \
+                } \
+            } \
+            return n; \
+        } \
+        \
+        /* a block of a against a block of b, then the block with the \
+           smaller last value (or both) moves on */ \
+        while(i + LANES_##s <= na && j + LANES_##s <= nb) { \
+            VECTOR_##s va = vld1q_##s(a + i); \
+            unsigned keep = lane_mask_##s(match_any_##s(va, vld1q_##s(b + j))); \
+            TYPE_##s last_a = a[i + LANES_##s - 1], last_b = b[j + LANES_##s - 1]; \
+            \
+            if(keep != 0) { \
+                n += store_kept_##s(out + n, va, keep, room - n); \
+            } \
+            i += last_a <= last_b ? LANES_##s : 0; \
+            j += last_b <= last_a ? LANES_##s : 0; \
+        } \
+        \
+        while(i < na && j < nb) { \
+            if(a[i] < b[j]) { \
+                i++; \
+            } else if(b[j] < a[i]) { \
+                j++; \
+            } else { \
+                out[n++] = a[i]; \
+                i++; \
+                j++; \
+            } \
+        } \
+        \
+        return n; \
+    } \
+    \
+    size_t sorted_difference_##s(const TYPE_##s *a, size_t na, const TYPE_##s *b, size_t nb, TYPE_##s *out) { \
+        size_t i = 0, j = 0, n = 0, k, end; \
+        unsigned found = 0; \
+        \
+        if(na * GALLOP_RATIO < nb) { \
+            for(; i < na; i++) { \
+                j = gallop_##s(b, j, nb, a[i]); \
+                if(j < nb && b[j] == a[i]) { \
+                    j++; \
+                } else { \
+                    out[n++] = a[i]; \
+                } \
+            } \
+            return n; \
+        } \
+        if(nb * GALLOP_RATIO < na) { \
+            /* copy the runs of a between the values of b */ \
+            for(; j < nb; j++) { \
+                end = gallop_##s(a, i, na, b[j]); \
+                memcpy(out + n, a + i, (end - i) * sizeof(TYPE_##s)); \
+                n += end - i; \
+                i = end < na && a[end] == b[j] ? end + 1 : end; \
+            } \
+            memcpy(out + n, a + i, (na - i) * sizeof(TYPE_##s)); \
+            return n + na - i; \
+        } \
+        \
+        /* found collects the lanes of the block of a seen in b until the \
+           block is done */ \
+        while(i + LANES_##s <= na && j + LANES_##s <= nb) { \
+            VECTOR_##s va = vld1q_##s(a + i); \
+            TYPE_##s last_a = a[i + LANES_##s - 1], last_b = b[j + LANES_##s - 1]; \
+            \
+            found |= lane_mask_##s(match_any_##s(va, vld1q_##s(b + j))); \
+            if(last_a <= last_b) { \
+                n += store_kept_##s(out + n, va, ~found & ((1u << LANES_##s) - 1), na - n); \
+                found = 0; \
+                i += LANES_##s; \
+            } \
+            j += last_b <= last_a ? LANES_##s : 0; \
+        } \
+        \
+        for(k = i; k < na; k++) { \
+            if(k - i < LANES_##s && (found >> (k - i) & 1)) { \
+                continue; \
+            } \
+            while(j < nb && b[j] < a[k]) { \
+                j++; \
+            } \
+            if(j < nb && b[j] == a[k]) { \
+                j++; \
+            } else { \
+                out[n++] = a[k]; \
+            } \
+        } \
+        \
+        return n; \
+    } \
+    \
+    /* union (unique set) or merge: the smaller half of the network goes \
+       out, the larger half is merged with the next block of the input \
+       whose next value is smaller */ \
+    static inline size_t merge_blocks_##s(const TYPE_##s *a, size_t na, const TYPE_##s *b, size_t nb, \
+                                          TYPE_##s *out, int unique) { \
+        TYPE_##s carry[LANES_##s]; \
+        size_t i = 0, j = 0, n = 0, c = LANES_##s; \
+        \
+        if(na >= LANES_##s && nb >= LANES_##s) { \
+            VECTOR_##s low, high, last; \
+            \
+            merge_network_##s(vld1q_##s(a), vld1q_##s(b), &low, &high); \
+            i = j = LANES_##s; \
+            /* differs from the first lane, nothing is dropped there */ \
+            last = vdupq_n_##s((TYPE_##s)(vgetq_lane_##s(low, 0) - 1)); \
+            \
+            for(;;) { \
+                if(unique) { \
+                    /* lanes equal to the lane before them, the first \
+                       lane compared with the last one written */ \
+                    unsigned duplicate = lane_mask_##s(vceqq_##s(low, vextq_##s(last, low, LANES_##s - 1))); \
+                    n += store_kept_##s(out + n, low, ~duplicate & ((1u << LANES_##s) - 1), na + nb - n); \
+                    last = low; \
+                } else { \
+                    vst1q_##s(out + n, low); \
+                    n += LANES_##s; \
+                } \
+                \
+                /* a partial block ends the vector loop, the values after \
+                   it could be smaller than the other block */ \
+                if(j == nb || (i < na && a[i] <= b[j])) { \
+                    if(i + LANES_##s > na) { \
+                        break; \
+                    } \
+                    merge_network_##s(vld1q_##s(a + i), high, &low, &high); \
+                    i += LANES_##s; \
+                } else { \
+                    if(j + LANES_##s > nb) { \
+                        break; \
+                    } \
+                    merge_network_##s(vld1q_##s(b + j), high, &low, &high); \
+                    j += LANES_##s; \
+                } \
+            } \
+            vst1q_##s(carry, high); \
+            c = 0; \
+        } \
+        \
+        /* the carried block and the rest of a and b */ \
+        while(c < LANES_##s || i < na || j < nb) { \
+            TYPE_##s v; \
+            \
+            if(c < LANES_##s && (i == na || carry[c] <= a[i]) && (j == nb || carry[c] <= b[j])) { \
+                v = carry[c++]; \
+            } else if(i < na && (j == nb || a[i] <= b[j])) { \
+                v = a[i++]; \
+            } else { \
+                v = b[j++]; \
+            } \
+            if(!unique || n == 0 || out[n - 1] != v) { \
+                out[n++] = v; \
+            } \
+        } \
+        \
+        return n; \
+    } \
+    \
+    size_t sorted_union_##s(const TYPE_##s *a, size_t na, const TYPE_##s *b, size_t nb, TYPE_##s *out) { \
+        return merge_blocks_##s(a, na, b, nb, out, 1); \
+    } \
+    \
+    size_t sorted_merge_##s(const TYPE_##s *a, size_t na, const TYPE_##s *b, size_t nb, TYPE_##s *out) { \
+        return merge_blocks_##s(a, na, b, nb, out, 0); \
+    }
+
+SORTEDSET(u16)
+SORTEDSET(u32)
@@ -0,0 +1,37 @@
+/* Intersection, union, difference and merge of sorted arrays of 16/32-Bit
+ * unsigned integers using ARM NEON
+ *
+ * Inputs are sorted ascending; for the set operations they hold no
+ * duplicates and the results are sorted sets again. Blocks of a are
+ * compared with all rotations (vextq) of a block of b by vceqq, the lanes
+ * to keep are packed with a vtbl shuffle. Union and merge run a min/max
+ * network on a block of each input and rotations of it, giving the smaller
+ * half of both sorted; the union drops lanes equal to their predecessor.
+ * Intersections and differences of arrays more than 32 times apart in size
+ * gallop through the larger one instead (exponential then binary search,
+ * finished by counting smaller lanes with vcltq).
+ *
+ * The functions return the number of values written to out, which needs
+ * room for min(na, nb) values (intersect), na (difference) or na + nb
+ * (union, merge) and must not overlap the inputs.
+ */
+
+#ifndef SORTEDSET_H
+#define SORTEDSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// intersect: values in a and in b, union: values in a or in b,
+// difference: values in a but not in b, merge: all values of a and b with
+// duplicates kept (the merge step of a merge sort)
+#define SORTEDSET_DECLARE(s, type) \
+    size_t sorted_intersect_##s(const type *a, size_t na, const type *b, size_t nb, type *out); \
+    size_t sorted_union_##s(const type *a, size_t na, const type *b, size_t nb, type *out); \
+    size_t sorted_difference_##s(const type *a, size_t na, const type *b, size_t nb, type *out); \
+    size_t sorted_merge_##s(const type *a, size_t na, const type *b, size_t nb, type *out);
+
+SORTEDSET_DECLARE(u16, uint16_t)
+SORTEDSET_DECLARE(u32, uint32_t)
+
+#endif
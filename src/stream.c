@@ -0,0 +1,63 @@
+/* Software prefetching and non-temporal stores for the streaming kernels
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include "stream.h"
+
+#define DEFAULT_L2_SIZE (512 * 1024)
+
+stream_config stream_settings = {256, DEFAULT_L2_SIZE, 2};
+
+
+static size_t sysfs_cache_size(const char *path) {
+    FILE *file = fopen(path, "r");
+    unsigned long size = 0;
+    char unit = 0;
+
+    if(file == NULL) {
+        return 0;
+    }
+    if(fscanf(file, "%lu%c", &size, &unit) < 1) {
+        size = 0;
+    }
+    fclose(file);
+
+    if(unit == 'K') {
+        size *= 1024;
+    } else if(unit == 'M') {
+        size *= 1024 * 1024;
+    }
+
+    return (size_t)size;
+}
+
+
+size_t stream_l2_cache_size(void) {
+    long size = -1;
+
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+    size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+    if(size > 0) {
+        return (size_t)size;
+    }
+
+    // index0/1 are the L1 data and instruction caches
+    return sysfs_cache_size("/sys/devices/system/cpu/cpu0/cache/index2/size");
+}
+
+
+void stream_init(void) {
+    size_t l2_size = stream_l2_cache_size();
+
+    if(l2_size == 0) {
+        l2_size = DEFAULT_L2_SIZE;
+    }
+
+    stream_settings.nontemporal_threshold = l2_size;
+
+    // larger caches usually come with longer memory latency and 64-byte
+    // lines, look further ahead there
+    stream_settings.prefetch_distance = l2_size >= 1024 * 1024 ? 512 : 256;
+}
@@ -0,0 +1,85 @@
+/* Software prefetching and non-temporal stores for the streaming kernels
+ *
+ * Kernels that walk large buffers prefetch stream_settings.prefetch_distance
+ * bytes ahead of their loads. Kernels whose input plus output is at least
+ * stream_settings.nontemporal_threshold bytes (by default the L2 size) no
+ * longer fit in the cache anyway and store their results around it.
+ *
+ * AArch64 has a non-temporal store pair (STNP). ARMv7-A has no streaming
+ * store hint, there the non-temporal path is a plain pair of stores and only
+ * the prefetching takes effect.
+ *
+ * Every streaming kernel prefetches (bswap, ascii, delta, the checksums,
+ * normalize, bitpack and the bit planes, rle, bitlen and varint lengths,
+ * streamvbyte and utf8). Only the kernels that write their output as whole
+ * 32-byte pairs at the input position store around the cache (bswap, ascii,
+ * bitplane_merge). The others store single q registers (delta, unpacking),
+ * write less than they read (packing, bit lengths, checksums, validation),
+ * scatter over several planes (normalize, bitplane_split), write at
+ * data-dependent offsets (rle, streamvbyte) or mix vector and scalar stores
+ * into the same lines (the utf8 transcoders), where a non-temporal store
+ * would evict a line that is about to be written again.
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arm_neon.h"
+
+typedef struct {
+    // bytes between the current load and the prefetched address, 0 disables
+    size_t prefetch_distance;
+    // buffers (input plus output bytes) at least this large bypass the
+    // cache on stores, 0 disables
+    size_t nontemporal_threshold;
+    // q registers loaded per loop iteration (1, 2 or 4) by the kernels with
+    // unrolled variants (bswap16_buf, bswap32_buf, bswap64_buf)
+    unsigned unroll;
+} stream_config;
+
+extern stream_config stream_settings;
+
+// L2 size in bytes from sysconf() or sysfs, 0 if unknown
+size_t stream_l2_cache_size(void);
+
+// derives the settings from the detected cache hierarchy, called once at
+// startup (the static defaults assume a 512 KiB L2)
+void stream_init(void);
+
+
+static inline void stream_prefetch(const void *ptr) {
+    __builtin_prefetch(ptr, 0, 0);
+}
+
+
+// prefetches distance bytes past ptr, nothing for a distance of 0
+static inline void stream_prefetch_ahead(const void *ptr, size_t distance) {
+    if(distance != 0) {
+        __builtin_prefetch((const uint8_t *)ptr + distance, 0, 0);
+    }
+}
+
+
+static inline int stream_nontemporal(size_t bytes) {
+    return stream_settings.nontemporal_threshold != 0 &&
+           bytes >= stream_settings.nontemporal_threshold;
+}
+
+
+// stores 32 bytes, around the cache if nontemporal is set
+static inline void stream_store_u8x16x2(uint8_t *ptr, uint8x16_t a, uint8x16_t b, int nontemporal) {
+#if defined(__aarch64__)
+    if(nontemporal) {
+        __asm__ volatile("stnp %q1, %q2, [%0]" : : "r"(ptr), "w"(a), "w"(b) : "memory");
+        return;
+    }
+#else
+    (void)nontemporal;
+#endif
+    vst1q_u8(ptr, a);
+    vst1q_u8(ptr + 16, b);
+}
+
+#endif
@@ -0,0 +1,681 @@
+/* StreamVByte coding of 32-Bit unsigned integers using ARM NEON
+ */
+
+#include <string.h>
+#include "arm_neon.h"
+#include "streamvbyte.h"
+#include "stream.h"
+
+// shuffle for decoding a group of 4 integers: output byte 4*k+j takes
+// data byte decode_shuffle[c][4*k+j], 255 is out of range and yields zero
+static const uint8_t decode_shuffle[256][16] = {
+    {0,255,255,255,1,255,255,255,2,255,255,255,3,255,255,255},
+    {0,1,255,255,2,255,255,255,3,255,255,255,4,255,255,255},
+    {0,1,2,255,3,255,255,255,4,255,255,255,5,255,255,255},
+    {0,1,2,3,4,255,255,255,5,255,255,255,6,255,255,255},
+    {0,255,255,255,1,2,255,255,3,255,255,255,4,255,255,255},
+    {0,1,255,255,2,3,255,255,4,255,255,255,5,255,255,255},
+    {0,1,2,255,3,4,255,255,5,255,255,255,6,255,255,255},
+    {0,1,2,3,4,5,255,255,6,255,255,255,7,255,255,255},
+    {0,255,255,255,1,2,3,255,4,255,255,255,5,255,255,255},
+    {0,1,255,255,2,3,4,255,5,255,255,255,6,255,255,255},
+    {0,1,2,255,3,4,5,255,6,255,255,255,7,255,255,255},
+    {0,1,2,3,4,5,6,255,7,255,255,255,8,255,255,255},
+    {0,255,255,255,1,2,3,4,5,255,255,255,6,255,255,255},
+    {0,1,255,255,2,3,4,5,6,255,255,255,7,255,255,255},
+    {0,1,2,255,3,4,5,6,7,255,255,255,8,255,255,255},
+    {0,1,2,3,4,5,6,7,8,255,255,255,9,255,255,255},
+    {0,255,255,255,1,255,255,255,2,3,255,255,4,255,255,255},
+    {0,1,255,255,2,255,255,255,3,4,255,255,5,255,255,255},
+    {0,1,2,255,3,255,255,255,4,5,255,255,6,255,255,255},
+    {0,1,2,3,4,255,255,255,5,6,255,255,7,255,255,255},
+    {0,255,255,255,1,2,255,255,3,4,255,255,5,255,255,255},
+    {0,1,255,255,2,3,255,255,4,5,255,255,6,255,255,255},
+    {0,1,2,255,3,4,255,255,5,6,255,255,7,255,255,255},
+    {0,1,2,3,4,5,255,255,6,7,255,255,8,255,255,255},
+    {0,255,255,255,1,2,3,255,4,5,255,255,6,255,255,255},
+    {0,1,255,255,2,3,4,255,5,6,255,255,7,255,255,255},
+    {0,1,2,255,3,4,5,255,6,7,255,255,8,255,255,255},
+    {0,1,2,3,4,5,6,255,7,8,255,255,9,255,255,255},
+    {0,255,255,255,1,2,3,4,5,6,255,255,7,255,255,255},
+    {0,1,255,255,2,3,4,5,6,7,255,255,8,255,255,255},
+    {0,1,2,255,3,4,5,6,7,8,255,255,9,255,255,255},
+    {0,1,2,3,4,5,6,7,8,9,255,255,10,255,255,255},
+    {0,255,255,255,1,255,255,255,2,3,4,255,5,255,255,255},
+    {0,1,255,255,2,255,255,255,3,4,5,255,6,255,255,255},
+    {0,1,2,255,3,255,255,255,4,5,6,255,7,255,255,255},
+    {0,1,2,3,4,255,255,255,5,6,7,255,8,255,255,255},
+    {0,255,255,255,1,2,255,255,3,4,5,255,6,255,255,255},
+    {0,1,255,255,2,3,255,255,4,5,6,255,7,255,255,255},
+    {0,1,2,255,3,4,255,255,5,6,7,255,8,255,255,255},
+    {0,1,2,3,4,5,255,255,6,7,8,255,9,255,255,255},
+    {0,255,255,255,1,2,3,255,4,5,6,255,7,255,255,255},
+    {0,1,255,255,2,3,4,255,5,6,7,255,8,255,255,255},
+    {0,1,2,255,3,4,5,255,6,7,8,255,9,255,255,255},
+    {0,1,2,3,4,5,6,255,7,8,9,255,10,255,255,255},
+    {0,255,255,255,1,2,3,4,5,6,7,255,8,255,255,255},
+    {0,1,255,255,2,3,4,5,6,7,8,255,9,255,255,255},
+    {0,1,2,255,3,4,5,6,7,8,9,255,10,255,255,255},
+    {0,1,2,3,4,5,6,7,8,9,10,255,11,255,255,255},
+    {0,255,255,255,1,255,255,255,2,3,4,5,6,255,255,255},
+    {0,1,255,255,2,255,255,255,3,4,5,6,7,255,255,255},
+    {0,1,2,255,3,255,255,255,4,5,6,7,8,255,255,255},
+    {0,1,2,3,4,255,255,255,5,6,7,8,9,255,255,255},
+    {0,255,255,255,1,2,255,255,3,4,5,6,7,255,255,255},
+    {0,1,255,255,2,3,255,255,4,5,6,7,8,255,255,255},
+    {0,1,2,255,3,4,255,255,5,6,7,8,9,255,255,255},
+    {0,1,2,3,4,5,255,255,6,7,8,9,10,255,255,255},
+    {0,255,255,255,1,2,3,255,4,5,6,7,8,255,255,255},
+    {0,1,255,255,2,3,4,255,5,6,7,8,9,255,255,255},
+    {0,1,2,255,3,4,5,255,6,7,8,9,10,255,255,255},
+    {0,1,2,3,4,5,6,255,7,8,9,10,11,255,255,255},
+    {0,255,255,255,1,2,3,4,5,6,7,8,9,255,255,255},
+    {0,1,255,255,2,3,4,5,6,7,8,9,10,255,255,255},
+    {0,1,2,255,3,4,5,6,7,8,9,10,11,255,255,255},
+    {0,1,2,3,4,5,6,7,8,9,10,11,12,255,255,255},
+    {0,255,255,255,1,255,255,255,2,255,255,255,3,4,255,255},
+    {0,1,255,255,2,255,255,255,3,255,255,255,4,5,255,255},
+    {0,1,2,255,3,255,255,255,4,255,255,255,5,6,255,255},
+    {0,1,2,3,4,255,255,255,5,255,255,255,6,7,255,255},
+    {0,255,255,255,1,2,255,255,3,255,255,255,4,5,255,255},
+    {0,1,255,255,2,3,255,255,4,255,255,255,5,6,255,255},
+    {0,1,2,255,3,4,255,255,5,255,255,255,6,7,255,255},
+    {0,1,2,3,4,5,255,255,6,255,255,255,7,8,255,255},
+    {0,255,255,255,1,2,3,255,4,255,255,255,5,6,255,255},
+    {0,1,255,255,2,3,4,255,5,255,255,255,6,7,255,255},
+    {0,1,2,255,3,4,5,255,6,255,255,255,7,8,255,255},
+    {0,1,2,3,4,5,6,255,7,255,255,255,8,9,255,255},
+    {0,255,255,255,1,2,3,4,5,255,255,255,6,7,255,255},
+    {0,1,255,255,2,3,4,5,6,255,255,255,7,8,255,255},
+    {0,1,2,255,3,4,5,6,7,255,255,255,8,9,255,255},
+    {0,1,2,3,4,5,6,7,8,255,255,255,9,10,255,255},
+    {0,255,255,255,1,255,255,255,2,3,255,255,4,5,255,255},
+    {0,1,255,255,2,255,255,255,3,4,255,255,5,6,255,255},
+    {0,1,2,255,3,255,255,255,4,5,255,255,6,7,255,255},
+    {0,1,2,3,4,255,255,255,5,6,255,255,7,8,255,255},
+    {0,255,255,255,1,2,255,255,3,4,255,255,5,6,255,255},
+    {0,1,255,255,2,3,255,255,4,5,255,255,6,7,255,255},
+    {0,1,2,255,3,4,255,255,5,6,255,255,7,8,255,255},
+    {0,1,2,3,4,5,255,255,6,7,255,255,8,9,255,255},
+    {0,255,255,255,1,2,3,255,4,5,255,255,6,7,255,255},
+    {0,1,255,255,2,3,4,255,5,6,255,255,7,8,255,255},
+    {0,1,2,255,3,4,5,255,6,7,255,255,8,9,255,255},
+    {0,1,2,3,4,5,6,255,7,8,255,255,9,10,255,255},
+    {0,255,255,255,1,2,3,4,5,6,255,255,7,8,255,255},
+    {0,1,255,255,2,3,4,5,6,7,255,255,8,9,255,255},
+    {0,1,2,255,3,4,5,6,7,8,255,255,9,10,255,255},
+    {0,1,2,3,4,5,6,7,8,9,255,255,10,11,255,255},
+    {0,255,255,255,1,255,255,255,2,3,4,255,5,6,255,255},
+    {0,1,255,255,2,255,255,255,3,4,5,255,6,7,255,255},
+    {0,1,2,255,3,255,255,255,4,5,6,255,7,8,255,255},
+    {0,1,2,3,4,255,255,255,5,6,7,255,8,9,255,255},
+    {0,255,255,255,1,2,255,255,3,4,5,255,6,7,255,255},
+    {0,1,255,255,2,3,255,255,4,5,6,255,7,8,255,255},
+    {0,1,2,255,3,4,255,255,5,6,7,255,8,9,255,255},
+    {0,1,2,3,4,5,255,255,6,7,8,255,9,10,255,255},
+    {0,255,255,255,1,2,3,255,4,5,6,255,7,8,255,255},
+    {0,1,255,255,2,3,4,255,5,6,7,255,8,9,255,255},
+    {0,1,2,255,3,4,5,255,6,7,8,255,9,10,255,255},
+    {0,1,2,3,4,5,6,255,7,8,9,255,10,11,255,255},
+    {0,255,255,255,1,2,3,4,5,6,7,255,8,9,255,255},
+    {0,1,255,255,2,3,4,5,6,7,8,255,9,10,255,255},
+    {0,1,2,255,3,4,5,6,7,8,9,255,10,11,255,255},
+    {0,1,2,3,4,5,6,7,8,9,10,255,11,12,255,255},
+    {0,255,255,255,1,255,255,255,2,3,4,5,6,7,255,255},
+    {0,1,255,255,2,255,255,255,3,4,5,6,7,8,255,255},
+    {0,1,2,255,3,255,255,255,4,5,6,7,8,9,255,255},
+    {0,1,2,3,4,255,255,255,5,6,7,8,9,10,255,255},
+    {0,255,255,255,1,2,255,255,3,4,5,6,7,8,255,255},
+    {0,1,255,255,2,3,255,255,4,5,6,7,8,9,255,255},
+    {0,1,2,255,3,4,255,255,5,6,7,8,9,10,255,255},
+    {0,1,2,3,4,5,255,255,6,7,8,9,10,11,255,255},
+    {0,255,255,255,1,2,3,255,4,5,6,7,8,9,255,255},
+    {0,1,255,255,2,3,4,255,5,6,7,8,9,10,255,255},
+    {0,1,2,255,3,4,5,255,6,7,8,9,10,11,255,255},
+    {0,1,2,3,4,5,6,255,7,8,9,10,11,12,255,255},
+    {0,255,255,255,1,2,3,4,5,6,7,8,9,10,255,255},
+    {0,1,255,255,2,3,4,5,6,7,8,9,10,11,255,255},
+    {0,1,2,255,3,4,5,6,7,8,9,10,11,12,255,255},
+    {0,1,2,3,4,5,6,7,8,9,10,11,12,13,255,255},
+    {0,255,255,255,1,255,255,255,2,255,255,255,3,4,5,255},
+    {0,1,255,255,2,255,255,255,3,255,255,255,4,5,6,255},
+    {0,1,2,255,3,255,255,255,4,255,255,255,5,6,7,255},
+    {0,1,2,3,4,255,255,255,5,255,255,255,6,7,8,255},
+    {0,255,255,255,1,2,255,255,3,255,255,255,4,5,6,255},
+    {0,1,255,255,2,3,255,255,4,255,255,255,5,6,7,255},
+    {0,1,2,255,3,4,255,255,5,255,255,255,6,7,8,255},
+    {0,1,2,3,4,5,255,255,6,255,255,255,7,8,9,255},
+    {0,255,255,255,1,2,3,255,4,255,255,255,5,6,7,255},
+    {0,1,255,255,2,3,4,255,5,255,255,255,6,7,8,255},
+    {0,1,2,255,3,4,5,255,6,255,255,255,7,8,9,255},
+    {0,1,2,3,4,5,6,255,7,255,255,255,8,9,10,255},
+    {0,255,255,255,1,2,3,4,5,255,255,255,6,7,8,255},
+    {0,1,255,255,2,3,4,5,6,255,255,255,7,8,9,255},
+    {0,1,2,255,3,4,5,6,7,255,255,255,8,9,10,255},
+    {0,1,2,3,4,5,6,7,8,255,255,255,9,10,11,255},
+    {0,255,255,255,1,255,255,255,2,3,255,255,4,5,6,255},
+    {0,1,255,255,2,255,255,255,3,4,255,255,5,6,7,255},
+    {0,1,2,255,3,255,255,255,4,5,255,255,6,7,8,255},
+    {0,1,2,3,4,255,255,255,5,6,255,255,7,8,9,255},
+    {0,255,255,255,1,2,255,255,3,4,255,255,5,6,7,255},
+    {0,1,255,255,2,3,255,255,4,5,255,255,6,7,8,255},
+    {0,1,2,255,3,4,255,255,5,6,255,255,7,8,9,255},
+    {0,1,2,3,4,5,255,255,6,7,255,255,8,9,10,255},
+    {0,255,255,255,1,2,3,255,4,5,255,255,6,7,8,255},
+    {0,1,255,255,2,3,4,255,5,6,255,255,7,8,9,255},
+    {0,1,2,255,3,4,5,255,6,7,255,255,8,9,10,255},
+    {0,1,2,3,4,5,6,255,7,8,255,255,9,10,11,255},
+    {0,255,255,255,1,2,3,4,5,6,255,255,7,8,9,255},
+    {0,1,255,255,2,3,4,5,6,7,255,255,8,9,10,255},
+    {0,1,2,255,3,4,5,6,7,8,255,255,9,10,11,255},
+    {0,1,2,3,4,5,6,7,8,9,255,255,10,11,12,255},
+    {0,255,255,255,1,255,255,255,2,3,4,255,5,6,7,255},
+    {0,1,255,255,2,255,255,255,3,4,5,255,6,7,8,255},
+    {0,1,2,255,3,255,255,255,4,5,6,255,7,8,9,255},
+    {0,1,2,3,4,255,255,255,5,6,7,255,8,9,10,255},
+    {0,255,255,255,1,2,255,255,3,4,5,255,6,7,8,255},
+    {0,1,255,255,2,3,255,255,4,5,6,255,7,8,9,255},
+    {0,1,2,255,3,4,255,255,5,6,7,255,8,9,10,255},
+    {0,1,2,3,4,5,255,255,6,7,8,255,9,10,11,255},
+    {0,255,255,255,1,2,3,255,4,5,6,255,7,8,9,255},
+    {0,1,255,255,2,3,4,255,5,6,7,255,8,9,10,255},
+    {0,1,2,255,3,4,5,255,6,7,8,255,9,10,11,255},
+    {0,1,2,3,4,5,6,255,7,8,9,255,10,11,12,255},
+    {0,255,255,255,1,2,3,4,5,6,7,255,8,9,10,255},
+    {0,1,255,255,2,3,4,5,6,7,8,255,9,10,11,255},
+    {0,1,2,255,3,4,5,6,7,8,9,255,10,11,12,255},
+    {0,1,2,3,4,5,6,7,8,9,10,255,11,12,13,255},
+    {0,255,255,255,1,255,255,255,2,3,4,5,6,7,8,255},
+    {0,1,255,255,2,255,255,255,3,4,5,6,7,8,9,255},
+    {0,1,2,255,3,255,255,255,4,5,6,7,8,9,10,255},
+    {0,1,2,3,4,255,255,255,5,6,7,8,9,10,11,255},
+    {0,255,255,255,1,2,255,255,3,4,5,6,7,8,9,255},
+    {0,1,255,255,2,3,255,255,4,5,6,7,8,9,10,255},
+    {0,1,2,255,3,4,255,255,5,6,7,8,9,10,11,255},
+    {0,1,2,3,4,5,255,255,6,7,8,9,10,11,12,255},
+    {0,255,255,255,1,2,3,255,4,5,6,7,8,9,10,255},
+    {0,1,255,255,2,3,4,255,5,6,7,8,9,10,11,255},
+    {0,1,2,255,3,4,5,255,6,7,8,9,10,11,12,255},
+    {0,1,2,3,4,5,6,255,7,8,9,10,11,12,13,255},
+    {0,255,255,255,1,2,3,4,5,6,7,8,9,10,11,255},
+    {0,1,255,255,2,3,4,5,6,7,8,9,10,11,12,255},
+    {0,1,2,255,3,4,5,6,7,8,9,10,11,12,13,255},
+    {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,255},
+    {0,255,255,255,1,255,255,255,2,255,255,255,3,4,5,6},
+    {0,1,255,255,2,255,255,255,3,255,255,255,4,5,6,7},
+    {0,1,2,255,3,255,255,255,4,255,255,255,5,6,7,8},
+    {0,1,2,3,4,255,255,255,5,255,255,255,6,7,8,9},
+    {0,255,255,255,1,2,255,255,3,255,255,255,4,5,6,7},
+    {0,1,255,255,2,3,255,255,4,255,255,255,5,6,7,8},
+    {0,1,2,255,3,4,255,255,5,255,255,255,6,7,8,9},
+    {0,1,2,3,4,5,255,255,6,255,255,255,7,8,9,10},
+    {0,255,255,255,1,2,3,255,4,255,255,255,5,6,7,8},
+    {0,1,255,255,2,3,4,255,5,255,255,255,6,7,8,9},
+    {0,1,2,255,3,4,5,255,6,255,255,255,7,8,9,10},
+    {0,1,2,3,4,5,6,255,7,255,255,255,8,9,10,11},
+    {0,255,255,255,1,2,3,4,5,255,255,255,6,7,8,9},
+    {0,1,255,255,2,3,4,5,6,255,255,255,7,8,9,10},
+    {0,1,2,255,3,4,5,6,7,255,255,255,8,9,10,11},
+    {0,1,2,3,4,5,6,7,8,255,255,255,9,10,11,12},
+    {0,255,255,255,1,255,255,255,2,3,255,255,4,5,6,7},
+    {0,1,255,255,2,255,255,255,3,4,255,255,5,6,7,8},
+    {0,1,2,255,3,255,255,255,4,5,255,255,6,7,8,9},
+    {0,1,2,3,4,255,255,255,5,6,255,255,7,8,9,10},
+    {0,255,255,255,1,2,255,255,3,4,255,255,5,6,7,8},
+    {0,1,255,255,2,3,255,255,4,5,255,255,6,7,8,9},
+    {0,1,2,255,3,4,255,255,5,6,255,255,7,8,9,10},
+    {0,1,2,3,4,5,255,255,6,7,255,255,8,9,10,11},
+    {0,255,255,255,1,2,3,255,4,5,255,255,6,7,8,9},
+    {0,1,255,255,2,3,4,255,5,6,255,255,7,8,9,10},
+    {0,1,2,255,3,4,5,255,6,7,255,255,8,9,10,11},
+    {0,1,2,3,4,5,6,255,7,8,255,255,9,10,11,12},
+    {0,255,255,255,1,2,3,4,5,6,255,255,7,8,9,10},
+    {0,1,255,255,2,3,4,5,6,7,255,255,8,9,10,11},
+    {0,1,2,255,3,4,5,6,7,8,255,255,9,10,11,12},
+    {0,1,2,3,4,5,6,7,8,9,255,255,10,11,12,13},
+    {0,255,255,255,1,255,255,255,2,3,4,255,5,6,7,8},
+    {0,1,255,255,2,255,255,255,3,4,5,255,6,7,8,9},
+    {0,1,2,255,3,255,255,255,4,5,6,255,7,8,9,10},
+    {0,1,2,3,4,255,255,255,5,6,7,255,8,9,10,11},
+    {0,255,255,255,1,2,255,255,3,4,5,255,6,7,8,9},
+    {0,1,255,255,2,3,255,255,4,5,6,255,7,8,9,10},
+    {0,1,2,255,3,4,255,255,5,6,7,255,8,9,10,11},
+    {0,1,2,3,4,5,255,255,6,7,8,255,9,10,11,12},
+    {0,255,255,255,1,2,3,255,4,5,6,255,7,8,9,10},
+    {0,1,255,255,2,3,4,255,5,6,7,255,8,9,10,11},
+    {0,1,2,255,3,4,5,255,6,7,8,255,9,10,11,12},
+    {0,1,2,3,4,5,6,255,7,8,9,255,10,11,12,13},
+    {0,255,255,255,1,2,3,4,5,6,7,255,8,9,10,11},
+    {0,1,255,255,2,3,4,5,6,7,8,255,9,10,11,12},
+    {0,1,2,255,3,4,5,6,7,8,9,255,10,11,12,13},
+    {0,1,2,3,4,5,6,7,8,9,10,255,11,12,13,14},
+    {0,255,255,255,1,255,255,255,2,3,4,5,6,7,8,9},
+    {0,1,255,255,2,255,255,255,3,4,5,6,7,8,9,10},
+    {0,1,2,255,3,255,255,255,4,5,6,7,8,9,10,11},
+    {0,1,2,3,4,255,255,255,5,6,7,8,9,10,11,12},
+    {0,255,255,255,1,2,255,255,3,4,5,6,7,8,9,10},
+    {0,1,255,255,2,3,255,255,4,5,6,7,8,9,10,11},
+    {0,1,2,255,3,4,255,255,5,6,7,8,9,10,11,12},
+    {0,1,2,3,4,5,255,255,6,7,8,9,10,11,12,13},
+    {0,255,255,255,1,2,3,255,4,5,6,7,8,9,10,11},
+    {0,1,255,255,2,3,4,255,5,6,7,8,9,10,11,12},
+    {0,1,2,255,3,4,5,255,6,7,8,9,10,11,12,13},
+    {0,1,2,3,4,5,6,255,7,8,9,10,11,12,13,14},
+    {0,255,255,255,1,2,3,4,5,6,7,8,9,10,11,12},
+    {0,1,255,255,2,3,4,5,6,7,8,9,10,11,12,13},
+    {0,1,2,255,3,4,5,6,7,8,9,10,11,12,13,14},
+    {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15}
+};
+
+// shuffle for encoding: data byte j takes byte encode_shuffle[c][j] of the
+// 4 input integers, bytes beyond the group length are don't care
+static const uint8_t encode_shuffle[256][16] = {
+    {0,4,8,12,255,255,255,255,255,255,255,255,255,255,255,255},
+    {0,1,4,8,12,255,255,255,255,255,255,255,255,255,255,255},
+    {0,1,2,4,8,12,255,255,255,255,255,255,255,255,255,255},
+    {0,1,2,3,4,8,12,255,255,255,255,255,255,255,255,255},
+    {0,4,5,8,12,255,255,255,255,255,255,255,255,255,255,255},
+    {0,1,4,5,8,12,255,255,255,255,255,255,255,255,255,255},
+    {0,1,2,4,5,8,12,255,255,255,255,255,255,255,255,255},
+    {0,1,2,3,4,5,8,12,255,255,255,255,255,255,255,255},
+    {0,4,5,6,8,12,255,255,255,255,255,255,255,255,255,255},
+    {0,1,4,5,6,8,12,255,255,255,255,255,255,255,255,255},
+    {0,1,2,4,5,6,8,12,255,255,255,255,255,255,255,255},
+    {0,1,2,3,4,5,6,8,12,255,255,255,255,255,255,255},
+    {0,4,5,6,7,8,12,255,255,255,255,255,255,255,255,255},
+    {0,1,4,5,6,7,8,12,255,255,255,255,255,255,255,255},
+    {0,1,2,4,5,6,7,8,12,255,255,255,255,255,255,255},
+    {0,1,2,3,4,5,6,7,8,12,255,255,255,255,255,255},
+    {0,4,8,9,12,255,255,255,255,255,255,255,255,255,255,255},
+    {0,1,4,8,9,12,255,255,255,255,255,255,255,255,255,255},
+    {0,1,2,4,8,9,12,255,255,255,255,255,255,255,255,255},
+    {0,1,2,3,4,8,9,12,255,255,255,255,255,255,255,255},
+    {0,4,5,8,9,12,255,255,255,255,255,255,255,255,255,255},
+    {0,1,4,5,8,9,12,255,255,255,255,255,255,255,255,255},
+    {0,1,2,4,5,8,9,12,255,255,255,255,255,255,255,255},
+    {0,1,2,3,4,5,8,9,12,255,255,255,255,255,255,255},
+    {0,4,5,6,8,9,12,255,255,255,255,255,255,255,255,255},
+    {0,1,4,5,6,8,9,12,255,255,255,255,255,255,255,255},
+    {0,1,2,4,5,6,8,9,12,255,255,255,255,255,255,255},
+    {0,1,2,3,4,5,6,8,9,12,255,255,255,255,255,255},
+    {0,4,5,6,7,8,9,12,255,255,255,255,255,255,255,255},
+    {0,1,4,5,6,7,8,9,12,255,255,255,255,255,255,255},
+    {0,1,2,4,5,6,7,8,9,12,255,255,255,255,255,255},
+    {0,1,2,3,4,5,6,7,8,9,12,255,255,255,255,255},
+    {0,4,8,9,10,12,255,255,255,255,255,255,255,255,255,255},
+    {0,1,4,8,9,10,12,255,255,255,255,255,255,255,255,255},
+    {0,1,2,4,8,9,10,12,255,255,255,255,255,255,255,255},
+    {0,1,2,3,4,8,9,10,12,255,255,255,255,255,255,255},
+    {0,4,5,8,9,10,12,255,255,255,255,255,255,255,255,255},
+    {0,1,4,5,8,9,10,12,255,255,255,255,255,255,255,255},
+    {0,1,2,4,5,8,9,10,12,255,255,255,255,255,255,255},
+    {0,1,2,3,4,5,8,9,10,12,255,255,255,255,255,255},
+    {0,4,5,6,8,9,10,12,255,255,255,255,255,255,255,255},
+    {0,1,4,5,6,8,9,10,12,255,255,255,255,255,255,255},
+    {0,1,2,4,5,6,8,9,10,12,255,255,255,255,255,255},
+    {0,1,2,3,4,5,6,8,9,10,12,255,255,255,255,255},
+    {0,4,5,6,7,8,9,10,12,255,255,255,255,255,255,255},
+    {0,1,4,5,6,7,8,9,10,12,255,255,255,255,255,255},
+    {0,1,2,4,5,6,7,8,9,10,12,255,255,255,255,255},
+    {0,1,2,3,4,5,6,7,8,9,10,12,255,255,255,255},
+    {0,4,8,9,10,11,12,255,255,255,255,255,255,255,255,255},
+    {0,1,4,8,9,10,11,12,255,255,255,255,255,255,255,255},
+    {0,1,2,4,8,9,10,11,12,255,255,255,255,255,255,255},
+    {0,1,2,3,4,8,9,10,11,12,255,255,255,255,255,255},
+    {0,4,5,8,9,10,11,12,255,255,255,255,255,255,255,255},
+    {0,1,4,5,8,9,10,11,12,255,255,255,255,255,255,255},
+    {0,1,2,4,5,8,9,10,11,12,255,255,255,255,255,255},
+    {0,1,2,3,4,5,8,9,10,11,12,255,255,255,255,255},
+    {0,4,5,6,8,9,10,11,12,255,255,255,255,255,255,255},
+    {0,1,4,5,6,8,9,10,11,12,255,255,255,255,255,255},
+    {0,1,2,4,5,6,8,9,10,11,12,255,255,255,255,255},
+    {0,1,2,3,4,5,6,8,9,10,11,12,255,255,255,255},
+    {0,4,5,6,7,8,9,10,11,12,255,255,255,255,255,255},
+    {0,1,4,5,6,7,8,9,10,11,12,255,255,255,255,255},
+    {0,1,2,4,5,6,7,8,9,10,11,12,255,255,255,255},
+    {0,1,2,3,4,5,6,7,8,9,10,11,12,255,255,255},
+    {0,4,8,12,13,255,255,255,255,255,255,255,255,255,255,255},
+    {0,1,4,8,12,13,255,255,255,255,255,255,255,255,255,255},
+    {0,1,2,4,8,12,13,255,255,255,255,255,255,255,255,255},
+    {0,1,2,3,4,8,12,13,255,255,255,255,255,255,255,255},
+    {0,4,5,8,12,13,255,255,255,255,255,255,255,255,255,255},
+    {0,1,4,5,8,12,13,255,255,255,255,255,255,255,255,255},
+    {0,1,2,4,5,8,12,13,255,255,255,255,255,255,255,255},
+    {0,1,2,3,4,5,8,12,13,255,255,255,255,255,255,255},
+    {0,4,5,6,8,12,13,255,255,255,255,255,255,255,255,255},
+    {0,1,4,5,6,8,12,13,255,255,255,255,255,255,255,255},
+    {0,1,2,4,5,6,8,12,13,255,255,255,255,255,255,255},
+    {0,1,2,3,4,5,6,8,12,13,255,255,255,255,255,255},
+    {0,4,5,6,7,8,12,13,255,255,255,255,255,255,255,255},
+    {0,1,4,5,6,7,8,12,13,255,255,255,255,255,255,255},
+    {0,1,2,4,5,6,7,8,12,13,255,255,255,255,255,255},
+    {0,1,2,3,4,5,6,7,8,12,13,255,255,255,255,255},
+    {0,4,8,9,12,13,255,255,255,255,255,255,255,255,255,255},
+    {0,1,4,8,9,12,13,255,255,255,255,255,255,255,255,255},
+    {0,1,2,4,8,9,12,13,255,255,255,255,255,255,255,255},
+    {0,1,2,3,4,8,9,12,13,255,255,255,255,255,255,255},
+    {0,4,5,8,9,12,13,255,255,255,255,255,255,255,255,255},
+    {0,1,4,5,8,9,12,13,255,255,255,255,255,255,255,255},
+    {0,1,2,4,5,8,9,12,13,255,255,255,255,255,255,255},
+    {0,1,2,3,4,5,8,9,12,13,255,255,255,255,255,255},
+    {0,4,5,6,8,9,12,13,255,255,255,255,255,255,255,255},
+    {0,1,4,5,6,8,9,12,13,255,255,255,255,255,255,255},
+    {0,1,2,4,5,6,8,9,12,13,255,255,255,255,255,255},
+    {0,1,2,3,4,5,6,8,9,12,13,255,255,255,255,255},
+    {0,4,5,6,7,8,9,12,13,255,255,255,255,255,255,255},
+    {0,1,4,5,6,7,8,9,12,13,255,255,255,255,255,255},
+    {0,1,2,4,5,6,7,8,9,12,13,255,255,255,255,255},
+    {0,1,2,3,4,5,6,7,8,9,12,13,255,255,255,255},
+    {0,4,8,9,10,12,13,255,255,255,255,255,255,255,255,255},
+    {0,1,4,8,9,10,12,13,255,255,255,255,255,255,255,255},
+    {0,1,2,4,8,9,10,12,13,255,255,255,255,255,255,255},
+    {0,1,2,3,4,8,9,10,12,13,255,255,255,255,255,255},
+    {0,4,5,8,9,10,12,13,255,255,255,255,255,255,255,255},
+    {0,1,4,5,8,9,10,12,13,255,255,255,255,255,255,255},
+    {0,1,2,4,5,8,9,10,12,13,255,255,255,255,255,255},
+    {0,1,2,3,4,5,8,9,10,12,13,255,255,255,255,255},
+    {0,4,5,6,8,9,10,12,13,255,255,255,255,255,255,255},
+    {0,1,4,5,6,8,9,10,12,13,255,255,255,255,255,255},
+    {0,1,2,4,5,6,8,9,10,12,13,255,255,255,255,255},
+    {0,1,2,3,4,5,6,8,9,10,12,13,255,255,255,255},
+    {0,4,5,6,7,8,9,10,12,13,255,255,255,255,255,255},
+    {0,1,4,5,6,7,8,9,10,12,13,255,255,255,255,255},
+    {0,1,2,4,5,6,7,8,9,10,12,13,255,255,255,255},
+    {0,1,2,3,4,5,6,7,8,9,10,12,13,255,255,255},
+    {0,4,8,9,10,11,12,13,255,255,255,255,255,255,255,255},
+    {0,1,4,8,9,10,11,12,13,255,255,255,255,255,255,255},
+    {0,1,2,4,8,9,10,11,12,13,255,255,255,255,255,255},
+    {0,1,2,3,4,8,9,10,11,12,13,255,255,255,255,255},
+    {0,4,5,8,9,10,11,12,13,255,255,255,255,255,255,255},
+    {0,1,4,5,8,9,10,11,12,13,255,255,255,255,255,255},
+    {0,1,2,4,5,8,9,10,11,12,13,255,255,255,255,255},
+    {0,1,2,3,4,5,8,9,10,11,12,13,255,255,255,255},
+    {0,4,5,6,8,9,10,11,12,13,255,255,255,255,255,255},
+    {0,1,4,5,6,8,9,10,11,12,13,255,255,255,255,255},
+    {0,1,2,4,5,6,8,9,10,11,12,13,255,255,255,255},
+    {0,1,2,3,4,5,6,8,9,10,11,12,13,255,255,255},
+    {0,4,5,6,7,8,9,10,11,12,13,255,255,255,255,255},
+    {0,1,4,5,6,7,8,9,10,11,12,13,255,255,255,255},
+    {0,1,2,4,5,6,7,8,9,10,11,12,13,255,255,255},
+    {0,1,2,3,4,5,6,7,8,9,10,11,12,13,255,255},
+    {0,4,8,12,13,14,255,255,255,255,255,255,255,255,255,255},
+    {0,1,4,8,12,13,14,255,255,255,255,255,255,255,255,255},
+    {0,1,2,4,8,12,13,14,255,255,255,255,255,255,255,255},
+    {0,1,2,3,4,8,12,13,14,255,255,255,255,255,255,255},
+    {0,4,5,8,12,13,14,255,255,255,255,255,255,255,255,255},
+    {0,1,4,5,8,12,13,14,255,255,255,255,255,255,255,255},
+    {0,1,2,4,5,8,12,13,14,255,255,255,255,255,255,255},
+    {0,1,2,3,4,5,8,12,13,14,255,255,255,255,255,255},
+    {0,4,5,6,8,12,13,14,255,255,255,255,255,255,255,255},
+    {0,1,4,5,6,8,12,13,14,255,255,255,255,255,255,255},
+    {0,1,2,4,5,6,8,12,13,14,255,255,255,255,255,255},
+    {0,1,2,3,4,5,6,8,12,13,14,255,255,255,255,255},
+    {0,4,5,6,7,8,12,13,14,255,255,255,255,255,255,255},
+    {0,1,4,5,6,7,8,12,13,14,255,255,255,255,255,255},
+    {0,1,2,4,5,6,7,8,12,13,14,255,255,255,255,255},
+    {0,1,2,3,4,5,6,7,8,12,13,14,255,255,255,255},
+    {0,4,8,9,12,13,14,255,255,255,255,255,255,255,255,255},
+    {0,1,4,8,9,12,13,14,255,255,255,255,255,255,255,255},
+    {0,1,2,4,8,9,12,13,14,255,255,255,255,255,255,255},
+    {0,1,2,3,4,8,9,12,13,14,255,255,255,255,255,255},
+    {0,4,5,8,9,12,13,14,255,255,255,255,255,255,255,255},
+    {0,1,4,5,8,9,12,13,14,255,255,255,255,255,255,255},
+    {0,1,2,4,5,8,9,12,13,14,255,255,255,255,255,255},
+    {0,1,2,3,4,5,8,9,12,13,14,255,255,255,255,255},
+    {0,4,5,6,8,9,12,13,14,255,255,255,255,255,255,255},
+    {0,1,4,5,6,8,9,12,13,14,255,255,255,255,255,255},
+    {0,1,2,4,5,6,8,9,12,13,14,255,255,255,255,255},
+    {0,1,2,3,4,5,6,8,9,12,13,14,255,255,255,255},
+    {0,4,5,6,7,8,9,12,13,14,255,255,255,255,255,255},
+    {0,1,4,5,6,7,8,9,12,13,14,255,255,255,255,255},
+    {0,1,2,4,5,6,7,8,9,12,13,14,255,255,255,255},
+    {0,1,2,3,4,5,6,7,8,9,12,13,14,255,255,255},
+    {0,4,8,9,10,12,13,14,255,255,255,255,255,255,255,255},
+    {0,1,4,8,9,10,12,13,14,255,255,255,255,255,255,255},
+    {0,1,2,4,8,9,10,12,13,14,255,255,255,255,255,255},
+    {0,1,2,3,4,8,9,10,12,13,14,255,255,255,255,255},
+    {0,4,5,8,9,10,12,13,14,255,255,255,255,255,255,255},
+    {0,1,4,5,8,9,10,12,13,14,255,255,255,255,255,255},
+    {0,1,2,4,5,8,9,10,12,13,14,255,255,255,255,255},
+    {0,1,2,3,4,5,8,9,10,12,13,14,255,255,255,255},
+    {0,4,5,6,8,9,10,12,13,14,255,255,255,255,255,255},
+    {0,1,4,5,6,8,9,10,12,13,14,255,255,255,255,255},
+    {0,1,2,4,5,6,8,9,10,12,13,14,255,255,255,255},
+    {0,1,2,3,4,5,6,8,9,10,12,13,14,255,255,255},
+    {0,4,5,6,7,8,9,10,12,13,14,255,255,255,255,255},
+    {0,1,4,5,6,7,8,9,10,12,13,14,255,255,255,255},
+    {0,1,2,4,5,6,7,8,9,10,12,13,14,255,255,255},
+    {0,1,2,3,4,5,6,7,8,9,10,12,13,14,255,255},
+    {0,4,8,9,10,11,12,13,14,255,255,255,255,255,255,255},
+    {0,1,4,8,9,10,11,12,13,14,255,255,255,255,255,255},
+    {0,1,2,4,8,9,10,11,12,13,14,255,255,255,255,255},
+    {0,1,2,3,4,8,9,10,11,12,13,14,255,255,255,255},
+    {0,4,5,8,9,10,11,12,13,14,255,255,255,255,255,255},
+    {0,1,4,5,8,9,10,11,12,13,14,255,255,255,255,255},
+    {0,1,2,4,5,8,9,10,11,12,13,14,255,255,255,255},
+    {0,1,2,3,4,5,8,9,10,11,12,13,14,255,255,255},
+    {0,4,5,6,8,9,10,11,12,13,14,255,255,255,255,255},
+    {0,1,4,5,6,8,9,10,11,12,13,14,255,255,255,255},
+    {0,1,2,4,5,6,8,9,10,11,12,13,14,255,255,255},
+    {0,1,2,3,4,5,6,8,9,10,11,12,13,14,255,255},
+    {0,4,5,6,7,8,9,10,11,12,13,14,255,255,255,255},
+    {0,1,4,5,6,7,8,9,10,11,12,13,14,255,255,255},
+    {0,1,2,4,5,6,7,8,9,10,11,12,13,14,255,255},
+    {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,255},
+    {0,4,8,12,13,14,15,255,255,255,255,255,255,255,255,255},
+    {0,1,4,8,12,13,14,15,255,255,255,255,255,255,255,255},
+    {0,1,2,4,8,12,13,14,15,255,255,255,255,255,255,255},
+    {0,1,2,3,4,8,12,13,14,15,255,255,255,255,255,255},
+    {0,4,5,8,12,13,14,15,255,255,255,255,255,255,255,255},
+    {0,1,4,5,8,12,13,14,15,255,255,255,255,255,255,255},
+    {0,1,2,4,5,8,12,13,14,15,255,255,255,255,255,255},
+    {0,1,2,3,4,5,8,12,13,14,15,255,255,255,255,255},
+    {0,4,5,6,8,12,13,14,15,255,255,255,255,255,255,255},
+    {0,1,4,5,6,8,12,13,14,15,255,255,255,255,255,255},
+    {0,1,2,4,5,6,8,12,13,14,15,255,255,255,255,255},
+    {0,1,2,3,4,5,6,8,12,13,14,15,255,255,255,255},
+    {0,4,5,6,7,8,12,13,14,15,255,255,255,255,255,255},
+    {0,1,4,5,6,7,8,12,13,14,15,255,255,255,255,255},
+    {0,1,2,4,5,6,7,8,12,13,14,15,255,255,255,255},
+    {0,1,2,3,4,5,6,7,8,12,13,14,15,255,255,255},
+    {0,4,8,9,12,13,14,15,255,255,255,255,255,255,255,255},
+    {0,1,4,8,9,12,13,14,15,255,255,255,255,255,255,255},
+    {0,1,2,4,8,9,12,13,14,15,255,255,255,255,255,255},
+    {0,1,2,3,4,8,9,12,13,14,15,255,255,255,255,255},
+    {0,4,5,8,9,12,13,14,15,255,255,255,255,255,255,255},
+    {0,1,4,5,8,9,12,13,14,15,255,255,255,255,255,255},
+    {0,1,2,4,5,8,9,12,13,14,15,255,255,255,255,255},
+    {0,1,2,3,4,5,8,9,12,13,14,15,255,255,255,255},
+    {0,4,5,6,8,9,12,13,14,15,255,255,255,255,255,255},
+    {0,1,4,5,6,8,9,12,13,14,15,255,255,255,255,255},
+    {0,1,2,4,5,6,8,9,12,13,14,15,255,255,255,255},
+    {0,1,2,3,4,5,6,8,9,12,13,14,15,255,255,255},
+    {0,4,5,6,7,8,9,12,13,14,15,255,255,255,255,255},
+    {0,1,4,5,6,7,8,9,12,13,14,15,255,255,255,255},
+    {0,1,2,4,5,6,7,8,9,12,13,14,15,255,255,255},
+    {0,1,2,3,4,5,6,7,8,9,12,13,14,15,255,255},
+    {0,4,8,9,10,12,13,14,15,255,255,255,255,255,255,255},
+    {0,1,4,8,9,10,12,13,14,15,255,255,255,255,255,255},
+    {0,1,2,4,8,9,10,12,13,14,15,255,255,255,255,255},
+    {0,1,2,3,4,8,9,10,12,13,14,15,255,255,255,255},
+    {0,4,5,8,9,10,12,13,14,15,255,255,255,255,255,255},
+    {0,1,4,5,8,9,10,12,13,14,15,255,255,255,255,255},
+    {0,1,2,4,5,8,9,10,12,13,14,15,255,255,255,255},
+    {0,1,2,3,4,5,8,9,10,12,13,14,15,255,255,255},
+    {0,4,5,6,8,9,10,12,13,14,15,255,255,255,255,255},
+    {0,1,4,5,6,8,9,10,12,13,14,15,255,255,255,255},
+    {0,1,2,4,5,6,8,9,10,12,13,14,15,255,255,255},
+    {0,1,2,3,4,5,6,8,9,10,12,13,14,15,255,255},
+    {0,4,5,6,7,8,9,10,12,13,14,15,255,255,255,255},
+    {0,1,4,5,6,7,8,9,10,12,13,14,15,255,255,255},
+    {0,1,2,4,5,6,7,8,9,10,12,13,14,15,255,255},
+    {0,1,2,3,4,5,6,7,8,9,10,12,13,14,15,255},
+    {0,4,8,9,10,11,12,13,14,15,255,255,255,255,255,255},
+    {0,1,4,8,9,10,11,12,13,14,15,255,255,255,255,255},
+    {0,1,2,4,8,9,10,11,12,13,14,15,255,255,255,255},
+    {0,1,2,3,4,8,9,10,11,12,13,14,15,255,255,255},
+    {0,4,5,8,9,10,11,12,13,14,15,255,255,255,255,255},
+    {0,1,4,5,8,9,10,11,12,13,14,15,255,255,255,255},
+    {0,1,2,4,5,8,9,10,11,12,13,14,15,255,255,255},
+    {0,1,2,3,4,5,8,9,10,11,12,13,14,15,255,255},
+    {0,4,5,6,8,9,10,11,12,13,14,15,255,255,255,255},
+    {0,1,4,5,6,8,9,10,11,12,13,14,15,255,255,255},
+    {0,1,2,4,5,6,8,9,10,11,12,13,14,15,255,255},
+    {0,1,2,3,4,5,6,8,9,10,11,12,13,14,15,255},
+    {0,4,5,6,7,8,9,10,11,12,13,14,15,255,255,255},
+    {0,1,4,5,6,7,8,9,10,11,12,13,14,15,255,255},
+    {0,1,2,4,5,6,7,8,9,10,11,12,13,14,15,255},
+    {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15}
+};
+
+// number of data bytes of a group of 4 integers
+static const uint8_t group_length[256] = {
+    4,5,6,7,5,6,7,8,6,7,8,9,7,8,9,10,
+    5,6,7,8,6,7,8,9,7,8,9,10,8,9,10,11,
+    6,7,8,9,7,8,9,10,8,9,10,11,9,10,11,12,
+    7,8,9,10,8,9,10,11,9,10,11,12,10,11,12,13,
+    5,6,7,8,6,7,8,9,7,8,9,10,8,9,10,11,
+    6,7,8,9,7,8,9,10,8,9,10,11,9,10,11,12,
+    7,8,9,10,8,9,10,11,9,10,11,12,10,11,12,13,
+    8,9,10,11,9,10,11,12,10,11,12,13,11,12,13,14,
+    6,7,8,9,7,8,9,10,8,9,10,11,9,10,11,12,
+    7,8,9,10,8,9,10,11,9,10,11,12,10,11,12,13,
+    8,9,10,11,9,10,11,12,10,11,12,13,11,12,13,14,
+    9,10,11,12,10,11,12,13,11,12,13,14,12,13,14,15,
+    7,8,9,10,8,9,10,11,9,10,11,12,10,11,12,13,
+    8,9,10,11,9,10,11,12,10,11,12,13,11,12,13,14,
+    9,10,11,12,10,11,12,13,11,12,13,14,12,13,14,15,
+    10,11,12,13,11,12,13,14,12,13,14,15,13,14,15,16
+};
+
+
+size_t svb_max_encoded_size(size_t n) {
+    return (n + 3) / 4 + 4 * n;
+}
+
+
+static inline uint8_t length_code_scalar(uint32_t x) {
+    return (uint8_t)((x > 0xff) + (x > 0xffff) + (x > 0xffffff));
+}
+
+
+size_t svb_encode(const uint32_t *in, size_t n, uint8_t *out) {
+    size_t i = 0, j;
+    size_t distance = stream_settings.prefetch_distance;
+    uint8_t *control = out;
+    uint8_t *data = out + (n + 3) / 4;
+    static const int32_t code_shift[4] = {0, 2, 4, 6};
+    int32x4_t vector_shift = vld1q_s32(code_shift);
+    uint32x4_t vector_limit0 = vdupq_n_u32(0xff);
+    uint32x4_t vector_limit1 = vdupq_n_u32(0xffff);
+    uint32x4_t vector_limit2 = vdupq_n_u32(0xffffff);
+
+    // every group stores a full 16 bytes, which stays inside the worst case
+    // output size as long as whole groups are left
+    for(; i + 4 <= n; i += 4) {
+        uint32x4_t vector_data = vld1q_u32(in + i);
+        uint32x4_t vector_code = vdupq_n_u32(0);
+        uint32x2_t vector_pair;
+        uint8x8x2_t bytes;
+        uint8x16_t vector_bytes;
+        uint8_t c;
+
+        stream_prefetch_ahead(in + i, distance);
+
+        // length code (bytes - 1): compares yield -1 for true
+        vector_code = vsubq_u32(vector_code, vcgtq_u32(vector_data, vector_limit0));
+        vector_code = vsubq_u32(vector_code, vcgtq_u32(vector_data, vector_limit1));
+        vector_code = vsubq_u32(vector_code, vcgtq_u32(vector_data, vector_limit2));
+
+        // move code k to bits 2k..2k+1 and add up the four lanes
+        vector_code = vshlq_u32(vector_code, vector_shift);
+        vector_pair = vpadd_u32(vget_low_u32(vector_code), vget_high_u32(vector_code));
+        c = (uint8_t)(vget_lane_u32(vector_pair, 0) + vget_lane_u32(vector_pair, 1));
+
+        // v: vector
+        // tbl2: table lookup in two d registers (16 bytes)
+        vector_bytes = vreinterpretq_u8_u32(vector_data);
+        bytes.val[0] = vget_low_u8(vector_bytes);
+        bytes.val[1] = vget_high_u8(vector_bytes);
+        vector_bytes = vcombine_u8(vtbl2_u8(bytes, vld1_u8(encode_shuffle[c])),
+                                   vtbl2_u8(bytes, vld1_u8(encode_shuffle[c] + 8)));
+
+        vst1q_u8(data, vector_bytes);
+        data += group_length[c];
+        *control++ = c;
+    }
+
+    if(i < n) {
+        uint8_t c = 0;
+
+        for(j = 0; i + j < n; j++) {
+            uint32_t value = in[i + j];
+            uint8_t code = length_code_scalar(value);
+
+            c |= (uint8_t)(code << (2 * j));
+            memcpy(data, &value, code + 1);
+            data += code + 1;
+        }
+        *control++ = c;
+    }
+
+    return (size_t)(data - out);
+}
+
+
+size_t svb_decode(const uint8_t *in, size_t len, uint32_t *out, size_t n) {
+    size_t i = 0, j;
+    size_t distance = stream_settings.prefetch_distance;
+    size_t control_len = (n + 3) / 4;
+    const uint8_t *control = in;
+    const uint8_t *data = in + control_len;
+    const uint8_t *end = in + len;
+
+    if(len < control_len) {
+        return 0;
+    }
+
+    for(; i + 4 <= n; i += 4) {
+        uint8_t c = *control;
+        uint8x16_t vector_data;
+        uint8x8x2_t bytes;
+
+        // the 16-byte load may read the following groups, but not past the
+        // end of the stream
+        if(end - data < 16) {
+            break;
+        }
+        control++;
+
+        vector_data = vld1q_u8(data);
+        stream_prefetch_ahead(data, distance);
+        bytes.val[0] = vget_low_u8(vector_data);
+        bytes.val[1] = vget_high_u8(vector_data);
+
+        // out of range indices (255) produce the zero upper bytes
+        vector_data = vcombine_u8(vtbl2_u8(bytes, vld1_u8(decode_shuffle[c])),
+                                  vtbl2_u8(bytes, vld1_u8(decode_shuffle[c] + 8)));
+
+        vst1q_u32(out + i, vreinterpretq_u32_u8(vector_data));
+        data += group_length[c];
+    }
+
+    // remaining integers one by one with bounds checks
+    for(; i < n; i += 4) {
+        uint8_t c = *control++;
+
+        for(j = 0; j < 4 && i + j < n; j++) {
+            size_t bytes = (size_t)((c >> (2 * j)) & 3) + 1;
+            uint32_t value = 0;
+
+            if((size_t)(end - data) < bytes) {
+                return 0;
+            }
+            memcpy(&value, data, bytes);
+            out[i + j] = value;
+            data += bytes;
+        }
+    }
+
+    return (size_t)(data - in);
+}
@@ -0,0 +1,26 @@
+/* StreamVByte coding of 32-Bit unsigned integers using ARM NEON
+ *
+ * The stream starts with (n + 3) / 4 control bytes followed by the data
+ * bytes. Every control byte describes 4 integers with 2 bits each (bits
+ * 2k..2k+1 for integer k) holding the number of data bytes minus one.
+ * Integers are stored little-endian with leading zero bytes dropped.
+ */
+
+#ifndef STREAMVBYTE_H
+#define STREAMVBYTE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// worst case size of the encoding of n integers
+size_t svb_max_encoded_size(size_t n);
+
+// encodes n integers into out (svb_max_encoded_size(n) bytes),
+// returns the number of bytes written
+size_t svb_encode(const uint32_t *in, size_t n, uint8_t *out);
+
+// decodes n integers from the len bytes at in, returns the number of bytes
+// consumed or 0 if the stream is shorter than its control bytes announce
+size_t svb_decode(const uint8_t *in, size_t len, uint32_t *out, size_t n);
+
+#endif
@@ -0,0 +1,372 @@
+/* Per-kernel instrumentation: wall time, bytes processed and optional PMU
+ * counters of every traced kernel call, logged to a per-thread ring buffer
+ */
+
+#ifdef NEON_TRACE
+
+#define _GNU_SOURCE
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "trace.h"
+
+// records per thread, power of two
+#define RING_SIZE 4096
+
+#define MAX_KERNELS 64
+
+typedef struct trace_ring {
+    trace_record records[RING_SIZE];
+    // head is only written by the owning thread, tail only by the consumer
+    uint64_t head;
+    uint64_t tail;
+    uint64_t dropped;
+    uint32_t thread;
+    struct trace_ring *next;
+} trace_ring;
+
+typedef struct {
+    int fds[TRACE_NUM_COUNTERS];
+    // position of each counter in a group read, -1 if not opened
+    int slot[TRACE_NUM_COUNTERS];
+    int opened;
+    int leader;
+} pmu_group;
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} pmu_events[TRACE_NUM_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                         (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND}
+};
+
+static trace_ring *rings;
+static uint32_t thread_count;
+static unsigned trace_flags;
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_once_t dump_at_exit_once = PTHREAD_ONCE_INIT;
+
+static __thread trace_ring *thread_ring;
+static __thread pmu_group *thread_pmu;
+static pthread_key_t pmu_key;
+static pthread_once_t pmu_key_once = PTHREAD_ONCE_INIT;
+
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+
+static void close_pmu(void *ptr) {
+    pmu_group *pmu = ptr;
+    int c;
+
+    for(c = 0; c < TRACE_NUM_COUNTERS; c++) {
+        if(pmu->fds[c] >= 0) {
+            close(pmu->fds[c]);
+        }
+    }
+    free(pmu);
+}
+
+
+static void create_pmu_key(void) {
+    pthread_key_create(&pmu_key, close_pmu);
+}
+
+
+// opens the counters of the calling thread as one group, unsupported events
+// are left out
+static pmu_group *open_pmu(void) {
+    pmu_group *pmu = malloc(sizeof(*pmu));
+    int c;
+
+    if(pmu == NULL) {
+        return NULL;
+    }
+    pmu->opened = 0;
+    pmu->leader = -1;
+
+    for(c = 0; c < TRACE_NUM_COUNTERS; c++) {
+        struct perf_event_attr attr;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = pmu_events[c].type;
+        attr.config = pmu_events[c].config;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        pmu->fds[c] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, pmu->leader, 0);
+        pmu->slot[c] = -1;
+        if(pmu->fds[c] >= 0) {
+            if(pmu->leader < 0) {
+                pmu->leader = pmu->fds[c];
+            }
+            pmu->slot[c] = pmu->opened++;
+        }
+    }
+
+    pthread_once(&pmu_key_once, create_pmu_key);
+    pthread_setspecific(pmu_key, pmu);
+
+    return pmu;
+}
+
+
+static void read_pmu(const pmu_group *pmu, uint64_t *counters) {
+    // PERF_FORMAT_GROUP: number of counters followed by their values
+    uint64_t values[1 + TRACE_NUM_COUNTERS];
+    int c;
+
+    if(pmu->leader < 0 || read(pmu->leader, values, sizeof(values)) <= 0) {
+        memset(counters, 0, TRACE_NUM_COUNTERS * sizeof(uint64_t));
+        return;
+    }
+    for(c = 0; c < TRACE_NUM_COUNTERS; c++) {
+        counters[c] = pmu->slot[c] >= 0 ? values[1 + pmu->slot[c]] : 0;
+    }
+}
+
+
+static void dump_at_exit(void) {
+    trace_dump_file(getenv("NEON_TRACE_FILE"));
+}
+
+
+static void register_dump_at_exit(void) {
+    if(getenv("NEON_TRACE_FILE") != NULL) {
+        atexit(dump_at_exit);
+    }
+}
+
+
+static trace_ring *register_ring(void) {
+    trace_ring *ring = calloc(1, sizeof(*ring));
+
+    // the first traced call of any thread arranges the NEON_TRACE_FILE dump
+    pthread_once(&dump_at_exit_once, register_dump_at_exit);
+
+    if(ring == NULL) {
+        return NULL;
+    }
+    ring->thread = __atomic_fetch_add(&thread_count, 1, __ATOMIC_RELAXED);
+
+    // rings are never freed, records of exited threads can still be dumped
+    ring->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+    while(!__atomic_compare_exchange_n(&rings, &ring->next, ring, 1,
+                                       __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+
+    return ring;
+}
+
+
+int trace_init(unsigned flags) {
+    trace_flags = flags;
+
+    if(flags & TRACE_PMU) {
+        if(thread_pmu == NULL) {
+            thread_pmu = open_pmu();
+        }
+        return thread_pmu != NULL && thread_pmu->opened > 0 ? 0 : -1;
+    }
+
+    return 0;
+}
+
+
+void trace_begin(trace_scope *scope) {
+    if(trace_flags & TRACE_PMU) {
+        if(thread_pmu == NULL) {
+            thread_pmu = open_pmu();
+        }
+        if(thread_pmu != NULL) {
+            read_pmu(thread_pmu, scope->counters);
+        }
+    }
+    scope->start_ns = now_ns();
+}
+
+
+void trace_end(const trace_scope *scope, const char *kernel, uint64_t bytes) {
+    uint64_t end_ns = now_ns();
+    trace_ring *ring = thread_ring;
+    trace_record *record;
+    uint64_t head;
+    int c;
+
+    if(ring == NULL) {
+        ring = thread_ring = register_ring();
+        if(ring == NULL) {
+            return;
+        }
+    }
+
+    head = ring->head;
+    if(head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= RING_SIZE) {
+        __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    record = &ring->records[head & (RING_SIZE - 1)];
+    record->kernel = kernel;
+    record->thread = ring->thread;
+    record->start_ns = scope->start_ns;
+    record->duration_ns = end_ns - scope->start_ns;
+    record->bytes = bytes;
+
+    if((trace_flags & TRACE_PMU) && thread_pmu != NULL) {
+        read_pmu(thread_pmu, record->counters);
+        for(c = 0; c < TRACE_NUM_COUNTERS; c++) {
+            record->counters[c] -= scope->counters[c];
+        }
+    } else {
+        memset(record->counters, 0, sizeof(record->counters));
+    }
+
+    // publish the record
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+
+size_t trace_drain(trace_record *out, size_t max) {
+    trace_ring *ring;
+    size_t n = 0;
+
+    pthread_mutex_lock(&drain_lock);
+    for(ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t tail = ring->tail;
+
+        for(; tail != head && n < max; tail++) {
+            out[n++] = ring->records[tail & (RING_SIZE - 1)];
+        }
+        // hand the slots back to the producer
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&drain_lock);
+
+    return n;
+}
+
+
+uint64_t trace_dropped(void) {
+    trace_ring *ring;
+    uint64_t dropped = 0;
+
+    for(ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+        dropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+    }
+
+    return dropped;
+}
+
+
+void trace_dump(FILE *out) {
+    trace_record records[256];
+    size_t n, i;
+
+    fprintf(out, "kernel,thread,start_ns,duration_ns,bytes,cycles,instructions,"
+                 "l1d_misses,llc_misses,backend_stalls\n");
+
+    while((n = trace_drain(records, 256)) > 0) {
+        for(i = 0; i < n; i++) {
+            const trace_record *r = &records[i];
+
+            fprintf(out, "%s,%u,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+                    r->kernel, r->thread,
+                    (unsigned long long)r->start_ns,
+                    (unsigned long long)r->duration_ns,
+                    (unsigned long long)r->bytes,
+                    (unsigned long long)r->counters[TRACE_CYCLES],
+                    (unsigned long long)r->counters[TRACE_INSTRUCTIONS],
+                    (unsigned long long)r->counters[TRACE_L1D_MISSES],
+                    (unsigned long long)r->counters[TRACE_LLC_MISSES],
+                    (unsigned long long)r->counters[TRACE_BACKEND_STALLS]);
+        }
+    }
+}
+
+
+int trace_dump_file(const char *path) {
+    FILE *out = fopen(path, "w");
+
+    if(out == NULL) {
+        return -1;
+    }
+    trace_dump(out);
+
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+
+void trace_summary(FILE *out) {
+    trace_record total[MAX_KERNELS];
+    uint64_t calls[MAX_KERNELS];
+    trace_record records[256];
+    size_t kernels = 0, n, i, k;
+    int c;
+
+    while((n = trace_drain(records, 256)) > 0) {
+        for(i = 0; i < n; i++) {
+            const trace_record *r = &records[i];
+
+            for(k = 0; k < kernels && strcmp(total[k].kernel, r->kernel) != 0; k++) {
+            }
+            if(k == MAX_KERNELS) {
+                continue;
+            }
+            if(k == kernels) {
+                memset(&total[k], 0, sizeof(total[k]));
+                total[k].kernel = r->kernel;
+                calls[k] = 0;
+                kernels++;
+            }
+
+            calls[k]++;
+            total[k].duration_ns += r->duration_ns;
+            total[k].bytes += r->bytes;
+            for(c = 0; c < TRACE_NUM_COUNTERS; c++) {
+                total[k].counters[c] += r->counters[c];
+            }
+        }
+    }
+
+    fprintf(out, "%-20s %8s %12s %10s %6s %12s %12s\n",
+            "kernel", "calls", "total us", "MB/s", "IPC", "L1D miss/KiB", "LLC miss/KiB");
+
+    for(k = 0; k < kernels; k++) {
+        const trace_record *t = &total[k];
+        double kib = t->bytes / 1024.0;
+
+        fprintf(out, "%-20s %8llu %12.1f %10.1f %6.2f %12.2f %12.2f\n",
+                t->kernel, (unsigned long long)calls[k], t->duration_ns / 1000.0,
+                t->duration_ns > 0 ? t->bytes * 1000.0 / t->duration_ns : 0.0,
+                t->counters[TRACE_CYCLES] > 0 ?
+                    (double)t->counters[TRACE_INSTRUCTIONS] / t->counters[TRACE_CYCLES] : 0.0,
+                kib > 0 ? t->counters[TRACE_L1D_MISSES] / kib : 0.0,
+                kib > 0 ? t->counters[TRACE_LLC_MISSES] / kib : 0.0);
+    }
+
+    if(trace_dropped() > 0) {
+        fprintf(out, "%llu records dropped\n", (unsigned long long)trace_dropped());
+    }
+}
+
+#endif
@@ -0,0 +1,105 @@
+/* Per-kernel instrumentation: wall time, bytes processed and optional PMU
+ * counters of every traced kernel call, logged to a per-thread ring buffer
+ *
+ * Tracing is compiled in only with NEON_TRACE defined (cmake -DNEON_TRACE=ON).
+ * Without it TRACE_KERNEL() expands to the bare call and the other functions
+ * are empty inline stubs, so instrumented code costs nothing.
+ *
+ *     TRACE_KERNEL("bswap32_buf", 8 * n, bswap32_buf(in, n, out));
+ *     TRACE_KERNEL("crc32c", n, crc = crc32c_update(crc, data, n));
+ *
+ * Each thread writes to its own single-producer ring, a full ring drops new
+ * records (counted) instead of blocking. trace_dump() and trace_summary()
+ * drain the rings of all threads and may run concurrently with them.
+ *
+ * Besides the calls wrapped by the program itself, the stage kernels of
+ * pipeline.h ("pipeline_stage") and the chunk callbacks of file_process()
+ * ("file_chunk") are traced. To get the CSV out of any program built with
+ * tracing, set NEON_TRACE_FILE: the records still in the rings are written
+ * to that file when the program exits.
+ *
+ *     NEON_TRACE_FILE=trace.csv ./arm_neon_examples
+ *     ./arm_neon_examples trace trace.csv
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// trace_init() flags
+#define TRACE_PMU 1
+
+enum {
+    TRACE_CYCLES,
+    TRACE_INSTRUCTIONS,
+    TRACE_L1D_MISSES,
+    TRACE_LLC_MISSES,
+    TRACE_BACKEND_STALLS,
+    TRACE_NUM_COUNTERS
+};
+
+typedef struct {
+    const char *kernel;
+    uint32_t thread;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint64_t bytes;
+    // zero where the counter is unavailable
+    uint64_t counters[TRACE_NUM_COUNTERS];
+} trace_record;
+
+typedef struct {
+    uint64_t start_ns;
+    uint64_t counters[TRACE_NUM_COUNTERS];
+} trace_scope;
+
+#ifdef NEON_TRACE
+
+// TRACE_PMU opens perf_event_open() counters for every tracing thread,
+// threads without them still record times; returns 0, -1 if PMU counters
+// were requested but cannot be opened
+int trace_init(unsigned flags);
+
+void trace_begin(trace_scope *scope);
+void trace_end(const trace_scope *scope, const char *kernel, uint64_t bytes);
+
+// moves up to max records of all threads to out, returns their number
+size_t trace_drain(trace_record *out, size_t max);
+
+// records dropped because a ring was full
+uint64_t trace_dropped(void);
+
+// drains all rings and writes one CSV line per record
+void trace_dump(FILE *out);
+
+// trace_dump() to a new file, returns 0, -1 on I/O errors
+int trace_dump_file(const char *path);
+
+// drains all rings and writes calls, time, throughput, IPC and misses per
+// KiB for each kernel
+void trace_summary(FILE *out);
+
+#define TRACE_KERNEL(name, bytes, call) do { \
+        trace_scope trace_scope_; \
+        trace_begin(&trace_scope_); \
+        call; \
+        trace_end(&trace_scope_, (name), (bytes)); \
+    } while(0)
+
+#else
+
+static inline int trace_init(unsigned flags) { (void)flags; return 0; }
+static inline size_t trace_drain(trace_record *out, size_t max) { (void)out; (void)max; return 0; }
+static inline uint64_t trace_dropped(void) { return 0; }
+static inline void trace_dump(FILE *out) { (void)out; }
+static inline int trace_dump_file(const char *path) { (void)path; return 0; }
+static inline void trace_summary(FILE *out) { (void)out; }
+
+#define TRACE_KERNEL(name, bytes, call) do { call; } while(0)
+
+#endif
+
+#endif
@@ -0,0 +1,339 @@
+/* Per-board auto-tuning of the streaming kernel settings
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "bswap.h"
+#include "checksum.h"
+#include "neon_alloc.h"
+#include "stream.h"
+#include "tune.h"
+
+#define DEFAULT_L2_SIZE (512 * 1024)
+#define BENCH_ROUNDS    5
+#define MAX_DISTANCE    4096
+#define MAX_CPU_ID      128
+#define MAX_PATH        4096
+
+// candidates within this fraction of the fastest count as equally fast, the
+// smallest of them wins so that noise does not flip the result between runs
+#define TOLERANCE       0.02
+
+static const size_t distances[] = {0, 64, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048};
+static const unsigned unrolls[] = {1, 2, 4};
+
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+
+// best of BENCH_ROUNDS passes of a read-only and a read-write streaming
+// kernel over bytes, in ns
+static uint64_t bench_streaming(const uint8_t *in, uint8_t *out, size_t bytes) {
+    static volatile uint32_t sink;
+    uint64_t best = UINT64_MAX;
+    int r;
+
+    for(r = 0; r < BENCH_ROUNDS; r++) {
+        uint64_t start = now_ns();
+        uint64_t elapsed;
+
+        sink ^= adler32_update(ADLER32_INIT, in, bytes);
+        bswap32_buf((const uint32_t *)in, bytes / 4, (uint32_t *)out);
+
+        elapsed = now_ns() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+
+    return best > 0 ? best : 1;
+}
+
+
+static double throughput_mbps(size_t bytes, uint64_t ns) {
+    // both kernels read the buffer
+    return 2.0 * (double)bytes * 1000.0 / (double)ns;
+}
+
+
+static size_t tune_prefetch_distance(const uint8_t *in, uint8_t *out, size_t bytes) {
+    size_t count = sizeof(distances) / sizeof(distances[0]);
+    uint64_t times[sizeof(distances) / sizeof(distances[0])];
+    uint64_t best = UINT64_MAX;
+    size_t c;
+
+    for(c = 0; c < count; c++) {
+        stream_settings.prefetch_distance = distances[c];
+        times[c] = bench_streaming(in, out, bytes);
+        best = times[c] < best ? times[c] : best;
+    }
+
+    c = 0;
+    while(times[c] > (double)best * (1.0 + TOLERANCE)) {
+        c++;
+    }
+
+    return distances[c];
+}
+
+
+// vectors in flight of the unrolled kernels, at the tuned prefetch distance
+static unsigned tune_unroll(const uint8_t *in, uint8_t *out, size_t bytes) {
+    size_t count = sizeof(unrolls) / sizeof(unrolls[0]);
+    uint64_t times[sizeof(unrolls) / sizeof(unrolls[0])];
+    uint64_t best = UINT64_MAX;
+    size_t c;
+
+    for(c = 0; c < count; c++) {
+        stream_settings.unroll = unrolls[c];
+        times[c] = bench_streaming(in, out, bytes);
+        best = times[c] < best ? times[c] : best;
+    }
+
+    c = 0;
+    while(times[c] > (double)best * (1.0 + TOLERANCE)) {
+        c++;
+    }
+
+    return unrolls[c];
+}
+
+
+#if defined(__aarch64__)
+// best of BENCH_ROUNDS passes of the read-write kernel only, in ns
+static uint64_t bench_stores(const uint8_t *in, uint8_t *out, size_t bytes) {
+    uint64_t best = UINT64_MAX;
+    int r;
+
+    for(r = 0; r < BENCH_ROUNDS; r++) {
+        uint64_t start = now_ns();
+        uint64_t elapsed;
+
+        bswap32_buf((const uint32_t *)in, bytes / 4, (uint32_t *)out);
+
+        elapsed = now_ns() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
+
+
+// smallest working set (input plus output bytes) from which on the
+// non-temporal stores are at least as fast as cached ones, 0 if never
+static size_t tune_nontemporal_threshold(const uint8_t *in, uint8_t *out, size_t bytes, size_t l2_size) {
+    size_t threshold = 0;
+    size_t size;
+
+    // from the largest size down, stop at the first one the cache wins
+    for(size = 4 * l2_size; size >= l2_size / 2; size /= 2) {
+        size_t half = size / 2 <= bytes ? size / 2 : bytes;
+        uint64_t cached, streaming;
+
+        stream_settings.nontemporal_threshold = 0;
+        cached = bench_stores(in, out, half);
+        stream_settings.nontemporal_threshold = 1;
+        streaming = bench_stores(in, out, half);
+
+        if(streaming > (double)cached * (1.0 + TOLERANCE)) {
+            break;
+        }
+        threshold = 2 * half;
+    }
+
+    return threshold;
+}
+#endif
+
+
+// copies the value of the first "key : value" line of /proc/cpuinfo
+static void cpuinfo_field(FILE *file, const char *key, char *out, size_t size) {
+    char line[256];
+    size_t key_length = strlen(key);
+
+    snprintf(out, size, "-");
+    if(file == NULL) {
+        return;
+    }
+
+    rewind(file);
+    while(fgets(line, sizeof(line), file) != NULL) {
+        char *colon = strchr(line, ':');
+
+        if(colon != NULL && strncmp(line, key, key_length) == 0 &&
+           (line[key_length] == ' ' || line[key_length] == '\t' || line[key_length] == ':')) {
+            char value[32];
+
+            if(sscanf(colon + 1, "%31s", value) == 1) {
+                snprintf(out, size, "%s", value);
+            }
+            return;
+        }
+    }
+}
+
+
+int tune_cpu_id(char *out, size_t size) {
+    FILE *file = fopen("/proc/cpuinfo", "r");
+    char implementer[32], part[32], revision[32];
+    int length;
+
+    cpuinfo_field(file, "CPU implementer", implementer, sizeof(implementer));
+    cpuinfo_field(file, "CPU part", part, sizeof(part));
+    cpuinfo_field(file, "CPU revision", revision, sizeof(revision));
+    if(file != NULL) {
+        fclose(file);
+    }
+
+    length = snprintf(out, size, "%s:%s:%s:%zu", implementer, part, revision, stream_l2_cache_size());
+
+    return length >= 0 && (size_t)length < size ? 0 : -1;
+}
+
+
+int tune_run(size_t bytes, tune_result *result) {
+    size_t l2_size = stream_l2_cache_size();
+    uint8_t *in, *out;
+    uint64_t default_ns;
+
+    if(l2_size == 0) {
+        l2_size = DEFAULT_L2_SIZE;
+    }
+    // well beyond the L2 so that the loads come from memory
+    if(bytes == 0) {
+        bytes = 4 * l2_size;
+    }
+    bytes = bytes < 64 ? 64 : bytes & ~(size_t)63;
+
+    in = neon_alloc(bytes);
+    out = neon_alloc(bytes);
+    if(in == NULL || out == NULL) {
+        neon_free(in);
+        neon_free(out);
+        return -1;
+    }
+
+    // touch all pages once so that page faults do not count
+    memset(in, 0x5a, bytes);
+    memset(out, 0, bytes);
+
+    // the first pass also warms up the clocks
+    bench_streaming(in, out, bytes);
+    default_ns = bench_streaming(in, out, bytes);
+
+    stream_settings.prefetch_distance = tune_prefetch_distance(in, out, bytes);
+    stream_settings.unroll = tune_unroll(in, out, bytes);
+#if defined(__aarch64__)
+    stream_settings.nontemporal_threshold = tune_nontemporal_threshold(in, out, bytes, l2_size);
+#endif
+    // ARMv7-A has no non-temporal stores, the threshold makes no difference
+
+    if(result != NULL) {
+        result->prefetch_distance = stream_settings.prefetch_distance;
+        result->unroll = stream_settings.unroll;
+        result->nontemporal_threshold = stream_settings.nontemporal_threshold;
+        result->default_mbps = throughput_mbps(bytes, default_ns);
+        result->tuned_mbps = throughput_mbps(bytes, bench_streaming(in, out, bytes));
+    }
+
+    neon_free(in);
+    neon_free(out);
+
+    return 0;
+}
+
+
+int tune_load(const char *path) {
+    FILE *file = fopen(path, "r");
+    char line[256];
+    char cpu_id[MAX_CPU_ID];
+    char value[MAX_CPU_ID];
+    size_t prefetch_distance = 0, nontemporal_threshold = 0;
+    unsigned unroll = 0;
+    int found = 0;
+
+    if(file == NULL) {
+        return -1;
+    }
+    if(tune_cpu_id(cpu_id, sizeof(cpu_id)) != 0) {
+        fclose(file);
+        return -1;
+    }
+
+    // one "key value" pair per line, '#' starts a comment
+    while(fgets(line, sizeof(line), file) != NULL) {
+        if(line[0] == '#') {
+            continue;
+        }
+        if(sscanf(line, "cpu %127s", value) == 1) {
+            found |= strcmp(value, cpu_id) == 0 ? 1 : 0;
+        } else if(sscanf(line, "prefetch_distance %zu", &prefetch_distance) == 1) {
+            found |= 2;
+        } else if(sscanf(line, "nontemporal_threshold %zu", &nontemporal_threshold) == 1) {
+            found |= 4;
+        } else if(sscanf(line, "unroll %u", &unroll) == 1) {
+            found |= 8;
+        }
+    }
+    fclose(file);
+
+    if(found != 15 || prefetch_distance > MAX_DISTANCE || (unroll != 1 && unroll != 2 && unroll != 4)) {
+        return -1;
+    }
+
+    stream_settings.prefetch_distance = prefetch_distance;
+    stream_settings.nontemporal_threshold = nontemporal_threshold;
+    stream_settings.unroll = unroll;
+
+    return 0;
+}
+
+
+int tune_save(const char *path) {
+    char cpu_id[MAX_CPU_ID];
+    char temporary[MAX_PATH];
+    FILE *file;
+    int error;
+
+    if(tune_cpu_id(cpu_id, sizeof(cpu_id)) != 0 ||
+       snprintf(temporary, sizeof(temporary), "%s.tmp", path) >= (int)sizeof(temporary)) {
+        return -1;
+    }
+
+    // written next to the target and renamed, readers never see half a file
+    file = fopen(temporary, "w");
+    if(file == NULL) {
+        return -1;
+    }
+    fprintf(file, "# streaming kernel settings, see tune.h\n");
+    fprintf(file, "cpu %s\n", cpu_id);
+    fprintf(file, "prefetch_distance %zu\n", stream_settings.prefetch_distance);
+    fprintf(file, "nontemporal_threshold %zu\n", stream_settings.nontemporal_threshold);
+    fprintf(file, "unroll %u\n", stream_settings.unroll);
+
+    error = ferror(file);
+    if(fclose(file) != 0 || error || rename(temporary, path) != 0) {
+        remove(temporary);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+int tune_init(const char *path) {
+    if(tune_load(path) == 0) {
+        return 0;
+    }
+    if(tune_run(0, NULL) != 0) {
+        return -1;
+    }
+    tune_save(path);
+
+    return 0;
+}
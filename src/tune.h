@@ -0,0 +1,63 @@
+/* Per-board auto-tuning of the streaming kernel settings
+ *
+ * The best prefetch distance, loop unrolling and non-temporal threshold
+ * depend on the core (Cortex-A9, A53, A72, ...) and its memory system, not
+ * only on the L2 size that stream_init() derives them from. tune_run() times
+ * representative streaming kernels with every candidate setting and applies
+ * the fastest: the prefetch distance first, then the number of vectors in
+ * flight of the unrolled kernels (the bswap*_buf family, 1, 2 or 4). The
+ * non-temporal threshold is only tuned in AArch64 builds; the default
+ * ARMv7-A build has no non-temporal stores and keeps the threshold of
+ * stream_init().
+ *
+ * Tile sizes and thread placement are not tuned. The motion tile size is
+ * the granularity of the reported counts, not a speed setting, and the
+ * pipeline stage count and CPU pinning come from the application's stage
+ * list, whose best layout depends on the work of its stages.
+ * tune_save() writes the current settings to a small text file and
+ * tune_load() applies such a file on later runs. A file written on another
+ * CPU (implementer, part, revision or L2 size differ) is not applied.
+ *
+ *     stream_init();
+ *     tune_init("/var/cache/arm_neon_examples.tune");
+ *
+ * loads the file and only benchmarks (and saves) if it is missing or stale.
+ */
+
+#ifndef TUNE_H
+#define TUNE_H
+
+#include <stddef.h>
+
+typedef struct {
+    size_t prefetch_distance;
+    unsigned unroll;
+    size_t nontemporal_threshold;
+    // benchmark throughput in MB/s with the settings before and after tuning
+    double default_mbps;
+    double tuned_mbps;
+} tune_result;
+
+// identifies the CPU the settings were tuned on, "-" for fields that are
+// unknown; returns 0, -1 if size is too small
+int tune_cpu_id(char *out, size_t size);
+
+// benchmarks the candidates on buffers of bytes (0 for four times the L2
+// size) and applies the fastest to stream_settings, result may be NULL;
+// returns 0, -1 if out of memory (the settings are unchanged then); call it
+// before other threads run the streaming kernels
+int tune_run(size_t bytes, tune_result *result);
+
+// applies the settings from path, returns 0, -1 if the file is missing,
+// invalid or was written on another CPU (the settings are unchanged then)
+int tune_load(const char *path);
+
+// writes stream_settings to path (replaced atomically), returns 0, -1 on
+// I/O errors
+int tune_save(const char *path);
+
+// tune_load(), or tune_run() and tune_save() if that fails; returns 0, -1
+// if the settings could not be tuned (saving is best effort)
+int tune_init(const char *path);
+
+#endif
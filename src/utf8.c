@@ -0,0 +1,314 @@
+/* UTF-8 validation and UTF-8 to UTF-16 / Latin-1 transcoding using ARM NEON
+ *
+ * The validator classifies every pair of consecutive bytes with three
+ * 16-entry nibble lookups (high and low nibble of the previous byte, high
+ * nibble of the current byte); a non-zero AND of the three is an error.
+ * Lengths of 3 and 4 byte sequences are checked separately against the
+ * bytes 2 and 3 positions back.
+ */
+
+#include <string.h>
+#include "arm_neon.h"
+#include "utf8.h"
+#include "neon_util.h"
+#include "stream.h"
+
+// error classes, one bit each
+#define TOO_SHORT      (1 << 0)  // 11______ 0_______
+#define TOO_LONG       (1 << 1)  // 0_______ 10______
+#define OVERLONG_3     (1 << 2)  // 11100000 100_____
+#define TOO_LARGE      (1 << 3)  // 11110100 1001____ and above
+#define SURROGATE      (1 << 4)  // 11101101 101_____
+#define OVERLONG_2     (1 << 5)  // 1100000_ 10______
+#define TOO_LARGE_1000 (1 << 6)  // 11110101 1000____ and above
+#define OVERLONG_4     (1 << 6)  // 11110000 1000____
+#define TWO_CONTS      (1 << 7)  // 10______ 10______
+#define CARRY          (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+static const uint8_t byte_1_high_table[16] = {
+    // 0_______ ________ ASCII in byte 1
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    // 10______ ________ continuation in byte 1
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    // 1100____ ________ two byte lead
+    TOO_SHORT | OVERLONG_2,
+    // 1101____ ________ two byte lead
+    TOO_SHORT,
+    // 1110____ ________ three byte lead
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    // 1111____ ________ four byte lead
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+};
+
+static const uint8_t byte_1_low_table[16] = {
+    // ____0000 ________
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    // ____0001 ________
+    CARRY | OVERLONG_2,
+    // ____001_ ________
+    CARRY,
+    CARRY,
+    // ____0100 ________
+    CARRY | TOO_LARGE,
+    // ____0101 ________ and up
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    // ____1101 ________
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000
+};
+
+static const uint8_t byte_2_high_table[16] = {
+    // ________ 0_______ ASCII in byte 2
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    // ________ 1000____
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+    // ________ 1001____
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    // ________ 101_____
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    // ________ 11______
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+};
+
+// a block ending in these lead bytes is incomplete: 0xc0.. in the last
+// lane, 0xe0.. in the last two and 0xf0.. in the last three
+static const uint8_t incomplete_limit[16] = {
+    255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 0xf0 - 1, 0xe0 - 1, 0xc0 - 1
+};
+
+
+typedef struct {
+    uint8x16_t prev_input;
+    uint8x16_t prev_incomplete;
+    uint8x16_t error;
+} utf8_state;
+
+
+// 16-entry table lookup of all 16 nibbles in idx
+static inline uint8x16_t lookup_16(uint8x8x2_t table, uint8x16_t idx) {
+    // v: vector
+    // tbl2: table lookup in two d registers (16 entries)
+    return vcombine_u8(vtbl2_u8(table, vget_low_u8(idx)), vtbl2_u8(table, vget_high_u8(idx)));
+}
+
+
+static inline uint8x8x2_t load_table(const uint8_t *table) {
+    uint8x8x2_t t;
+
+    t.val[0] = vld1_u8(table);
+    t.val[1] = vld1_u8(table + 8);
+
+    return t;
+}
+
+
+static inline void check_block(utf8_state *state, uint8x16_t input,
+                               const uint8x8x2_t *tables) {
+    uint8x16_t prev1, prev2, prev3;
+    uint8x16_t special, must23;
+    uint8x16_t vector_low_nibble = vdupq_n_u8(0x0f);
+
+    // ASCII fast path: the block cannot start or continue a sequence, only
+    // a sequence left open by the previous block is an error
+    if(max_u8x16(input) < 0x80) {
+        state->error = vorrq_u8(state->error, state->prev_incomplete);
+        state->prev_incomplete = vdupq_n_u8(0);
+        state->prev_input = input;
+        return;
+    }
+
+    // the 1, 2 and 3 bytes preceding every lane
+    prev1 = vextq_u8(state->prev_input, input, 15);
+    prev2 = vextq_u8(state->prev_input, input, 14);
+    prev3 = vextq_u8(state->prev_input, input, 13);
+
+    special = lookup_16(tables[0], vshrq_n_u8(prev1, 4));
+    special = vandq_u8(special, lookup_16(tables[1], vandq_u8(prev1, vector_low_nibble)));
+    special = vandq_u8(special, lookup_16(tables[2], vshrq_n_u8(input, 4)));
+
+    // lanes that must be the 2nd/3rd continuation byte of a 3 or 4 byte
+    // sequence: only prev2 >= 0xe0 or prev3 >= 0xf0 reach 0x80 here
+    must23 = vorrq_u8(vqsubq_u8(prev2, vdupq_n_u8(0xe0 - 0x80)),
+                      vqsubq_u8(prev3, vdupq_n_u8(0xf0 - 0x80)));
+    must23 = vandq_u8(must23, vdupq_n_u8(0x80));
+
+    // TWO_CONTS is expected exactly where must23 is set
+    state->error = vorrq_u8(state->error, veorq_u8(must23, special));
+
+    state->prev_incomplete = vqsubq_u8(input, vld1q_u8(incomplete_limit));
+    state->prev_input = input;
+}
+
+
+int utf8_validate(const uint8_t *in, size_t len) {
+    size_t i = 0;
+    size_t distance = stream_settings.prefetch_distance;
+    utf8_state state;
+    uint8x8x2_t tables[3];
+
+    tables[0] = load_table(byte_1_high_table);
+    tables[1] = load_table(byte_1_low_table);
+    tables[2] = load_table(byte_2_high_table);
+
+    state.prev_input = vdupq_n_u8(0);
+    state.prev_incomplete = vdupq_n_u8(0);
+    state.error = vdupq_n_u8(0);
+
+    for(; i + 16 <= len; i += 16) {
+        stream_prefetch_ahead(in + i, distance);
+        check_block(&state, vld1q_u8(in + i), tables);
+    }
+
+    // the tail is padded with ASCII zeros
+    if(i < len) {
+        uint8_t block[16] = {0};
+
+        memcpy(block, in + i, len - i);
+        check_block(&state, vld1q_u8(block), tables);
+    }
+
+    state.error = vorrq_u8(state.error, state.prev_incomplete);
+
+    return max_u8x16(state.error) == 0;
+}
+
+
+int utf8_is_ascii(const uint8_t *in, size_t len) {
+    size_t i = 0;
+    size_t distance = stream_settings.prefetch_distance;
+    uint8x16_t vector_or = vdupq_n_u8(0);
+    uint8_t tail = 0;
+
+    // OR everything together and test the top bit once
+    for(; i + 16 <= len; i += 16) {
+        stream_prefetch_ahead(in + i, distance);
+        vector_or = vorrq_u8(vector_or, vld1q_u8(in + i));
+    }
+    for(; i < len; i++) {
+        tail |= in[i];
+    }
+
+    return ((max_u8x16(vector_or) | tail) & 0x80) == 0;
+}
+
+
+// decodes one sequence of valid UTF-8, returns its length
+static inline size_t decode_scalar(const uint8_t *in, uint32_t *code_point) {
+    uint8_t lead = in[0];
+
+    if(lead < 0x80) {
+        *code_point = lead;
+        return 1;
+    }
+    if(lead < 0xe0) {
+        *code_point = ((uint32_t)(lead & 0x1f) << 6) | (in[1] & 0x3f);
+        return 2;
+    }
+    if(lead < 0xf0) {
+        *code_point = ((uint32_t)(lead & 0x0f) << 12) | ((uint32_t)(in[1] & 0x3f) << 6) |
+                      (in[2] & 0x3f);
+        return 3;
+    }
+    *code_point = ((uint32_t)(lead & 0x07) << 18) | ((uint32_t)(in[1] & 0x3f) << 12) |
+                  ((uint32_t)(in[2] & 0x3f) << 6) | (in[3] & 0x3f);
+    return 4;
+}
+
+
+size_t utf8_to_utf16(const uint8_t *in, size_t len, uint16_t *out) {
+    size_t i = 0, end;
+    size_t distance = stream_settings.prefetch_distance;
+    uint16_t *o = out;
+
+    if(!utf8_validate(in, len)) {
+        return 0;
+    }
+
+    while(i < len) {
+        if(i + 16 <= len) {
+            uint8x16_t vector_data = vld1q_u8(in + i);
+
+            stream_prefetch_ahead(in + i, distance);
+            if(max_u8x16(vector_data) < 0x80) {
+                // v: vector
+                // movl: widen 8 to 16 bit
+                vst1q_u16(o, vmovl_u8(vget_low_u8(vector_data)));
+                vst1q_u16(o + 8, vmovl_u8(vget_high_u8(vector_data)));
+                o += 16;
+                i += 16;
+                continue;
+            }
+            end = i + 16;
+        } else {
+            end = len;
+        }
+
+        // scalar up to the end of the block, a sequence may cross it
+        while(i < end) {
+            uint32_t code_point;
+
+            i += decode_scalar(in + i, &code_point);
+            if(code_point < 0x10000) {
+                *o++ = (uint16_t)code_point;
+            } else {
+                code_point -= 0x10000;
+                *o++ = (uint16_t)(0xd800 | (code_point >> 10));
+                *o++ = (uint16_t)(0xdc00 | (code_point & 0x3ff));
+            }
+        }
+    }
+
+    return (size_t)(o - out);
+}
+
+
+size_t utf8_to_latin1(const uint8_t *in, size_t len, uint8_t *out) {
+    size_t i = 0, end;
+    size_t distance = stream_settings.prefetch_distance;
+    uint8_t *o = out;
+
+    if(!utf8_validate(in, len)) {
+        return 0;
+    }
+
+    while(i < len) {
+        if(i + 16 <= len) {
+            uint8x16_t vector_data = vld1q_u8(in + i);
+
+            stream_prefetch_ahead(in + i, distance);
+            if(max_u8x16(vector_data) < 0x80) {
+                vst1q_u8(o, vector_data);
+                o += 16;
+                i += 16;
+                continue;
+            }
+            end = i + 16;
+        } else {
+            end = len;
+        }
+
+        while(i < end) {
+            uint32_t code_point;
+
+            i += decode_scalar(in + i, &code_point);
+            if(code_point > 0xff) {
+                return 0;
+            }
+            *o++ = (uint8_t)code_point;
+        }
+    }
+
+    return (size_t)(o - out);
+}
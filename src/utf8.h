@@ -0,0 +1,29 @@
+/* UTF-8 validation and UTF-8 to UTF-16 / Latin-1 transcoding using ARM NEON
+ *
+ * The validator rejects overlong forms, surrogates, code points above
+ * U+10FFFF and truncated or stray continuation bytes. The transcoders
+ * validate their input first and copy 16-byte ASCII blocks with vector
+ * widening; other blocks fall back to a scalar decoder.
+ */
+
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// returns 1 if the len bytes at in are valid UTF-8, 0 otherwise
+int utf8_validate(const uint8_t *in, size_t len);
+
+// returns 1 if all len bytes are below 0x80
+int utf8_is_ascii(const uint8_t *in, size_t len);
+
+// transcodes to UTF-16 (native byte order, out needs len units), returns
+// the number of units written or 0 for invalid input
+size_t utf8_to_utf16(const uint8_t *in, size_t len, uint16_t *out);
+
+// transcodes to Latin-1 (out needs len bytes), returns the number of bytes
+// written or 0 for invalid input or code points above U+00FF
+size_t utf8_to_latin1(const uint8_t *in, size_t len, uint8_t *out);
+
+#endif
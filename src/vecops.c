@@ -0,0 +1,145 @@
+/* Element-wise arithmetic, compare, shift and logic kernels on buffers of
+ * 8/16/32-Bit signed and unsigned integers and single precision floats
+ * using ARM NEON
+ *
+ * Every kernel is one of the loop macros below instantiated with an
+ * intrinsic; the tails run through zero padded copies, so every element
+ * sees the same instruction.
+ */
+
+#include <string.h>
+#include "arm_neon.h"
+#include "shift.h"
+#include "vecops.h"
+#include "neon_util.h"
+
+// out = expr(va, vb)
+#define KERNEL_2(name, s, out_type, store, expr) \
+    void name(const TYPE_##s *a, const TYPE_##s *b, size_t n, out_type *out) { \
+        TYPE_##s tail_a[LANES_##s], tail_b[LANES_##s]; \
+        out_type tail_out[LANES_##s]; \
+        VECTOR_##s va, vb; \
+        size_t i = 0; \
+        for(; i + LANES_##s <= n; i += LANES_##s) { \
+            va = vld1q_##s(a + i); \
+            vb = vld1q_##s(b + i); \
+            store(out + i, expr); \
+        } \
+        if(i < n) { \
+            memset(tail_a, 0, sizeof(tail_a)); \
+            memset(tail_b, 0, sizeof(tail_b)); \
+            memcpy(tail_a, a + i, (n - i) * sizeof(TYPE_##s)); \
+            memcpy(tail_b, b + i, (n - i) * sizeof(TYPE_##s)); \
+            va = vld1q_##s(tail_a); \
+            vb = vld1q_##s(tail_b); \
+            store(tail_out, expr); \
+            memcpy(out + i, tail_out, (n - i) * sizeof(out_type)); \
+        } \
+    }
+
+// out = expr(v), the body of the unary and shift kernels
+#define LOOP_1(s, expr) \
+    TYPE_##s tail[LANES_##s]; \
+    VECTOR_##s v; \
+    size_t i = 0; \
+    for(; i + LANES_##s <= n; i += LANES_##s) { \
+        v = vld1q_##s(in + i); \
+        vst1q_##s(out + i, expr); \
+    } \
+    if(i < n) { \
+        memset(tail, 0, sizeof(tail)); \
+        memcpy(tail, in + i, (n - i) * sizeof(TYPE_##s)); \
+        v = vld1q_##s(tail); \
+        vst1q_##s(tail, expr); \
+        memcpy(out + i, tail, (n - i) * sizeof(TYPE_##s)); \
+    }
+
+#define BINARY(op, s, intrinsic) \
+    KERNEL_2(vec_##op##_##s, s, TYPE_##s, vst1q_##s, intrinsic##_##s(va, vb))
+
+#define COMPARE(op, s, intrinsic) \
+    KERNEL_2(vec_##op##_##s, s, CAT(TYPE_, MASK_##s), CAT(vst1q_, MASK_##s), intrinsic##_##s(va, vb))
+
+#define UNARY(op, s, intrinsic) \
+    void vec_##op##_##s(const TYPE_##s *in, size_t n, TYPE_##s *out) { \
+        LOOP_1(s, intrinsic##_##s(v)) \
+    }
+
+// the shift kernels of shift.c, with immediate shifts where it has them
+#define SHIFT(op, s, mode) \
+    void vec_##op##_##s(const TYPE_##s *in, size_t n, int shift, TYPE_##s *out) { \
+        shift_##s(in, n, shift, mode, out); \
+    }
+
+// v: vector
+// padd: pairwise addition of neighbouring lanes (d registers only), the low
+// and high half of a q register give the pair sums of all its lanes
+#define PAIRWISE(s) \
+    void vec_padd_##s(const TYPE_##s *in, size_t n, TYPE_##s *out) { \
+        TYPE_##s tail[LANES_##s]; \
+        VECTOR_##s v; \
+        size_t i = 0; \
+        for(; i + LANES_##s <= n; i += LANES_##s) { \
+            v = vld1q_##s(in + i); \
+            vst1_##s(out + i / 2, vpadd_##s(vget_low_##s(v), vget_high_##s(v))); \
+        } \
+        if(i < n) { \
+            memset(tail, 0, sizeof(tail)); \
+            memcpy(tail, in + i, (n - i) * sizeof(TYPE_##s)); \
+            v = vld1q_##s(tail); \
+            vst1_##s(tail, vpadd_##s(vget_low_##s(v), vget_high_##s(v))); \
+            memcpy(out + i / 2, tail, (n - i + 1) / 2 * sizeof(TYPE_##s)); \
+        } \
+    }
+
+#define DEFINE_COMMON(s) \
+    BINARY(add, s, vaddq) \
+    BINARY(sub, s, vsubq) \
+    BINARY(mul, s, vmulq) \
+    BINARY(min, s, vminq) \
+    BINARY(max, s, vmaxq) \
+    BINARY(abd, s, vabdq) \
+    COMPARE(cmpeq, s, vceqq) \
+    COMPARE(cmpgt, s, vcgtq) \
+    COMPARE(cmpge, s, vcgeq) \
+    PAIRWISE(s)
+
+#define DEFINE_INT(s) \
+    DEFINE_COMMON(s) \
+    BINARY(qadd, s, vqaddq) \
+    BINARY(qsub, s, vqsubq) \
+    BINARY(hadd, s, vhaddq) \
+    BINARY(rhadd, s, vrhaddq) \
+    BINARY(hsub, s, vhsubq) \
+    BINARY(and, s, vandq) \
+    BINARY(or, s, vorrq) \
+    BINARY(xor, s, veorq) \
+    BINARY(bic, s, vbicq) \
+    SHIFT(shl, s, SHIFT_PLAIN) \
+    SHIFT(rshl, s, SHIFT_ROUNDING) \
+    SHIFT(qshl, s, SHIFT_SATURATING)
+
+#define DEFINE_SIGNED(s) \
+    UNARY(abs, s, vabsq) \
+    UNARY(neg, s, vnegq)
+
+#define DEFINE_SATURATING_SIGNED(s) \
+    UNARY(qabs, s, vqabsq) \
+    UNARY(qneg, s, vqnegq)
+
+DEFINE_INT(u8)
+DEFINE_INT(s8)
+DEFINE_INT(u16)
+DEFINE_INT(s16)
+DEFINE_INT(u32)
+DEFINE_INT(s32)
+DEFINE_COMMON(f32)
+
+DEFINE_SIGNED(s8)
+DEFINE_SIGNED(s16)
+DEFINE_SIGNED(s32)
+DEFINE_SIGNED(f32)
+
+DEFINE_SATURATING_SIGNED(s8)
+DEFINE_SATURATING_SIGNED(s16)
+DEFINE_SATURATING_SIGNED(s32)
@@ -0,0 +1,87 @@
+/* Element-wise arithmetic, compare, shift and logic kernels on buffers of
+ * 8/16/32-Bit signed and unsigned integers and single precision floats
+ * using ARM NEON
+ *
+ * The functions are generated for every lane type by the macros below and
+ * named vec_<op>_<suffix> after the intrinsics, e.g. vec_qadd_s16() applies
+ * vqaddq_s16 to a whole buffer. Suffixes: u8 s8 u16 s16 u32 s32 (all
+ * integer ops) and f32 (arithmetic, min/max, compares, pairwise, abs/neg).
+ *
+ * a, b, in and out may alias as long as they are identical. Compare results
+ * are all-ones/zero masks of the unsigned type of the same width.
+ */
+
+#ifndef VECOPS_H
+#define VECOPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define VECOPS_BINARY(op, s, type) \
+    void vec_##op##_##s(const type *a, const type *b, size_t n, type *out);
+
+#define VECOPS_COMPARE(op, s, type, mask_type) \
+    void vec_##op##_##s(const type *a, const type *b, size_t n, mask_type *out);
+
+// operations common to all lane types:
+// add, sub, mul, min, max, abd (absolute difference), compares a == b,
+// a > b, a >= b, and padd: out[i] = in[2i] + in[2i + 1] for (n + 1) / 2
+// outputs (an odd last element is passed through)
+#define VECOPS_DECLARE_COMMON(s, type, mask_type) \
+    VECOPS_BINARY(add, s, type) \
+    VECOPS_BINARY(sub, s, type) \
+    VECOPS_BINARY(mul, s, type) \
+    VECOPS_BINARY(min, s, type) \
+    VECOPS_BINARY(max, s, type) \
+    VECOPS_BINARY(abd, s, type) \
+    VECOPS_COMPARE(cmpeq, s, type, mask_type) \
+    VECOPS_COMPARE(cmpgt, s, type, mask_type) \
+    VECOPS_COMPARE(cmpge, s, type, mask_type) \
+    void vec_padd_##s(const type *in, size_t n, type *out);
+
+// integer only: saturating add/sub, halving add/sub ((a + b) >> 1), rounding
+// halving add ((a + b + 1) >> 1), bitwise and, or, xor, and-not (a & ~b) and
+// the shifts by a signed count (left, or right if negative): plain, rounding
+// and saturating, which are the shift_<suffix>() kernels of shift.h
+#define VECOPS_DECLARE_INT(s, type, mask_type) \
+    VECOPS_DECLARE_COMMON(s, type, mask_type) \
+    VECOPS_BINARY(qadd, s, type) \
+    VECOPS_BINARY(qsub, s, type) \
+    VECOPS_BINARY(hadd, s, type) \
+    VECOPS_BINARY(rhadd, s, type) \
+    VECOPS_BINARY(hsub, s, type) \
+    VECOPS_BINARY(and, s, type) \
+    VECOPS_BINARY(or, s, type) \
+    VECOPS_BINARY(xor, s, type) \
+    VECOPS_BINARY(bic, s, type) \
+    void vec_shl_##s(const type *in, size_t n, int shift, type *out); \
+    void vec_rshl_##s(const type *in, size_t n, int shift, type *out); \
+    void vec_qshl_##s(const type *in, size_t n, int shift, type *out);
+
+// signed and float: absolute value and negation, wrapping for integers
+#define VECOPS_DECLARE_SIGNED(s, type) \
+    void vec_abs_##s(const type *in, size_t n, type *out); \
+    void vec_neg_##s(const type *in, size_t n, type *out);
+
+VECOPS_DECLARE_INT(u8, uint8_t, uint8_t)
+VECOPS_DECLARE_INT(s8, int8_t, uint8_t)
+VECOPS_DECLARE_INT(u16, uint16_t, uint16_t)
+VECOPS_DECLARE_INT(s16, int16_t, uint16_t)
+VECOPS_DECLARE_INT(u32, uint32_t, uint32_t)
+VECOPS_DECLARE_INT(s32, int32_t, uint32_t)
+VECOPS_DECLARE_COMMON(f32, float, uint32_t)
+
+VECOPS_DECLARE_SIGNED(s8, int8_t)
+VECOPS_DECLARE_SIGNED(s16, int16_t)
+VECOPS_DECLARE_SIGNED(s32, int32_t)
+VECOPS_DECLARE_SIGNED(f32, float)
+
+// saturating absolute value and negation (the minimum maps to the maximum)
+void vec_qabs_s8(const int8_t *in, size_t n, int8_t *out);
+void vec_qabs_s16(const int16_t *in, size_t n, int16_t *out);
+void vec_qabs_s32(const int32_t *in, size_t n, int32_t *out);
+void vec_qneg_s8(const int8_t *in, size_t n, int8_t *out);
+void vec_qneg_s16(const int16_t *in, size_t n, int16_t *out);
+void vec_qneg_s32(const int32_t *in, size_t n, int32_t *out);
+
+#endif